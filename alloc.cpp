@@ -0,0 +1,132 @@
+#include "alloc.h"
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+thread_local long long alloc_thread_allocs = 0;
+thread_local long long alloc_thread_frees = 0;
+thread_local long long alloc_thread_bytes = 0;
+bool alloc_tracking()
+{
+#ifdef FLAPPY_ALLOC_TRACK
+    return true;
+#else
+    return false;
+#endif
+}
+AllocCounters alloc_counters()
+{
+    AllocCounters c;
+    c.allocs = alloc_thread_allocs;
+    c.frees = alloc_thread_frees;
+    c.bytes = alloc_thread_bytes;
+    return c;
+}
+void alloc_record(AllocStats& s, const AllocCounters& start)
+{
+    AllocCounters now = alloc_counters();
+    long long allocs = now.allocs - start.allocs;
+    ++s.frames;
+    s.frames_allocating += allocs > 0;
+    s.allocs += allocs;
+    s.bytes += now.bytes - start.bytes;
+    s.worst_allocs = allocs > s.worst_allocs ? allocs : s.worst_allocs;
+}
+#ifdef FLAPPY_ALLOC_TRACK
+void* alloc_take(std::size_t size, std::size_t align)
+{
+    ++alloc_thread_allocs;
+    alloc_thread_bytes += (long long)size;
+    size = size == 0 ? 1 : size;
+    void* p;
+#ifdef _WIN32
+    p = align > alignof(std::max_align_t) ? _aligned_malloc(size, align) : std::malloc(size);
+#else
+    p = align > alignof(std::max_align_t) ? std::aligned_alloc(align, (size + align - 1) / align * align) : std::malloc(size);
+#endif
+    return p;
+}
+void alloc_give(void* p, std::size_t align)
+{
+    if (p == nullptr)
+    {
+        return;
+    }
+    ++alloc_thread_frees;
+#ifdef _WIN32
+    if (align > alignof(std::max_align_t))
+    {
+        _aligned_free(p);
+        return;
+    }
+#else
+    (void)align;
+#endif
+    std::free(p);
+}
+void* operator new(std::size_t size)
+{
+    void* p = alloc_take(size, 0);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return alloc_take(size, 0);
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return alloc_take(size, 0);
+}
+void* operator new(std::size_t size, std::align_val_t align)
+{
+    void* p = alloc_take(size, (std::size_t)align);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+void* operator new[](std::size_t size, std::align_val_t align)
+{
+    return operator new(size, align);
+}
+void operator delete(void* p) noexcept
+{
+    alloc_give(p, 0);
+}
+void operator delete[](void* p) noexcept
+{
+    alloc_give(p, 0);
+}
+void operator delete(void* p, std::size_t) noexcept
+{
+    alloc_give(p, 0);
+}
+void operator delete[](void* p, std::size_t) noexcept
+{
+    alloc_give(p, 0);
+}
+void operator delete(void* p, std::align_val_t align) noexcept
+{
+    alloc_give(p, (std::size_t)align);
+}
+void operator delete[](void* p, std::align_val_t align) noexcept
+{
+    alloc_give(p, (std::size_t)align);
+}
+void operator delete(void* p, std::size_t, std::align_val_t align) noexcept
+{
+    alloc_give(p, (std::size_t)align);
+}
+void operator delete[](void* p, std::size_t, std::align_val_t align) noexcept
+{
+    alloc_give(p, (std::size_t)align);
+}
+#endif
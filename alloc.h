@@ -0,0 +1,18 @@
+#pragma once
+struct AllocCounters
+{
+    long long allocs = 0;
+    long long frees = 0;
+    long long bytes = 0;
+};
+struct AllocStats
+{
+    long long frames = 0;
+    long long frames_allocating = 0;
+    long long allocs = 0;
+    long long bytes = 0;
+    long long worst_allocs = 0;
+};
+bool alloc_tracking();
+AllocCounters alloc_counters();
+void alloc_record(AllocStats& s, const AllocCounters& start);
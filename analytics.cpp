@@ -0,0 +1,540 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "simulation.h"
+#include "telemetry.h"
+#include "flightrec.h"
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace std;
+const int analytics_max_score = 256;
+const int analytics_interval_bins = 64;
+const int analytics_height_rows = 16;
+const int analytics_causes = 5;
+struct MappedLog
+{
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
+struct LogBlock
+{
+    int file;
+    const unsigned char* data;
+    unsigned int count;
+};
+struct FlapMark
+{
+    int file = -1;
+    unsigned int run = 0;
+    unsigned int tick = 0;
+    int difficulty = 0;
+};
+struct AnalyticsTotals
+{
+    long long events = 0;
+    long long runs[2] = {};
+    long long flaps[2] = {};
+    long long scores[2] = {};
+    long long deaths[2] = {};
+    long long run_scores[2][analytics_max_score + 1] = {};
+    long long death_heat[2][analytics_height_rows][analytics_causes] = {};
+    long long flap_intervals[2][analytics_interval_bins] = {};
+    long long flap_interval_total[2] = {};
+    FlapMark first_flap;
+    FlapMark last_flap;
+};
+bool map_log(const char* path, MappedLog& log);
+void unmap_log(MappedLog& log);
+bool index_blocks(const MappedLog& log, int file, vector<LogBlock>& blocks);
+void add_flap_interval(AnalyticsTotals& t, int difficulty, unsigned int interval);
+void reduce_blocks(const LogBlock* blocks, int count, AnalyticsTotals& t);
+void merge_totals(AnalyticsTotals& into, const AnalyticsTotals& from);
+void print_survival(const AnalyticsTotals& t, int d);
+void print_death_heatmap(const AnalyticsTotals& t, int d);
+void print_flap_timing(const AnalyticsTotals& t, int d);
+void print_flight_inputs(const FlightDump& dump, unsigned int frame, size_t& next);
+bool print_flight_timeline(const char* path);
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        cout << "usage: Flappy-Analytics [-j threads] telemetry_*.fbt ..." << endl;
+        cout << "       Flappy-Analytics --flight flight_*.ffr ..." << endl;
+        return 1;
+    }
+    if (strcmp(argv[1], "--flight") == 0)
+    {
+        bool ok = argc > 2;
+        for (int i = 2; i < argc; ++i)
+        {
+            ok = print_flight_timeline(argv[i]) && ok;
+        }
+        return ok ? 0 : 1;
+    }
+    int num_threads = (int)thread::hardware_concurrency();
+    int first_path = 1;
+    if (argc > 3 && strcmp(argv[1], "-j") == 0)
+    {
+        num_threads = atoi(argv[2]);
+        first_path = 3;
+    }
+    num_threads = num_threads < 1 ? 1 : num_threads;
+    auto start = chrono::steady_clock::now();
+    vector<MappedLog> logs(argc - first_path);
+    vector<LogBlock> blocks;
+    size_t total_bytes = 0;
+    for (int i = first_path; i < argc; ++i)
+    {
+        MappedLog& log = logs[i - first_path];
+        if (!map_log(argv[i], log) || !index_blocks(log, i - first_path, blocks))
+        {
+            cout << "skipping " << argv[i] << ": not a telemetry log" << endl;
+            continue;
+        }
+        total_bytes += log.size;
+    }
+    int chunks = num_threads < (int)blocks.size() ? num_threads : (int)blocks.size();
+    vector<AnalyticsTotals> partials(chunks > 0 ? chunks : 1);
+    vector<thread> workers;
+    for (int c = 0; c < chunks; ++c)
+    {
+        int begin = (int)((long long)blocks.size() * c / chunks);
+        int end = (int)((long long)blocks.size() * (c + 1) / chunks);
+        workers.emplace_back(reduce_blocks, blocks.data() + begin, end - begin, ref(partials[c]));
+    }
+    for (thread& worker : workers)
+    {
+        worker.join();
+    }
+    AnalyticsTotals totals;
+    for (int c = 0; c < chunks; ++c)
+    {
+        merge_totals(totals, partials[c]);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    for (MappedLog& log : logs)
+    {
+        unmap_log(log);
+    }
+    for (int d = EASY; d <= HARD; ++d)
+    {
+        cout << endl << (d == EASY ? "=== EASY ===" : "=== HARD ===") << endl;
+        cout << totals.runs[d] << " runs, " << totals.flaps[d] << " flaps, " << totals.scores[d] << " pipes passed, " << totals.deaths[d] << " deaths" << endl;
+        if (totals.runs[d] == 0)
+        {
+            continue;
+        }
+        print_survival(totals, d);
+        print_death_heatmap(totals, d);
+        print_flap_timing(totals, d);
+    }
+    cout << endl << totals.events << " events, " << total_bytes << " bytes in " << seconds * 1000.0 << " ms on " << (chunks > 0 ? chunks : 1) << " threads: "
+         << (long long)(totals.events / seconds) << " events/s, " << total_bytes / seconds / 1e6 << " MB/s" << endl;
+    return 0;
+}
+bool map_log(const char* path, MappedLog& log)
+{
+#ifdef _WIN32
+    log.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (log.file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(log.file, &size);
+    log.size = (size_t)size.QuadPart;
+    if (log.size == 0)
+    {
+        return false;
+    }
+    log.mapping = CreateFileMappingA(log.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (log.mapping == nullptr)
+    {
+        return false;
+    }
+    log.data = (const unsigned char*)MapViewOfFile(log.mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+    log.size = (size_t)st.st_size;
+    void* data = mmap(nullptr, log.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    madvise(data, log.size, MADV_SEQUENTIAL);
+    log.data = (const unsigned char*)data;
+#endif
+    return log.data != nullptr;
+}
+void unmap_log(MappedLog& log)
+{
+#ifdef _WIN32
+    if (log.data != nullptr)
+    {
+        UnmapViewOfFile(log.data);
+    }
+    if (log.mapping != nullptr)
+    {
+        CloseHandle(log.mapping);
+    }
+    if (log.file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(log.file);
+    }
+#else
+    if (log.data != nullptr)
+    {
+        munmap((void*)log.data, log.size);
+    }
+#endif
+    log.data = nullptr;
+}
+bool index_blocks(const MappedLog& log, int file, vector<LogBlock>& blocks)
+{
+    if (log.size < 8 || memcmp(log.data, "FBTL", 4) != 0)
+    {
+        return false;
+    }
+    size_t offset = 8;
+    while (offset + 4 <= log.size)
+    {
+        unsigned int count;
+        memcpy(&count, log.data + offset, 4);
+        size_t block_bytes = 4 + (size_t)count * telemetry_event_bytes;
+        if (count == 0 || offset + block_bytes > log.size)
+        {
+            break;
+        }
+        blocks.push_back({ file, log.data + offset + 4, count });
+        offset += block_bytes;
+    }
+    return true;
+}
+void add_flap_interval(AnalyticsTotals& t, int difficulty, unsigned int interval)
+{
+    int bin = interval < (unsigned)analytics_interval_bins ? (int)interval : analytics_interval_bins - 1;
+    ++t.flap_intervals[difficulty][bin];
+    t.flap_interval_total[difficulty] += interval;
+}
+void reduce_blocks(const LogBlock* blocks, int count, AnalyticsTotals& t)
+{
+    for (int b = 0; b < count; ++b)
+    {
+        const LogBlock& block = blocks[b];
+        unsigned int n = block.count;
+        const unsigned char* types = block.data;
+        const unsigned char* difficulties = types + n;
+        const unsigned char* runs = difficulties + n;
+        const unsigned char* ticks = runs + (size_t)n * 4;
+        const unsigned char* values = ticks + (size_t)n * 4;
+        const unsigned char* ys = values + (size_t)n * 4;
+        t.events += n;
+        for (unsigned int i = 0; i < n; ++i)
+        {
+            int d = difficulties[i] == HARD ? HARD : EASY;
+            switch (types[i])
+            {
+            case EVENT_RUN_START:
+                ++t.runs[d];
+                break;
+            case EVENT_FLAP:
+            {
+                FlapMark mark;
+                mark.file = block.file;
+                mark.difficulty = d;
+                memcpy(&mark.run, runs + (size_t)i * 4, 4);
+                memcpy(&mark.tick, ticks + (size_t)i * 4, 4);
+                ++t.flaps[d];
+                if (t.first_flap.file < 0)
+                {
+                    t.first_flap = mark;
+                }
+                else if (t.last_flap.file == mark.file && t.last_flap.run == mark.run && mark.tick > t.last_flap.tick)
+                {
+                    add_flap_interval(t, d, mark.tick - t.last_flap.tick);
+                }
+                t.last_flap = mark;
+                break;
+            }
+            case EVENT_SCORE:
+                ++t.scores[d];
+                break;
+            case EVENT_DEATH:
+            {
+                int cause;
+                float y;
+                memcpy(&cause, values + (size_t)i * 4, 4);
+                memcpy(&y, ys + (size_t)i * 4, 4);
+                int row = (int)(y * analytics_height_rows / height);
+                row = row < 0 ? 0 : (row >= analytics_height_rows ? analytics_height_rows - 1 : row);
+                cause = cause < 0 || cause >= analytics_causes ? HIT_NONE : cause;
+                ++t.deaths[d];
+                ++t.death_heat[d][row][cause];
+                break;
+            }
+            case EVENT_RUN_END:
+            {
+                int score;
+                memcpy(&score, values + (size_t)i * 4, 4);
+                score = score < 0 ? 0 : (score > analytics_max_score ? analytics_max_score : score);
+                ++t.run_scores[d][score];
+                break;
+            }
+            }
+        }
+    }
+}
+void merge_totals(AnalyticsTotals& into, const AnalyticsTotals& from)
+{
+    if (from.first_flap.file >= 0 && into.last_flap.file == from.first_flap.file && into.last_flap.run == from.first_flap.run
+        && from.first_flap.tick > into.last_flap.tick)
+    {
+        add_flap_interval(into, from.first_flap.difficulty, from.first_flap.tick - into.last_flap.tick);
+    }
+    if (into.first_flap.file < 0)
+    {
+        into.first_flap = from.first_flap;
+    }
+    if (from.last_flap.file >= 0)
+    {
+        into.last_flap = from.last_flap;
+    }
+    into.events += from.events;
+    for (int d = EASY; d <= HARD; ++d)
+    {
+        into.runs[d] += from.runs[d];
+        into.flaps[d] += from.flaps[d];
+        into.scores[d] += from.scores[d];
+        into.deaths[d] += from.deaths[d];
+        into.flap_interval_total[d] += from.flap_interval_total[d];
+        for (int s = 0; s <= analytics_max_score; ++s)
+        {
+            into.run_scores[d][s] += from.run_scores[d][s];
+        }
+        for (int r = 0; r < analytics_height_rows; ++r)
+        {
+            for (int c = 0; c < analytics_causes; ++c)
+            {
+                into.death_heat[d][r][c] += from.death_heat[d][r][c];
+            }
+        }
+        for (int i = 0; i < analytics_interval_bins; ++i)
+        {
+            into.flap_intervals[d][i] += from.flap_intervals[d][i];
+        }
+    }
+}
+void print_survival(const AnalyticsTotals& t, int d)
+{
+    long long ended = 0;
+    int best = 0;
+    for (int s = 0; s <= analytics_max_score; ++s)
+    {
+        ended += t.run_scores[d][s];
+        best = t.run_scores[d][s] > 0 ? s : best;
+    }
+    if (ended == 0)
+    {
+        return;
+    }
+    cout << "survival by pipe index (share of runs that passed pipe N):" << endl;
+    long long reached = ended;
+    for (int s = 1; s <= best && s <= 40; ++s)
+    {
+        reached -= t.run_scores[d][s - 1];
+        double share = (double)reached / ended;
+        cout << "  pipe " << setw(3) << s << "  " << fixed << setprecision(3) << share << "  " << string((size_t)(share * 40 + 0.5), '#') << endl;
+    }
+    cout.unsetf(ios::fixed);
+    cout << setprecision(6);
+}
+void print_death_heatmap(const AnalyticsTotals& t, int d)
+{
+    const char* shades = " .:-=+*#%@";
+    long long peak = 0;
+    for (int r = 0; r < analytics_height_rows; ++r)
+    {
+        for (int c = 1; c < analytics_causes; ++c)
+        {
+            peak = t.death_heat[d][r][c] > peak ? t.death_heat[d][r][c] : peak;
+        }
+    }
+    if (peak == 0)
+    {
+        return;
+    }
+    cout << "death heatmap (bird height vs cause):" << endl;
+    cout << "     y   ceiling  floor  top-pipe  bottom-pipe" << endl;
+    int row_px = height / analytics_height_rows;
+    for (int r = 0; r < analytics_height_rows; ++r)
+    {
+        cout << "  " << setw(4) << r * row_px << "   ";
+        for (int c = 1; c < analytics_causes; ++c)
+        {
+            long long n = t.death_heat[d][r][c];
+            int shade = n == 0 ? 0 : 1 + (int)(8 * n / peak);
+            cout << "  " << shades[shade] << " " << setw(6) << n;
+        }
+        cout << endl;
+    }
+}
+void print_flap_timing(const AnalyticsTotals& t, int d)
+{
+    long long count = 0;
+    long long peak = 0;
+    for (int i = 0; i < analytics_interval_bins; ++i)
+    {
+        count += t.flap_intervals[d][i];
+        peak = t.flap_intervals[d][i] > peak ? t.flap_intervals[d][i] : peak;
+    }
+    if (count == 0)
+    {
+        return;
+    }
+    cout << "flap timing (ticks between flaps, mean " << (double)t.flap_interval_total[d] / count << "):" << endl;
+    long long seen = 0;
+    int median = 0;
+    int p90 = 0;
+    for (int i = 0; i < analytics_interval_bins; ++i)
+    {
+        seen += t.flap_intervals[d][i];
+        median = seen * 2 < count ? i + 1 : median;
+        p90 = seen * 10 < count * 9 ? i + 1 : p90;
+        if (t.flap_intervals[d][i] > 0)
+        {
+            cout << "  " << setw(3) << i << (i == analytics_interval_bins - 1 ? "+ " : "  ") << setw(8) << t.flap_intervals[d][i] << "  "
+                 << string((size_t)(40 * t.flap_intervals[d][i] / peak), '#') << endl;
+        }
+    }
+    cout << "  median " << median << " ticks, p90 " << p90 << " ticks" << endl;
+}
+void print_flight_inputs(const FlightDump& dump, unsigned int frame, size_t& next)
+{
+    while (next < dump.inputs.size() && dump.inputs[next].frame < frame)
+    {
+        ++next;
+    }
+    const char* separator = "  ";
+    while (next < dump.inputs.size() && dump.inputs[next].frame == frame)
+    {
+        const FlightInput& in = dump.inputs[next++];
+        cout << separator << flight_input_name(in.type);
+        if (in.type == FLIGHT_KEY_DOWN || in.type == FLIGHT_KEY_UP)
+        {
+            cout << " " << in.code;
+        }
+        else if (in.type == FLIGHT_MOUSE_DOWN || in.type == FLIGHT_MOUSE_UP)
+        {
+            cout << " " << in.code << " at " << in.x << "," << in.y;
+        }
+        else if (in.type == FLIGHT_RESIZED)
+        {
+            cout << " " << in.x << "x" << in.y;
+        }
+        separator = ", ";
+    }
+}
+bool print_flight_timeline(const char* path)
+{
+    FlightDump dump;
+    if (!flight_load(path, dump))
+    {
+        cout << path << ": not a flight recorder dump" << endl;
+        return false;
+    }
+    const FlightHeader& h = dump.header;
+    cout << path << ": ";
+    if (h.reason == FLIGHT_HITCH)
+    {
+        cout << "hitch on frame " << h.detail;
+    }
+    else if (h.reason == FLIGHT_SIGNAL)
+    {
+        cout << "fatal signal " << h.detail;
+    }
+    else
+    {
+        cout << "requested on frame " << h.detail;
+    }
+    cout << ", frame budget " << h.budget_ms << " ms" << endl;
+    if (dump.frames.empty())
+    {
+        cout << "  no frames recorded" << endl;
+        return true;
+    }
+    const FlightFrame& last = dump.frames.back();
+    double span = last.start - dump.frames.front().start;
+    double phase_total[FLIGHT_PHASES] = {};
+    float phase_worst[FLIGHT_PHASES] = {};
+    int over = 0;
+    for (const FlightFrame& f : dump.frames)
+    {
+        float total = 0.f;
+        for (int p = 0; p < FLIGHT_PHASES; ++p)
+        {
+            phase_total[p] += f.phase_us[p];
+            phase_worst[p] = f.phase_us[p] > phase_worst[p] ? f.phase_us[p] : phase_worst[p];
+            total += f.phase_us[p];
+        }
+        over += total > h.budget_ms * 1000.f;
+    }
+    cout << "  " << dump.frames.size() << " frames over " << fixed << setprecision(2) << span << " s, " << dump.inputs.size() << " inputs, " << over
+         << " frames over budget" << endl;
+    cout << "  phase ms (mean / worst):";
+    for (int p = 0; p < FLIGHT_PHASES; ++p)
+    {
+        cout << "  " << flight_phase_name(p) << " " << setprecision(3) << phase_total[p] / dump.frames.size() / 1000.0 << " / " << phase_worst[p] / 1000.0;
+    }
+    cout << endl << endl;
+    cout << "      time   frame  state            tick  score  world     events  update    draw    wait  present    total  flags  inputs" << endl;
+    size_t next_input = 0;
+    int last_state = -1;
+    for (const FlightFrame& f : dump.frames)
+    {
+        float total = 0.f;
+        for (int p = 0; p < FLIGHT_PHASES; ++p)
+        {
+            total += f.phase_us[p];
+        }
+        const char* state = f.state < h.state_count ? h.state_names[f.state] : "?";
+        cout << (total > h.budget_ms * 1000.f ? "! " : (f.state != last_state ? "> " : "  ")) << setw(8) << setprecision(3) << f.start - last.start << "  "
+             << setw(6) << f.frame << "  " << left << setw(16) << state << right << setw(5) << f.tick << "  " << setw(5) << f.score << "  " << hex << setfill('0')
+             << setw(8) << f.world_hash << dec << setfill(' ') << setprecision(2);
+        for (int p = 0; p < FLIGHT_PHASES; ++p)
+        {
+            cout << setw(8) << f.phase_us[p] / 1000.0;
+        }
+        cout << setw(9) << total / 1000.0 << "  " << ((f.flags & FLIGHT_AUTOPILOT) ? 'A' : '-') << ((f.flags & FLIGHT_ATTRACT) ? 'D' : '-')
+             << ((f.flags & FLIGHT_CAPTURE) ? 'C' : '-') << ((f.flags & FLIGHT_STARTED) ? 'S' : '-');
+        print_flight_inputs(dump, f.frame, next_input);
+        cout << endl;
+        last_state = f.state;
+    }
+    cout << defaultfloat << setprecision(6) << endl;
+    return true;
+}
@@ -0,0 +1,85 @@
+#include "anim.h"
+using namespace std;
+bool anim_pack_sheet(SpriteSheet& sheet, const int* w, const int* h, int count, int max_size, int padding)
+{
+    sheet.frames.clear();
+    sheet.width = 0;
+    sheet.height = 0;
+    int x = padding;
+    int y = padding;
+    int row_h = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        if (w[i] + 2 * padding > max_size)
+        {
+            return false;
+        }
+        if (x + w[i] + padding > max_size)
+        {
+            x = padding;
+            y += row_h + padding;
+            row_h = 0;
+        }
+        sheet.frames.push_back({ x, y, w[i], h[i] });
+        x += w[i] + padding;
+        if (h[i] > row_h)
+        {
+            row_h = h[i];
+        }
+        if (x > sheet.width)
+        {
+            sheet.width = x;
+        }
+    }
+    sheet.height = y + row_h + padding;
+    return sheet.height <= max_size;
+}
+AnimClip anim_make_clip(const int* frames, int count, float frame_time, bool loop)
+{
+    AnimClip clip;
+    clip.frame_count = count < anim_max_frames ? count : anim_max_frames;
+    for (int i = 0; i < clip.frame_count; ++i)
+    {
+        clip.frames[i] = frames[i];
+    }
+    clip.frame_time = frame_time > 0.f ? frame_time : 1.f;
+    clip.loop = loop;
+    return clip;
+}
+int anim_clip_frame(const AnimClip& clip, float time)
+{
+    if (clip.frame_count <= 0)
+    {
+        return 0;
+    }
+    int index = time > 0.f ? (int)(time / clip.frame_time) : 0;
+    if (clip.loop)
+    {
+        index %= clip.frame_count;
+    }
+    else if (index >= clip.frame_count)
+    {
+        index = clip.frame_count - 1;
+    }
+    return clip.frames[index];
+}
+bool anim_clip_done(const AnimClip& clip, float time)
+{
+    return !clip.loop && time >= clip.frame_time * clip.frame_count;
+}
+void anim_play(AnimPlayer& player, const AnimClip& clip, float now)
+{
+    if (player.clip != &clip)
+    {
+        anim_restart(player, clip, now);
+    }
+}
+void anim_restart(AnimPlayer& player, const AnimClip& clip, float now)
+{
+    player.clip = &clip;
+    player.start = now;
+}
+int anim_frame(const AnimPlayer& player, float now)
+{
+    return player.clip ? anim_clip_frame(*player.clip, now - player.start) : 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+const int anim_max_frames = 32;
+struct AnimRect
+{
+    int left;
+    int top;
+    int width;
+    int height;
+};
+struct SpriteSheet
+{
+    int width = 0;
+    int height = 0;
+    std::vector<AnimRect> frames;
+};
+struct AnimClip
+{
+    int frames[anim_max_frames];
+    int frame_count = 0;
+    float frame_time = 1.f;
+    bool loop = false;
+};
+struct AnimPlayer
+{
+    const AnimClip* clip = nullptr;
+    float start = 0.f;
+};
+bool anim_pack_sheet(SpriteSheet& sheet, const int* w, const int* h, int count, int max_size, int padding);
+AnimClip anim_make_clip(const int* frames, int count, float frame_time, bool loop);
+int anim_clip_frame(const AnimClip& clip, float time);
+bool anim_clip_done(const AnimClip& clip, float time);
+void anim_play(AnimPlayer& player, const AnimClip& clip, float now);
+void anim_restart(AnimPlayer& player, const AnimClip& clip, float now);
+int anim_frame(const AnimPlayer& player, float now);
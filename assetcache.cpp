@@ -0,0 +1,470 @@
+#include "assetcache.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace std;
+const char assetcache_magic[4] = { 'F', 'B', 'A', 'C' };
+const int assetcache_poll_ms = 5;
+const long long assetcache_alignment = 64;
+struct AssetCacheHeader
+{
+    char magic[4];
+    int version;
+    unsigned int stamp;
+    int entry_count;
+    long long bytes;
+    atomic<int> ready;
+    atomic<int> users;
+    AssetEntry entries[assetcache_max_entries];
+};
+string assetcache_name;
+int assetcache_current = ASSETCACHE_LOCAL;
+unsigned int assetcache_current_stamp = 0;
+AssetCacheHeader* assetcache_header = nullptr;
+const unsigned char* assetcache_view = nullptr;
+size_t assetcache_view_size = 0;
+vector<AssetEntry> assetcache_pending;
+vector<unsigned char> assetcache_pending_data;
+double assetcache_waited = 0.0;
+#ifdef _WIN32
+HANDLE assetcache_mapping = nullptr;
+HANDLE assetcache_lock = nullptr;
+#else
+int assetcache_fd = -1;
+#endif
+long long assetcache_align(long long v, long long a)
+{
+    return (v + a - 1) / a * a;
+}
+unsigned int assetcache_mix(unsigned int h, const void* data, size_t bytes)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+unsigned int assetcache_stamp(const char* directory)
+{
+    vector<string> files;
+    error_code ec;
+    for (const filesystem::directory_entry& entry : filesystem::directory_iterator(directory, ec))
+    {
+        if (entry.is_regular_file(ec))
+        {
+            files.push_back(entry.path().filename().string());
+        }
+    }
+    sort(files.begin(), files.end());
+    unsigned int h = assetcache_mix(2166136261u, &assetcache_version, sizeof(assetcache_version));
+    for (const string& file : files)
+    {
+        filesystem::path path = filesystem::path(directory) / file;
+        long long size = (long long)filesystem::file_size(path, ec);
+        long long written = (long long)filesystem::last_write_time(path, ec).time_since_epoch().count();
+        h = assetcache_mix(h, file.c_str(), file.size() + 1);
+        h = assetcache_mix(h, &size, sizeof(size));
+        h = assetcache_mix(h, &written, sizeof(written));
+    }
+    return h;
+}
+void assetcache_unmap()
+{
+#ifdef _WIN32
+    if (assetcache_view != nullptr)
+    {
+        UnmapViewOfFile(assetcache_view);
+    }
+    if (assetcache_header != nullptr)
+    {
+        UnmapViewOfFile(assetcache_header);
+    }
+    if (assetcache_mapping != nullptr)
+    {
+        CloseHandle(assetcache_mapping);
+    }
+    assetcache_mapping = nullptr;
+#else
+    if (assetcache_view != nullptr)
+    {
+        munmap((void*)assetcache_view, assetcache_view_size);
+    }
+    if (assetcache_header != nullptr)
+    {
+        munmap(assetcache_header, sizeof(AssetCacheHeader));
+    }
+    if (assetcache_fd >= 0)
+    {
+        close(assetcache_fd);
+    }
+    assetcache_fd = -1;
+#endif
+    assetcache_view = nullptr;
+    assetcache_view_size = 0;
+    assetcache_header = nullptr;
+}
+void assetcache_remove()
+{
+#ifndef _WIN32
+    int fd = shm_open(assetcache_name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return;
+    }
+    struct stat named;
+    struct stat mine;
+    if (assetcache_fd >= 0 && fstat(fd, &named) == 0 && fstat(assetcache_fd, &mine) == 0 && named.st_dev == mine.st_dev && named.st_ino == mine.st_ino)
+    {
+        shm_unlink(assetcache_name.c_str());
+    }
+    close(fd);
+#endif
+}
+bool assetcache_map_views(size_t size)
+{
+#ifdef _WIN32
+    assetcache_header = (AssetCacheHeader*)MapViewOfFile(assetcache_mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(AssetCacheHeader));
+    assetcache_view = (const unsigned char*)MapViewOfFile(assetcache_mapping, FILE_MAP_READ, 0, 0, size);
+    if (assetcache_header == nullptr || assetcache_view == nullptr)
+    {
+        return false;
+    }
+#else
+    void* header = mmap(nullptr, sizeof(AssetCacheHeader), PROT_READ | PROT_WRITE, MAP_SHARED, assetcache_fd, 0);
+    void* view = mmap(nullptr, size, PROT_READ, MAP_SHARED, assetcache_fd, 0);
+    assetcache_header = header == MAP_FAILED ? nullptr : (AssetCacheHeader*)header;
+    assetcache_view = view == MAP_FAILED ? nullptr : (const unsigned char*)view;
+    if (assetcache_header == nullptr || assetcache_view == nullptr)
+    {
+        return false;
+    }
+#endif
+    assetcache_view_size = size;
+    return true;
+}
+bool assetcache_valid(unsigned int stamp)
+{
+    const AssetCacheHeader* h = assetcache_header;
+    return memcmp(h->magic, assetcache_magic, 4) == 0 && h->version == assetcache_version && h->stamp == stamp && h->entry_count >= 0 &&
+           h->entry_count <= assetcache_max_entries && h->bytes == (long long)assetcache_view_size;
+}
+int assetcache_open_existing(unsigned int stamp, double wait_seconds)
+{
+    double start = chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+    double waited = 0.0;
+    size_t size = 0;
+    while (true)
+    {
+#ifdef _WIN32
+        if (assetcache_header == nullptr)
+        {
+            MEMORY_BASIC_INFORMATION info;
+            AssetCacheHeader* header = (AssetCacheHeader*)MapViewOfFile(assetcache_mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, 0);
+            if (header != nullptr && VirtualQuery(header, &info, sizeof(info)) != 0)
+            {
+                size = (size_t)info.RegionSize;
+                assetcache_header = header;
+            }
+        }
+#else
+        struct stat st;
+        if (assetcache_header == nullptr && fstat(assetcache_fd, &st) == 0 && (size_t)st.st_size >= sizeof(AssetCacheHeader))
+        {
+            void* header = mmap(nullptr, sizeof(AssetCacheHeader), PROT_READ | PROT_WRITE, MAP_SHARED, assetcache_fd, 0);
+            if (header != MAP_FAILED)
+            {
+                size = (size_t)st.st_size;
+                assetcache_header = (AssetCacheHeader*)header;
+            }
+        }
+#endif
+        if (assetcache_header != nullptr && assetcache_header->ready.load(memory_order_acquire) != 0)
+        {
+            break;
+        }
+        waited = chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count() - start;
+        if (waited >= wait_seconds)
+        {
+            assetcache_remove();
+            assetcache_unmap();
+            return ASSETCACHE_LOCAL;
+        }
+        this_thread::sleep_for(chrono::milliseconds(assetcache_poll_ms));
+    }
+    assetcache_waited = waited;
+    size_t mapped = (size_t)assetcache_header->bytes;
+#ifdef _WIN32
+    UnmapViewOfFile(assetcache_header);
+    bool fits = mapped <= size;
+#else
+    munmap(assetcache_header, sizeof(AssetCacheHeader));
+    bool fits = mapped == size;
+#endif
+    assetcache_header = nullptr;
+    if (!fits || !assetcache_map_views(mapped))
+    {
+        assetcache_unmap();
+        return ASSETCACHE_LOCAL;
+    }
+    if (!assetcache_valid(stamp))
+    {
+        assetcache_remove();
+        assetcache_unmap();
+        return ASSETCACHE_LOCAL;
+    }
+    assetcache_header->users.fetch_add(1);
+    return ASSETCACHE_SHARED;
+}
+int assetcache_attach(const char* name, unsigned int stamp, double wait_seconds)
+{
+    assetcache_detach();
+    assetcache_current_stamp = stamp;
+    assetcache_waited = 0.0;
+#ifdef _WIN32
+    assetcache_name = string("Local\\") + name;
+    assetcache_lock = CreateMutexA(nullptr, FALSE, (assetcache_name + "_lock").c_str());
+    if (assetcache_lock == nullptr)
+    {
+        return assetcache_current = ASSETCACHE_LOCAL;
+    }
+    DWORD locked = WaitForSingleObject(assetcache_lock, (DWORD)(wait_seconds * 1000.0));
+    if (locked != WAIT_OBJECT_0 && locked != WAIT_ABANDONED)
+    {
+        CloseHandle(assetcache_lock);
+        assetcache_lock = nullptr;
+        return assetcache_current = ASSETCACHE_LOCAL;
+    }
+    assetcache_mapping = OpenFileMappingA(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, assetcache_name.c_str());
+    if (assetcache_mapping == nullptr)
+    {
+        return assetcache_current = ASSETCACHE_BUILD;
+    }
+    ReleaseMutex(assetcache_lock);
+    CloseHandle(assetcache_lock);
+    assetcache_lock = nullptr;
+#else
+    assetcache_name = string("/") + name;
+    assetcache_fd = shm_open(assetcache_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (assetcache_fd >= 0)
+    {
+        return assetcache_current = ASSETCACHE_BUILD;
+    }
+    assetcache_fd = shm_open(assetcache_name.c_str(), O_RDWR, 0);
+    if (assetcache_fd < 0)
+    {
+        return assetcache_current = ASSETCACHE_LOCAL;
+    }
+#endif
+    return assetcache_current = assetcache_open_existing(stamp, wait_seconds);
+}
+void assetcache_add(const char* name, int kind, int width, int height, int channels, int rate, const void* data, long long bytes, const AnimRect* rects, int rect_count)
+{
+    if (assetcache_current != ASSETCACHE_BUILD || (int)assetcache_pending.size() >= assetcache_max_entries || bytes < 0 || rect_count < 0)
+    {
+        return;
+    }
+    AssetEntry e;
+    memset(&e, 0, sizeof(e));
+    strncpy(e.name, name, assetcache_name_bytes - 1);
+    e.kind = kind;
+    e.width = width;
+    e.height = height;
+    e.channels = channels;
+    e.rate = rate;
+    e.rect_count = rect_count;
+    e.offset = (long long)assetcache_pending_data.size();
+    e.bytes = bytes;
+    long long rect_at = e.offset + assetcache_align(bytes, 16);
+    assetcache_pending_data.resize((size_t)assetcache_align(rect_at + rect_count * (long long)sizeof(AnimRect), assetcache_alignment));
+    memcpy(assetcache_pending_data.data() + e.offset, data, (size_t)bytes);
+    if (rect_count > 0)
+    {
+        memcpy(assetcache_pending_data.data() + rect_at, rects, rect_count * sizeof(AnimRect));
+    }
+    assetcache_pending.push_back(e);
+}
+bool assetcache_publish()
+{
+    if (assetcache_current != ASSETCACHE_BUILD)
+    {
+        return false;
+    }
+    long long data_at = assetcache_align(sizeof(AssetCacheHeader), assetcache_alignment);
+    long long total = data_at + (long long)assetcache_pending_data.size();
+    unsigned char* base = nullptr;
+#ifdef _WIN32
+    assetcache_mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, (DWORD)(total >> 32), (DWORD)total, assetcache_name.c_str());
+    if (assetcache_mapping != nullptr)
+    {
+        base = (unsigned char*)MapViewOfFile(assetcache_mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, (size_t)total);
+    }
+#else
+    if (ftruncate(assetcache_fd, (off_t)total) == 0)
+    {
+        void* data = mmap(nullptr, (size_t)total, PROT_READ | PROT_WRITE, MAP_SHARED, assetcache_fd, 0);
+        base = data == MAP_FAILED ? nullptr : (unsigned char*)data;
+    }
+#endif
+    bool ok = base != nullptr;
+    if (ok)
+    {
+        AssetCacheHeader* h = new (base) AssetCacheHeader();
+        memcpy(h->magic, assetcache_magic, 4);
+        h->version = assetcache_version;
+        h->stamp = assetcache_current_stamp;
+        h->entry_count = (int)assetcache_pending.size();
+        h->bytes = total;
+        for (int i = 0; i < h->entry_count; ++i)
+        {
+            h->entries[i] = assetcache_pending[i];
+            h->entries[i].offset += data_at;
+        }
+        memcpy(base + data_at, assetcache_pending_data.data(), assetcache_pending_data.size());
+        h->users.store(1);
+        h->ready.store(1, memory_order_release);
+#ifdef _WIN32
+        UnmapViewOfFile(base);
+#else
+        munmap(base, (size_t)total);
+#endif
+        ok = assetcache_map_views((size_t)total);
+    }
+#ifdef _WIN32
+    ReleaseMutex(assetcache_lock);
+    CloseHandle(assetcache_lock);
+    assetcache_lock = nullptr;
+#endif
+    assetcache_pending.clear();
+    assetcache_pending.shrink_to_fit();
+    assetcache_pending_data.clear();
+    assetcache_pending_data.shrink_to_fit();
+    if (!ok)
+    {
+        assetcache_remove();
+        assetcache_unmap();
+        assetcache_current = ASSETCACHE_LOCAL;
+        return false;
+    }
+    assetcache_current = ASSETCACHE_SHARED;
+    return true;
+}
+void assetcache_detach()
+{
+    if (assetcache_current == ASSETCACHE_SHARED && assetcache_header != nullptr && assetcache_header->users.fetch_sub(1) == 1)
+    {
+        assetcache_remove();
+    }
+    else if (assetcache_current == ASSETCACHE_BUILD)
+    {
+        assetcache_remove();
+    }
+#ifdef _WIN32
+    if (assetcache_lock != nullptr)
+    {
+        ReleaseMutex(assetcache_lock);
+        CloseHandle(assetcache_lock);
+        assetcache_lock = nullptr;
+    }
+#endif
+    assetcache_unmap();
+    assetcache_pending.clear();
+    assetcache_pending_data.clear();
+    assetcache_current = ASSETCACHE_LOCAL;
+}
+int assetcache_mode()
+{
+    return assetcache_current;
+}
+const AssetEntry* assetcache_find(const char* name)
+{
+    if (assetcache_current != ASSETCACHE_SHARED)
+    {
+        return nullptr;
+    }
+    const AssetCacheHeader* h = (const AssetCacheHeader*)assetcache_view;
+    for (int i = 0; i < h->entry_count; ++i)
+    {
+        const AssetEntry& e = h->entries[i];
+        long long end = e.offset + assetcache_align(e.bytes, 16) + e.rect_count * (long long)sizeof(AnimRect);
+        if (strncmp(e.name, name, assetcache_name_bytes) == 0 && e.offset >= 0 && e.bytes >= 0 && e.rect_count >= 0 && end <= h->bytes)
+        {
+            return &e;
+        }
+    }
+    return nullptr;
+}
+const unsigned char* assetcache_data(const AssetEntry& entry)
+{
+    return assetcache_view + entry.offset;
+}
+const AnimRect* assetcache_rects(const AssetEntry& entry)
+{
+    return (const AnimRect*)(assetcache_view + entry.offset + assetcache_align(entry.bytes, 16));
+}
+AssetCacheStats assetcache_stats()
+{
+    AssetCacheStats stats;
+    stats.mode = assetcache_current;
+    stats.wait_seconds = assetcache_waited;
+    if (assetcache_current == ASSETCACHE_SHARED)
+    {
+        const AssetCacheHeader* h = (const AssetCacheHeader*)assetcache_view;
+        stats.entries = h->entry_count;
+        stats.bytes = h->bytes;
+        stats.users = assetcache_header->users.load();
+    }
+    else if (assetcache_current == ASSETCACHE_BUILD)
+    {
+        stats.entries = (int)assetcache_pending.size();
+        stats.bytes = (long long)assetcache_pending_data.size();
+    }
+    return stats;
+}
+long long assetcache_private_bytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS_EX pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc)))
+    {
+        return (long long)pmc.PrivateUsage;
+    }
+    return -1;
+#elif defined(__linux__)
+    ifstream smaps("/proc/self/smaps_rollup");
+    string key;
+    long long kb = 0;
+    long long total = 0;
+    bool found = false;
+    while (smaps >> key)
+    {
+        if (key == "Private_Clean:" || key == "Private_Dirty:")
+        {
+            smaps >> kb;
+            total += kb;
+            found = true;
+        }
+    }
+    return found ? total * 1024 : -1;
+#else
+    return -1;
+#endif
+}
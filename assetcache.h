@@ -0,0 +1,49 @@
+#pragma once
+#include "anim.h"
+const int assetcache_max_entries = 48;
+const int assetcache_name_bytes = 32;
+const int assetcache_version = 1;
+const char assetcache_default_name[] = "flappy_assets";
+enum AssetCacheMode
+{
+    ASSETCACHE_LOCAL,
+    ASSETCACHE_BUILD,
+    ASSETCACHE_SHARED
+};
+enum AssetKind
+{
+    ASSET_PIXELS,
+    ASSET_SAMPLES,
+    ASSET_BYTES
+};
+struct AssetEntry
+{
+    char name[assetcache_name_bytes];
+    int kind;
+    int width;
+    int height;
+    int channels;
+    int rate;
+    int rect_count;
+    long long offset;
+    long long bytes;
+};
+struct AssetCacheStats
+{
+    int mode = ASSETCACHE_LOCAL;
+    int entries = 0;
+    int users = 0;
+    long long bytes = 0;
+    double wait_seconds = 0.0;
+};
+unsigned int assetcache_stamp(const char* directory);
+int assetcache_attach(const char* name, unsigned int stamp, double wait_seconds);
+void assetcache_add(const char* name, int kind, int width, int height, int channels, int rate, const void* data, long long bytes, const AnimRect* rects, int rect_count);
+bool assetcache_publish();
+void assetcache_detach();
+int assetcache_mode();
+const AssetEntry* assetcache_find(const char* name);
+const unsigned char* assetcache_data(const AssetEntry& entry);
+const AnimRect* assetcache_rects(const AssetEntry& entry);
+AssetCacheStats assetcache_stats();
+long long assetcache_private_bytes();
@@ -0,0 +1,397 @@
+#include "autopilot.h"
+#include <cmath>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+using namespace std;
+const int plan_angle_steps = 360;
+const int plan_memo_size = 1 << 14;
+struct PlanMemoEntry
+{
+    unsigned long long key;
+    unsigned int stamp;
+};
+thread_local PlanMemoEntry plan_memo[plan_memo_size];
+thread_local unsigned int plan_memo_stamp = 0;
+thread_local bool plan_exact_ran = false;
+float plan_box_left[plan_angle_steps + 1];
+float plan_box_right[plan_angle_steps + 1];
+float plan_box_top[plan_angle_steps + 1];
+float plan_box_bottom[plan_angle_steps + 1];
+float plan_pipe_left = 0.f;
+float plan_pipe_w = 0.f;
+thread autopilot_thread;
+mutex autopilot_lock;
+condition_variable autopilot_wake;
+bool autopilot_running = false;
+bool autopilot_has_job = false;
+SimWorld autopilot_job;
+SimParams autopilot_params;
+double autopilot_budget_us = 300.0;
+int autopilot_result_tick = -1;
+bool autopilot_result_flap = false;
+AutopilotStats autopilot_counters;
+void plan_init(const SimParams& p)
+{
+    SimWorld probe;
+    sim_reset(probe, 0);
+    probe.bird_y = 0.f;
+    for (int i = 0; i <= plan_angle_steps; ++i)
+    {
+        float left = 1e9f;
+        float right = -1e9f;
+        float top = 1e9f;
+        float bottom = -1e9f;
+        for (int k = 0; k <= 8; ++k)
+        {
+            probe.bird_rotation = -90.f + (i + k / 8.f) * 0.5f;
+            SimBox box = get_bird_hit_box(probe, p);
+            left = min_f(left, box.left - bird_x);
+            top = min_f(top, box.top);
+            right = right > box.left + box.width - bird_x ? right : box.left + box.width - bird_x;
+            bottom = bottom > box.top + box.height ? bottom : box.top + box.height;
+        }
+        plan_box_left[i] = left - 0.01f;
+        plan_box_right[i] = right + 0.01f;
+        plan_box_top[i] = top - 0.01f;
+        plan_box_bottom[i] = bottom + 0.01f;
+    }
+    SimPipe pipe = { 0.f, min_gap_y, 0, min_gap_y, 0, 0 };
+    SimBox upper = get_pipe_hit_box(pipe, p, true);
+    SimBox lower = get_pipe_hit_box(pipe, p, false);
+    plan_pipe_left = min_f(upper.left, lower.left);
+    plan_pipe_w = (upper.width > lower.width ? upper.width : lower.width) + 0.01f;
+}
+void plan_clone(const SimWorld& w, PlanWorld& out)
+{
+    out.bird_y = w.bird_y;
+    out.bird_vel = w.bird_vel;
+    out.rng = w.rng;
+    out.next_gap_high = w.next_gap_high;
+    out.tick = w.tick;
+    out.speed_scale = w.speed_scale;
+    out.pattern = w.pattern;
+    out.pipe_count = 0;
+    int count = w.pipe_count > plan_max_pipes ? plan_max_pipes : w.pipe_count;
+    for (int i = 0; i < count; ++i)
+    {
+        out.pipes[out.pipe_count].x = w.pipes[i].x;
+        out.pipes[out.pipe_count].gap_y = w.pipes[i].gap_y;
+        out.pipes[out.pipe_count].base_y = w.pipes[i].base_y;
+        out.pipes[out.pipe_count].move_amp = w.pipes[i].move_amp;
+        out.pipes[out.pipe_count].move_period = w.pipes[i].move_period;
+        ++out.pipe_count;
+    }
+}
+bool plan_exact_clear(const PlanWorld& w, const SimParams& p, float rotation)
+{
+    if (p.masks == nullptr)
+    {
+        return false;
+    }
+    plan_exact_ran = true;
+    SimWorld probe;
+    probe.bird_y = w.bird_y;
+    probe.bird_vel = w.bird_vel;
+    probe.bird_rotation = rotation;
+    probe.bird_falling = w.bird_vel > 0.f;
+    probe.pipe_count = w.pipe_count;
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        probe.pipes[i].x = w.pipes[i].x;
+        probe.pipes[i].gap_y = w.pipes[i].gap_y;
+    }
+    return check_collision(probe, p) == HIT_NONE;
+}
+bool plan_step(PlanWorld& w, const SimParams& p, bool flap)
+{
+    if (flap)
+    {
+        w.bird_vel = p.flap_strength;
+    }
+    w.bird_vel += p.gravity;
+    w.bird_y += w.bird_vel;
+    if (w.pipe_count == 0 || w.pipes[w.pipe_count - 1].x <= width - p.pipe_interval)
+    {
+        if (w.pipe_count == plan_max_pipes)
+        {
+            for (int i = 0; i < w.pipe_count - 1; ++i)
+            {
+                w.pipes[i] = w.pipes[i + 1];
+            }
+            --w.pipe_count;
+        }
+        int prev_gap_y = w.pipe_count > 0 ? w.pipes[w.pipe_count - 1].gap_y : -1;
+        int gap_y = spawn_gap_y(w.rng, w.next_gap_high, w.pattern, w.speed_scale, prev_gap_y, p);
+        w.pipes[w.pipe_count].x = width;
+        w.pipes[w.pipe_count].gap_y = gap_y;
+        w.pipes[w.pipe_count].base_y = gap_y;
+        w.pipes[w.pipe_count].move_amp = (short)w.pattern.move_amp;
+        w.pipes[w.pipe_count].move_period = (short)w.pattern.move_period;
+        ++w.pipe_count;
+    }
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        w.pipes[i].x += p.pipe_speed * w.speed_scale;
+        if (w.pipes[i].move_amp != 0)
+        {
+            w.pipes[i].gap_y = w.pipes[i].base_y + gap_wave(w.tick, w.pipes[i].move_amp, w.pipes[i].move_period);
+        }
+    }
+    ++w.tick;
+    if (w.pipes[0].x + p.pipe_w < 0)
+    {
+        for (int i = 0; i < w.pipe_count - 1; ++i)
+        {
+            w.pipes[i] = w.pipes[i + 1];
+        }
+        --w.pipe_count;
+    }
+    float rotation = min_f(w.bird_vel * 4.f, 90.f);
+    int index = (int)((rotation + 90.f) * 2.f);
+    index = index < 0 ? 0 : (index > plan_angle_steps ? plan_angle_steps : index);
+    float top = w.bird_y + plan_box_top[index];
+    float bottom = w.bird_y + plan_box_bottom[index];
+    if (top < 0 || bottom > height)
+    {
+        return plan_exact_clear(w, p, rotation);
+    }
+    float left = bird_x + plan_box_left[index];
+    float right = bird_x + plan_box_right[index];
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        float pipe_left = w.pipes[i].x + plan_pipe_left;
+        if (pipe_left >= right)
+        {
+            break;
+        }
+        if (pipe_left + plan_pipe_w <= left)
+        {
+            continue;
+        }
+        if (top < w.pipes[i].gap_y || bottom > w.pipes[i].gap_y + p.pipe_gap)
+        {
+            return plan_exact_clear(w, p, rotation);
+        }
+    }
+    return true;
+}
+struct PlanSearch
+{
+    const SimParams* params;
+    int depth_limit;
+    long long nodes;
+    long long visits;
+    chrono::steady_clock::time_point deadline;
+    bool out_of_time;
+};
+int plan_preferred_option(const PlanWorld& w, const SimParams& p)
+{
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        if (w.pipes[i].x + p.pipe_w > bird_x - p.bird_w / 2.f)
+        {
+            return w.bird_y > w.pipes[i].gap_y + p.pipe_gap * 0.6f ? 1 : 0;
+        }
+    }
+    return w.bird_y > height / 2 ? 1 : 0;
+}
+bool plan_expired(PlanSearch& s)
+{
+    if (chrono::steady_clock::now() > s.deadline)
+    {
+        s.out_of_time = true;
+    }
+    return s.out_of_time;
+}
+bool plan_visit(PlanSearch& s, const PlanWorld& w, int depth)
+{
+    if ((++s.visits & 3) == 0 && plan_expired(s))
+    {
+        return false;
+    }
+    unsigned long long key = ((unsigned long long)depth << 42) ^ ((unsigned long long)(unsigned int)(int)(w.bird_y * 2.f) << 21) ^ (unsigned long long)(unsigned int)(int)(w.bird_vel * 32.f + 1024.f);
+    unsigned int slot = (unsigned int)((key * 0x9E3779B97F4A7C15ull) >> 50) & (plan_memo_size - 1);
+    for (int probe = 0; probe < 8; ++probe)
+    {
+        PlanMemoEntry& entry = plan_memo[(slot + probe) & (plan_memo_size - 1)];
+        if (entry.stamp != plan_memo_stamp)
+        {
+            entry.key = key;
+            entry.stamp = plan_memo_stamp;
+            return true;
+        }
+        if (entry.key == key)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+bool plan_search(PlanSearch& s, const PlanWorld& w, int depth, int first_option)
+{
+    if (depth == s.depth_limit)
+    {
+        return true;
+    }
+    if (depth > 0 && !plan_visit(s, w, depth))
+    {
+        return false;
+    }
+    ++s.nodes;
+    int preferred = plan_preferred_option(w, *s.params);
+    for (int k = 0; k < 2; ++k)
+    {
+        int option = k == 0 ? preferred : 1 - preferred;
+        if (depth == 0 && option != first_option)
+        {
+            continue;
+        }
+        PlanWorld next = w;
+        bool alive = true;
+        for (int t = 0; t < plan_repeat && alive; ++t)
+        {
+            plan_exact_ran = false;
+            alive = plan_step(next, *s.params, option == 1 && t == 0);
+            if (plan_exact_ran && plan_expired(s))
+            {
+                return false;
+            }
+        }
+        if (alive && plan_search(s, next, depth + 1, first_option))
+        {
+            return true;
+        }
+        if (s.out_of_time)
+        {
+            return false;
+        }
+    }
+    return false;
+}
+PlanResult plan_action(const SimWorld& w, const SimParams& p, double budget_us)
+{
+    auto start = chrono::steady_clock::now();
+    PlanResult result;
+    PlanWorld root;
+    plan_clone(w, root);
+    PlanSearch search;
+    search.params = &p;
+    search.nodes = 0;
+    search.visits = 0;
+    search.deadline = start + chrono::nanoseconds((long long)(budget_us * 1000.0));
+    search.out_of_time = false;
+    int preferred = plan_preferred_option(root, p);
+    result.flap = preferred == 1;
+    for (int depth = 4; depth <= plan_max_depth && !search.out_of_time; depth *= 2)
+    {
+        search.depth_limit = depth;
+        ++plan_memo_stamp;
+        bool found = false;
+        for (int k = 0; k < 2 && !found && !search.out_of_time; ++k)
+        {
+            int first = k == 0 ? preferred : 1 - preferred;
+            if (plan_search(search, root, 0, first))
+            {
+                result.flap = first == 1;
+                result.survivable = true;
+                result.depth = depth;
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            break;
+        }
+    }
+    result.nodes = search.nodes;
+    result.micros = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+void autopilot_worker()
+{
+    while (true)
+    {
+        SimWorld job;
+        SimParams params;
+        double budget;
+        {
+            unique_lock<mutex> guard(autopilot_lock);
+            autopilot_wake.wait(guard, [] { return autopilot_has_job || !autopilot_running; });
+            if (!autopilot_running)
+            {
+                return;
+            }
+            job = autopilot_job;
+            params = autopilot_params;
+            budget = autopilot_budget_us;
+            autopilot_has_job = false;
+        }
+        PlanResult result = plan_action(job, params, budget);
+        lock_guard<mutex> guard(autopilot_lock);
+        autopilot_result_tick = job.tick;
+        autopilot_result_flap = result.flap;
+        ++autopilot_counters.plans;
+        autopilot_counters.depth_total += result.depth * plan_repeat;
+        autopilot_counters.micros_total += result.micros;
+        autopilot_counters.overruns += result.micros > budget + plan_overrun_slack_us ? 1 : 0;
+        if (result.micros > autopilot_counters.micros_max)
+        {
+            autopilot_counters.micros_max = result.micros;
+        }
+    }
+}
+void autopilot_start(const SimParams& p, double budget_us)
+{
+    if (autopilot_running)
+    {
+        return;
+    }
+    plan_init(p);
+    autopilot_budget_us = budget_us;
+    autopilot_has_job = false;
+    autopilot_result_tick = -1;
+    autopilot_counters = AutopilotStats();
+    autopilot_running = true;
+    autopilot_thread = thread(autopilot_worker);
+}
+void autopilot_stop()
+{
+    if (!autopilot_running)
+    {
+        return;
+    }
+    {
+        lock_guard<mutex> guard(autopilot_lock);
+        autopilot_running = false;
+    }
+    autopilot_wake.notify_one();
+    autopilot_thread.join();
+}
+void autopilot_post(const SimWorld& w, const SimParams& p)
+{
+    {
+        lock_guard<mutex> guard(autopilot_lock);
+        autopilot_job = w;
+        autopilot_params = p;
+        autopilot_has_job = true;
+    }
+    autopilot_wake.notify_one();
+}
+bool autopilot_poll(int tick, bool& flap)
+{
+    lock_guard<mutex> guard(autopilot_lock);
+    if (autopilot_result_tick != tick)
+    {
+        ++autopilot_counters.missed_ticks;
+        return false;
+    }
+    flap = autopilot_result_flap;
+    return true;
+}
+AutopilotStats autopilot_stats()
+{
+    lock_guard<mutex> guard(autopilot_lock);
+    return autopilot_counters;
+}
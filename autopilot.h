@@ -0,0 +1,52 @@
+#pragma once
+#include "simulation.h"
+const int plan_repeat = 2;
+const int plan_max_depth = 64;
+const int plan_max_pipes = 8;
+const double plan_overrun_slack_us = 5.0;
+struct PlanPipe
+{
+    float x;
+    int gap_y;
+    int base_y;
+    short move_amp;
+    short move_period;
+};
+struct PlanWorld
+{
+    float bird_y;
+    float bird_vel;
+    unsigned int rng;
+    int next_gap_high;
+    int tick;
+    float speed_scale;
+    PatternState pattern;
+    int pipe_count;
+    PlanPipe pipes[plan_max_pipes];
+};
+struct PlanResult
+{
+    bool flap = false;
+    bool survivable = false;
+    int depth = 0;
+    long long nodes = 0;
+    double micros = 0.0;
+};
+struct AutopilotStats
+{
+    long long plans = 0;
+    long long missed_ticks = 0;
+    long long overruns = 0;
+    long long depth_total = 0;
+    double micros_total = 0.0;
+    double micros_max = 0.0;
+};
+void plan_init(const SimParams& p);
+void plan_clone(const SimWorld& w, PlanWorld& out);
+bool plan_step(PlanWorld& w, const SimParams& p, bool flap);
+PlanResult plan_action(const SimWorld& w, const SimParams& p, double budget_us);
+void autopilot_start(const SimParams& p, double budget_us);
+void autopilot_stop();
+void autopilot_post(const SimWorld& w, const SimParams& p);
+bool autopilot_poll(int tick, bool& flap);
+AutopilotStats autopilot_stats();
@@ -0,0 +1,2617 @@
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "simulation.h"
+#include "flappy_env.h"
+#include "autopilot.h"
+#include "telemetry.h"
+#include "reach.h"
+#include "bitmask.h"
+#include "particles.h"
+#include "pattern.h"
+#include "ecs.h"
+#include "fixed.h"
+#include "pacer.h"
+#include "spectate.h"
+#include "replaydb.h"
+#include "counters.h"
+#include "renderqueue.h"
+#include "metrics.h"
+#include "flightrec.h"
+#include "assetcache.h"
+#include "simkernel.h"
+#include "raster.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+using namespace std;
+double now_seconds();
+void bench_env_size(int num_envs, int num_threads, bool fixed_point = false);
+void bench_env();
+void fill_test_texture(vector<unsigned char>& rgba, int w, int h, unsigned char shade);
+void bench_raster_size(int num_envs, int num_threads, int out_w, int out_h);
+void bench_raster();
+void bench_autopilot_steps(Difficulty d);
+void bench_autopilot_runs(Difficulty d, int runs, int target_score, double budget_us, bool pixel_collision);
+void bench_autopilot();
+void telemetry_wait_written();
+void bench_telemetry_log();
+double bench_telemetry_play(Difficulty d, int ticks, bool logging, long long& events);
+void bench_telemetry();
+void bench_reach_build(Difficulty d);
+int bench_reach_check(const char* name, const SimParams& p, int row_step);
+bool bench_reach_search(const SimWorld& w, const SimParams& p, int start_tick, int target_score, unordered_set<unsigned long long>& seen);
+bool bench_reach_clears(const SimWorld& start, const SimParams& p, int target_score);
+int bench_reach_live(const char* name, SimParams p, int spawns);
+int bench_reach(int row_step);
+void make_bird_silhouette(vector<unsigned char>& rgba, int w, int h);
+void make_pipe_silhouette(vector<unsigned char>& rgba, int w, int h, bool lip_at_bottom);
+void make_bench_masks(CollisionMasks& m, SimParams& p);
+bool pixel_reference_hit(const SimWorld& w, const SimParams& p, const vector<unsigned char>& bird, const vector<unsigned char>& pipe_top, const vector<unsigned char>& pipe_bottom);
+void bench_collision();
+struct BenchVertex
+{
+    float x;
+    float y;
+    unsigned int color;
+    float u;
+    float v;
+};
+void bench_particle_quads(const ParticlePool& pool, BenchVertex* out);
+void bench_particles_at(int target);
+void bench_particles();
+double bench_spawn_ns(const SimParams& p, int spawns);
+int bench_pattern_file(const char* path);
+int bench_pattern(int count, char* paths[]);
+Entity bench_spawn_entity(EcsWorld& w, unsigned int& rng);
+void bench_ecs();
+unsigned long long bench_float_mix(unsigned long long h, float v);
+unsigned long long bench_float_hash(const SimWorld& w, unsigned long long h);
+double bench_float_run(const SimParams& p, int seeds, int ticks, unsigned long long& hash, long long& score);
+double bench_fixed_run(const FixedParams& f, int seeds, int ticks, unsigned long long& hash, long long& score);
+unsigned long long bench_fixed_world_hash(const FixedParams& f, int seeds, int ticks);
+int bench_fixed_masks();
+int bench_fixed_toggle();
+int bench_fixed();
+void bench_pacer_work(unsigned int& rng, double period);
+void bench_pacer_report(const char* name, const FrameStats& frames, const FrameStats* lateness, long long missed, double period);
+void bench_pacer_rate(double hz, double seconds);
+void bench_pacer();
+bool bench_spectate_matches(const SpectateView& v, const SimWorld& w);
+int bench_spectate_clients(int count, int ticks);
+int bench_spectate();
+void bench_replaydb_report(const char* name, vector<double>& micros);
+int bench_replaydb(int runs);
+void bench_counters_report(const PerfCounters& c, const char* name, const CounterValues& v, long long ticks);
+template <class F>
+void bench_counters_phase(PerfCounters& c, const char* name, const vector<SimWorld>& worlds, vector<SimWorld>& work, int count, F step);
+void bench_counters();
+struct BenchDrawScene
+{
+    const char* name;
+    bool game;
+    bool menu_bird;
+    bool overlay;
+    int buttons;
+    int text_layer;
+    int text_count;
+    int text_size[4];
+    int text_calls[4];
+};
+void bench_queue_quad(RenderQueue& q, vector<BenchVertex>& vertices, int layer, int material);
+void bench_queue_frame(RenderQueue& q, vector<BenchVertex>& vertices, const BenchDrawScene& scene, bool atlas, int particles);
+int bench_queue_gather(const RenderQueue& q, const vector<BenchVertex>& vertices, vector<BenchVertex>& batch);
+int bench_renderqueue();
+bool bench_metrics_valid(const string& body, long long frames);
+void bench_metrics_frames(const char* name, int frames, int ticks, vector<double>& micros);
+int bench_metrics();
+void bench_flight_frames(SimWorld& w, const SimParams& p, int frames, int sleep_ms);
+bool bench_flight_find(long long first_time, long long last_time, unsigned int frame, FlightDump& dump);
+int bench_flight();
+struct BenchAsset
+{
+    string name;
+    int kind;
+    int width;
+    int height;
+    int channels;
+    int rate;
+    vector<unsigned char> data;
+    vector<AnimRect> rects;
+};
+bool bench_asset_bytes(const string& path, vector<unsigned char>& bytes);
+bool bench_asset_image(const string& path, int& w, int& h, vector<unsigned char>& rgba);
+bool bench_asset_sheet(BenchAsset& a, const vector<string>& paths);
+bool bench_asset_wav(BenchAsset& a, const string& path);
+bool bench_asset_decode(vector<BenchAsset>& assets);
+unsigned long long bench_asset_checksum(const unsigned char* data, long long bytes, unsigned long long h);
+int bench_assetcache_instance(bool shared, int id);
+bool bench_assetcache_round(const char* self, bool shared, int instances);
+int bench_assetcache(const char* self);
+double bench_kernel_run(int mode, SimKernel kernel, const SimParams& p, vector<SimWorld>& worlds, int ticks, unsigned long long& hash, long long& score);
+int bench_kernels_profile(Difficulty d);
+int bench_kernels();
+void print_usage();
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        print_usage();
+        return 1;
+    }
+    if (strcmp(argv[1], "env") == 0)
+    {
+        bench_env();
+    }
+    else if (strcmp(argv[1], "raster") == 0)
+    {
+        bench_raster();
+    }
+    else if (strcmp(argv[1], "autopilot") == 0)
+    {
+        bench_autopilot();
+    }
+    else if (strcmp(argv[1], "telemetry") == 0)
+    {
+        bench_telemetry();
+    }
+    else if (strcmp(argv[1], "reach") == 0)
+    {
+        return bench_reach(argc > 2 ? atoi(argv[2]) : 4);
+    }
+    else if (strcmp(argv[1], "collision") == 0)
+    {
+        bench_collision();
+    }
+    else if (strcmp(argv[1], "particles") == 0)
+    {
+        bench_particles();
+    }
+    else if (strcmp(argv[1], "ecs") == 0)
+    {
+        bench_ecs();
+    }
+    else if (strcmp(argv[1], "pattern") == 0)
+    {
+        return bench_pattern(argc - 2, argv + 2);
+    }
+    else if (strcmp(argv[1], "fixed") == 0)
+    {
+        return bench_fixed();
+    }
+    else if (strcmp(argv[1], "pacer") == 0)
+    {
+        bench_pacer();
+    }
+    else if (strcmp(argv[1], "spectate") == 0)
+    {
+        return bench_spectate();
+    }
+    else if (strcmp(argv[1], "replaydb") == 0)
+    {
+        return bench_replaydb(argc > 2 ? atoi(argv[2]) : 500000);
+    }
+    else if (strcmp(argv[1], "counters") == 0)
+    {
+        bench_counters();
+    }
+    else if (strcmp(argv[1], "renderqueue") == 0)
+    {
+        return bench_renderqueue();
+    }
+    else if (strcmp(argv[1], "metrics") == 0)
+    {
+        return bench_metrics();
+    }
+    else if (strcmp(argv[1], "flight") == 0)
+    {
+        return bench_flight();
+    }
+    else if (strcmp(argv[1], "assetcache") == 0)
+    {
+        return bench_assetcache(argv[0]);
+    }
+    else if (strcmp(argv[1], "assetcache-instance") == 0 && argc > 3)
+    {
+        return bench_assetcache_instance(strcmp(argv[2], "shared") == 0, atoi(argv[3]));
+    }
+    else if (strcmp(argv[1], "kernels") == 0)
+    {
+        return bench_kernels();
+    }
+    else
+    {
+        print_usage();
+        return 1;
+    }
+    return 0;
+}
+double now_seconds()
+{
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+void print_usage()
+{
+    cout << "usage: Flappy-Bench <benchmark>" << endl;
+    cout << "  env    vectorized RL environment steps per second at 1, 64 and 4096 envs" << endl;
+    cout << "  raster software-rendered pixel observations per second" << endl;
+    cout << "  autopilot  planner step cost, depth reached and win rate" << endl;
+    cout << "  telemetry  event logging cost, flusher bandwidth and per-tick gameplay overhead" << endl;
+    cout << "  reach [row_step]  gap reachability table build time, every next gap of every row_step-th row (4 by default, 1 for all) checked against exhaustive simulation" << endl;
+    cout << "  collision  bitmask vs hit-box collision cost per tick and accuracy against a per-pixel reference" << endl;
+    cout << "  particles  particle pool update and vertex batch cost per frame at 5k, 50k and full capacity" << endl;
+    cout << "  ecs    entity systems (move, collide, score, cull, render list) over 100k entities vs per-object structs" << endl;
+    cout << "  pattern [files]  obstacle pattern compile time, bytecode size and cost per spawn (default: patterns/*.pat)" << endl;
+    cout << "  fixed  fixed-point physics throughput vs the float path and a trajectory hash checked against the reference build" << endl;
+    cout << "  pacer  frame pacing error and frame-time statistics at 60, 144 and 240 Hz vs a plain sleep limiter" << endl;
+    cout << "  spectate  live broadcast bandwidth per spectator, fan-out cost and end-to-end delay for 1, 8 and 64 local spectators" << endl;
+    cout << "  replaydb [runs]  replay store append rate, compaction time and best-run, range and top-100 query latency, checked against a full scan" << endl;
+    cout << "  counters  cycles, instructions, L1D/LLC misses and branch misses per tick for each simulation and draw phase (perf_event_open)" << endl;
+    cout << "  renderqueue  draw calls and texture changes per frame for each screen, direct vs sorted and batched, and queue cost per frame" << endl;
+    cout << "  metrics  metrics recording cost, scrape latency and size, exposition format check, and frame time with and without a scraper" << endl;
+    cout << "  flight  flight recorder cost per frame, forced hitch dump with cooldown, and dump round trip through the timeline loader" << endl;
+    cout << "  assetcache  startup time and private memory per process for 1, 4 and 8 processes loading assets/, with and without the shared-memory cache" << endl;
+    cout << "  kernels  batch simulation steps per second with the generic step vs the per-difficulty specialized kernels, checked bit-for-bit" << endl;
+}
+void bench_env_size(int num_envs, int num_threads, bool fixed_point)
+{
+    FlappyEnv* env = flappy_env_create(num_envs, FLAPPY_ENV_EASY, num_threads);
+    flappy_env_set_fixed_point(env, fixed_point ? 1 : 0);
+    vector<float> observations((size_t)num_envs * flappy_env_observation_size());
+    vector<float> rewards(num_envs);
+    vector<unsigned char> dones(num_envs);
+    vector<unsigned char> actions(num_envs);
+    flappy_env_set_buffers(env, observations.data(), rewards.data(), dones.data(), nullptr);
+    flappy_env_reset(env, 1234);
+    unsigned int rng = 2463534242u;
+    long long steps = 0;
+    int episodes = 0;
+    double start = now_seconds();
+    double elapsed = 0.0;
+    while (elapsed < 1.0)
+    {
+        for (int i = 0; i < num_envs; ++i)
+        {
+            rng ^= rng << 13;
+            rng ^= rng >> 17;
+            rng ^= rng << 5;
+            float gap_center = (observations[(size_t)i * FLAPPY_ENV_OBS_SIZE + 3] + observations[(size_t)i * FLAPPY_ENV_OBS_SIZE + 4]) / 2.f;
+            actions[i] = (observations[(size_t)i * FLAPPY_ENV_OBS_SIZE] > gap_center && (rng & 7) == 0) ? 1 : 0;
+        }
+        for (int k = 0; k < 64; ++k)
+        {
+            flappy_env_step(env, actions.data());
+            for (int i = 0; i < num_envs; ++i)
+            {
+                episodes += dones[i];
+            }
+        }
+        steps += 64LL * num_envs;
+        elapsed = now_seconds() - start;
+    }
+    cout << "envs " << num_envs << "  threads " << num_threads << "  " << (long long)(steps / elapsed) << " env-steps/s  (" << episodes << " episodes)" << (fixed_point ? "  fixed-point" : "") << endl;
+    flappy_env_destroy(env);
+}
+void bench_env()
+{
+    int cores = (int)thread::hardware_concurrency();
+    if (cores < 1)
+    {
+        cores = 1;
+    }
+    int max_threads = cores > 4 ? cores : 4;
+    int sizes[4] = { 1, 64, 1024, 4096 };
+    for (int i = 0; i < 4; ++i)
+    {
+        for (int threads = 1; threads <= max_threads && threads <= sizes[i]; threads *= 2)
+        {
+            bench_env_size(sizes[i], threads);
+        }
+    }
+}
+void fill_test_texture(vector<unsigned char>& rgba, int w, int h, unsigned char shade)
+{
+    rgba.resize((size_t)w * h * 4);
+    for (int i = 0; i < w * h; ++i)
+    {
+        rgba[4 * i] = (unsigned char)(shade + i % 17);
+        rgba[4 * i + 1] = shade;
+        rgba[4 * i + 2] = (unsigned char)(shade / 2);
+        rgba[4 * i + 3] = (i % 7 == 0) ? 0 : 255;
+    }
+}
+void bench_raster_size(int num_envs, int num_threads, int out_w, int out_h)
+{
+    FlappyEnv* env = flappy_env_create(num_envs, FLAPPY_ENV_EASY, num_threads);
+    int sizes[5][2] = { { width, height }, { 35, 35 }, { 35, 35 }, { 25, 100 }, { 25, 100 } };
+    vector<unsigned char> rgba;
+    for (int i = 0; i < 5; ++i)
+    {
+        fill_test_texture(rgba, sizes[i][0], sizes[i][1], (unsigned char)(60 + 30 * i));
+        flappy_env_set_texture(env, i, rgba.data(), sizes[i][0], sizes[i][1]);
+    }
+    vector<unsigned char> pixels((size_t)num_envs * out_w * out_h);
+    vector<unsigned char> actions(num_envs);
+    flappy_env_set_pixel_buffer(env, pixels.data(), out_w, out_h);
+    flappy_env_reset(env, 99);
+    long long frames = 0;
+    double start = now_seconds();
+    double elapsed = 0.0;
+    int tick = 0;
+    while (elapsed < 1.0)
+    {
+        for (int i = 0; i < num_envs; ++i)
+        {
+            actions[i] = ((tick + i) % 18) == 0 ? 1 : 0;
+        }
+        flappy_env_step(env, actions.data());
+        ++tick;
+        frames += num_envs;
+        elapsed = now_seconds() - start;
+    }
+    cout << "envs " << num_envs << "  threads " << num_threads << "  " << out_w << "x" << out_h << "  " << (long long)(frames / elapsed) << " frames/s (step + render)" << endl;
+    flappy_env_destroy(env);
+}
+void bench_raster()
+{
+    int cores = (int)thread::hardware_concurrency();
+    if (cores < 1)
+    {
+        cores = 1;
+    }
+    bench_raster_size(4096, 1, 84, 84);
+    if (cores > 1)
+    {
+        bench_raster_size(4096, cores, 84, 84);
+    }
+    bench_raster_size(64, 1, 168, 168);
+}
+void bench_autopilot_steps(Difficulty d)
+{
+    SimParams p;
+    ReachTable reach;
+    apply_difficulty(d, p, reach);
+    plan_init(p);
+    const int steps = 2000000;
+    SimWorld w;
+    sim_reset(w, 5);
+    double start = now_seconds();
+    for (int i = 0; i < steps; ++i)
+    {
+        bool flap = w.pipe_count > 0 && w.bird_y > w.pipes[0].gap_y + p.pipe_gap / 2;
+        if (sim_step(w, p, flap).hit != HIT_NONE)
+        {
+            sim_reset(w, w.rng);
+        }
+    }
+    double sim_seconds = now_seconds() - start;
+    sim_reset(w, 5);
+    PlanWorld pw;
+    plan_clone(w, pw);
+    start = now_seconds();
+    for (int i = 0; i < steps; ++i)
+    {
+        bool flap = pw.pipe_count > 0 && pw.bird_y > pw.pipes[0].gap_y + p.pipe_gap / 2;
+        if (!plan_step(pw, p, flap))
+        {
+            sim_reset(w, pw.rng);
+            plan_clone(w, pw);
+        }
+    }
+    double plan_seconds = now_seconds() - start;
+    cout << (d == EASY ? "EASY" : "HARD") << "  sim_step " << (long long)(steps / sim_seconds) << " steps/s, plan_step "
+         << (long long)(steps / plan_seconds) << " steps/s, world clone " << sizeof(SimWorld) << " -> " << sizeof(PlanWorld) << " bytes" << endl;
+}
+void bench_autopilot_runs(Difficulty d, int runs, int target_score, double budget_us, bool pixel_collision)
+{
+    SimParams p;
+    ReachTable reach;
+    apply_difficulty(d, p, reach);
+    CollisionMasks* masks = new CollisionMasks();
+    if (pixel_collision)
+    {
+        make_bench_masks(*masks, p);
+    }
+    plan_init(p);
+    int wins = 0;
+    long long depth_total = 0;
+    double micros_total = 0.0;
+    long long overruns = 0;
+    vector<double> micros;
+    for (int run = 0; run < runs; ++run)
+    {
+        SimWorld w;
+        sim_reset(w, 1000 + run);
+        while (w.score < target_score)
+        {
+            PlanResult plan = plan_action(w, p, budget_us);
+            micros.push_back(plan.micros);
+            depth_total += plan.depth * plan_repeat;
+            micros_total += plan.micros;
+            overruns += plan.micros > budget_us + plan_overrun_slack_us ? 1 : 0;
+            if (sim_step(w, p, plan.flap).hit != HIT_NONE)
+            {
+                break;
+            }
+        }
+        if (w.score >= target_score)
+        {
+            ++wins;
+        }
+    }
+    delete masks;
+    long long plans = (long long)micros.size();
+    sort(micros.begin(), micros.end());
+    cout << (d == EASY ? "EASY" : "HARD") << (pixel_collision ? " pixel" : "") << "  budget " << budget_us << " us: win rate " << wins << "/" << runs << " (reach "
+         << target_score << " pipes), mean lookahead " << (double)depth_total / plans << " ticks, mean plan " << micros_total / plans << " us, p99 "
+         << micros[(size_t)(plans * 0.99)] << " us, max " << micros.back() << " us, " << overruns << "/" << plans << " plans over budget" << endl;
+}
+void bench_autopilot()
+{
+    bench_autopilot_steps(EASY);
+    bench_autopilot_steps(HARD);
+    bench_autopilot_runs(EASY, 20, 100, 300.0, false);
+    bench_autopilot_runs(HARD, 20, 100, 300.0, false);
+    bench_autopilot_runs(HARD, 20, 100, 100.0, false);
+    bench_autopilot_runs(HARD, 20, 100, 300.0, true);
+}
+void telemetry_wait_written()
+{
+    TelemetryStats stats = telemetry_stats();
+    while (stats.events_written < stats.events_logged)
+    {
+        this_thread::sleep_for(chrono::milliseconds(1));
+        stats = telemetry_stats();
+    }
+}
+void bench_telemetry_log()
+{
+    if (!telemetry_open("bench_telemetry.fbt"))
+    {
+        cout << "cannot write bench_telemetry.fbt" << endl;
+        return;
+    }
+    const int bursts = 200;
+    const int burst_events = 32768;
+    double log_seconds = 0.0;
+    for (int b = 0; b < bursts; ++b)
+    {
+        double burst_start = now_seconds();
+        for (int i = 0; i < burst_events; ++i)
+        {
+            telemetry_log(EVENT_FLAP, EASY, b, i, 0, (float)i);
+        }
+        log_seconds += now_seconds() - burst_start;
+        telemetry_wait_written();
+    }
+    telemetry_close();
+    TelemetryStats stats = telemetry_stats();
+    cout << "log      " << log_seconds * 1e9 / ((double)bursts * burst_events) << " ns/event, " << stats.events_dropped << " dropped" << endl;
+    cout << "flusher  " << stats.events_written << " events, " << (double)stats.bytes_written / stats.events_written << " bytes/event, "
+         << stats.bytes_written / stats.write_seconds / 1e6 << " MB/s while writing" << endl;
+    remove("bench_telemetry.fbt");
+}
+double bench_telemetry_play(Difficulty d, int ticks, bool logging, long long& events)
+{
+    SimParams p;
+    ReachTable reach;
+    apply_difficulty(d, p, reach);
+    SimWorld w;
+    sim_reset(w, 9);
+    unsigned int run = 0;
+    events = 0;
+    double seconds = 0.0;
+    double start = now_seconds();
+    for (int i = 0; i < ticks; ++i)
+    {
+        if (i % 100000 == 0 && logging)
+        {
+            seconds += now_seconds() - start;
+            telemetry_wait_written();
+            start = now_seconds();
+        }
+        bool flap = w.pipe_count > 0 && w.bird_y > w.pipes[0].gap_y + p.pipe_gap / 2;
+        if (flap && logging)
+        {
+            events += telemetry_log(EVENT_FLAP, d, run, w.tick, 0, w.bird_y);
+        }
+        SimStepResult result = sim_step(w, p, flap);
+        if (result.scored > 0 && logging)
+        {
+            events += telemetry_log(EVENT_SCORE, d, run, w.tick, w.score, w.bird_y);
+        }
+        if (result.hit != HIT_NONE)
+        {
+            if (logging)
+            {
+                events += telemetry_log(EVENT_DEATH, d, run, w.tick, result.hit, w.bird_y);
+                events += telemetry_log(EVENT_RUN_END, d, run, w.tick, w.score, w.bird_y);
+                events += telemetry_log(EVENT_RUN_START, d, run + 1, 0, (int)w.rng, w.bird_y);
+            }
+            ++run;
+            sim_reset(w, w.rng);
+        }
+    }
+    return seconds + now_seconds() - start;
+}
+void bench_telemetry()
+{
+    bench_telemetry_log();
+    const int ticks = 20000000;
+    for (int d = EASY; d <= HARD; ++d)
+    {
+        long long events = 0;
+        double plain = bench_telemetry_play((Difficulty)d, ticks, false, events);
+        telemetry_open("bench_telemetry.fbt");
+        double logged = bench_telemetry_play((Difficulty)d, ticks, true, events);
+        telemetry_close();
+        TelemetryStats stats = telemetry_stats();
+        remove("bench_telemetry.fbt");
+        cout << (d == EASY ? "EASY" : "HARD") << "  " << events << " events over " << ticks << " ticks, " << (logged - plain) * 1e9 / ticks
+             << " ns/tick overhead, " << stats.bytes_written * 60.0 / ticks << " bytes/s at 60 Hz, " << stats.events_dropped << " dropped" << endl;
+    }
+}
+void bench_reach_build(Difficulty d)
+{
+    SimParams p;
+    apply_difficulty(d, p);
+    ReachTable table;
+    double start = now_seconds();
+    reach_build(table, p);
+    double ms = (now_seconds() - start) * 1000.0;
+    cout << (d == EASY ? "EASY" : "HARD") << "  built in " << ms << " ms: " << table.reachable_pairs << "/" << table.gap_count * table.gap_count
+         << " gap pairs reachable, " << table.spacing_ticks << " ticks between pipes" << endl;
+}
+int bench_reach_check(const char* name, const SimParams& p, int row_step)
+{
+    ReachTable table;
+    reach_build(table, p);
+    int last_gap = table.first_gap + table.gap_count - 1;
+    vector<unsigned char> passable;
+    int rows = 0;
+    long long checked = 0;
+    int confirmed = 0;
+    int unsound = 0;
+    int conservative = 0;
+    double start = now_seconds();
+    for (int g = table.first_gap; g <= last_gap; g = g < last_gap && g + row_step > last_gap ? last_gap : g + row_step)
+    {
+        reach_simulate_row(p, g, passable);
+        ++rows;
+        for (int n = table.first_gap; n <= last_gap; ++n)
+        {
+            bool in_table = reach_is_reachable(table, g, n);
+            bool simulated = passable[n - table.first_gap] != 0;
+            ++checked;
+            if (in_table && !simulated)
+            {
+                if (reach_simulate_pair(p, g, n))
+                {
+                    ++confirmed;
+                    continue;
+                }
+                ++unsound;
+                cout << "  FAIL " << g << " -> " << n << " is in the table but no flap sequence passes it" << endl;
+            }
+            conservative += !in_table && simulated;
+        }
+    }
+    cout << name << "  " << table.reachable_pairs << "/" << table.gap_count * table.gap_count << " reachable, " << rows << "/" << table.gap_count << " rows x "
+         << table.gap_count << " next gaps = " << checked << " pairs simulated in " << now_seconds() - start << " s (" << confirmed << " confirmed pair by pair), "
+         << unsound << " unsound, " << conservative << " reachable pairs missed by the table" << endl;
+    return unsound;
+}
+bool bench_reach_search(const SimWorld& w, const SimParams& p, int start_tick, int target_score, unordered_set<unsigned long long>& seen)
+{
+    int next = 0;
+    while (next < w.pipe_count && w.pipes[next].scored)
+    {
+        ++next;
+    }
+    bool prefer_flap = next < w.pipe_count && w.bird_y > w.pipes[next].gap_y + p.pipe_gap * 0.6f;
+    for (int i = 0; i < 2; ++i)
+    {
+        SimWorld c = w;
+        if (sim_step(c, p, (i == 0) == prefer_flap).hit != HIT_NONE)
+        {
+            continue;
+        }
+        if (c.score >= target_score)
+        {
+            return true;
+        }
+        unsigned long long key = ((unsigned long long)(c.tick - start_tick) << 44) | ((unsigned long long)(lroundf(c.bird_y * 4.f) & 0xfffff) << 24) |
+                                 ((unsigned long long)(lroundf(c.bird_vel * 64.f) & 0x7fffff) << 1) | (c.bird_falling != 0);
+        if (c.tick - start_tick < 1024 && seen.insert(key).second && bench_reach_search(c, p, start_tick, target_score, seen))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+bool bench_reach_clears(const SimWorld& start, const SimParams& p, int target_score)
+{
+    unordered_set<unsigned long long> seen;
+    return bench_reach_search(start, p, start.tick, target_score, seen);
+}
+int bench_reach_live(const char* name, SimParams p, int spawns)
+{
+    ReachTable table;
+    reach_attach(table, p);
+    int last_gap = table.first_gap + table.gap_count - 1;
+    unsigned int rng = 12345;
+    int seed = 1;
+    SimWorld w;
+    sim_reset(w, seed);
+    int jitter = 0;
+    int last_spawn_tick = -1;
+    int spacing_min = INT_MAX;
+    int spacing_max = 0;
+    int tested = 0;
+    int bot_doomed = 0;
+    int spawned_stuck = 0;
+    int extremes = 0;
+    int extremes_stuck = 0;
+    double start = now_seconds();
+    while (tested + bot_doomed < spawns)
+    {
+        int next = 0;
+        while (next < w.pipe_count && w.pipes[next].scored)
+        {
+            ++next;
+        }
+        int target = next < w.pipe_count ? w.pipes[next].gap_y + p.pipe_gap / 2 + jitter : height / 2;
+        float newest = w.pipe_count > 0 ? w.pipes[w.pipe_count - 1].x : -1e9f;
+        if (sim_step(w, p, w.bird_y > target && w.bird_vel > 0).hit != HIT_NONE)
+        {
+            sim_reset(w, ++seed);
+            last_spawn_tick = -1;
+            continue;
+        }
+        if (w.pipe_count < 2 || w.pipes[w.pipe_count - 1].x <= newest)
+        {
+            continue;
+        }
+        if (last_spawn_tick >= 0)
+        {
+            spacing_min = min(spacing_min, w.tick - last_spawn_tick);
+            spacing_max = max(spacing_max, w.tick - last_spawn_tick);
+        }
+        last_spawn_tick = w.tick;
+        jitter = (int)(xorshift32(rng) % 61) - 30;
+        int unscored = 0;
+        for (int i = 0; i < w.pipe_count; ++i)
+        {
+            unscored += !w.pipes[i].scored;
+        }
+        if (!bench_reach_clears(w, p, w.score + unscored - 1))
+        {
+            ++bot_doomed;
+            continue;
+        }
+        ++tested;
+        int prev_gap = w.pipes[w.pipe_count - 2].gap_y;
+        int lowest = -1;
+        int highest = -1;
+        for (int n = table.first_gap; n <= last_gap; ++n)
+        {
+            if (reach_is_reachable(table, prev_gap, n))
+            {
+                lowest = lowest < 0 ? n : lowest;
+                highest = n;
+            }
+        }
+        spawned_stuck += !bench_reach_clears(w, p, w.score + unscored);
+        int gaps[2] = { lowest, highest };
+        for (int gap : gaps)
+        {
+            SimWorld probe = w;
+            probe.pipes[probe.pipe_count - 1].gap_y = gap;
+            probe.pipes[probe.pipe_count - 1].base_y = gap;
+            ++extremes;
+            extremes_stuck += !bench_reach_clears(probe, p, w.score + unscored);
+        }
+    }
+    bool spacing_ok = spacing_min == table.spacing_ticks && spacing_max == table.spacing_ticks;
+    cout << name << "  " << tested << " real spawn states from sim_step (" << bot_doomed << " more where the bot could not clear the previous pipe) searched in "
+         << now_seconds() - start << " s: spawned gap unclearable from the bird's state in " << spawned_stuck << ", highest/lowest allowed gap in " << extremes_stuck << "/"
+         << extremes << "; spawn spacing " << spacing_min << "-" << spacing_max << " ticks, table assumes " << table.spacing_ticks << (spacing_ok ? "" : " (MISMATCH)") << endl;
+    return spacing_ok ? 0 : 1;
+}
+int bench_reach(int row_step)
+{
+    row_step = row_step < 1 ? 1 : row_step;
+    bench_reach_build(EASY);
+    bench_reach_build(HARD);
+    SimParams easy;
+    ReachTable reach;
+    apply_difficulty(EASY, easy, reach);
+    SimParams tight = easy;
+    tight.pipe_gap = 80;
+    tight.pipe_speed = -9.f;
+    tight.pipe_interval = 150;
+    tight.reach = nullptr;
+    int unsound = bench_reach_check("EASY ", easy, row_step);
+    unsound += bench_reach_check("tight", tight, row_step);
+    unsound += bench_reach_live("EASY ", easy, 200);
+    unsound += bench_reach_live("tight", tight, 60);
+    cout << (unsound == 0 ? "reachability check passed" : "reachability check FAILED") << endl;
+    return unsound == 0 ? 0 : 1;
+}
+void make_bird_silhouette(vector<unsigned char>& rgba, int w, int h)
+{
+    rgba.assign((size_t)w * h * 4, 0);
+    for (int y = 0; y < h; ++y)
+    {
+        for (int x = 0; x < w; ++x)
+        {
+            float dx = (x + 0.5f - w / 2.f) / (w * 0.42f);
+            float dy = (y + 0.5f - h / 2.f) / (h * 0.32f);
+            bool body = dx * dx + dy * dy <= 1.f;
+            bool beak = x >= w * 0.75f && y >= h * 0.45f && y <= h * 0.6f;
+            bool wing = x >= w * 0.2f && x <= w * 0.5f && y >= h * 0.15f && y <= h * 0.35f;
+            rgba[4 * ((size_t)y * w + x) + 3] = (body || beak || wing) ? 255 : 0;
+        }
+    }
+}
+void make_pipe_silhouette(vector<unsigned char>& rgba, int w, int h, bool lip_at_bottom)
+{
+    rgba.assign((size_t)w * h * 4, 0);
+    for (int y = 0; y < h; ++y)
+    {
+        bool lip = lip_at_bottom ? y >= h - 12 : y < 12;
+        for (int x = 0; x < w; ++x)
+        {
+            rgba[4 * ((size_t)y * w + x) + 3] = (lip || (x >= 2 && x < w - 2)) ? 255 : 0;
+        }
+    }
+}
+bool pixel_reference_hit(const SimWorld& w, const SimParams& p, const vector<unsigned char>& bird, const vector<unsigned char>& pipe_top, const vector<unsigned char>& pipe_bottom)
+{
+    const int bird_w = 35;
+    const int bird_h = 35;
+    const int pipe_tex_w = 25;
+    const int pipe_tex_h = 100;
+    float angle = w.bird_rotation * 3.141592654f / 180.f;
+    float c = cosf(angle);
+    float s = sinf(angle);
+    for (int py = (int)w.bird_y - 32; py < (int)w.bird_y + 32; ++py)
+    {
+        for (int px = (int)bird_x - 32; px < (int)bird_x + 32; ++px)
+        {
+            float dx = px + 0.5f - bird_x;
+            float dy = py + 0.5f - w.bird_y;
+            float u = c * dx + s * dy + bird_w / 2.f;
+            float v = -s * dx + c * dy + bird_h / 2.f;
+            if (u < 0.f || v < 0.f || u >= bird_w || v >= bird_h || bird[4 * ((int)v * bird_w + (int)u) + 3] < 128)
+            {
+                continue;
+            }
+            if (py < 0 || py >= height)
+            {
+                return true;
+            }
+            for (int i = 0; i < w.pipe_count; ++i)
+            {
+                float along = px + 0.5f - w.pipes[i].x;
+                if (along < 0.f || along >= p.pipe_w)
+                {
+                    continue;
+                }
+                int tu = (int)(along * pipe_tex_w / p.pipe_w);
+                int gap_y = w.pipes[i].gap_y;
+                int bottom_y = gap_y + p.pipe_gap;
+                if (py < gap_y && pipe_top[4 * ((int)((py + 0.5f) * pipe_tex_h / gap_y) * pipe_tex_w + tu) + 3] >= 128)
+                {
+                    return true;
+                }
+                if (py >= bottom_y && pipe_bottom[4 * ((int)((py - bottom_y + 0.5f) * pipe_tex_h / (height - bottom_y)) * pipe_tex_w + tu) + 3] >= 128)
+                {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+void make_bench_masks(CollisionMasks& m, SimParams& p)
+{
+    vector<unsigned char> bird;
+    vector<unsigned char> pipe_top;
+    vector<unsigned char> pipe_bottom;
+    make_bird_silhouette(bird, 35, 35);
+    make_pipe_silhouette(pipe_top, 25, 100, true);
+    make_pipe_silhouette(pipe_bottom, 25, 100, false);
+    mask_set_texture(m, MASK_BIRD_UP, bird.data(), 35, 35, p.pipe_w);
+    mask_set_texture(m, MASK_BIRD_DOWN, bird.data(), 35, 35, p.pipe_w);
+    mask_set_texture(m, MASK_PIPE_TOP, pipe_top.data(), 25, 100, p.pipe_w);
+    mask_set_texture(m, MASK_PIPE_BOTTOM, pipe_bottom.data(), 25, 100, p.pipe_w);
+    p.masks = &m;
+}
+void bench_collision()
+{
+    vector<unsigned char> bird;
+    vector<unsigned char> pipe_top;
+    vector<unsigned char> pipe_bottom;
+    make_bird_silhouette(bird, 35, 35);
+    make_pipe_silhouette(pipe_top, 25, 100, true);
+    make_pipe_silhouette(pipe_bottom, 25, 100, false);
+    ReachTable reach;
+    for (int d = EASY; d <= HARD; ++d)
+    {
+        SimParams boxes;
+        apply_difficulty((Difficulty)d, boxes, reach);
+        CollisionMasks* masks = new CollisionMasks();
+        SimParams pixels = boxes;
+        double start = now_seconds();
+        make_bench_masks(*masks, pixels);
+        double build_ms = (now_seconds() - start) * 1000.0;
+        const int samples = 1 << 16;
+        vector<SimWorld> worlds(samples);
+        SimWorld w;
+        sim_reset(w, 77);
+        unsigned int rng = 3;
+        for (int i = 0; i < samples; ++i)
+        {
+            int jitter = (int)(xorshift32(rng) % 61) - 30;
+            bool flap = w.pipe_count > 0 && w.bird_y > w.pipes[0].gap_y + pixels.pipe_gap / 2 + jitter;
+            sim_step(w, pixels, flap);
+            worlds[i] = w;
+            if (w.bird_y < 0.f || w.bird_y > height || w.tick > 4000)
+            {
+                sim_reset(w, rng);
+            }
+        }
+        const int passes = 40;
+        int box_hits = 0;
+        int mask_hits = 0;
+        start = now_seconds();
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            for (int i = 0; i < samples; ++i)
+            {
+                box_hits += check_collision(worlds[i], boxes) != HIT_NONE;
+            }
+        }
+        double box_ns = (now_seconds() - start) * 1e9 / ((double)passes * samples);
+        start = now_seconds();
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            for (int i = 0; i < samples; ++i)
+            {
+                mask_hits += check_collision(worlds[i], pixels) != HIT_NONE;
+            }
+        }
+        double mask_ns = (now_seconds() - start) * 1e9 / ((double)passes * samples);
+        int broad = 0;
+        int box_wrong = 0;
+        int mask_wrong = 0;
+        int reference_hits = 0;
+        for (int i = 0; i < samples; ++i)
+        {
+            const SimWorld& s = worlds[i];
+            SimBox bounds = get_bird_hit_box(s, pixels);
+            for (int k = 0; k < s.pipe_count; ++k)
+            {
+                if (boxes_intersect(bounds, get_pipe_hit_box(s.pipes[k], pixels, true)) || boxes_intersect(bounds, get_pipe_hit_box(s.pipes[k], pixels, false)))
+                {
+                    ++broad;
+                    break;
+                }
+            }
+            bool reference = pixel_reference_hit(s, pixels, bird, pipe_top, pipe_bottom);
+            reference_hits += reference;
+            box_wrong += (check_collision(s, boxes) != HIT_NONE) != reference;
+            mask_wrong += (check_collision(s, pixels) != HIT_NONE) != reference;
+        }
+        cout << (d == EASY ? "EASY" : "HARD") << "  masks built in " << build_ms << " ms (" << sizeof(CollisionMasks) / 1024 << " KB), box test "
+             << box_ns << " ns, bitmask test " << mask_ns << " ns per tick, narrow phase on " << 100.0 * broad / samples << "% of ticks" << endl;
+        cout << "      " << samples << " ticks, per-pixel reference hits " << reference_hits << ", box test " << box_hits / passes << " hits (" << box_wrong
+             << " wrong), bitmask test " << mask_hits / passes << " hits (" << mask_wrong << " wrong)" << endl;
+        delete masks;
+    }
+}
+void bench_particle_quads(const ParticlePool& pool, BenchVertex* out)
+{
+    for (int i = 0; i < pool.count; ++i)
+    {
+        unsigned int alpha = (unsigned int)((pool.color[i] & 0xFF) * particle_fade(pool, i));
+        unsigned int color = (pool.color[i] & 0xFFFFFF00u) | alpha;
+        float half = pool.size[i] * 0.5f;
+        BenchVertex* quad = out + 4 * i;
+        quad[0] = { pool.x[i] - half, pool.y[i] - half, color, 0.f, 0.f };
+        quad[1] = { pool.x[i] + half, pool.y[i] - half, color, 0.f, 0.f };
+        quad[2] = { pool.x[i] + half, pool.y[i] + half, color, 0.f, 0.f };
+        quad[3] = { pool.x[i] - half, pool.y[i] + half, color, 0.f, 0.f };
+    }
+}
+void bench_particles_at(int target)
+{
+    ParticlePool* pool = new ParticlePool();
+    vector<BenchVertex> vertices(4 * particle_capacity);
+    ParticleEmitter stress = particle_feathers;
+    stress.count = 256;
+    stress.life_min = 50.f;
+    stress.life_max = 70.f;
+    unsigned int rng = 11;
+    const int warmup = 120;
+    const int frames = 600;
+    double update_s = 0.0;
+    double quads_s = 0.0;
+    long long live = 0;
+    long long emitted = 0;
+    for (int frame = 0; frame < warmup + frames; ++frame)
+    {
+        double start = now_seconds();
+        while (pool->count + stress.count <= target)
+        {
+            float x = (float)(xorshift32(rng) % width);
+            float y = (float)(xorshift32(rng) % height);
+            emitted += particles_emit(*pool, stress, x, y, 0.f, 0.f);
+        }
+        particles_update(*pool, 1.f);
+        double mid = now_seconds();
+        bench_particle_quads(*pool, vertices.data());
+        double end = now_seconds();
+        if (frame >= warmup)
+        {
+            update_s += mid - start;
+            quads_s += end - mid;
+            live += pool->count;
+        }
+    }
+    double mean_live = (double)live / frames;
+    double frame_ms = (update_s + quads_s) * 1000.0 / frames;
+    cout << "  " << (int)mean_live << " live: emit+update " << update_s * 1e9 / live << " ns, vertex batch " << quads_s * 1e9 / live
+         << " ns per particle, " << frame_ms << " ms per frame (" << 100.0 * frame_ms / (1000.0 / 60.0) << "% of a 60 fps frame), "
+         << emitted / (warmup + frames) << " spawned per frame" << endl;
+    delete pool;
+}
+void bench_particles()
+{
+    cout << "Particle pool: " << particle_capacity << " slots, " << sizeof(ParticlePool) / 1024 << " KB, one draw call per frame" << endl;
+    bench_particles_at(5000);
+    bench_particles_at(50000);
+    bench_particles_at(particle_capacity);
+}
+double bench_spawn_ns(const SimParams& p, int spawns)
+{
+    SimWorld w;
+    sim_reset(w, 5);
+    int prev = -1;
+    long long checksum = 0;
+    double start = now_seconds();
+    for (int i = 0; i < spawns; ++i)
+    {
+        prev = spawn_gap_y(w.rng, w.next_gap_high, w.pattern, w.speed_scale, prev, p);
+        checksum += prev;
+    }
+    double ns = (now_seconds() - start) * 1e9 / spawns;
+    return checksum == 0 ? -ns : ns;
+}
+int bench_pattern_file(const char* path)
+{
+    ifstream in(path);
+    if (!in.is_open())
+    {
+        cout << "  " << path << ": cannot open" << endl;
+        return 1;
+    }
+    stringstream text;
+    text << in.rdbuf();
+    string source = text.str();
+    ObstacleProgram* prog = new ObstacleProgram();
+    char error[160];
+    const int compiles = 2000;
+    bool ok = true;
+    double start = now_seconds();
+    for (int i = 0; i < compiles && ok; ++i)
+    {
+        ok = pattern_compile(*prog, source.c_str(), error, sizeof(error));
+    }
+    double compile_us = (now_seconds() - start) * 1e6 / compiles;
+    if (!ok)
+    {
+        cout << "  " << path << ": " << error << endl;
+        delete prog;
+        return 1;
+    }
+    ObstacleProgram* copy = new ObstacleProgram();
+    int failures = pattern_set_code(*copy, prog->code, prog->length) ? 0 : 1;
+    const int spawns = 1 << 20;
+    int worst = 0;
+    ReachTable reach;
+    for (int d = EASY; d <= HARD; ++d)
+    {
+        SimParams p;
+        apply_difficulty((Difficulty)d, p, reach);
+        p.pattern = prog;
+        double ns = bench_spawn_ns(p, spawns);
+        SimWorld w;
+        sim_reset(w, 9);
+        int lo = min_gap_y;
+        int hi = get_max_gap_y(p);
+        int pipes = 0;
+        for (int t = 0; t < 200000; ++t)
+        {
+            int before = w.pipe_count;
+            update_pipes(w, p);
+            pipes += w.pipe_count > before;
+            for (int i = 0; i < w.pipe_count; ++i)
+            {
+                if (w.pipes[i].gap_y < lo || w.pipes[i].gap_y > hi)
+                {
+                    ++failures;
+                }
+            }
+        }
+        if (d == EASY)
+        {
+            cout << "  " << path << ": " << prog->length << " bytes, compiled in " << compile_us << " us" << endl;
+        }
+        cout << "    " << (d == EASY ? "EASY" : "HARD") << " " << ns << " ns per spawn, " << pipes << " pipes placed in 200000 ticks, speed now "
+             << w.pattern.speed_pct << "%" << endl;
+        worst = ns > worst ? (int)ns : worst;
+    }
+    if (failures > 0)
+    {
+        cout << "    " << failures << " gaps out of range or bytecode rejected" << endl;
+    }
+    delete copy;
+    delete prog;
+    return failures > 0 ? 1 : 0;
+}
+int bench_pattern(int count, char* paths[])
+{
+    const int spawns = 1 << 20;
+    ReachTable reach;
+    for (int d = EASY; d <= HARD; ++d)
+    {
+        SimParams p;
+        apply_difficulty((Difficulty)d, p, reach);
+        cout << (d == EASY ? "EASY" : "HARD") << " built-in gaps: " << bench_spawn_ns(p, spawns) << " ns per spawn" << endl;
+    }
+    static const char* defaults[] = { "patterns/tunnel.pat", "patterns/zigzag.pat", "patterns/moving.pat", "patterns/ramp.pat" };
+    int failed = 0;
+    if (count == 0)
+    {
+        for (const char* path : defaults)
+        {
+            failed += bench_pattern_file(path);
+        }
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        failed += bench_pattern_file(paths[i]);
+    }
+    return failed > 0 ? 1 : 0;
+}
+Entity bench_spawn_entity(EcsWorld& w, unsigned int& rng)
+{
+    Entity e = ecs_create(w);
+    float x = (float)(width + xorshift32(rng) % 4096);
+    float y = (float)(xorshift32(rng) % height);
+    ecs_add(w.placements, e, Placement{ x, y, 1.f, 1.f, 0.f });
+    if (xorshift32(rng) & 1)
+    {
+        ecs_add(w.visuals, e, Visual{ (int)(xorshift32(rng) % 3), (int)(xorshift32(rng) % 4), 0, 0, 20, 20, 0.f, 0.f });
+    }
+    return e;
+}
+void bench_ecs()
+{
+    const int count = 100000;
+    const int frames = 300;
+    EcsWorld w;
+    ecs_reserve(w, count);
+    unsigned int rng = 21;
+    vector<Entity> entities(count);
+    vector<float> speeds(count);
+    double start = now_seconds();
+    for (int i = 0; i < count; ++i)
+    {
+        entities[i] = bench_spawn_entity(w, rng);
+        speeds[i] = -2.f - (xorshift32(rng) % 300) / 100.f;
+    }
+    double create_ms = (now_seconds() - start) * 1000.0;
+    vector<RenderItem> items;
+    items.reserve(count);
+    double sync_s = 0.0;
+    double recycle_s = 0.0;
+    double render_s = 0.0;
+    long long respawned = 0;
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        double t0 = now_seconds();
+        for (int i = 0; i < count; ++i)
+        {
+            ecs_get(w.placements, entities[i])->x += speeds[i];
+        }
+        double t1 = now_seconds();
+        for (int i = 0; i < count; ++i)
+        {
+            if (ecs_get(w.placements, entities[i])->x < -50.f)
+            {
+                ecs_destroy(w, entities[i]);
+                entities[i] = bench_spawn_entity(w, rng);
+                ++respawned;
+            }
+        }
+        double t2 = now_seconds();
+        ecs_render_list(w, items);
+        double t3 = now_seconds();
+        sync_s += t1 - t0;
+        recycle_s += t2 - t1;
+        render_s += t3 - t2;
+    }
+    double per = 1e9 / ((double)frames * count);
+    double frame_ms = (sync_s + recycle_s + render_s) * 1000.0 / frames;
+    cout << count << " entities created in " << create_ms << " ms, " << w.alive << " alive, " << items.size() << " drawn per frame" << endl;
+    cout << "  placement sync " << sync_s * per << " ns, destroy+respawn " << recycle_s * per << " ns, render list " << render_s * per << " ns per entity" << endl;
+    cout << "  " << frame_ms << " ms per frame (" << 100.0 * frame_ms / (1000.0 / 60.0) << "% of a 60 fps frame), " << respawned / frames << " respawned per frame" << endl;
+}
+unsigned long long bench_float_mix(unsigned long long h, float v)
+{
+    unsigned int bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return (h ^ bits) * 0x100000001B3ull;
+}
+unsigned long long bench_float_hash(const SimWorld& w, unsigned long long h)
+{
+    h = bench_float_mix(h, w.bird_y);
+    h = bench_float_mix(h, w.bird_vel);
+    h = bench_float_mix(h, w.bird_rotation);
+    h = (h ^ (unsigned int)(w.score * 31 + w.pipe_count)) * 0x100000001B3ull;
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        h = bench_float_mix(h, w.pipes[i].x);
+    }
+    return h;
+}
+double bench_float_run(const SimParams& p, int seeds, int ticks, unsigned long long& hash, long long& score)
+{
+    hash = 0xCBF29CE484222325ull;
+    score = 0;
+    double start = now_seconds();
+    for (int seed = 1; seed <= seeds; ++seed)
+    {
+        SimWorld w;
+        sim_reset(w, seed);
+        for (int t = 0; t < ticks; ++t)
+        {
+            int next = 0;
+            while (next < w.pipe_count && w.pipes[next].scored)
+            {
+                ++next;
+            }
+            int target = next < w.pipe_count ? w.pipes[next].gap_y + p.pipe_gap * 2 / 3 : height / 2;
+            if (sim_step(w, p, w.bird_y > target && w.bird_vel > 0).hit != HIT_NONE)
+            {
+                score += w.score;
+                sim_reset(w, w.rng);
+            }
+            hash = bench_float_hash(w, hash);
+        }
+        score += w.score;
+    }
+    return now_seconds() - start;
+}
+double bench_fixed_run(const FixedParams& f, int seeds, int ticks, unsigned long long& hash, long long& score)
+{
+    hash = 0xCBF29CE484222325ull;
+    score = 0;
+    double start = now_seconds();
+    for (int seed = 1; seed <= seeds; ++seed)
+    {
+        FixedWorld w;
+        fixed_reset(w, seed);
+        for (int t = 0; t < ticks; ++t)
+        {
+            int next = 0;
+            while (next < w.pipe_count && w.pipes[next].scored)
+            {
+                ++next;
+            }
+            int target = next < w.pipe_count ? w.pipes[next].gap_y + f.sim->pipe_gap * 2 / 3 : height / 2;
+            if (fixed_step(w, f, w.bird_y > target * fixed_one && w.bird_vel > 0).hit != HIT_NONE)
+            {
+                score += w.score;
+                fixed_reset(w, w.rng);
+            }
+            hash = fixed_hash(w, hash);
+        }
+        score += w.score;
+    }
+    return now_seconds() - start;
+}
+unsigned long long bench_fixed_world_hash(const FixedParams& f, int seeds, int ticks)
+{
+    unsigned long long hash = 0xCBF29CE484222325ull;
+    for (int seed = 1; seed <= seeds; ++seed)
+    {
+        SimWorld w;
+        sim_reset(w, seed);
+        for (int t = 0; t < ticks; ++t)
+        {
+            int next = 0;
+            while (next < w.pipe_count && w.pipes[next].scored)
+            {
+                ++next;
+            }
+            int target = next < w.pipe_count ? w.pipes[next].gap_y + f.sim->pipe_gap * 2 / 3 : height / 2;
+            if (fixed_step_world(w, f, w.bird_y > target && w.bird_vel > 0).hit != HIT_NONE)
+            {
+                sim_reset(w, w.rng);
+            }
+            FixedWorld fw;
+            fixed_from_sim(w, fw);
+            hash = fixed_hash(fw, hash);
+        }
+    }
+    return hash;
+}
+int bench_fixed_masks()
+{
+    SimParams p;
+    apply_difficulty(HARD, p);
+    CollisionMasks* masks = new CollisionMasks();
+    make_bench_masks(*masks, p);
+    FixedParams f;
+    fixed_params(p, f);
+    unsigned long long hash = 0;
+    long long score = 0;
+    double seconds = bench_fixed_run(f, 16, 20000, hash, score);
+    long long ticks = 0;
+    long long hits = 0;
+    long long disagreements = 0;
+    for (int seed = 1; seed <= 16; ++seed)
+    {
+        FixedWorld w;
+        fixed_reset(w, seed);
+        for (int t = 0; t < 20000; ++t)
+        {
+            int target = w.pipe_count > 0 ? w.pipes[w.pipe_count > 1 && w.pipes[0].scored ? 1 : 0].gap_y + p.pipe_gap / 2 : height / 2;
+            SimHit hit = fixed_step(w, f, w.bird_y > target * fixed_one && w.bird_vel > 0).hit;
+            SimWorld s;
+            fixed_to_sim(w, s);
+            ++ticks;
+            hits += hit != HIT_NONE;
+            disagreements += hit != mask_check_collision(s, p, *masks);
+            if (hit != HIT_NONE)
+            {
+                fixed_reset(w, w.rng);
+            }
+        }
+    }
+    cout << "HARD  fixed with bitmasks " << (long long)(16 * 20000 / seconds) << " steps/s, " << hits << " hits in " << ticks << " ticks, " << disagreements
+         << " disagreements with the float mask test" << endl;
+    delete masks;
+    return disagreements > 0 ? 1 : 0;
+}
+int bench_fixed_toggle()
+{
+    const int num_envs = 64;
+    FlappyEnv* envs[2] = { flappy_env_create(num_envs, FLAPPY_ENV_EASY, 1), flappy_env_create(num_envs, FLAPPY_ENV_EASY, 1) };
+    vector<float> observations[2];
+    vector<unsigned char> actions(num_envs);
+    for (int e = 0; e < 2; ++e)
+    {
+        observations[e].resize((size_t)num_envs * flappy_env_observation_size());
+        flappy_env_set_buffers(envs[e], observations[e].data(), nullptr, nullptr, nullptr);
+        flappy_env_reset(envs[e], 99);
+    }
+    float worst = 0.f;
+    for (int k = 0; k < 120; ++k)
+    {
+        for (int i = 0; i < num_envs; ++i)
+        {
+            actions[i] = (k + i) % 9 == 0 ? 1 : 0;
+        }
+        if (k == 60)
+        {
+            flappy_env_set_fixed_point(envs[1], 1);
+        }
+        flappy_env_step(envs[0], actions.data());
+        flappy_env_step(envs[1], actions.data());
+        if (k == 60)
+        {
+            for (size_t j = 0; j < observations[0].size(); ++j)
+            {
+                float diff = fabsf(observations[0][j] - observations[1][j]);
+                worst = diff > worst ? diff : worst;
+            }
+        }
+    }
+    flappy_env_destroy(envs[0]);
+    flappy_env_destroy(envs[1]);
+    bool ok = worst < 1e-3f;
+    cout << "switching to fixed point mid-episode: largest observation jump " << worst << (ok ? ", worlds carried over" : ", worlds were NOT carried over") << endl;
+    return ok ? 0 : 1;
+}
+int bench_fixed()
+{
+    const unsigned long long reference[2] = { 0x193ca2e74216a7eeull, 0x2d1a6fe60ecc8a7eull };
+    const int seeds = 64;
+    const int ticks = 20000;
+    int mismatches = 0;
+    ReachTable reach;
+    for (int d = EASY; d <= HARD; ++d)
+    {
+        SimParams p;
+        apply_difficulty((Difficulty)d, p, reach);
+        FixedParams f;
+        fixed_params(p, f);
+        unsigned long long float_hash = 0;
+        unsigned long long hash = 0;
+        long long float_score = 0;
+        long long score = 0;
+        double float_s = bench_float_run(p, seeds, ticks, float_hash, float_score);
+        double fixed_s = bench_fixed_run(f, seeds, ticks, hash, score);
+        double steps = (double)seeds * ticks;
+        bool match = hash == reference[d];
+        mismatches += !match;
+        cout << (d == EASY ? "EASY" : "HARD") << "  float " << (long long)(steps / float_s) << " steps/s, fixed " << (long long)(steps / fixed_s)
+             << " steps/s, " << float_score << " vs " << score << " pipes passed by the same controller" << endl;
+        cout << "  fixed trajectory hash " << hex << hash << (match ? " matches" : " DIFFERS from") << " the reference, float hash " << float_hash << dec << endl;
+        unsigned long long world_hash = bench_fixed_world_hash(f, seeds, ticks);
+        mismatches += world_hash != hash;
+        cout << "  stepping a SimWorld through fixed_step_world " << (world_hash == hash ? "reproduces" : "DOES NOT reproduce") << " the fixed trajectory" << endl;
+    }
+    mismatches += bench_fixed_masks();
+    mismatches += bench_fixed_toggle();
+    bench_env_size(4096, 1, false);
+    bench_env_size(4096, 1, true);
+    return mismatches > 0 ? 1 : 0;
+}
+void bench_pacer_work(unsigned int& rng, double period)
+{
+    double until = pacer_now() + period * (0.1 + (xorshift32(rng) % 400) / 1000.0);
+    while (pacer_now() < until)
+    {
+    }
+}
+void bench_pacer_report(const char* name, const FrameStats& frames, const FrameStats* lateness, long long missed, double period)
+{
+    cout << "  " << name << ": frame mean " << stats_mean(frames) * 1000.0 << " ms (target " << period * 1000.0 << "), p99 "
+         << stats_percentile(frames, 0.99) * 1000.0 << " ms, worst " << frames.worst * 1000.0 << " ms";
+    if (lateness != nullptr)
+    {
+        cout << ", late by " << stats_mean(*lateness) * 1e6 << " us mean / " << stats_percentile(*lateness, 0.99) * 1e6 << " us p99";
+    }
+    cout << ", " << missed << " missed of " << frames.count << endl;
+}
+void bench_pacer_rate(double hz, double seconds)
+{
+    double period = 1.0 / hz;
+    unsigned int rng = 7;
+    FrameStats* limiter = new FrameStats();
+    long long limiter_missed = 0;
+    double end = pacer_now() + seconds;
+    double frame_start = pacer_now();
+    while (frame_start < end)
+    {
+        bench_pacer_work(rng, period);
+        double remaining = period - (pacer_now() - frame_start);
+        if (remaining > 0.0)
+        {
+            this_thread::sleep_for(chrono::duration<double>(remaining));
+        }
+        double now = pacer_now();
+        stats_add(*limiter, now - frame_start);
+        limiter_missed += now - frame_start > period * 1.5;
+        frame_start = now;
+    }
+    cout << hz << " Hz" << endl;
+    bench_pacer_report("sleep limiter", *limiter, nullptr, limiter_missed, period);
+    delete limiter;
+    const double spins[2] = { 0.0, 0.002 };
+    for (double spin : spins)
+    {
+        FramePacer* pacer = new FramePacer();
+        pacer_init(*pacer, hz, PACER_SLEEP_SPIN, spin);
+        end = pacer_now() + seconds;
+        while (pacer_now() < end)
+        {
+            bench_pacer_work(rng, period);
+            pacer_wait(*pacer);
+        }
+        bench_pacer_report(spin > 0.0 ? "pacer, 2 ms spin" : "pacer, sleep only", pacer->frames, &pacer->lateness, pacer->missed, period);
+        pacer_close(*pacer);
+        delete pacer;
+    }
+}
+void bench_pacer()
+{
+    const double rates[3] = { 60.0, 144.0, 240.0 };
+    for (double hz : rates)
+    {
+        bench_pacer_rate(hz, 2.0);
+    }
+}
+bool bench_spectate_matches(const SpectateView& v, const SimWorld& w)
+{
+    if (!v.synced || v.world.tick != w.tick || v.world.score != w.score || v.world.pipe_count != w.pipe_count || fabs(v.world.bird_y - w.bird_y) > 1.f / spectate_y_steps)
+    {
+        return false;
+    }
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        if (v.world.pipes[i].x != w.pipes[i].x || v.world.pipes[i].gap_y != w.pipes[i].gap_y)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+int bench_spectate_clients(int count, int ticks)
+{
+    if (!spectate_listen(0))
+    {
+        cout << "cannot listen on a local port" << endl;
+        return 1;
+    }
+    SimParams p;
+    apply_difficulty(HARD, p);
+    SimWorld w;
+    sim_reset(w, 1);
+    vector<SpectateClient>* clients = new vector<SpectateClient>(count);
+    for (SpectateClient& c : *clients)
+    {
+        if (!spectate_connect(c, "127.0.0.1", spectate_port()))
+        {
+            cout << "cannot connect to port " << spectate_port() << endl;
+            delete clients;
+            spectate_close();
+            return 1;
+        }
+    }
+    double deadline = now_seconds() + 5.0;
+    while (spectate_clients() < count && now_seconds() < deadline)
+    {
+        spectate_poll(1, w, p);
+    }
+    FrameStats* delay = new FrameStats();
+    long long mismatches = 0;
+    long long timeouts = 0;
+    long long runs = 1;
+    double sim_seconds = 0.0;
+    vector<bool> seen(count);
+    for (int t = 0; t < ticks; ++t)
+    {
+        int next = 0;
+        while (next < w.pipe_count && w.pipes[next].scored)
+        {
+            ++next;
+        }
+        int target = next < w.pipe_count ? w.pipes[next].gap_y + p.pipe_gap * 2 / 3 : height / 2;
+        bool flap = w.bird_y > target && w.bird_vel > 0;
+        double step_start = now_seconds();
+        if (sim_step(w, p, flap).hit != HIT_NONE)
+        {
+            sim_reset(w, w.rng);
+            ++runs;
+        }
+        sim_seconds += now_seconds() - step_start;
+        double published = now_seconds();
+        spectate_publish(w, p, flap);
+        int waiting = count;
+        deadline = published + 1.0;
+        seen.assign(count, false);
+        while (waiting > 0 && now_seconds() < deadline)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                SpectateClient& c = (*clients)[i];
+                if (seen[i] || spectate_receive(c) < 0 || c.view.world.tick != w.tick)
+                {
+                    continue;
+                }
+                stats_add(*delay, now_seconds() - published);
+                mismatches += !bench_spectate_matches(c.view, w);
+                seen[i] = true;
+                --waiting;
+            }
+        }
+        timeouts += waiting;
+    }
+    SpectateStats stats = spectate_stats();
+    double seconds_of_play = (double)ticks / 60.0;
+    cout << count << " spectators, " << ticks << " ticks, " << runs << " runs: " << (double)stats.bytes_published / seconds_of_play << " B/s per spectator ("
+         << (double)stats.bytes_published / ticks << " B/tick, " << stats.keyframes << " keyframes), publish " << stats.publish_seconds / stats.publishes * 1e6
+         << " us/tick on the game thread vs sim " << sim_seconds / ticks * 1e6 << " us/tick" << endl;
+    cout << "  delay mean " << stats_mean(*delay) * 1e6 << " us, p99 " << stats_percentile(*delay, 0.99) * 1e6 << " us, worst " << delay->worst * 1e6
+         << " us, " << mismatches << " mismatched views, " << timeouts << " timeouts, " << stats.clients_dropped << " dropped, " << stats.frames_dropped
+         << " frames resynced" << endl;
+    for (SpectateClient& c : *clients)
+    {
+        spectate_disconnect(c);
+    }
+    delete clients;
+    delete delay;
+    spectate_close();
+    return mismatches + timeouts + stats.clients_dropped > 0 ? 1 : 0;
+}
+int bench_spectate()
+{
+    const int counts[3] = { 1, 8, 64 };
+    int failures = 0;
+    for (int count : counts)
+    {
+        failures += bench_spectate_clients(count, 3600);
+    }
+    return failures > 0 ? 1 : 0;
+}
+void bench_replaydb_report(const char* name, vector<double>& micros)
+{
+    sort(micros.begin(), micros.end());
+    double total = 0.0;
+    for (double m : micros)
+    {
+        total += m;
+    }
+    cout << "  " << name << ": " << micros.size() << " queries, mean " << total / micros.size() << " us, p50 " << micros[micros.size() / 2] << " us, p99 "
+         << micros[micros.size() * 99 / 100] << " us, worst " << micros.back() << " us" << endl;
+}
+int bench_replaydb(int runs)
+{
+    const char* path = "bench_replays.fdb";
+    const int seed_pool = 50000;
+    const long long start_time = 1790000000;
+    const long long week = 7 * 24 * 3600;
+    const long long span = 8 * week;
+    remove(path);
+    remove("bench_replays.fdb.idx");
+    ReplayDb* db = new ReplayDb();
+    if (!replaydb_open(*db, path))
+    {
+        cout << "cannot create " << path << endl;
+        delete db;
+        return 1;
+    }
+    vector<ReplayKey> truth;
+    truth.reserve(runs);
+    vector<double> during;
+    vector<double> during_compaction;
+    unsigned int rng = 12345;
+    Replay r;
+    double start = now_seconds();
+    for (int i = 0; i < runs; ++i)
+    {
+        r.difficulty = xorshift32(rng) & 1;
+        r.seed = xorshift32(rng) % seed_pool;
+        unsigned int roll = xorshift32(rng);
+        r.score = (int)(roll % 16) * (int)((roll >> 4) % 16) + (int)((roll >> 8) % 4);
+        r.ticks = 90 + r.score * 90 + (int)(xorshift32(rng) % 90);
+        r.flap_ticks.resize(r.score + 4 < 64 ? r.score + 4 : 64);
+        for (int f = 0; f < (int)r.flap_ticks.size(); ++f)
+        {
+            r.flap_ticks[f] = f * 40 + (int)(xorshift32(rng) % 40);
+        }
+        long long timestamp = start_time + span * i / runs;
+        if (!replaydb_append(*db, r, timestamp))
+        {
+            cout << "append failed at run " << i << endl;
+            delete db;
+            return 1;
+        }
+        truth.push_back(ReplayKey{ r.difficulty, r.seed, r.score, r.ticks, timestamp, 0 });
+        if (i % 100 == 99)
+        {
+            ReplayKey best;
+            bool compacting = replaydb_stats(*db).compacting;
+            double q = now_seconds();
+            replaydb_best(*db, r.difficulty, xorshift32(rng) % seed_pool, best);
+            (compacting ? during_compaction : during).push_back((now_seconds() - q) * 1e6);
+        }
+    }
+    double append_s = now_seconds() - start;
+    start = now_seconds();
+    replaydb_compact(*db, true);
+    double final_compact_s = now_seconds() - start;
+    ReplayDbStats stats = replaydb_stats(*db);
+    cout << runs << " runs appended in " << append_s << " s (" << (long long)(runs / append_s) << " runs/s), " << stats.data_bytes / 1e6 << " MB data, "
+         << stats.index_bytes / 1e6 << " MB index" << endl;
+    cout << "  " << stats.compactions << " background compactions, " << stats.compact_seconds << " s total, final one waited " << final_compact_s * 1000.0 << " ms" << endl;
+    bench_replaydb_report("best-run lookups while appending, no compaction", during);
+    if (!during_compaction.empty())
+    {
+        bench_replaydb_report("best-run lookups while appending, compaction running", during_compaction);
+    }
+    int mismatches = 0;
+    vector<double> best_us;
+    vector<double> range_us;
+    vector<double> top_us;
+    vector<ReplayKey> found;
+    for (int q = 0; q < 20000; ++q)
+    {
+        int d = q & 1;
+        unsigned int seed = xorshift32(rng) % seed_pool;
+        ReplayKey best;
+        double t = now_seconds();
+        bool any = replaydb_best(*db, d, seed, best);
+        best_us.push_back((now_seconds() - t) * 1e6);
+        int min_score = (int)(xorshift32(rng) % 64);
+        long long from = start_time + (long long)(xorshift32(rng) % (unsigned int)span);
+        long long to = from + week;
+        t = now_seconds();
+        int count = replaydb_range(*db, d, seed, min_score, INT_MAX, from, to, found);
+        range_us.push_back((now_seconds() - t) * 1e6);
+        if (q % 100 != 0)
+        {
+            continue;
+        }
+        int expected_best = -1;
+        int expected_count = 0;
+        for (const ReplayKey& k : truth)
+        {
+            if (k.difficulty == d && k.seed == seed)
+            {
+                expected_best = k.score > expected_best ? k.score : expected_best;
+                expected_count += k.score >= min_score && k.timestamp >= from && k.timestamp < to;
+            }
+        }
+        mismatches += any != (expected_best >= 0) || (any && best.score != expected_best) || count != expected_count;
+    }
+    for (int q = 0; q < 200; ++q)
+    {
+        int d = q & 1;
+        long long from = start_time + (long long)(xorshift32(rng) % (unsigned int)(span - week));
+        long long to = from + week;
+        double t = now_seconds();
+        int count = replaydb_top(*db, d, from, to, 100, found);
+        top_us.push_back((now_seconds() - t) * 1e6);
+        if (q % 20 != 0)
+        {
+            continue;
+        }
+        vector<int> expected;
+        for (const ReplayKey& k : truth)
+        {
+            if (k.difficulty == d && k.timestamp >= from && k.timestamp < to)
+            {
+                expected.push_back(k.score);
+            }
+        }
+        sort(expected.rbegin(), expected.rend());
+        expected.resize(expected.size() < 100 ? expected.size() : 100);
+        bool same = count == (int)expected.size();
+        for (int i = 0; same && i < count; ++i)
+        {
+            same = found[i].score == expected[i];
+        }
+        mismatches += !same;
+    }
+    bench_replaydb_report("best run on a seed", best_us);
+    bench_replaydb_report("seed runs by score and week", range_us);
+    bench_replaydb_report("top 100 of a week", top_us);
+    ReplayKey best;
+    Replay loaded;
+    start = now_seconds();
+    bool loaded_ok = replaydb_best(*db, HARD, 7, best) && replaydb_load(*db, best, loaded) && loaded.seed == 7 && loaded.score == best.score;
+    double load_us = (now_seconds() - start) * 1e6;
+    replaydb_close(*db);
+    start = now_seconds();
+    bool reopened = replaydb_open(*db, path);
+    double reopen_ms = (now_seconds() - start) * 1000.0;
+    stats = replaydb_stats(*db);
+    cout << "  best HARD run on seed 7 loaded in " << load_us << " us, reopened in " << reopen_ms << " ms with " << stats.indexed << " indexed and "
+         << stats.pending << " pending runs" << endl;
+    mismatches += !loaded_ok + !reopened + (stats.runs != runs);
+    cout << "  " << mismatches << " results differ from a full scan" << endl;
+    replaydb_close(*db);
+    delete db;
+    remove(path);
+    remove("bench_replays.fdb.idx");
+    return mismatches > 0 ? 1 : 0;
+}
+long long bench_counters_sink = 0;
+void bench_counters_report(const PerfCounters& c, const char* name, const CounterValues& v, long long ticks)
+{
+    cout << "  " << name << ": " << v.seconds * 1e9 / ticks << " ns/tick";
+    for (int k = 0; k < COUNTER_KINDS; ++k)
+    {
+        if (c.available[k])
+        {
+            cout << ", " << v.value[k] / ticks << " " << counter_name(k);
+        }
+    }
+    if (c.available[COUNTER_CYCLES] && c.available[COUNTER_INSTRUCTIONS] && v.value[COUNTER_CYCLES] > 0.0)
+    {
+        cout << ", IPC " << v.value[COUNTER_INSTRUCTIONS] / v.value[COUNTER_CYCLES];
+    }
+    for (int k = 0; k < COUNTER_KINDS; ++k)
+    {
+        if (c.available[k] && v.running[k] < v.enabled[k] * 0.99)
+        {
+            cout << ", " << counter_name(k) << " counted " << 100.0 * v.running[k] / v.enabled[k] << "% of the time";
+        }
+    }
+    cout << endl;
+}
+template <class F>
+void bench_counters_phase(PerfCounters& c, const char* name, const vector<SimWorld>& worlds, vector<SimWorld>& work, int count, F step)
+{
+    const int passes = 4;
+    CounterValues total;
+    for (int pass = 0; pass < passes; ++pass)
+    {
+        work.assign(worlds.begin(), worlds.begin() + count);
+        counters_begin(c);
+        for (int i = 0; i < count; ++i)
+        {
+            step(work[i]);
+        }
+        CounterValues v = counters_end(c);
+        for (int k = 0; k < COUNTER_KINDS; ++k)
+        {
+            total.value[k] += v.value[k];
+            total.enabled[k] += v.enabled[k];
+            total.running[k] += v.running[k];
+        }
+        total.seconds += v.seconds;
+    }
+    bench_counters_report(c, name, total, (long long)passes * count);
+}
+void bench_counters()
+{
+    PerfCounters* c = new PerfCounters();
+    if (!counters_open(*c))
+    {
+        cout << "Hardware counters unavailable: " << c->reason << ". Reporting wall-clock time only." << endl;
+    }
+    else if (c->reason[0] != '\0')
+    {
+        cout << "Note: " << c->reason << endl;
+    }
+    SimParams boxes;
+    apply_difficulty(HARD, boxes);
+    CollisionMasks* masks = new CollisionMasks();
+    SimParams pixels = boxes;
+    make_bench_masks(*masks, pixels);
+    RasterAssets* assets = new RasterAssets();
+    int sizes[5][2] = { { width, height }, { 35, 35 }, { 35, 35 }, { 25, 100 }, { 25, 100 } };
+    vector<unsigned char> rgba;
+    for (int i = 0; i < RASTER_TEXTURE_COUNT; ++i)
+    {
+        fill_test_texture(rgba, sizes[i][0], sizes[i][1], (unsigned char)(60 + 30 * i));
+        raster_set_texture(*assets, i, rgba.data(), sizes[i][0], sizes[i][1]);
+    }
+    const int samples = 1 << 16;
+    vector<SimWorld> worlds(samples);
+    vector<SimWorld> work;
+    SimWorld w;
+    sim_reset(w, 77);
+    unsigned int rng = 3;
+    for (int i = 0; i < samples; ++i)
+    {
+        int jitter = (int)(xorshift32(rng) % 61) - 30;
+        bool flap = w.pipe_count > 0 && w.bird_y > w.pipes[0].gap_y + boxes.pipe_gap / 2 + jitter;
+        sim_step(w, boxes, flap);
+        worlds[i] = w;
+        if (w.bird_y < 0.f || w.bird_y > height || w.tick > 4000)
+        {
+            sim_reset(w, rng);
+        }
+    }
+    cout << "HARD, " << samples << " recorded ticks per phase, 4 passes" << endl;
+    bench_counters_phase(*c, "update_bird", worlds, work, samples, [&](SimWorld& s) { update_bird(s, boxes); });
+    bench_counters_phase(*c, "update_pipes", worlds, work, samples, [&](SimWorld& s) { bench_counters_sink += update_pipes(s, boxes); });
+    bench_counters_phase(*c, "check_collision (boxes)", worlds, work, samples, [&](SimWorld& s) { bench_counters_sink += check_collision(s, boxes); });
+    bench_counters_phase(*c, "check_collision (bitmasks)", worlds, work, samples, [&](SimWorld& s) { bench_counters_sink += check_collision(s, pixels); });
+    bench_counters_phase(*c, "sim_step (bitmasks)", worlds, work, samples, [&](SimWorld& s) { bench_counters_sink += sim_step(s, pixels, s.tick % 19 == 0).hit; });
+    const int draw_sizes[2][2] = { { 84, 84 }, { width, height } };
+    for (int d = 0; d < 2; ++d)
+    {
+        int out_w = draw_sizes[d][0];
+        int out_h = draw_sizes[d][1];
+        raster_prepare(*assets, out_w, out_h);
+        vector<unsigned char> out((size_t)out_w * out_h);
+        string name = "draw (software raster " + to_string(out_w) + "x" + to_string(out_h) + ")";
+        bench_counters_phase(*c, name.c_str(), worlds, work, d == 0 ? samples / 4 : samples / 64, [&](SimWorld& s) { raster_draw_world(*assets, s, boxes, out.data()); });
+    }
+    counters_close(*c);
+    delete c;
+    delete masks;
+    delete assets;
+}
+void bench_queue_quad(RenderQueue& q, vector<BenchVertex>& vertices, int layer, int material)
+{
+    int first = (int)vertices.size();
+    for (int k = 0; k < 4; ++k)
+    {
+        vertices.push_back({ (float)layer, (float)material, 0xFFFFFFFFu, 0.f, 0.f });
+    }
+    queue_vertices(q, layer, material, first, 4);
+}
+void bench_queue_frame(RenderQueue& q, vector<BenchVertex>& vertices, const BenchDrawScene& scene, bool atlas, int particles)
+{
+    const int background = 1;
+    const int ui = 2;
+    const int bird = 3;
+    const int pipe_down = 4;
+    const int pipe_up = 5;
+    const int font = 6;
+    queue_begin(q);
+    vertices.clear();
+    bench_queue_quad(q, vertices, 0, background);
+    if (scene.game)
+    {
+        for (int i = 0; i < max_pipes; ++i)
+        {
+            bench_queue_quad(q, vertices, 1, pipe_down);
+            bench_queue_quad(q, vertices, 1, pipe_up);
+        }
+        bench_queue_quad(q, vertices, 2, bird);
+        int first = (int)vertices.size();
+        vertices.resize(first + 4 * particles);
+        queue_vertices(q, 3, queue_untextured, first, 4 * particles);
+    }
+    if (scene.overlay)
+    {
+        bench_queue_quad(q, vertices, 5, queue_untextured);
+    }
+    for (int i = 0; i < scene.text_count; ++i)
+    {
+        queue_drawable(q, scene.text_layer, font + scene.text_size[i], i, scene.text_calls[i]);
+    }
+    if (scene.menu_bird)
+    {
+        bench_queue_quad(q, vertices, 6, bird);
+    }
+    for (int i = 0; i < scene.buttons; ++i)
+    {
+        bench_queue_quad(q, vertices, 6, atlas ? ui : 100 + i);
+    }
+}
+int bench_queue_gather(const RenderQueue& q, const vector<BenchVertex>& vertices, vector<BenchVertex>& batch)
+{
+    int drawn = 0;
+    for (const QueueBatch& b : q.batches)
+    {
+        if (b.drawable >= 0 || b.contiguous)
+        {
+            drawn += b.vertex_count;
+            continue;
+        }
+        batch.clear();
+        for (int i = b.first_command; i < b.first_command + b.command_count; ++i)
+        {
+            const QueueCommand& c = q.commands[i];
+            batch.insert(batch.end(), vertices.begin() + c.first, vertices.begin() + c.first + c.count);
+        }
+        drawn += (int)batch.size();
+    }
+    return drawn;
+}
+int bench_renderqueue()
+{
+    const BenchDrawScene scenes[] = {
+        { "MAIN_MENU", false, true, false, 4, 6, 1, { 48 }, { 1 } },
+        { "SETTINGS_MENU", false, false, false, 5, 6, 0, {}, {} },
+        { "LEADERBOARD_MENU", false, false, false, 1, 6, 4, { 60, 48, 48, 48 }, { 2, 2, 2, 2 } },
+        { "PLAYING", true, false, false, 0, 4, 2, { 64, 64 }, { 2, 2 } },
+        { "PAUSED", true, false, true, 4, 6, 0, {}, {} },
+        { "GAME_OVER", true, false, false, 3, 6, 2, { 72, 40 }, { 2, 2 } },
+    };
+    const int particles = 300;
+    const int frames = 20000;
+    RenderQueue q;
+    queue_reserve(q, 128);
+    vector<BenchVertex> vertices;
+    vertices.reserve(4 * (particles + 64));
+    vector<BenchVertex> batch;
+    batch.reserve(4 * 64);
+    int failures = 0;
+    cout << "Per frame, " << max_pipes << " pipes and " << particles << " particles in play: direct (one texture per button) / direct with the button atlas -> sorted and batched" << endl;
+    for (const BenchDrawScene& scene : scenes)
+    {
+        bench_queue_frame(q, vertices, scene, false, particles);
+        queue_finish(q);
+        RenderQueueStats before = q.frame;
+        bench_queue_frame(q, vertices, scene, true, particles);
+        queue_finish(q);
+        RenderQueueStats after = q.frame;
+        int expected = (int)vertices.size();
+        int drawn = bench_queue_gather(q, vertices, batch);
+        bool ordered = true;
+        for (int i = 1; i < (int)q.commands.size(); ++i)
+        {
+            ordered = ordered && (q.commands[i - 1].key >> 56) <= (q.commands[i].key >> 56);
+        }
+        double start = now_seconds();
+        long long sink = 0;
+        for (int f = 0; f < frames; ++f)
+        {
+            bench_queue_frame(q, vertices, scene, true, particles);
+            queue_finish(q);
+            sink += bench_queue_gather(q, vertices, batch);
+        }
+        double us = (now_seconds() - start) * 1e6 / frames;
+        bool ok = ordered && drawn == expected && sink == (long long)drawn * frames;
+        failures += !ok;
+        printf("  %-17s %3lld commands: %3lld / %3lld / %3lld draw calls, %3lld / %3lld / %3lld texture changes, %.2f us to queue, sort and batch%s\n", scene.name,
+               after.commands, before.immediate_calls, after.immediate_calls, after.batched_calls, before.immediate_changes, after.immediate_changes,
+               after.batched_changes, us, ok ? "" : "  MISMATCH");
+    }
+    return failures == 0 ? 0 : 1;
+}
+bool bench_metrics_valid(const string& body, long long frames)
+{
+    const char* required[] = { "flappy_frame_seconds_bucket{le=\"+Inf\"}", "flappy_frame_seconds_sum", "flappy_frames_dropped_total",
+                               "flappy_runs_started_total{difficulty=\"easy\"}", "flappy_runs_finished_total{difficulty=\"hard\"}",
+                               "flappy_leaderboard_write_seconds_count", "flappy_asset_load_seconds" };
+    for (const char* name : required)
+    {
+        if (body.find(string(name) + " ") == string::npos)
+        {
+            cout << "  missing " << name << endl;
+            return false;
+        }
+    }
+    istringstream lines(body);
+    string line;
+    while (getline(lines, line))
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        size_t space = line.rfind(' ');
+        char* end = nullptr;
+        strtod(line.c_str() + space + 1, &end);
+        if (space == string::npos || space == 0 || *end != '\0')
+        {
+            cout << "  malformed line: " << line << endl;
+            return false;
+        }
+    }
+    size_t at = body.find("flappy_frame_seconds_count ");
+    return at != string::npos && atoll(body.c_str() + at + 27) == frames;
+}
+void bench_metrics_frames(const char* name, int frames, int ticks, vector<double>& micros)
+{
+    SimParams p;
+    apply_difficulty(HARD, p);
+    SimWorld w;
+    sim_reset(w, 9);
+    micros.clear();
+    for (int f = 0; f < frames; ++f)
+    {
+        double start = now_seconds();
+        for (int t = 0; t < ticks; ++t)
+        {
+            bool flap = w.pipe_count > 0 && w.bird_y > w.pipes[0].gap_y + p.pipe_gap / 2;
+            if (sim_step(w, p, flap).hit != HIT_NONE)
+            {
+                sim_reset(w, w.rng);
+            }
+        }
+        double seconds = now_seconds() - start;
+        metrics_frame(seconds, seconds > 1.0 / 60.0);
+        micros.push_back(seconds * 1e6);
+    }
+    sort(micros.begin(), micros.end());
+    double total = 0.0;
+    for (double m : micros)
+    {
+        total += m;
+    }
+    cout << "  " << name << ": mean " << total / frames << " us, p99 " << micros[frames * 99 / 100] << " us, worst " << micros.back() << " us per frame" << endl;
+}
+int bench_metrics()
+{
+    const int records = 10000000;
+    double start = now_seconds();
+    for (int i = 0; i < records; ++i)
+    {
+        metrics_frame((i % 40) * 0.001, (i & 1023) == 0);
+    }
+    double record_ns = (now_seconds() - start) * 1e9 / records;
+    long long frames = records;
+    metrics_asset_load(0.25);
+    metrics_run_started(EASY);
+    metrics_run_finished(HARD);
+    metrics_leaderboard_write(0.0004);
+    cout << "Recording a frame: " << record_ns << " ns (relaxed atomic adds on the render thread)" << endl;
+    if (!metrics_listen(0))
+    {
+        cout << "Cannot listen on a local port" << endl;
+        return 1;
+    }
+    int port = metrics_port();
+    const int scrapes = 200;
+    vector<double> micros;
+    string response;
+    bool ok = true;
+    for (int i = 0; i < scrapes; ++i)
+    {
+        double t0 = now_seconds();
+        ok = metrics_fetch(port, "/metrics", response) && ok;
+        micros.push_back((now_seconds() - t0) * 1e6);
+    }
+    size_t body_at = response.find("\r\n\r\n");
+    string body = body_at == string::npos ? string() : response.substr(body_at + 4);
+    ok = ok && bench_metrics_valid(body, frames);
+    string missing;
+    bool rejected = !metrics_fetch(port, "/nothing", missing) && missing.compare(0, 12, "HTTP/1.1 404") == 0;
+    sort(micros.begin(), micros.end());
+    cout << "Scrape on port " << port << ": " << body.size() << " bytes, p50 " << micros[scrapes / 2] << " us, p99 " << micros[scrapes * 99 / 100]
+         << " us, format " << (ok ? "valid" : "INVALID") << ", unknown paths " << (rejected ? "rejected" : "NOT REJECTED") << endl;
+    const int frame_count = 1200;
+    const int ticks = 60000;
+    bench_metrics_frames("no scraper", frame_count, ticks, micros);
+    atomic<bool> scraping(true);
+    atomic<int> scraped(0);
+    thread scraper([&]() {
+        string r;
+        while (scraping.load())
+        {
+            scraped += metrics_fetch(port, "/metrics", r);
+            this_thread::sleep_for(chrono::milliseconds(100));
+        }
+    });
+    bench_metrics_frames("scraped at 10 Hz", frame_count, ticks, micros);
+    scraping.store(false);
+    scraper.join();
+    cout << "  " << scraped.load() << " scrapes during the run" << endl;
+    MetricsStats stats = metrics_stats();
+    metrics_close();
+    cout << "Server: " << stats.scrapes << " scrapes, " << stats.rejected << " rejected, " << stats.bytes_sent << " bytes, " << stats.render_seconds / stats.scrapes * 1e6
+         << " us to render each" << endl;
+    return ok && rejected ? 0 : 1;
+}
+void bench_flight_frames(SimWorld& w, const SimParams& p, int frames, int sleep_ms)
+{
+    for (int f = 0; f < frames; ++f)
+    {
+        flight_begin_frame(2);
+        if ((f & 7) == 0)
+        {
+            flight_input(FLIGHT_KEY_DOWN, 57, 0, 0);
+        }
+        flight_phase(FLIGHT_EVENTS);
+        bool flap = w.pipe_count > 0 && w.bird_y > w.pipes[0].gap_y + p.pipe_gap / 2;
+        if (sim_step(w, p, flap).hit != HIT_NONE)
+        {
+            sim_reset(w, w.rng);
+        }
+        flight_phase(FLIGHT_UPDATE);
+        flight_phase(FLIGHT_DRAW);
+        if (sleep_ms > 0)
+        {
+            this_thread::sleep_for(chrono::milliseconds(sleep_ms));
+        }
+        flight_phase(FLIGHT_WAIT);
+        flight_phase(FLIGHT_PRESENT);
+        flight_end_frame(w.tick, w.score, flight_hash(&w, (int)sizeof(w)), FLIGHT_AUTOPILOT | FLIGHT_STARTED);
+    }
+}
+bool bench_flight_find(long long first_time, long long last_time, unsigned int frame, FlightDump& dump)
+{
+    bool found = false;
+    for (long long t = first_time; t <= last_time; ++t)
+    {
+        char path[96];
+        snprintf(path, sizeof(path), "flight_hitch_%lld_%u.ffr", t, frame);
+        if (!found && flight_load(path, dump))
+        {
+            found = true;
+        }
+        remove(path);
+    }
+    return found;
+}
+int bench_flight()
+{
+    const char* states[] = { "MAIN_MENU", "DIFFICULTY_SELECT", "PLAYING", "GAME_OVER" };
+    SimParams p;
+    apply_difficulty(HARD, p);
+    SimWorld w;
+    sim_reset(w, 11);
+    const int frames = 2000000;
+    flight_open(1000.0, states, 4);
+    double start = now_seconds();
+    bench_flight_frames(w, p, frames, 0);
+    double with_ns = (now_seconds() - start) * 1e9 / frames;
+    flight_close();
+    sim_reset(w, 11);
+    start = now_seconds();
+    for (int f = 0; f < frames; ++f)
+    {
+        bool flap = w.pipe_count > 0 && w.bird_y > w.pipes[0].gap_y + p.pipe_gap / 2;
+        if (sim_step(w, p, flap).hit != HIT_NONE)
+        {
+            sim_reset(w, w.rng);
+        }
+    }
+    double without_ns = (now_seconds() - start) * 1e9 / frames;
+    double cost_ns = with_ns - without_ns;
+    cout << "Recording a frame (begin, 5 phases, 1/8 input, world hash, end): " << cost_ns << " ns" << (cost_ns < 1000.0 ? "" : "  OVER 1 us") << endl;
+    int failures = cost_ns < 1000.0 ? 0 : 1;
+    const double budget_ms = 20.0;
+    long long first_time = (long long)time(nullptr);
+    flight_open(budget_ms, states, 4);
+    sim_reset(w, 12);
+    bench_flight_frames(w, p, 300, 0);
+    unsigned int hitch_frame = 300;
+    bench_flight_frames(w, p, 2, 30);
+    bench_flight_frames(w, p, 100, 0);
+    SimWorld last = w;
+    bench_flight_frames(w, p, 1, 0);
+    bool dumped = flight_dump("bench_flight.ffr", FLIGHT_REQUESTED, 7);
+    flight_close();
+    long long last_time = (long long)time(nullptr);
+    FlightStats stats = flight_stats();
+    bool counted = stats.frames == 403 && stats.hitches == 2 && stats.dumps == 1 && stats.suppressed == 1 && stats.worst_ms >= 30.0;
+    cout << "Forced hitch: " << stats.hitches << " hitches, " << stats.dumps << " dumped, " << stats.suppressed << " suppressed, worst " << stats.worst_ms
+         << " ms" << (counted ? "" : "  MISMATCH") << endl;
+    failures += !counted;
+    FlightDump dump;
+    bool found = bench_flight_find(first_time, last_time, hitch_frame, dump);
+    float hitch_ms = 0.f;
+    if (found && dump.frames.size() == hitch_frame + 1)
+    {
+        for (int ph = 0; ph < FLIGHT_PHASES; ++ph)
+        {
+            hitch_ms += dump.frames.back().phase_us[ph] / 1000.f;
+        }
+    }
+    bool hitch_ok = found && dump.header.reason == FLIGHT_HITCH && dump.header.detail == (int)hitch_frame && dump.frames.size() == hitch_frame + 1 &&
+                    dump.frames.back().frame == hitch_frame && hitch_ms >= 30.f && dump.inputs.size() == 39;
+    cout << "Hitch dump: " << (found ? "written" : "MISSING") << ", " << dump.frames.size() << " frames, " << dump.inputs.size() << " inputs, last frame "
+         << hitch_ms << " ms" << (hitch_ok ? "" : "  MISMATCH") << endl;
+    failures += !hitch_ok;
+    FlightDump manual;
+    bool loaded = dumped && flight_load("bench_flight.ffr", manual);
+    bool round_trip = loaded && manual.header.reason == FLIGHT_REQUESTED && manual.header.detail == 7 && manual.frames.size() == 403 &&
+                      manual.inputs.size() == 53 && manual.frames.back().tick == w.tick && manual.frames.back().world_hash == flight_hash(&w, (int)sizeof(w)) &&
+                      manual.frames[manual.frames.size() - 2].world_hash == flight_hash(&last, (int)sizeof(last)) &&
+                      strcmp(manual.header.state_names[2], "PLAYING") == 0;
+    for (size_t i = 1; round_trip && i < manual.frames.size(); ++i)
+    {
+        round_trip = manual.frames[i].frame == manual.frames[i - 1].frame + 1 && manual.frames[i].start >= manual.frames[i - 1].start;
+    }
+    remove("bench_flight.ffr");
+    cout << "Dump round trip: " << (loaded ? "loaded" : "NOT LOADED") << ", " << manual.frames.size() << " frames, " << manual.inputs.size() << " inputs, "
+         << (round_trip ? "matches" : "MISMATCH") << ", " << sizeof(FlightHeader) + flight_frame_capacity * sizeof(FlightFrame) + flight_input_capacity * sizeof(FlightInput)
+         << " bytes when full" << endl;
+    failures += !round_trip;
+    return failures == 0 ? 0 : 1;
+}
+bool bench_asset_bytes(const string& path, vector<unsigned char>& bytes)
+{
+    ifstream in(path, ios::binary);
+    if (!in.is_open())
+    {
+        return false;
+    }
+    bytes.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    return !bytes.empty();
+}
+bool bench_asset_image(const string& path, int& w, int& h, vector<unsigned char>& rgba)
+{
+    vector<unsigned char> bytes;
+    if (!bench_asset_bytes(path, bytes) || bytes.size() < 24)
+    {
+        return false;
+    }
+    if (bytes[0] == 0x89 && bytes[1] == 'P')
+    {
+        w = (bytes[16] << 24) | (bytes[17] << 16) | (bytes[18] << 8) | bytes[19];
+        h = (bytes[20] << 24) | (bytes[21] << 16) | (bytes[22] << 8) | bytes[23];
+    }
+    else if (bytes[0] == 'G' && bytes[1] == 'I' && bytes[2] == 'F')
+    {
+        w = bytes[6] | (bytes[7] << 8);
+        h = bytes[8] | (bytes[9] << 8);
+    }
+    else
+    {
+        return false;
+    }
+    rgba.resize((size_t)w * h * 4);
+    size_t n = bytes.size();
+    for (size_t i = 0; i < rgba.size(); ++i)
+    {
+        rgba[i] = (unsigned char)(bytes[i % n] ^ (i * 31));
+    }
+    return true;
+}
+bool bench_asset_sheet(BenchAsset& a, const vector<string>& paths)
+{
+    vector<unsigned char> rgba;
+    a.kind = ASSET_PIXELS;
+    a.width = 0;
+    a.height = 0;
+    for (const string& path : paths)
+    {
+        int w = 0;
+        int h = 0;
+        if (!bench_asset_image(path, w, h, rgba))
+        {
+            cout << "  cannot read " << path << endl;
+            return false;
+        }
+        if (a.width != 0 && w != a.width)
+        {
+            vector<unsigned char> row_data;
+            int width = max(a.width, w);
+            row_data.resize((size_t)width * (a.height + h) * 4);
+            for (int y = 0; y < a.height; ++y)
+            {
+                memcpy(row_data.data() + (size_t)y * width * 4, a.data.data() + (size_t)y * a.width * 4, (size_t)a.width * 4);
+            }
+            for (int y = 0; y < h; ++y)
+            {
+                memcpy(row_data.data() + (size_t)(a.height + y) * width * 4, rgba.data() + (size_t)y * w * 4, (size_t)w * 4);
+            }
+            a.data.swap(row_data);
+            a.width = width;
+        }
+        else
+        {
+            a.width = w;
+            a.data.insert(a.data.end(), rgba.begin(), rgba.end());
+        }
+        AnimRect r = { 0, a.height, w, h };
+        a.rects.push_back(r);
+        a.height += h;
+    }
+    return true;
+}
+bool bench_asset_wav(BenchAsset& a, const string& path)
+{
+    vector<unsigned char> bytes;
+    if (!bench_asset_bytes(path, bytes))
+    {
+        return false;
+    }
+    if (bytes.size() < 12 || memcmp(bytes.data(), "RIFF", 4) != 0)
+    {
+        a.kind = ASSET_BYTES;
+        a.data.swap(bytes);
+        return true;
+    }
+    a.kind = ASSET_SAMPLES;
+    size_t at = 12;
+    while (at + 8 <= bytes.size())
+    {
+        unsigned int size = bytes[at + 4] | (bytes[at + 5] << 8) | (bytes[at + 6] << 16) | ((unsigned int)bytes[at + 7] << 24);
+        size_t body = at + 8;
+        if (memcmp(bytes.data() + at, "fmt ", 4) == 0 && body + 8 <= bytes.size())
+        {
+            a.channels = bytes[body + 2] | (bytes[body + 3] << 8);
+            a.rate = bytes[body + 4] | (bytes[body + 5] << 8) | (bytes[body + 6] << 16) | (bytes[body + 7] << 24);
+        }
+        else if (memcmp(bytes.data() + at, "data", 4) == 0)
+        {
+            size = (unsigned int)min<size_t>(size, bytes.size() - body);
+            a.data.assign(bytes.begin() + body, bytes.begin() + body + size);
+            return a.channels > 0;
+        }
+        at = body + size + (size & 1);
+    }
+    return false;
+}
+bool bench_asset_decode(vector<BenchAsset>& assets)
+{
+    static const char* singles[] = { "bg", "birdup", "birddown", "pipedown", "pipeup" };
+    static const char* ui_files[] = { "mainnewgame", "settings", "leaderboard", "mainexit", "difficulty", "soundon", "soundoff", "musicon", "musicoff", "backbutton",
+                                      "easy", "hard", "pauseresume", "pauserestart", "pausemain", "pauseexit", "overagain", "overmain", "overexit" };
+    static const char* sounds[] = { "flap", "score", "dead" };
+    assets.clear();
+    for (const char* name : singles)
+    {
+        BenchAsset a = { name, ASSET_PIXELS, 0, 0, 0, 0, {}, {} };
+        if (!bench_asset_image(string("assets/") + name + ".png", a.width, a.height, a.data))
+        {
+            cout << "  cannot read assets/" << name << ".png" << endl;
+            return false;
+        }
+        assets.push_back(a);
+    }
+    vector<string> intro;
+    for (int i = 1; i <= 19; ++i)
+    {
+        intro.push_back("assets/intr" + to_string(i) + ".gif");
+    }
+    vector<string> ui;
+    for (const char* name : ui_files)
+    {
+        ui.push_back(string("assets/") + name + ".png");
+    }
+    BenchAsset intro_sheet = { "intro_sheet", ASSET_PIXELS, 0, 0, 0, 0, {}, {} };
+    BenchAsset ui_sheet = { "ui_sheet", ASSET_PIXELS, 0, 0, 0, 0, {}, {} };
+    if (!bench_asset_sheet(intro_sheet, intro) || !bench_asset_sheet(ui_sheet, ui))
+    {
+        return false;
+    }
+    assets.push_back(intro_sheet);
+    assets.push_back(ui_sheet);
+    for (const char* name : sounds)
+    {
+        BenchAsset a = { name, ASSET_SAMPLES, 0, 0, 0, 0, {}, {} };
+        if (!bench_asset_wav(a, string("assets/") + name + ".wav"))
+        {
+            cout << "  cannot read assets/" << name << ".wav" << endl;
+            return false;
+        }
+        assets.push_back(a);
+    }
+    BenchAsset font = { "font", ASSET_BYTES, 0, 0, 0, 0, {}, {} };
+    if (!bench_asset_bytes("assets/arial.ttf", font.data))
+    {
+        cout << "  cannot read assets/arial.ttf" << endl;
+        return false;
+    }
+    assets.push_back(font);
+    return true;
+}
+unsigned long long bench_asset_checksum(const unsigned char* data, long long bytes, unsigned long long h)
+{
+    for (long long i = 0; i + 8 <= bytes; i += 8)
+    {
+        unsigned long long w;
+        memcpy(&w, data + i, 8);
+        h = (h ^ w) * 1099511628211ull;
+    }
+    return h;
+}
+int bench_assetcache_instance(bool shared, int id)
+{
+    long long baseline = assetcache_private_bytes();
+    double start = now_seconds();
+    int mode = shared ? assetcache_attach(assetcache_default_name, assetcache_stamp("assets"), 10.0) : ASSETCACHE_LOCAL;
+    bool built = mode == ASSETCACHE_BUILD;
+    vector<BenchAsset> assets;
+    if (mode != ASSETCACHE_SHARED)
+    {
+        if (!bench_asset_decode(assets))
+        {
+            assetcache_detach();
+            return 1;
+        }
+        if (built)
+        {
+            for (const BenchAsset& a : assets)
+            {
+                assetcache_add(a.name.c_str(), a.kind, a.width, a.height, a.channels, a.rate, a.data.data(), (long long)a.data.size(), a.rects.data(), (int)a.rects.size());
+            }
+            if (assetcache_publish())
+            {
+                vector<BenchAsset>().swap(assets);
+            }
+        }
+    }
+    unsigned long long sum = 1469598103934665603ull;
+    long long bytes = 0;
+    if (assets.empty())
+    {
+        static const char* names[] = { "bg", "birdup", "birddown", "pipedown", "pipeup", "intro_sheet", "ui_sheet", "flap", "score", "dead", "font" };
+        for (const char* name : names)
+        {
+            const AssetEntry* e = assetcache_find(name);
+            if (e == nullptr)
+            {
+                assetcache_detach();
+                return 1;
+            }
+            sum = bench_asset_checksum(assetcache_data(*e), e->bytes, sum);
+            bytes += e->bytes;
+        }
+    }
+    else
+    {
+        for (const BenchAsset& a : assets)
+        {
+            sum = bench_asset_checksum(a.data.data(), (long long)a.data.size(), sum);
+            bytes += (long long)a.data.size();
+        }
+    }
+    double ms = (now_seconds() - start) * 1000.0;
+    long long added = assetcache_private_bytes() - baseline;
+    string result = "bench_assetcache_" + to_string(id) + ".txt";
+    {
+        ofstream out(result + ".tmp");
+        out << (built ? "built" : (assetcache_mode() == ASSETCACHE_SHARED ? "mapped" : "decoded")) << " " << ms << " " << added << " " << bytes << " " << sum << endl;
+    }
+    rename((result + ".tmp").c_str(), result.c_str());
+    for (int i = 0; i < 6000 && !ifstream("bench_assetcache.go").is_open(); ++i)
+    {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    assetcache_detach();
+    return 0;
+}
+bool bench_assetcache_round(const char* self, bool shared, int instances)
+{
+    remove("bench_assetcache.go");
+    vector<thread> children;
+    int launched = 0;
+    vector<string> modes(instances);
+    vector<double> ms(instances);
+    vector<long long> added(instances);
+    vector<long long> bytes(instances);
+    vector<unsigned long long> sums(instances);
+    bool ok = true;
+    for (int i = 0; i < instances && ok; ++i)
+    {
+        string command = string("\"") + self + "\" assetcache-instance " + (shared ? "shared" : "private") + " " + to_string(i);
+        children.emplace_back([command]() { (void)system(command.c_str()); });
+        ++launched;
+        if (i + 1 < instances && i > 0)
+        {
+            continue;
+        }
+        for (int done = 0; done < launched && ok;)
+        {
+            done = 0;
+            for (int k = 0; k < launched; ++k)
+            {
+                done += ifstream("bench_assetcache_" + to_string(k) + ".txt").is_open();
+            }
+            if (done < launched)
+            {
+                this_thread::sleep_for(chrono::milliseconds(5));
+            }
+        }
+    }
+    for (int i = 0; i < instances; ++i)
+    {
+        string result = "bench_assetcache_" + to_string(i) + ".txt";
+        ifstream in(result);
+        ok = (bool)(in >> modes[i] >> ms[i] >> added[i] >> bytes[i] >> sums[i]) && ok;
+    }
+    ofstream("bench_assetcache.go") << "go" << endl;
+    for (thread& t : children)
+    {
+        t.join();
+    }
+    for (int i = 0; i < instances; ++i)
+    {
+        remove(("bench_assetcache_" + to_string(i) + ".txt").c_str());
+    }
+    remove("bench_assetcache.go");
+    double later_ms = 0.0;
+    double total_mb = 0.0;
+    bool same = ok;
+    for (int i = 0; i < instances && ok; ++i)
+    {
+        later_ms += i > 0 ? ms[i] : 0.0;
+        total_mb += added[i] / 1048576.0;
+        same = same && sums[i] == sums[0] && bytes[i] == bytes[0];
+    }
+    printf("  %-7s %d instance%s: first %7.2f ms (%s), later %7.2f ms mean (%s), %6.2f MB private per process, %6.2f MB total, payloads %s\n",
+           shared ? "shared" : "private", instances, instances > 1 ? "s" : " ", ms[0], modes[0].c_str(), instances > 1 ? later_ms / (instances - 1) : 0.0,
+           instances > 1 ? modes[instances - 1].c_str() : "-", total_mb / instances, total_mb, same ? "match" : "MISMATCH");
+    return ok && same;
+}
+int bench_assetcache(const char* self)
+{
+    vector<BenchAsset> assets;
+    double start = now_seconds();
+    if (!bench_asset_decode(assets))
+    {
+        return 1;
+    }
+    double decode_ms = (now_seconds() - start) * 1000.0;
+    long long payload = 0;
+    for (const BenchAsset& a : assets)
+    {
+        payload += (long long)a.data.size();
+    }
+    cout << "Decoded payloads: " << assets.size() << " entries, " << payload / 1048576.0 << " MB, " << decode_ms
+         << " ms in-process (images are expanded to RGBA at their real size as a stand-in for PNG/GIF decoding)" << endl;
+    int failures = 0;
+    const int counts[] = { 1, 4, 8 };
+    for (int n : counts)
+    {
+        failures += !bench_assetcache_round(self, false, n);
+        failures += !bench_assetcache_round(self, true, n);
+    }
+    return failures == 0 ? 0 : 1;
+}
+double bench_kernel_run(int mode, SimKernel kernel, const SimParams& p, vector<SimWorld>& worlds, int ticks, unsigned long long& hash, long long& score)
+{
+    int count = (int)worlds.size();
+    for (int i = 0; i < count; ++i)
+    {
+        sim_reset(worlds[i], (unsigned int)i * 2654435761u + 3);
+    }
+    vector<unsigned char> actions(count);
+    vector<SimStepResult> results(count);
+    int aim = p.difficulty == HARD ? p.pipe_gap * 2 / 3 : p.pipe_gap / 2;
+    hash = 1469598103934665603ull;
+    score = 0;
+    double start = now_seconds();
+    for (int t = 0; t < ticks; ++t)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            const SimWorld& w = worlds[i];
+            int next = 0;
+            while (next < w.pipe_count && w.pipes[next].x + p.pipe_w < bird_x - p.bird_w / 2.f)
+            {
+                ++next;
+            }
+            actions[i] = next < w.pipe_count && w.bird_y > w.pipes[next].gap_y + aim;
+        }
+        if (mode == 0)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                results[i] = sim_step(worlds[i], p, actions[i] != 0);
+            }
+        }
+        else if (mode == 1)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                results[i] = sim_step_with(kernel, worlds[i], p, actions[i] != 0);
+            }
+        }
+        else
+        {
+            sim_step_batch(kernel, worlds.data(), actions.data(), results.data(), count, p);
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            hash = (hash ^ (unsigned long long)(results[i].hit * 16 + results[i].scored)) * 1099511628211ull;
+            if (results[i].hit != HIT_NONE)
+            {
+                score += worlds[i].score;
+                sim_reset(worlds[i], sim_rand(worlds[i]));
+            }
+        }
+    }
+    double seconds = now_seconds() - start;
+    for (const SimWorld& w : worlds)
+    {
+        hash = bench_asset_checksum((const unsigned char*)&w, offsetof(SimWorld, pipes) + w.pipe_count * sizeof(SimPipe), hash);
+    }
+    return (double)count * ticks / seconds;
+}
+int bench_kernels_profile(Difficulty d)
+{
+    SimParams p;
+    ReachTable reach;
+    apply_difficulty(d, p, reach);
+    SimKernel kernel = sim_pick_kernel(p);
+    const int count = 4096;
+    const int ticks = 600;
+    vector<SimWorld> worlds(count);
+    const int repeats = 5;
+    unsigned long long hashes[3];
+    long long scores[3];
+    double rates[3] = {};
+    for (int r = 0; r < repeats; ++r)
+    {
+        for (int mode = 0; mode < 3; ++mode)
+        {
+            rates[mode] = max(rates[mode], bench_kernel_run(mode, kernel, p, worlds, ticks, hashes[mode], scores[mode]));
+        }
+    }
+    bool same = hashes[1] == hashes[0] && hashes[2] == hashes[0] && scores[1] == scores[0] && scores[2] == scores[0];
+    printf("  %s (%s kernel): generic %6.2f M steps/s, dispatched per step %6.2f M (%.2fx), batch %6.2f M (%.2fx), %lld points, trajectories %s\n",
+           d == EASY ? "EASY" : "HARD", sim_kernel_name(kernel), rates[0] / 1e6, rates[1] / 1e6, rates[1] / rates[0], rates[2] / 1e6, rates[2] / rates[0], scores[0],
+           same ? "identical" : "DIFFER");
+    return same && kernel != KERNEL_GENERIC ? 0 : 1;
+}
+int bench_kernels()
+{
+    int failures = bench_kernels_profile(EASY) + bench_kernels_profile(HARD);
+    SimParams custom;
+    apply_difficulty(HARD, custom);
+    custom.gravity = 0.5f;
+    SimKernel fallback = sim_pick_kernel(custom);
+    cout << "  custom parameters use the " << sim_kernel_name(fallback) << " kernel" << endl;
+    return failures + (fallback != KERNEL_GENERIC);
+}
@@ -0,0 +1,238 @@
+#include "bitmask.h"
+#include "fixed.h"
+#include <cmath>
+using namespace std;
+const unsigned char mask_alpha_threshold = 128;
+void mask_build_bird(BirdMask& out, const unsigned char* rgba, int w, int h, int degrees, int center_x8, int center_y8)
+{
+    long long c = fixed_cos[degrees < 0 ? -degrees : degrees];
+    long long s = degrees < 0 ? -fixed_cos[90 + degrees] : fixed_cos[90 - degrees];
+    out = BirdMask();
+    for (int y = 0; y < mask_size; ++y)
+    {
+        long long dy = 8 * y + 4 - center_y8;
+        for (int x = 0; x < mask_size; ++x)
+        {
+            long long dx = 8 * x + 4 - center_x8;
+            long long u = ((c * dx + s * dy) >> fixed_trig_shift) + 4 * w;
+            long long v = ((c * dy - s * dx) >> fixed_trig_shift) + 4 * h;
+            if (u < 0 || v < 0 || u >= 8 * w || v >= 8 * h)
+            {
+                continue;
+            }
+            if (rgba[4 * ((size_t)(v >> 3) * w + (size_t)(u >> 3)) + 3] < mask_alpha_threshold)
+            {
+                continue;
+            }
+            out.rows[y] |= 1ull << x;
+            out.top = y < out.top ? y : out.top;
+            out.bottom = y > out.bottom ? y : out.bottom;
+            out.left = x < out.left ? x : out.left;
+            out.right = x > out.right ? x : out.right;
+        }
+    }
+}
+void mask_build_pipe(PipeMask& out, const unsigned char* rgba, int w, int h, float screen_w, float offset)
+{
+    out.cols = (int)ceilf(screen_w) + 1;
+    out.tex_h = h;
+    out.rows.assign(h, 0);
+    for (int y = 0; y < h; ++y)
+    {
+        for (int x = 0; x < out.cols; ++x)
+        {
+            float along = x + 0.5f - offset;
+            if (along < 0.f || along >= screen_w)
+            {
+                continue;
+            }
+            int u = (int)(along * w / screen_w);
+            if (u < w && rgba[4 * ((size_t)y * w + u) + 3] >= mask_alpha_threshold)
+            {
+                out.rows[y] |= 1ull << x;
+            }
+        }
+    }
+}
+bool mask_set_texture(CollisionMasks& m, int which, const unsigned char* rgba, int w, int h, float screen_w)
+{
+    if (!rgba || w <= 0 || h <= 0)
+    {
+        return false;
+    }
+    if (which == MASK_BIRD_UP || which == MASK_BIRD_DOWN)
+    {
+        if ((w + 2) * (w + 2) + (h + 2) * (h + 2) > mask_size * mask_size)
+        {
+            return false;
+        }
+        int center_x8 = 8 * mask_half + (int)lroundf(8.f * (bird_x - floorf(bird_x)));
+        for (int phase = 0; phase < mask_phases; ++phase)
+        {
+            for (int i = 0; i < mask_angle_count; ++i)
+            {
+                mask_build_bird(m.bird[which][phase][i], rgba, w, h, mask_angle_min + i * mask_angle_step, center_x8, 8 * mask_half + 8 * phase / mask_phases);
+            }
+        }
+    }
+    else if (which == MASK_PIPE_TOP || which == MASK_PIPE_BOTTOM)
+    {
+        if (screen_w <= 0.f || ceilf(screen_w) + 1 > mask_size)
+        {
+            return false;
+        }
+        for (int phase = 0; phase < mask_phases; ++phase)
+        {
+            mask_build_pipe(m.pipe[which - MASK_PIPE_TOP][phase], rgba, w, h, screen_w, (float)phase / mask_phases);
+        }
+    }
+    else
+    {
+        return false;
+    }
+    m.ready[which] = true;
+    return true;
+}
+bool mask_ready(const CollisionMasks& m)
+{
+    return m.ready[MASK_BIRD_UP] && m.ready[MASK_BIRD_DOWN] && m.ready[MASK_PIPE_TOP] && m.ready[MASK_PIPE_BOTTOM];
+}
+int mask_angle_index(float rotation)
+{
+    int index = (int)floorf((rotation - mask_angle_min) / mask_angle_step + 0.5f);
+    return index < 0 ? 0 : (index >= mask_angle_count ? mask_angle_count - 1 : index);
+}
+void mask_split(float pos, int& pixel, int& phase)
+{
+    pixel = (int)floorf(pos);
+    phase = (int)((pos - pixel) * mask_phases + 0.5f);
+    if (phase == mask_phases)
+    {
+        ++pixel;
+        phase = 0;
+    }
+}
+SimBox mask_bird_bounds(const CollisionMasks& m, float bird_y, float rotation)
+{
+    int index = mask_angle_index(rotation);
+    int top = mask_size;
+    int bottom = -1;
+    int left = mask_size;
+    int right = -1;
+    for (int which = MASK_BIRD_UP; which <= MASK_BIRD_DOWN; ++which)
+    {
+        for (int phase = 0; phase < mask_phases; ++phase)
+        {
+            const BirdMask& b = m.bird[which][phase][index];
+            top = b.top < top ? b.top : top;
+            bottom = b.bottom > bottom ? b.bottom : bottom;
+            left = b.left < left ? b.left : left;
+            right = b.right > right ? b.right : right;
+        }
+    }
+    SimBox box;
+    box.left = bird_x - 1.f - mask_half + left;
+    box.top = bird_y - 1.f - mask_half + top;
+    box.width = (float)(right - left + 3);
+    box.height = (float)(bottom - top + 3);
+    return box;
+}
+SimBox mask_pipe_bounds(const CollisionMasks& m, const SimPipe& pipe, const SimParams& p, bool top)
+{
+    SimBox box;
+    box.left = pipe.x - 1.f;
+    box.width = (float)(m.pipe[top ? 0 : 1][0].cols + 2);
+    if (top)
+    {
+        box.top = 0.f;
+        box.height = (float)pipe.gap_y;
+    }
+    else
+    {
+        box.top = (float)(pipe.gap_y + p.pipe_gap);
+        box.height = height - box.top;
+    }
+    return box;
+}
+bool mask_rows_hit(const BirdMask& bird, int bird_top, int bird_left, const PipeMask& pipe, int pipe_left, int pipe_top, int pipe_h, int first, int last)
+{
+    int shift = pipe_left - bird_left;
+    if (shift >= mask_size || shift <= -mask_size)
+    {
+        return false;
+    }
+    for (int y = first; y <= last; ++y)
+    {
+        unsigned long long bits = pipe.rows[(2 * (y - pipe_top) + 1) * pipe.tex_h / (2 * pipe_h)];
+        bits = shift >= 0 ? bits << shift : bits >> -shift;
+        if (bird.rows[y - bird_top] & bits)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+SimHit mask_check_cells(const CollisionMasks& m, const SimParams& p, int falling, int pixel_y, int phase_y, int angle_index, const MaskPipeCell* pipes, int pipe_count)
+{
+    const BirdMask& bird = m.bird[falling ? MASK_BIRD_DOWN : MASK_BIRD_UP][phase_y][angle_index];
+    if (bird.bottom < 0)
+    {
+        return HIT_NONE;
+    }
+    int origin_x = (int)floorf(bird_x) - mask_half;
+    int origin_y = pixel_y - mask_half;
+    int top = origin_y + bird.top;
+    int bottom = origin_y + bird.bottom;
+    int left = origin_x + bird.left;
+    int right = origin_x + bird.right;
+    if (top < 0)
+    {
+        return HIT_CEILING;
+    }
+    if (bottom >= height)
+    {
+        return HIT_FLOOR;
+    }
+    for (int i = 0; i < pipe_count; ++i)
+    {
+        int pipe_left = pipes[i].left;
+        if (pipe_left > right)
+        {
+            break;
+        }
+        const PipeMask& upper = m.pipe[0][pipes[i].phase];
+        const PipeMask& lower = m.pipe[1][pipes[i].phase];
+        int gap_y = pipes[i].gap_y;
+        int bottom_y = gap_y + p.pipe_gap;
+        if (pipe_left + upper.cols > left && top < gap_y && gap_y > 0)
+        {
+            int last = bottom < gap_y - 1 ? bottom : gap_y - 1;
+            if (mask_rows_hit(bird, origin_y, origin_x, upper, pipe_left, 0, gap_y, top, last))
+            {
+                return HIT_TOP_PIPE;
+            }
+        }
+        if (pipe_left + lower.cols > left && bottom >= bottom_y && bottom_y < height)
+        {
+            int first = top > bottom_y ? top : bottom_y;
+            if (mask_rows_hit(bird, origin_y, origin_x, lower, pipe_left, bottom_y, height - bottom_y, first, bottom))
+            {
+                return HIT_BOTTOM_PIPE;
+            }
+        }
+    }
+    return HIT_NONE;
+}
+SimHit mask_check_collision(const SimWorld& w, const SimParams& p, const CollisionMasks& m)
+{
+    int pixel_y;
+    int phase_y;
+    mask_split(w.bird_y, pixel_y, phase_y);
+    MaskPipeCell pipes[max_pipes];
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        mask_split(w.pipes[i].x, pipes[i].left, pipes[i].phase);
+        pipes[i].gap_y = w.pipes[i].gap_y;
+    }
+    return mask_check_cells(m, p, w.bird_falling, pixel_y, phase_y, mask_angle_index(w.bird_rotation), pipes, w.pipe_count);
+}
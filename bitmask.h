@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include "simulation.h"
+const int mask_size = 64;
+const int mask_half = mask_size / 2;
+const int mask_angle_min = -90;
+const int mask_angle_step = 2;
+const int mask_angle_count = 180 / mask_angle_step + 1;
+const int mask_phases = 4;
+enum MaskTextureId
+{
+    MASK_BIRD_UP,
+    MASK_BIRD_DOWN,
+    MASK_PIPE_TOP,
+    MASK_PIPE_BOTTOM
+};
+struct BirdMask
+{
+    int top = mask_size;
+    int bottom = -1;
+    int left = mask_size;
+    int right = -1;
+    unsigned long long rows[mask_size] = {};
+};
+struct PipeMask
+{
+    int cols = 0;
+    int tex_h = 0;
+    std::vector<unsigned long long> rows;
+};
+struct MaskPipeCell
+{
+    int left;
+    int phase;
+    int gap_y;
+};
+struct CollisionMasks
+{
+    BirdMask bird[2][mask_phases][mask_angle_count];
+    PipeMask pipe[2][mask_phases];
+    bool ready[4] = {};
+};
+bool mask_set_texture(CollisionMasks& m, int which, const unsigned char* rgba, int w, int h, float screen_w);
+bool mask_ready(const CollisionMasks& m);
+int mask_angle_index(float rotation);
+SimBox mask_bird_bounds(const CollisionMasks& m, float bird_y, float rotation);
+SimBox mask_pipe_bounds(const CollisionMasks& m, const SimPipe& pipe, const SimParams& p, bool top);
+SimHit mask_check_cells(const CollisionMasks& m, const SimParams& p, int falling, int pixel_y, int phase_y, int angle_index, const MaskPipeCell* pipes, int pipe_count);
+SimHit mask_check_collision(const SimWorld& w, const SimParams& p, const CollisionMasks& m);
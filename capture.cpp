@@ -0,0 +1,211 @@
+#include "capture.h"
+#include <SFML/Graphics.hpp>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <cstdio>
+using namespace std;
+using namespace sf;
+const int capture_slot_count = 6;
+vector<unsigned char> capture_slots[capture_slot_count];
+vector<unsigned char> capture_yuv;
+int capture_read_index = 0;
+int capture_write_index = 0;
+int capture_filled = 0;
+bool capture_running = false;
+bool capture_stopping = false;
+CaptureFormat capture_format = CAPTURE_Y4M;
+int capture_w = 0;
+int capture_h = 0;
+string capture_path;
+ofstream capture_file;
+CaptureStats capture_counters;
+mutex capture_lock;
+condition_variable capture_has_frame;
+condition_variable capture_has_slot;
+thread capture_thread;
+void capture_write_y4m(const unsigned char* rgba)
+{
+    int w = capture_w;
+    int h = capture_h;
+    int cw = (w + 1) / 2;
+    int ch = (h + 1) / 2;
+    unsigned char* y_plane = capture_yuv.data();
+    unsigned char* u_plane = y_plane + (size_t)w * h;
+    unsigned char* v_plane = u_plane + (size_t)cw * ch;
+    for (int i = 0; i < w * h; ++i)
+    {
+        const unsigned char* px = rgba + 4 * (size_t)i;
+        y_plane[i] = (unsigned char)((77 * px[0] + 150 * px[1] + 29 * px[2] + 128) >> 8);
+    }
+    for (int cy = 0; cy < ch; ++cy)
+    {
+        for (int cx = 0; cx < cw; ++cx)
+        {
+            int r = 0, g = 0, b = 0, n = 0;
+            for (int dy = 0; dy < 2; ++dy)
+            {
+                for (int dx = 0; dx < 2; ++dx)
+                {
+                    int x = 2 * cx + dx;
+                    int y = 2 * cy + dy;
+                    if (x < w && y < h)
+                    {
+                        const unsigned char* px = rgba + 4 * ((size_t)y * w + x);
+                        r += px[0];
+                        g += px[1];
+                        b += px[2];
+                        ++n;
+                    }
+                }
+            }
+            r /= n;
+            g /= n;
+            b /= n;
+            int u = ((-43 * r - 85 * g + 128 * b + 128) >> 8) + 128;
+            int v = ((128 * r - 107 * g - 21 * b + 128) >> 8) + 128;
+            u_plane[(size_t)cy * cw + cx] = (unsigned char)(u < 0 ? 0 : (u > 255 ? 255 : u));
+            v_plane[(size_t)cy * cw + cx] = (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+        }
+    }
+    capture_file.write("FRAME\n", 6);
+    capture_file.write((const char*)capture_yuv.data(), (streamsize)capture_yuv.size());
+}
+void capture_write_png(const unsigned char* rgba, long long index)
+{
+    char number[32];
+    snprintf(number, sizeof(number), "_%05lld.png", index);
+    Image image;
+    image.create(capture_w, capture_h, rgba);
+    image.saveToFile(capture_path + number);
+}
+void capture_worker()
+{
+    long long written = 0;
+    while (true)
+    {
+        int slot;
+        {
+            unique_lock<mutex> guard(capture_lock);
+            capture_has_frame.wait(guard, [] { return capture_filled > 0 || capture_stopping; });
+            if (capture_filled == 0)
+            {
+                return;
+            }
+            slot = capture_read_index;
+        }
+        if (capture_format == CAPTURE_Y4M)
+        {
+            capture_write_y4m(capture_slots[slot].data());
+        }
+        else
+        {
+            capture_write_png(capture_slots[slot].data(), written);
+        }
+        ++written;
+        {
+            lock_guard<mutex> guard(capture_lock);
+            capture_read_index = (capture_read_index + 1) % capture_slot_count;
+            --capture_filled;
+            capture_counters.frames_written = written;
+        }
+        capture_has_slot.notify_one();
+    }
+}
+bool capture_start(const char* path, CaptureFormat format, int w, int h, int fps)
+{
+    if (capture_running)
+    {
+        return false;
+    }
+    capture_format = format;
+    capture_w = w;
+    capture_h = h;
+    capture_path = path;
+    if (format == CAPTURE_Y4M)
+    {
+        capture_file.open(path, ios::binary);
+        if (!capture_file.is_open())
+        {
+            return false;
+        }
+        capture_file << "YUV4MPEG2 W" << w << " H" << h << " F" << fps << ":1 Ip A1:1 C420jpeg\n";
+        capture_yuv.resize((size_t)w * h + 2 * (size_t)((w + 1) / 2) * ((h + 1) / 2));
+    }
+    for (int i = 0; i < capture_slot_count; ++i)
+    {
+        capture_slots[i].resize((size_t)w * h * 4);
+    }
+    capture_read_index = 0;
+    capture_write_index = 0;
+    capture_filled = 0;
+    capture_stopping = false;
+    capture_counters = CaptureStats();
+    capture_running = true;
+    capture_thread = thread(capture_worker);
+    return true;
+}
+bool capture_submit(const unsigned char* rgba, bool wait_for_slot)
+{
+    if (!capture_running)
+    {
+        return false;
+    }
+    {
+        unique_lock<mutex> guard(capture_lock);
+        ++capture_counters.frames_submitted;
+        if (wait_for_slot)
+        {
+            capture_has_slot.wait(guard, [] { return capture_filled < capture_slot_count; });
+        }
+        else if (capture_filled == capture_slot_count)
+        {
+            ++capture_counters.frames_dropped;
+            return false;
+        }
+    }
+    memcpy(capture_slots[capture_write_index].data(), rgba, capture_slots[capture_write_index].size());
+    {
+        lock_guard<mutex> guard(capture_lock);
+        capture_write_index = (capture_write_index + 1) % capture_slot_count;
+        ++capture_filled;
+    }
+    capture_has_frame.notify_one();
+    return true;
+}
+void capture_add_overhead(double us)
+{
+    lock_guard<mutex> guard(capture_lock);
+    capture_counters.submit_us_total += us;
+}
+void capture_stop()
+{
+    if (!capture_running)
+    {
+        return;
+    }
+    {
+        lock_guard<mutex> guard(capture_lock);
+        capture_stopping = true;
+    }
+    capture_has_frame.notify_one();
+    capture_thread.join();
+    if (capture_file.is_open())
+    {
+        capture_file.close();
+    }
+    capture_running = false;
+}
+bool capture_active()
+{
+    return capture_running;
+}
+CaptureStats capture_stats()
+{
+    lock_guard<mutex> guard(capture_lock);
+    return capture_counters;
+}
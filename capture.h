@@ -0,0 +1,19 @@
+#pragma once
+enum CaptureFormat
+{
+    CAPTURE_Y4M,
+    CAPTURE_PNG
+};
+struct CaptureStats
+{
+    long long frames_submitted = 0;
+    long long frames_written = 0;
+    long long frames_dropped = 0;
+    double submit_us_total = 0.0;
+};
+bool capture_start(const char* path, CaptureFormat format, int w, int h, int fps);
+bool capture_submit(const unsigned char* rgba, bool wait_for_slot);
+void capture_add_overhead(double us);
+void capture_stop();
+bool capture_active();
+CaptureStats capture_stats();
@@ -0,0 +1,185 @@
+#include "counters.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+using namespace std;
+const char* counter_names[COUNTER_KINDS] = { "cycles", "instructions", "L1D misses", "LLC misses", "branch misses" };
+const char* counter_name(int kind)
+{
+    return kind >= 0 && kind < COUNTER_KINDS ? counter_names[kind] : "?";
+}
+#if defined(__linux__)
+int counters_open_event(unsigned int type, unsigned long long config, bool grouped, int group_fd)
+{
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING | (grouped ? PERF_FORMAT_GROUP : 0);
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+int counters_open_all(PerfCounters& c, bool grouped)
+{
+    const unsigned long long cache_read_miss = ((unsigned long long)PERF_COUNT_HW_CACHE_OP_READ << 8) | ((unsigned long long)PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    const unsigned int types[COUNTER_KINDS] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE };
+    const unsigned long long configs[COUNTER_KINDS] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_L1D | cache_read_miss,
+                                                        PERF_COUNT_HW_CACHE_LL | cache_read_miss, PERF_COUNT_HW_BRANCH_MISSES };
+    int error = 0;
+    int members = 0;
+    for (int k = 0; k < COUNTER_KINDS; ++k)
+    {
+        int group_fd = grouped && c.leader >= 0 ? c.fd[c.leader] : -1;
+        c.fd[k] = counters_open_event(types[k], configs[k], grouped, group_fd);
+        if (c.fd[k] < 0 && k == COUNTER_LLC_MISSES)
+        {
+            c.fd[k] = counters_open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, grouped, group_fd);
+        }
+        if (c.fd[k] < 0)
+        {
+            error = error != 0 ? error : errno;
+            continue;
+        }
+        c.leader = grouped && c.leader < 0 ? k : c.leader;
+        c.slot[k] = grouped ? members : 0;
+        ++members;
+    }
+    return members > 0 ? 0 : error;
+}
+bool counters_group_runs(const PerfCounters& c)
+{
+    unsigned long long data[3 + COUNTER_KINDS];
+    auto until = chrono::steady_clock::now() + chrono::milliseconds(2);
+    while (chrono::steady_clock::now() < until)
+    {
+    }
+    return read(c.fd[c.leader], data, sizeof(data)) >= (ssize_t)(3 * sizeof(unsigned long long)) && data[2] > 0;
+}
+void counters_close_fds(PerfCounters& c)
+{
+    for (int k = 0; k < COUNTER_KINDS; ++k)
+    {
+        if (c.fd[k] >= 0)
+        {
+            close(c.fd[k]);
+        }
+        c.fd[k] = -1;
+        c.slot[k] = -1;
+    }
+    c.leader = -1;
+}
+#endif
+bool counters_open(PerfCounters& c)
+{
+    counters_close(c);
+#if defined(_WIN32)
+    c.available[COUNTER_CYCLES] = true;
+    c.opened = 1;
+    snprintf(c.reason, sizeof(c.reason), "only cycles are available on Windows (QueryThreadCycleTime)");
+#elif defined(__linux__)
+    int error = counters_open_all(c, true);
+    if (c.leader >= 0 && !counters_group_runs(c))
+    {
+        counters_close_fds(c);
+        error = counters_open_all(c, false);
+    }
+    for (int k = 0; k < COUNTER_KINDS; ++k)
+    {
+        c.available[k] = c.fd[k] >= 0;
+        c.opened += c.available[k];
+    }
+    if (c.opened == 0)
+    {
+        snprintf(c.reason, sizeof(c.reason), "perf_event_open failed: %s%s", strerror(error),
+                 error == EACCES || error == EPERM ? " (check /proc/sys/kernel/perf_event_paranoid)" : "");
+    }
+    else if (c.opened < COUNTER_KINDS)
+    {
+        snprintf(c.reason, sizeof(c.reason), "%d of %d counters are supported on this CPU%s", c.opened, COUNTER_KINDS, c.leader < 0 ? ", not as one group" : "");
+    }
+    else if (c.leader < 0)
+    {
+        snprintf(c.reason, sizeof(c.reason), "the counters don't fit on the PMU as one group and are multiplexed separately");
+    }
+#else
+    snprintf(c.reason, sizeof(c.reason), "hardware counters are not supported on this platform");
+#endif
+    return c.opened > 0;
+}
+void counters_close(PerfCounters& c)
+{
+#if defined(__linux__)
+    counters_close_fds(c);
+#endif
+    for (int k = 0; k < COUNTER_KINDS; ++k)
+    {
+        c.fd[k] = -1;
+        c.available[k] = false;
+    }
+    c.opened = 0;
+    c.reason[0] = '\0';
+}
+CounterValues counters_read(const PerfCounters& c)
+{
+    CounterValues v;
+#if defined(_WIN32)
+    ULONG64 cycles = 0;
+    QueryThreadCycleTime(GetCurrentThread(), &cycles);
+    v.value[COUNTER_CYCLES] = (double)cycles;
+#elif defined(__linux__)
+    unsigned long long data[3 + COUNTER_KINDS];
+    if (c.leader >= 0 && read(c.fd[c.leader], data, sizeof(data)) >= (ssize_t)(3 * sizeof(unsigned long long)))
+    {
+        for (int k = 0; k < COUNTER_KINDS; ++k)
+        {
+            if (c.fd[k] >= 0 && c.slot[k] < (int)data[0])
+            {
+                v.value[k] = (double)data[3 + c.slot[k]];
+                v.enabled[k] = (double)data[1];
+                v.running[k] = (double)data[2];
+            }
+        }
+    }
+    for (int k = 0; k < COUNTER_KINDS && c.leader < 0; ++k)
+    {
+        if (c.fd[k] >= 0 && read(c.fd[k], data, 3 * sizeof(unsigned long long)) == (ssize_t)(3 * sizeof(unsigned long long)))
+        {
+            v.value[k] = (double)data[0];
+            v.enabled[k] = (double)data[1];
+            v.running[k] = (double)data[2];
+        }
+    }
+#endif
+    v.seconds = chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+    return v;
+}
+void counters_begin(PerfCounters& c)
+{
+    c.start = counters_read(c);
+}
+CounterValues counters_end(const PerfCounters& c)
+{
+    CounterValues v = counters_read(c);
+    for (int k = 0; k < COUNTER_KINDS; ++k)
+    {
+        double enabled = v.enabled[k] - c.start.enabled[k];
+        double running = v.running[k] - c.start.running[k];
+        double delta = v.value[k] - c.start.value[k];
+        v.value[k] = enabled == 0.0 ? delta : (running > 0.0 ? delta * (enabled / running) : 0.0);
+        v.enabled[k] = enabled;
+        v.running[k] = running;
+    }
+    v.seconds -= c.start.seconds;
+    return v;
+}
@@ -0,0 +1,33 @@
+#pragma once
+enum CounterKind
+{
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_L1D_MISSES,
+    COUNTER_LLC_MISSES,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_KINDS
+};
+struct CounterValues
+{
+    double value[COUNTER_KINDS] = {};
+    double enabled[COUNTER_KINDS] = {};
+    double running[COUNTER_KINDS] = {};
+    double seconds = 0.0;
+};
+struct PerfCounters
+{
+    int fd[COUNTER_KINDS] = { -1, -1, -1, -1, -1 };
+    int slot[COUNTER_KINDS] = { -1, -1, -1, -1, -1 };
+    int leader = -1;
+    bool available[COUNTER_KINDS] = {};
+    int opened = 0;
+    char reason[128] = "";
+    CounterValues start;
+};
+const char* counter_name(int kind);
+bool counters_open(PerfCounters& c);
+void counters_close(PerfCounters& c);
+CounterValues counters_read(const PerfCounters& c);
+void counters_begin(PerfCounters& c);
+CounterValues counters_end(const PerfCounters& c);
@@ -0,0 +1,97 @@
+#include "ecs.h"
+using namespace std;
+void ecs_reserve(EcsWorld& w, int count)
+{
+    w.generation.reserve(count);
+    w.free_indices.reserve(count);
+    ecs_reserve(w.placements, count);
+    ecs_reserve(w.visuals, count);
+}
+Entity ecs_create(EcsWorld& w)
+{
+    unsigned int index;
+    if (!w.free_indices.empty())
+    {
+        index = w.free_indices.back();
+        w.free_indices.pop_back();
+    }
+    else
+    {
+        index = (unsigned int)w.generation.size();
+        if (index > ecs_index_mask)
+        {
+            return no_entity;
+        }
+        w.generation.push_back(0);
+    }
+    ++w.alive;
+    return (w.generation[index] << ecs_index_bits) | index;
+}
+bool ecs_alive(const EcsWorld& w, Entity e)
+{
+    unsigned int index = ecs_index(e);
+    return e != no_entity && index < w.generation.size() && w.generation[index] == (e >> ecs_index_bits);
+}
+void ecs_destroy(EcsWorld& w, Entity e)
+{
+    if (!ecs_alive(w, e))
+    {
+        return;
+    }
+    ecs_remove(w.placements, e);
+    ecs_remove(w.visuals, e);
+    unsigned int index = ecs_index(e);
+    w.generation[index] = (w.generation[index] + 1) & (0xFFFFFFFFu >> ecs_index_bits);
+    w.free_indices.push_back(index);
+    --w.alive;
+}
+template <typename T>
+void ecs_clear_set(ComponentSet<T>& set)
+{
+    set.sparse.assign(set.sparse.size(), -1);
+    set.dense.clear();
+    set.data.clear();
+}
+void ecs_clear(EcsWorld& w)
+{
+    ecs_clear_set(w.placements);
+    ecs_clear_set(w.visuals);
+    w.free_indices.clear();
+    for (unsigned int i = (unsigned int)w.generation.size(); i-- > 0;)
+    {
+        w.generation[i] = (w.generation[i] + 1) & (0xFFFFFFFFu >> ecs_index_bits);
+        w.free_indices.push_back(i);
+    }
+    w.alive = 0;
+}
+int ecs_layer(const Visual& v)
+{
+    return v.layer < 0 ? 0 : (v.layer >= ecs_max_layers ? ecs_max_layers - 1 : v.layer);
+}
+void ecs_render_list(EcsWorld& w, vector<RenderItem>& out)
+{
+    int count = (int)w.visuals.dense.size();
+    int offsets[ecs_max_layers + 1] = {};
+    for (int k = 0; k < count; ++k)
+    {
+        if (ecs_has(w.placements, w.visuals.dense[k]))
+        {
+            ++offsets[ecs_layer(w.visuals.data[k]) + 1];
+        }
+    }
+    for (int l = 0; l < ecs_max_layers; ++l)
+    {
+        offsets[l + 1] += offsets[l];
+    }
+    out.resize(offsets[ecs_max_layers]);
+    for (int k = 0; k < count; ++k)
+    {
+        const Placement* t = ecs_get(w.placements, w.visuals.dense[k]);
+        if (t != nullptr)
+        {
+            RenderItem& item = out[offsets[ecs_layer(w.visuals.data[k])]++];
+            item.placement = *t;
+            item.visual = w.visuals.data[k];
+        }
+    }
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <vector>
+typedef unsigned int Entity;
+const Entity no_entity = 0xFFFFFFFFu;
+const int ecs_index_bits = 20;
+const unsigned int ecs_index_mask = (1u << ecs_index_bits) - 1;
+const int ecs_max_layers = 8;
+struct Placement
+{
+    float x;
+    float y;
+    float scale_x;
+    float scale_y;
+    float rotation;
+};
+struct Visual
+{
+    int texture;
+    int layer;
+    int left;
+    int top;
+    int width;
+    int height;
+    float origin_x;
+    float origin_y;
+};
+struct RenderItem
+{
+    Placement placement;
+    Visual visual;
+};
+template <typename T>
+struct ComponentSet
+{
+    std::vector<int> sparse;
+    std::vector<Entity> dense;
+    std::vector<T> data;
+};
+struct EcsWorld
+{
+    std::vector<unsigned int> generation;
+    std::vector<unsigned int> free_indices;
+    int alive = 0;
+    ComponentSet<Placement> placements;
+    ComponentSet<Visual> visuals;
+};
+inline unsigned int ecs_index(Entity e)
+{
+    return e & ecs_index_mask;
+}
+template <typename T>
+bool ecs_has(const ComponentSet<T>& set, Entity e)
+{
+    unsigned int i = ecs_index(e);
+    return i < set.sparse.size() && set.sparse[i] >= 0 && set.dense[set.sparse[i]] == e;
+}
+template <typename T>
+T* ecs_get(ComponentSet<T>& set, Entity e)
+{
+    return ecs_has(set, e) ? &set.data[set.sparse[ecs_index(e)]] : nullptr;
+}
+template <typename T>
+T& ecs_add(ComponentSet<T>& set, Entity e, const T& value)
+{
+    unsigned int i = ecs_index(e);
+    if (i >= set.sparse.size())
+    {
+        set.sparse.resize(i + 1, -1);
+    }
+    if (set.sparse[i] >= 0 && set.dense[set.sparse[i]] == e)
+    {
+        set.data[set.sparse[i]] = value;
+        return set.data[set.sparse[i]];
+    }
+    set.sparse[i] = (int)set.dense.size();
+    set.dense.push_back(e);
+    set.data.push_back(value);
+    return set.data.back();
+}
+template <typename T>
+void ecs_remove(ComponentSet<T>& set, Entity e)
+{
+    if (!ecs_has(set, e))
+    {
+        return;
+    }
+    int slot = set.sparse[ecs_index(e)];
+    int last = (int)set.dense.size() - 1;
+    set.dense[slot] = set.dense[last];
+    set.data[slot] = set.data[last];
+    set.sparse[ecs_index(set.dense[slot])] = slot;
+    set.sparse[ecs_index(e)] = -1;
+    set.dense.pop_back();
+    set.data.pop_back();
+}
+template <typename T>
+void ecs_reserve(ComponentSet<T>& set, int count)
+{
+    set.sparse.reserve(count);
+    set.dense.reserve(count);
+    set.data.reserve(count);
+}
+void ecs_reserve(EcsWorld& w, int count);
+Entity ecs_create(EcsWorld& w);
+void ecs_destroy(EcsWorld& w, Entity e);
+bool ecs_alive(const EcsWorld& w, Entity e);
+void ecs_clear(EcsWorld& w);
+void ecs_render_list(EcsWorld& w, std::vector<RenderItem>& out);
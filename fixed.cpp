@@ -0,0 +1,283 @@
+#include "fixed.h"
+#include "bitmask.h"
+#include "pattern.h"
+#include <cmath>
+int fixed_from_float(float v)
+{
+    return (int)std::floor(v * fixed_one + 0.5f);
+}
+float fixed_to_float(int v)
+{
+    return (float)v / fixed_one;
+}
+int fixed_max(int a, int b)
+{
+    return a > b ? a : b;
+}
+int fixed_min(int a, int b)
+{
+    return a < b ? a : b;
+}
+void fixed_params(const SimParams& p, FixedParams& f)
+{
+    f.gravity = fixed_from_float(p.gravity);
+    f.flap_strength = fixed_from_float(p.flap_strength);
+    f.pipe_speed = fixed_from_float(p.pipe_speed);
+    f.pipe_w = fixed_from_float(p.pipe_w);
+    f.bird_x = fixed_from_float(bird_x);
+    f.bird_w = fixed_from_float(p.bird_w);
+    f.bird_h = fixed_from_float(p.bird_h);
+    f.shrink_bird = 10 * fixed_one;
+    f.shrink_pipe = 5 * fixed_one;
+    for (int d = 0; d <= 90; ++d)
+    {
+        long long c = fixed_cos[d];
+        long long s = fixed_cos[90 - d];
+        f.bounds_w[d] = (int)((f.bird_w * c + f.bird_h * s) >> fixed_trig_shift);
+        f.bounds_h[d] = (int)((f.bird_w * s + f.bird_h * c) >> fixed_trig_shift);
+    }
+    f.sim = &p;
+}
+void fixed_reset(FixedWorld& w, unsigned int seed)
+{
+    w.bird_y = height / 2 * fixed_one;
+    w.bird_vel = 0;
+    w.bird_rotation = 0;
+    w.bird_falling = 0;
+    w.score = 0;
+    w.pipe_count = 0;
+    w.next_gap_high = 1;
+    w.rng = sim_seed(seed);
+    w.tick = 0;
+    pattern_reset(w.pattern);
+    for (int i = 0; i < max_pipes; ++i)
+    {
+        w.pipes[i] = FixedPipe{ 0, 0, 0, 0, 0, 0 };
+    }
+}
+void fixed_to_sim(const FixedWorld& w, SimWorld& out)
+{
+    out.bird_y = fixed_to_float(w.bird_y);
+    out.bird_vel = fixed_to_float(w.bird_vel);
+    out.bird_rotation = fixed_to_float(w.bird_rotation);
+    out.bird_falling = w.bird_falling;
+    out.score = w.score;
+    out.pipe_count = w.pipe_count;
+    out.next_gap_high = w.next_gap_high;
+    out.rng = w.rng;
+    out.tick = w.tick;
+    out.speed_scale = w.pattern.speed_pct / 100.f;
+    out.pattern = w.pattern;
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        const FixedPipe& pipe = w.pipes[i];
+        out.pipes[i] = SimPipe{ fixed_to_float(pipe.x), pipe.gap_y, pipe.scored, pipe.base_y, pipe.move_amp, pipe.move_period };
+    }
+}
+void fixed_from_sim(const SimWorld& w, FixedWorld& out)
+{
+    out.bird_y = fixed_from_float(w.bird_y);
+    out.bird_vel = fixed_from_float(w.bird_vel);
+    out.bird_rotation = fixed_from_float(w.bird_rotation);
+    out.bird_falling = w.bird_falling;
+    out.score = w.score;
+    out.pipe_count = w.pipe_count;
+    out.next_gap_high = w.next_gap_high;
+    out.rng = w.rng;
+    out.tick = w.tick;
+    out.pattern = w.pattern;
+    for (int i = 0; i < max_pipes; ++i)
+    {
+        const SimPipe& pipe = w.pipes[i];
+        out.pipes[i] = i < w.pipe_count ? FixedPipe{ fixed_from_float(pipe.x), pipe.gap_y, pipe.scored, pipe.base_y, pipe.move_amp, pipe.move_period } : FixedPipe{ 0, 0, 0, 0, 0, 0 };
+    }
+}
+void fixed_update_bird(FixedWorld& w, const FixedParams& f, bool flap)
+{
+    if (flap)
+    {
+        w.bird_vel = f.flap_strength;
+        w.bird_falling = 0;
+    }
+    w.bird_vel += f.gravity;
+    w.bird_y += w.bird_vel;
+    w.bird_rotation = fixed_min(w.bird_vel * 4, 90 * fixed_one);
+    w.bird_falling |= w.bird_vel > 0;
+}
+int fixed_update_pipes(FixedWorld& w, const FixedParams& f)
+{
+    const SimParams& p = *f.sim;
+    if (w.pipe_count < max_pipes && (w.pipe_count == 0 || w.pipes[w.pipe_count - 1].x <= (width - p.pipe_interval) * fixed_one))
+    {
+        int prev_gap_y = w.pipe_count > 0 ? w.pipes[w.pipe_count - 1].gap_y : -1;
+        float speed_scale = 1.f;
+        int gap_y = spawn_gap_y(w.rng, w.next_gap_high, w.pattern, speed_scale, prev_gap_y, p);
+        w.pipes[w.pipe_count] = FixedPipe{ width * fixed_one, gap_y, 0, gap_y, (short)w.pattern.move_amp, (short)w.pattern.move_period };
+        ++w.pipe_count;
+    }
+    int dx = f.pipe_speed * w.pattern.speed_pct / 100;
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        FixedPipe& pipe = w.pipes[i];
+        pipe.x += dx;
+        if (pipe.move_amp != 0)
+        {
+            pipe.gap_y = pipe.base_y + gap_wave(w.tick, pipe.move_amp, pipe.move_period);
+        }
+    }
+    if (w.pipe_count > 0 && w.pipes[0].x + f.pipe_w < 0)
+    {
+        for (int i = 0; i < w.pipe_count - 1; ++i)
+        {
+            w.pipes[i] = w.pipes[i + 1];
+        }
+        --w.pipe_count;
+    }
+    int scored = 0;
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        if (!w.pipes[i].scored && w.pipes[i].x + f.pipe_w < f.bird_x)
+        {
+            w.pipes[i].scored = 1;
+            ++w.score;
+            ++scored;
+        }
+    }
+    return scored;
+}
+void fixed_mask_split(int v, int& pixel, int& phase)
+{
+    pixel = v >> fixed_shift;
+    phase = ((v & (fixed_one - 1)) * mask_phases + fixed_one / 2) >> fixed_shift;
+    if (phase == mask_phases)
+    {
+        ++pixel;
+        phase = 0;
+    }
+}
+int fixed_mask_angle(int rotation)
+{
+    int step = mask_angle_step * fixed_one;
+    int index = rotation - mask_angle_min * fixed_one + step / 2;
+    index = index < 0 ? 0 : index / step;
+    return index >= mask_angle_count ? mask_angle_count - 1 : index;
+}
+SimHit fixed_check_collision(const FixedWorld& w, const FixedParams& f)
+{
+    if (f.sim->masks != nullptr)
+    {
+        int pixel_y;
+        int phase_y;
+        fixed_mask_split(w.bird_y, pixel_y, phase_y);
+        MaskPipeCell pipes[max_pipes];
+        for (int i = 0; i < w.pipe_count; ++i)
+        {
+            fixed_mask_split(w.pipes[i].x, pipes[i].left, pipes[i].phase);
+            pipes[i].gap_y = w.pipes[i].gap_y;
+        }
+        return mask_check_cells(*f.sim->masks, *f.sim, w.bird_falling, pixel_y, phase_y, fixed_mask_angle(w.bird_rotation), pipes, w.pipe_count);
+    }
+    int degrees = (w.bird_rotation + fixed_one / 2) >> fixed_shift;
+    degrees = fixed_min(degrees < 0 ? -degrees : degrees, 90);
+    int bounds_w = f.bounds_w[degrees];
+    int bounds_h = f.bounds_h[degrees];
+    int left = f.bird_x - (bounds_w >> 1) + f.shrink_bird;
+    int right = left + bounds_w - 2 * f.shrink_bird;
+    int top = w.bird_y - (bounds_h >> 1) + f.shrink_bird;
+    int bottom = top + bounds_h - 2 * f.shrink_bird;
+    if (top < 0)
+    {
+        return HIT_CEILING;
+    }
+    if (bottom > height * fixed_one)
+    {
+        return HIT_FLOOR;
+    }
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        int pipe_left = w.pipes[i].x + f.shrink_pipe;
+        int pipe_right = w.pipes[i].x + f.pipe_w - f.shrink_pipe;
+        if (fixed_max(left, pipe_left) >= fixed_min(right, pipe_right))
+        {
+            continue;
+        }
+        int gap_top = w.pipes[i].gap_y * fixed_one;
+        int gap_bottom = (w.pipes[i].gap_y + f.sim->pipe_gap) * fixed_one;
+        if (top < fixed_min(bottom, gap_top))
+        {
+            return HIT_TOP_PIPE;
+        }
+        if (fixed_max(top, gap_bottom) < fixed_min(bottom, height * fixed_one))
+        {
+            return HIT_BOTTOM_PIPE;
+        }
+    }
+    return HIT_NONE;
+}
+SimStepResult fixed_step(FixedWorld& w, const FixedParams& f, bool flap)
+{
+    SimStepResult result;
+    fixed_update_bird(w, f, flap);
+    result.scored = fixed_update_pipes(w, f);
+    result.hit = fixed_check_collision(w, f);
+    ++w.tick;
+    return result;
+}
+SimStepResult fixed_step_world(SimWorld& w, const FixedParams& f, bool flap)
+{
+    FixedWorld fw;
+    fixed_from_sim(w, fw);
+    SimStepResult result = fixed_step(fw, f, flap);
+    fixed_to_sim(fw, w);
+    return result;
+}
+void fixed_move_pipes(SimWorld& w, const SimParams& p)
+{
+    int dx = fixed_from_float(p.pipe_speed) * (int)std::lround(w.speed_scale * 100.f) / 100;
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        SimPipe& pipe = w.pipes[i];
+        pipe.x = fixed_to_float(fixed_from_float(pipe.x) + dx);
+        if (pipe.move_amp != 0)
+        {
+            pipe.gap_y = pipe.base_y + gap_wave(w.tick, pipe.move_amp, pipe.move_period);
+        }
+    }
+}
+unsigned long long fixed_mix(unsigned long long h, int v)
+{
+    return (h ^ (unsigned int)v) * 0x100000001B3ull;
+}
+unsigned long long fixed_hash(const FixedWorld& w, unsigned long long h)
+{
+    h = fixed_mix(h, w.bird_y);
+    h = fixed_mix(h, w.bird_vel);
+    h = fixed_mix(h, w.bird_rotation);
+    h = fixed_mix(h, w.bird_falling);
+    h = fixed_mix(h, w.score);
+    h = fixed_mix(h, w.next_gap_high);
+    h = fixed_mix(h, (int)w.rng);
+    h = fixed_mix(h, w.tick);
+    h = fixed_mix(h, w.pattern.pc);
+    h = fixed_mix(h, w.pattern.depth);
+    for (int i = 0; i < pattern_max_depth; ++i)
+    {
+        h = fixed_mix(h, w.pattern.loop_left[i]);
+    }
+    h = fixed_mix(h, w.pattern.last_gap);
+    h = fixed_mix(h, w.pattern.speed_pct);
+    h = fixed_mix(h, w.pattern.move_amp);
+    h = fixed_mix(h, w.pattern.move_period);
+    h = fixed_mix(h, w.pipe_count);
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        const FixedPipe& pipe = w.pipes[i];
+        h = fixed_mix(h, pipe.x);
+        h = fixed_mix(h, pipe.gap_y);
+        h = fixed_mix(h, pipe.scored);
+        h = fixed_mix(h, pipe.base_y);
+        h = fixed_mix(h, pipe.move_amp);
+        h = fixed_mix(h, pipe.move_period);
+    }
+    return h;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "simulation.h"
+const int fixed_shift = 8;
+const int fixed_one = 1 << fixed_shift;
+const int fixed_trig_shift = 16;
+const int fixed_cos[91] = {
+    65536, 65526, 65496, 65446, 65376, 65287, 65177, 65048, 64898, 64729, 64540, 64332, 64104, 63856, 63589, 63303,
+    62997, 62672, 62328, 61966, 61584, 61183, 60764, 60326, 59870, 59396, 58903, 58393, 57865, 57319, 56756, 56175,
+    55578, 54963, 54332, 53684, 53020, 52339, 51643, 50931, 50203, 49461, 48703, 47930, 47143, 46341, 45525, 44695,
+    43852, 42995, 42126, 41243, 40348, 39441, 38521, 37590, 36647, 35693, 34729, 33754, 32768, 31772, 30767, 29753,
+    28729, 27697, 26656, 25607, 24550, 23486, 22415, 21336, 20252, 19161, 18064, 16962, 15855, 14742, 13626, 12505,
+    11380, 10252, 9121, 7987, 6850, 5712, 4572, 3430, 2287, 1144, 0
+};
+struct FixedParams
+{
+    int gravity;
+    int flap_strength;
+    int pipe_speed;
+    int pipe_w;
+    int bird_x;
+    int bird_w;
+    int bird_h;
+    int shrink_bird;
+    int shrink_pipe;
+    int bounds_w[91];
+    int bounds_h[91];
+    const SimParams* sim;
+};
+struct FixedPipe
+{
+    int x;
+    int gap_y;
+    int scored;
+    int base_y;
+    short move_amp;
+    short move_period;
+};
+struct FixedWorld
+{
+    int bird_y;
+    int bird_vel;
+    int bird_rotation;
+    int bird_falling;
+    int score;
+    int pipe_count;
+    int next_gap_high;
+    unsigned int rng;
+    int tick;
+    PatternState pattern;
+    FixedPipe pipes[max_pipes];
+};
+int fixed_from_float(float v);
+float fixed_to_float(int v);
+void fixed_params(const SimParams& p, FixedParams& f);
+void fixed_reset(FixedWorld& w, unsigned int seed);
+void fixed_to_sim(const FixedWorld& w, SimWorld& out);
+void fixed_from_sim(const SimWorld& w, FixedWorld& out);
+SimHit fixed_check_collision(const FixedWorld& w, const FixedParams& f);
+SimStepResult fixed_step(FixedWorld& w, const FixedParams& f, bool flap);
+SimStepResult fixed_step_world(SimWorld& w, const FixedParams& f, bool flap);
+void fixed_move_pipes(SimWorld& w, const SimParams& p);
+unsigned long long fixed_hash(const FixedWorld& w, unsigned long long h);
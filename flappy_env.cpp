@@ -0,0 +1,326 @@
+#include "flappy_env.h"
+#include "simulation.h"
+#include "simkernel.h"
+#include "raster.h"
+#include "reach.h"
+#include "bitmask.h"
+#include "fixed.h"
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+using namespace std;
+const int env_spin_limit = 4096;
+enum EnvJob
+{
+    JOB_NONE,
+    JOB_RESET,
+    JOB_STEP,
+    JOB_QUIT
+};
+struct FlappyEnv
+{
+    int num_envs = 0;
+    int num_threads = 1;
+    SimParams params;
+    SimKernel kernel = KERNEL_GENERIC;
+    vector<SimWorld> worlds;
+    int fixed_point = 0;
+    FixedParams fixed;
+    vector<FixedWorld> fixed_worlds;
+    float* observations = nullptr;
+    float* rewards = nullptr;
+    unsigned char* dones = nullptr;
+    int* scores = nullptr;
+    RasterAssets raster;
+    CollisionMasks masks;
+    ReachTable reach;
+    unsigned char* pixels = nullptr;
+    const unsigned char* actions = nullptr;
+    unsigned long long seed = 0;
+    EnvJob job = JOB_NONE;
+    atomic<int> generation{ 0 };
+    atomic<int> pending{ 0 };
+    atomic<int> sleepers{ 0 };
+    mutex lock;
+    condition_variable job_ready;
+    vector<thread> workers;
+};
+void env_write_observation(const SimWorld& w, const SimParams& p, float obs[])
+{
+    obs[0] = w.bird_y / height;
+    obs[1] = w.bird_vel / 10.f;
+    int slot = 2;
+    for (int i = 0; i < w.pipe_count && slot < FLAPPY_ENV_OBS_SIZE; ++i)
+    {
+        if (w.pipes[i].x + p.pipe_w < bird_x - p.bird_w / 2.f)
+        {
+            continue;
+        }
+        obs[slot++] = (w.pipes[i].x - bird_x) / width;
+        obs[slot++] = (float)w.pipes[i].gap_y / height;
+        obs[slot++] = (float)(w.pipes[i].gap_y + p.pipe_gap) / height;
+    }
+    while (slot < FLAPPY_ENV_OBS_SIZE)
+    {
+        obs[slot++] = 1.f;
+        obs[slot++] = (float)min_gap_y / height;
+        obs[slot++] = (float)(get_max_gap_y(p) + p.pipe_gap) / height;
+    }
+}
+void env_run_range(FlappyEnv* env, EnvJob job, int begin, int end)
+{
+    for (int i = begin; i < end; ++i)
+    {
+        SimWorld& w = env->worlds[i];
+        if (job == JOB_RESET)
+        {
+            unsigned int seed = (unsigned int)(env->seed + (unsigned long long)i * 0x9E3779B97F4A7C15ull);
+            if (env->fixed_point)
+            {
+                fixed_reset(env->fixed_worlds[i], seed);
+                fixed_to_sim(env->fixed_worlds[i], w);
+            }
+            else
+            {
+                sim_reset(w, seed);
+            }
+            if (env->rewards)
+            {
+                env->rewards[i] = 0.f;
+            }
+            if (env->dones)
+            {
+                env->dones[i] = 0;
+            }
+            if (env->scores)
+            {
+                env->scores[i] = 0;
+            }
+        }
+        else
+        {
+            bool flap = env->actions && env->actions[i] != 0;
+            SimStepResult result = env->fixed_point ? fixed_step(env->fixed_worlds[i], env->fixed, flap) : sim_step_with(env->kernel, w, env->params, flap);
+            bool done = result.hit != HIT_NONE;
+            if (env->rewards)
+            {
+                env->rewards[i] = done ? -1.f : (float)result.scored;
+            }
+            if (env->dones)
+            {
+                env->dones[i] = done ? 1 : 0;
+            }
+            if (env->scores)
+            {
+                env->scores[i] = w.score;
+            }
+            if (env->fixed_point)
+            {
+                FixedWorld& fw = env->fixed_worlds[i];
+                if (done)
+                {
+                    fixed_reset(fw, xorshift32(fw.rng));
+                }
+                fixed_to_sim(fw, w);
+            }
+            else if (done)
+            {
+                sim_reset(w, sim_rand(w));
+            }
+        }
+        if (env->observations)
+        {
+            env_write_observation(w, env->params, env->observations + (size_t)i * FLAPPY_ENV_OBS_SIZE);
+        }
+        if (env->pixels)
+        {
+            raster_draw_world(env->raster, w, env->params, env->pixels + (size_t)i * env->raster.out_w * env->raster.out_h);
+        }
+    }
+}
+void env_chunk_bounds(const FlappyEnv* env, int index, int& begin, int& end)
+{
+    int per = (env->num_envs + env->num_threads - 1) / env->num_threads;
+    begin = index * per;
+    end = begin + per;
+    if (begin > env->num_envs)
+    {
+        begin = env->num_envs;
+    }
+    if (end > env->num_envs)
+    {
+        end = env->num_envs;
+    }
+}
+int env_wait_job(FlappyEnv* env, int seen)
+{
+    for (int spin = 0; spin < env_spin_limit; ++spin)
+    {
+        int generation = env->generation.load();
+        if (generation != seen)
+        {
+            return generation;
+        }
+        this_thread::yield();
+    }
+    unique_lock<mutex> guard(env->lock);
+    env->sleepers.fetch_add(1);
+    env->job_ready.wait(guard, [&] { return env->generation.load() != seen; });
+    env->sleepers.fetch_sub(1);
+    return env->generation.load();
+}
+void env_post_job(FlappyEnv* env, EnvJob job, int pending)
+{
+    env->job = job;
+    env->pending.store(pending);
+    env->generation.fetch_add(1);
+    if (env->sleepers.load() > 0)
+    {
+        {
+            lock_guard<mutex> guard(env->lock);
+        }
+        env->job_ready.notify_all();
+    }
+}
+void env_worker_loop(FlappyEnv* env, int index)
+{
+    int seen = 0;
+    while (true)
+    {
+        seen = env_wait_job(env, seen);
+        EnvJob job = env->job;
+        if (job == JOB_QUIT)
+        {
+            return;
+        }
+        int begin, end;
+        env_chunk_bounds(env, index, begin, end);
+        env_run_range(env, job, begin, end);
+        env->pending.fetch_sub(1, memory_order_release);
+    }
+}
+void env_run_job(FlappyEnv* env, EnvJob job)
+{
+    if (env->num_threads == 1)
+    {
+        env_run_range(env, job, 0, env->num_envs);
+        return;
+    }
+    env_post_job(env, job, env->num_threads - 1);
+    int begin, end;
+    env_chunk_bounds(env, 0, begin, end);
+    env_run_range(env, job, begin, end);
+    while (env->pending.load(memory_order_acquire) != 0)
+    {
+        this_thread::yield();
+    }
+}
+extern "C" FlappyEnv* flappy_env_create(int num_envs, int difficulty, int num_threads)
+{
+    if (num_envs <= 0)
+    {
+        return nullptr;
+    }
+    FlappyEnv* env = new FlappyEnv();
+    env->num_envs = num_envs;
+    env->num_threads = num_threads < 1 ? 1 : (num_threads > num_envs ? num_envs : num_threads);
+    apply_difficulty(difficulty == FLAPPY_ENV_HARD ? HARD : EASY, env->params, env->reach);
+    env->kernel = sim_pick_kernel(env->params);
+    env->worlds.resize(num_envs);
+    env->fixed_worlds.resize(num_envs);
+    fixed_params(env->params, env->fixed);
+    for (int i = 0; i < num_envs; ++i)
+    {
+        sim_reset(env->worlds[i], (unsigned int)i);
+    }
+    for (int t = 1; t < env->num_threads; ++t)
+    {
+        env->workers.emplace_back(env_worker_loop, env, t);
+    }
+    return env;
+}
+extern "C" void flappy_env_destroy(FlappyEnv* env)
+{
+    if (!env)
+    {
+        return;
+    }
+    if (!env->workers.empty())
+    {
+        env_post_job(env, JOB_QUIT, 0);
+        for (thread& worker : env->workers)
+        {
+            worker.join();
+        }
+    }
+    delete env;
+}
+extern "C" int flappy_env_num_envs(const FlappyEnv* env)
+{
+    return env ? env->num_envs : 0;
+}
+extern "C" int flappy_env_observation_size(void)
+{
+    return FLAPPY_ENV_OBS_SIZE;
+}
+extern "C" void flappy_env_set_buffers(FlappyEnv* env, float* observations, float* rewards, unsigned char* dones, int* scores)
+{
+    env->observations = observations;
+    env->rewards = rewards;
+    env->dones = dones;
+    env->scores = scores;
+}
+extern "C" int flappy_env_set_texture(FlappyEnv* env, int which, const unsigned char* rgba, int w, int h)
+{
+    if (!raster_set_texture(env->raster, which, rgba, w, h))
+    {
+        return 0;
+    }
+    if (which >= FLAPPY_ENV_TEX_BIRD_UP && which <= FLAPPY_ENV_TEX_PIPE_UP && !mask_ready(env->masks))
+    {
+        mask_set_texture(env->masks, which - FLAPPY_ENV_TEX_BIRD_UP, rgba, w, h, env->params.pipe_w);
+        if (mask_ready(env->masks))
+        {
+            env->params.masks = &env->masks;
+            apply_difficulty(env->params.difficulty, env->params, env->reach);
+            env->kernel = sim_pick_kernel(env->params);
+            fixed_params(env->params, env->fixed);
+        }
+    }
+    return 1;
+}
+extern "C" void flappy_env_set_pixel_buffer(FlappyEnv* env, unsigned char* pixels, int out_w, int out_h)
+{
+    if (!pixels || out_w <= 0 || out_h <= 0)
+    {
+        env->pixels = nullptr;
+        return;
+    }
+    raster_prepare(env->raster, out_w, out_h);
+    env->pixels = pixels;
+}
+extern "C" void flappy_env_set_fixed_point(FlappyEnv* env, int enabled)
+{
+    int fixed_point = enabled ? 1 : 0;
+    if (fixed_point && !env->fixed_point)
+    {
+        for (int i = 0; i < env->num_envs; ++i)
+        {
+            fixed_from_sim(env->worlds[i], env->fixed_worlds[i]);
+        }
+    }
+    env->fixed_point = fixed_point;
+}
+extern "C" void flappy_env_reset(FlappyEnv* env, unsigned long long seed)
+{
+    env->seed = seed;
+    env_run_job(env, JOB_RESET);
+}
+extern "C" void flappy_env_step(FlappyEnv* env, const unsigned char* actions)
+{
+    env->actions = actions;
+    env_run_job(env, JOB_STEP);
+    env->actions = nullptr;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#if defined(FLAPPY_ENV_STATIC)
+#define FLAPPY_ENV_API
+#elif defined(_WIN32) && defined(FLAPPY_ENV_EXPORTS)
+#define FLAPPY_ENV_API __declspec(dllexport)
+#elif defined(_WIN32)
+#define FLAPPY_ENV_API __declspec(dllimport)
+#else
+#define FLAPPY_ENV_API __attribute__((visibility("default")))
+#endif
+#ifdef __cplusplus
+extern "C" {
+#endif
+#define FLAPPY_ENV_OBS_SIZE 8
+#define FLAPPY_ENV_EASY 0
+#define FLAPPY_ENV_HARD 1
+#define FLAPPY_ENV_TEX_BACKGROUND 0
+#define FLAPPY_ENV_TEX_BIRD_UP 1
+#define FLAPPY_ENV_TEX_BIRD_DOWN 2
+#define FLAPPY_ENV_TEX_PIPE_DOWN 3
+#define FLAPPY_ENV_TEX_PIPE_UP 4
+typedef struct FlappyEnv FlappyEnv;
+FLAPPY_ENV_API FlappyEnv* flappy_env_create(int num_envs, int difficulty, int num_threads);
+FLAPPY_ENV_API void flappy_env_destroy(FlappyEnv* env);
+FLAPPY_ENV_API int flappy_env_num_envs(const FlappyEnv* env);
+FLAPPY_ENV_API int flappy_env_observation_size(void);
+FLAPPY_ENV_API void flappy_env_set_buffers(FlappyEnv* env, float* observations, float* rewards, unsigned char* dones, int* scores);
+FLAPPY_ENV_API int flappy_env_set_texture(FlappyEnv* env, int which, const unsigned char* rgba, int w, int h);
+FLAPPY_ENV_API void flappy_env_set_pixel_buffer(FlappyEnv* env, unsigned char* pixels, int out_w, int out_h);
+FLAPPY_ENV_API void flappy_env_set_fixed_point(FlappyEnv* env, int enabled);
+FLAPPY_ENV_API void flappy_env_reset(FlappyEnv* env, unsigned long long seed);
+FLAPPY_ENV_API void flappy_env_step(FlappyEnv* env, const unsigned char* actions);
+#ifdef __cplusplus
+}
+#endif
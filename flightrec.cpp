@@ -0,0 +1,359 @@
+#include "flightrec.h"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <thread>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+using namespace std;
+const char flight_magic[4] = { 'F', 'B', 'F', 'R' };
+const int flight_signals[] = { SIGSEGV, SIGILL, SIGFPE, SIGABRT };
+const int flight_signal_count = sizeof(flight_signals) / sizeof(flight_signals[0]);
+const unsigned int flight_cooldown_frames = flight_frame_capacity / 4;
+const char* flight_input_names[FLIGHT_INPUT_TYPES] = { "key down", "key up", "mouse down", "mouse up", "focus lost", "focus gained", "closed", "resized" };
+const char* flight_phase_names[FLIGHT_PHASES] = { "events", "update", "draw", "wait", "present" };
+FlightFrame flight_frames[flight_frame_capacity];
+FlightInput flight_inputs[flight_input_capacity];
+unsigned int flight_frame_head = 0;
+unsigned int flight_input_head = 0;
+unsigned int flight_frame_inputs = 0;
+FlightFrame flight_current;
+double flight_mark = 0.0;
+double flight_origin = 0.0;
+FlightHeader flight_header;
+FlightStats flight_totals;
+unsigned int flight_last_dump = 0;
+bool flight_dumped = false;
+FlightFrame flight_snapshot_frames[flight_frame_capacity];
+FlightInput flight_snapshot_inputs[flight_input_capacity];
+unsigned int flight_snapshot_frame_head = 0;
+unsigned int flight_snapshot_input_head = 0;
+int flight_snapshot_reason = 0;
+int flight_snapshot_detail = 0;
+atomic<bool> flight_pending(false);
+atomic<bool> flight_running(false);
+atomic<long long> flight_dumps(0);
+thread flight_writer;
+char flight_crash_path[64];
+void (*flight_previous[flight_signal_count])(int);
+#ifdef _WIN32
+LPTOP_LEVEL_EXCEPTION_FILTER flight_previous_filter = nullptr;
+#endif
+double flight_now()
+{
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+int flight_open_file(const char* path)
+{
+#ifdef _WIN32
+    return _open(path, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    return open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+}
+bool flight_write_all(int fd, const void* data, unsigned int bytes)
+{
+    const char* p = (const char*)data;
+    while (bytes > 0)
+    {
+#ifdef _WIN32
+        int n = _write(fd, p, bytes);
+#else
+        int n = (int)write(fd, p, bytes);
+#endif
+        if (n <= 0)
+        {
+            return false;
+        }
+        p += n;
+        bytes -= (unsigned int)n;
+    }
+    return true;
+}
+void flight_close_file(int fd)
+{
+#ifdef _WIN32
+    _close(fd);
+#else
+    close(fd);
+#endif
+}
+template <class T>
+bool flight_write_ring(int fd, const T* ring, int capacity, unsigned int head, unsigned int count)
+{
+    unsigned int first = (head - count) % capacity;
+    unsigned int tail = capacity - first < count ? capacity - first : count;
+    return flight_write_all(fd, ring + first, tail * sizeof(T)) && flight_write_all(fd, ring, (count - tail) * sizeof(T));
+}
+bool flight_write(int fd, int reason, int detail, const FlightFrame* frames, unsigned int frame_head, const FlightInput* inputs, unsigned int input_head)
+{
+    FlightHeader h = flight_header;
+    h.reason = reason;
+    h.detail = detail;
+    h.frame_count = frame_head < (unsigned int)flight_frame_capacity ? frame_head : flight_frame_capacity;
+    h.input_count = input_head < (unsigned int)flight_input_capacity ? input_head : flight_input_capacity;
+    return flight_write_all(fd, &h, sizeof(h)) && flight_write_ring(fd, frames, flight_frame_capacity, frame_head, h.frame_count) &&
+           flight_write_ring(fd, inputs, flight_input_capacity, input_head, h.input_count);
+}
+void flight_write_crash(int detail)
+{
+    int fd = flight_open_file(flight_crash_path);
+    if (fd >= 0)
+    {
+        flight_write(fd, FLIGHT_SIGNAL, detail, flight_frames, flight_frame_head, flight_inputs, flight_input_head);
+        flight_close_file(fd);
+    }
+}
+void flight_on_signal(int sig)
+{
+    flight_write_crash(sig);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+#ifdef _WIN32
+LONG WINAPI flight_on_exception(EXCEPTION_POINTERS* info)
+{
+    flight_write_crash((int)info->ExceptionRecord->ExceptionCode);
+    return flight_previous_filter != nullptr ? flight_previous_filter(info) : EXCEPTION_CONTINUE_SEARCH;
+}
+#endif
+void flight_write_pending()
+{
+    char path[96];
+    snprintf(path, sizeof(path), "flight_%s_%lld_%u.ffr", flight_snapshot_reason == FLIGHT_HITCH ? "hitch" : "manual", (long long)time(nullptr),
+             flight_snapshot_detail);
+    int fd = flight_open_file(path);
+    if (fd >= 0)
+    {
+        if (flight_write(fd, flight_snapshot_reason, flight_snapshot_detail, flight_snapshot_frames, flight_snapshot_frame_head, flight_snapshot_inputs,
+                         flight_snapshot_input_head))
+        {
+            flight_dumps.fetch_add(1, memory_order_relaxed);
+        }
+        flight_close_file(fd);
+    }
+    flight_pending.store(false, memory_order_release);
+}
+void flight_writer_loop()
+{
+    while (flight_running.load(memory_order_acquire))
+    {
+        if (flight_pending.load(memory_order_acquire))
+        {
+            flight_write_pending();
+        }
+        else
+        {
+            this_thread::sleep_for(chrono::milliseconds(50));
+        }
+    }
+    if (flight_pending.load(memory_order_acquire))
+    {
+        flight_write_pending();
+    }
+}
+bool flight_snapshot(int reason, int detail)
+{
+    if (!flight_running.load(memory_order_relaxed) || flight_pending.load(memory_order_acquire))
+    {
+        return false;
+    }
+    memcpy(flight_snapshot_frames, flight_frames, sizeof(flight_frames));
+    memcpy(flight_snapshot_inputs, flight_inputs, sizeof(flight_inputs));
+    flight_snapshot_frame_head = flight_frame_head;
+    flight_snapshot_input_head = flight_input_head;
+    flight_snapshot_reason = reason;
+    flight_snapshot_detail = detail;
+    flight_pending.store(true, memory_order_release);
+    return true;
+}
+bool flight_open(double budget_ms, const char* const* state_names, int state_count)
+{
+    if (flight_running.load())
+    {
+        return false;
+    }
+    memset(&flight_header, 0, sizeof(flight_header));
+    memcpy(flight_header.magic, flight_magic, 4);
+    flight_header.version = flight_version;
+    flight_header.budget_ms = (float)budget_ms;
+    flight_header.frame_bytes = sizeof(FlightFrame);
+    flight_header.input_bytes = sizeof(FlightInput);
+    flight_header.state_count = state_count < flight_max_states ? state_count : flight_max_states;
+    for (unsigned int i = 0; i < flight_header.state_count; ++i)
+    {
+        strncpy(flight_header.state_names[i], state_names[i], flight_state_name_bytes - 1);
+    }
+    flight_frame_head = 0;
+    flight_input_head = 0;
+    flight_totals = FlightStats();
+    flight_dumps.store(0);
+    flight_dumped = false;
+    flight_origin = flight_now();
+    flight_mark = flight_origin;
+    snprintf(flight_crash_path, sizeof(flight_crash_path), "flight_crash_%lld.ffr", (long long)time(nullptr));
+    for (int i = 0; i < flight_signal_count; ++i)
+    {
+        flight_previous[i] = signal(flight_signals[i], flight_on_signal);
+    }
+#ifdef _WIN32
+    flight_previous_filter = SetUnhandledExceptionFilter(flight_on_exception);
+#endif
+    flight_running.store(true, memory_order_release);
+    flight_writer = thread(flight_writer_loop);
+    return true;
+}
+void flight_close()
+{
+    if (!flight_running.load())
+    {
+        return;
+    }
+    flight_running.store(false, memory_order_release);
+    flight_writer.join();
+    for (int i = 0; i < flight_signal_count; ++i)
+    {
+        signal(flight_signals[i], flight_previous[i] == SIG_ERR ? SIG_DFL : flight_previous[i]);
+    }
+#ifdef _WIN32
+    SetUnhandledExceptionFilter(flight_previous_filter);
+#endif
+}
+void flight_begin_frame(int state)
+{
+    double now = flight_now();
+    memset(&flight_current, 0, sizeof(flight_current));
+    flight_current.frame = flight_frame_head;
+    flight_current.state = (unsigned char)state;
+    flight_current.start = now - flight_origin;
+    flight_frame_inputs = flight_input_head;
+    flight_mark = now;
+}
+void flight_phase(int phase)
+{
+    double now = flight_now();
+    flight_current.phase_us[phase] += (float)((now - flight_mark) * 1e6);
+    flight_mark = now;
+}
+short flight_clamp_short(int v)
+{
+    return (short)(v < -32768 ? -32768 : (v > 32767 ? 32767 : v));
+}
+void flight_input(int type, int code, int x, int y)
+{
+    FlightInput& in = flight_inputs[flight_input_head % flight_input_capacity];
+    in.frame = flight_frame_head;
+    in.type = (unsigned char)type;
+    in.pad = 0;
+    in.code = (unsigned short)code;
+    in.x = flight_clamp_short(x);
+    in.y = flight_clamp_short(y);
+    ++flight_input_head;
+    ++flight_totals.inputs;
+}
+void flight_end_frame(int tick, int score, unsigned int world_hash, int flags)
+{
+    unsigned int inputs = flight_input_head - flight_frame_inputs;
+    flight_current.inputs = (unsigned char)(inputs > 255 ? 255 : inputs);
+    flight_current.flags = (unsigned short)flags;
+    flight_current.tick = tick;
+    flight_current.score = score;
+    flight_current.world_hash = world_hash;
+    flight_frames[flight_frame_head % flight_frame_capacity] = flight_current;
+    ++flight_frame_head;
+    ++flight_totals.frames;
+    double ms = (flight_mark - flight_origin - flight_current.start) * 1000.0;
+    if (ms > flight_totals.worst_ms)
+    {
+        flight_totals.worst_ms = ms;
+    }
+    if (flight_header.budget_ms <= 0.f || ms <= flight_header.budget_ms)
+    {
+        return;
+    }
+    ++flight_totals.hitches;
+    bool cooled = !flight_dumped || flight_frame_head - flight_last_dump >= flight_cooldown_frames;
+    if (cooled && flight_snapshot(FLIGHT_HITCH, (int)flight_current.frame))
+    {
+        flight_dumped = true;
+        flight_last_dump = flight_frame_head;
+    }
+    else
+    {
+        ++flight_totals.suppressed;
+    }
+}
+bool flight_request()
+{
+    return flight_snapshot(FLIGHT_REQUESTED, (int)flight_frame_head);
+}
+bool flight_dump(const char* path, int reason, int detail)
+{
+    int fd = flight_open_file(path);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool ok = flight_write(fd, reason, detail, flight_frames, flight_frame_head, flight_inputs, flight_input_head);
+    flight_close_file(fd);
+    return ok;
+}
+unsigned int flight_hash(const void* data, int bytes)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    unsigned int h = 2166136261u;
+    int i = 0;
+    for (; i + 4 <= bytes; i += 4)
+    {
+        unsigned int w;
+        memcpy(&w, p + i, 4);
+        h = (h ^ w) * 16777619u;
+    }
+    for (; i < bytes; ++i)
+    {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+FlightStats flight_stats()
+{
+    FlightStats stats = flight_totals;
+    stats.dumps = flight_dumps.load();
+    return stats;
+}
+const char* flight_input_name(int type)
+{
+    return type >= 0 && type < FLIGHT_INPUT_TYPES ? flight_input_names[type] : "?";
+}
+const char* flight_phase_name(int phase)
+{
+    return phase >= 0 && phase < FLIGHT_PHASES ? flight_phase_names[phase] : "?";
+}
+bool flight_load(const char* path, FlightDump& dump)
+{
+    ifstream in(path, ios::binary);
+    if (!in.read((char*)&dump.header, sizeof(dump.header)) || memcmp(dump.header.magic, flight_magic, 4) != 0 || dump.header.version != flight_version ||
+        dump.header.frame_bytes != sizeof(FlightFrame) || dump.header.input_bytes != sizeof(FlightInput) ||
+        dump.header.frame_count > (unsigned int)flight_frame_capacity || dump.header.input_count > (unsigned int)flight_input_capacity ||
+        dump.header.state_count > (unsigned int)flight_max_states)
+    {
+        return false;
+    }
+    dump.frames.resize(dump.header.frame_count);
+    dump.inputs.resize(dump.header.input_count);
+    in.read((char*)dump.frames.data(), (streamsize)(dump.frames.size() * sizeof(FlightFrame)));
+    in.read((char*)dump.inputs.data(), (streamsize)(dump.inputs.size() * sizeof(FlightInput)));
+    return (bool)in;
+}
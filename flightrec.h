@@ -0,0 +1,104 @@
+#pragma once
+#include <vector>
+const int flight_frame_capacity = 2048;
+const int flight_input_capacity = 1024;
+const int flight_max_states = 16;
+const int flight_state_name_bytes = 24;
+const int flight_version = 1;
+enum FlightPhase
+{
+    FLIGHT_EVENTS,
+    FLIGHT_UPDATE,
+    FLIGHT_DRAW,
+    FLIGHT_WAIT,
+    FLIGHT_PRESENT,
+    FLIGHT_PHASES
+};
+enum FlightInputType
+{
+    FLIGHT_KEY_DOWN,
+    FLIGHT_KEY_UP,
+    FLIGHT_MOUSE_DOWN,
+    FLIGHT_MOUSE_UP,
+    FLIGHT_FOCUS_LOST,
+    FLIGHT_FOCUS_GAINED,
+    FLIGHT_CLOSED,
+    FLIGHT_RESIZED,
+    FLIGHT_INPUT_TYPES
+};
+enum FlightReason
+{
+    FLIGHT_HITCH,
+    FLIGHT_SIGNAL,
+    FLIGHT_REQUESTED
+};
+enum FlightFlag
+{
+    FLIGHT_AUTOPILOT = 1,
+    FLIGHT_ATTRACT = 2,
+    FLIGHT_CAPTURE = 4,
+    FLIGHT_STARTED = 8
+};
+struct FlightFrame
+{
+    unsigned int frame;
+    unsigned char state;
+    unsigned char inputs;
+    unsigned short flags;
+    int tick;
+    int score;
+    unsigned int world_hash;
+    float phase_us[FLIGHT_PHASES];
+    double start;
+};
+struct FlightInput
+{
+    unsigned int frame;
+    unsigned char type;
+    unsigned char pad;
+    unsigned short code;
+    short x;
+    short y;
+};
+struct FlightHeader
+{
+    char magic[4];
+    int version;
+    int reason;
+    int detail;
+    float budget_ms;
+    unsigned int frame_count;
+    unsigned int input_count;
+    unsigned int frame_bytes;
+    unsigned int input_bytes;
+    unsigned int state_count;
+    char state_names[flight_max_states][flight_state_name_bytes];
+};
+struct FlightStats
+{
+    long long frames = 0;
+    long long inputs = 0;
+    long long hitches = 0;
+    long long dumps = 0;
+    long long suppressed = 0;
+    double worst_ms = 0.0;
+};
+struct FlightDump
+{
+    FlightHeader header;
+    std::vector<FlightFrame> frames;
+    std::vector<FlightInput> inputs;
+};
+bool flight_open(double budget_ms, const char* const* state_names, int state_count);
+void flight_close();
+void flight_begin_frame(int state);
+void flight_phase(int phase);
+void flight_input(int type, int code, int x, int y);
+void flight_end_frame(int tick, int score, unsigned int world_hash, int flags);
+bool flight_request();
+bool flight_dump(const char* path, int reason, int detail);
+unsigned int flight_hash(const void* data, int bytes);
+FlightStats flight_stats();
+const char* flight_input_name(int type);
+const char* flight_phase_name(int phase);
+bool flight_load(const char* path, FlightDump& dump);
@@ -4,23 +4,95 @@
 #include <ctime>   
 #include <iostream>
 #include <fstream>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <thread>
+#include "simulation.h"
+#include "raster.h"
+#include "replay.h"
+#include "capture.h"
+#include "autopilot.h"
+#include "telemetry.h"
+#include "reach.h"
+#include "bitmask.h"
+#include "anim.h"
+#include "particles.h"
+#include "pattern.h"
+#include "ecs.h"
+#include "pacer.h"
+#include "alloc.h"
+#include "spectate.h"
+#include "replaydb.h"
+#include "renderqueue.h"
+#include "metrics.h"
+#include "flightrec.h"
+#include "assetcache.h"
+#include "fixed.h"
 using namespace std;
 using namespace sf;
-const int width = 864;
-const int height = 512;
-int pipe_gap = 150;
-int pipe_interval = 250;
-const int ground_height = 112;
-const int min_gap_y = 50;
-const int max_pipes = 20;
-float gravity = 0.30f;
-float flap_strength = -5.0f;
-float pipe_speed = -2.8f;
-struct PipePair 
-{
-    Sprite top;
-    Sprite bottom;
-    bool scored = false;
+enum BirdFrame
+{
+    BIRD_FRAME_UP,
+    BIRD_FRAME_DOWN,
+    BIRD_FRAME_COUNT
+};
+enum SceneTexture
+{
+    SCENE_BIRD,
+    SCENE_PIPE_DOWN,
+    SCENE_PIPE_UP,
+    SCENE_TEXTURE_COUNT
+};
+enum SceneLayer
+{
+    LAYER_PIPES,
+    LAYER_BIRD
+};
+enum UiImage
+{
+    UI_NEW_GAME,
+    UI_SETTINGS,
+    UI_LEADERBOARD,
+    UI_MAIN_EXIT,
+    UI_DIFFICULTY,
+    UI_SOUND_ON,
+    UI_SOUND_OFF,
+    UI_MUSIC_ON,
+    UI_MUSIC_OFF,
+    UI_BACK,
+    UI_EASY,
+    UI_HARD,
+    UI_RESUME,
+    UI_RESTART,
+    UI_PAUSE_MAIN,
+    UI_PAUSE_EXIT,
+    UI_PLAY_AGAIN,
+    UI_OVER_MAIN,
+    UI_OVER_EXIT,
+    UI_IMAGE_COUNT
+};
+enum DrawLayer
+{
+    DRAW_BACKGROUND,
+    DRAW_PIPES,
+    DRAW_BIRD,
+    DRAW_PARTICLES,
+    DRAW_HUD,
+    DRAW_OVERLAY,
+    DRAW_MENU
+};
+enum Material
+{
+    MATERIAL_UNTEXTURED = queue_untextured,
+    MATERIAL_BACKGROUND,
+    MATERIAL_INTRO,
+    MATERIAL_UI,
+    MATERIAL_BIRD,
+    MATERIAL_PIPE_DOWN,
+    MATERIAL_PIPE_UP,
+    MATERIAL_TEXTURE_COUNT,
+    MATERIAL_FONT = MATERIAL_TEXTURE_COUNT
 };
 enum GameState 
 {
@@ -33,40 +105,67 @@ enum GameState
     PAUSED,
     GAME_OVER
 };
-enum Difficulty 
+const int sim_ticks_per_second = 60;
+const int snapshot_words = sizeof(SimWorld) / 4;
+static_assert(snapshot_words < 256, "rewind deltas store word indices and counts in one byte");
+const int rewind_ticks_per_second = 60;
+const int rewind_history_seconds = 5;
+const int rewind_step_ticks = 2 * rewind_ticks_per_second;
+const int rewind_keyframe_interval = 30;
+const int rewind_group_count = rewind_history_seconds * rewind_ticks_per_second / rewind_keyframe_interval + 1;
+const int rewind_max_delta_bytes = 1 + 5 * snapshot_words;
+const int frame_quad_budget = 64;
+const int frame_command_budget = 128;
+const int scene_materials[SCENE_TEXTURE_COUNT] = { MATERIAL_BIRD, MATERIAL_PIPE_DOWN, MATERIAL_PIPE_UP };
+const char* ui_image_files[UI_IMAGE_COUNT] = { "mainnewgame.png", "settings.png", "leaderboard.png", "mainexit.png", "difficulty.png",
+                                               "soundon.png", "soundoff.png", "musicon.png", "musicoff.png", "backbutton.png", "easy.png", "hard.png",
+                                               "pauseresume.png", "pauserestart.png", "pausemain.png", "pauseexit.png", "overagain.png", "overmain.png", "overexit.png" };
+struct RewindGroup
 {
-    EASY,
-    HARD
+    SimWorld keyframe;
+    int first_tick = 0;
+    int tick_count = 0;
+    int bytes_used = 0;
+    int delta_offset[rewind_keyframe_interval];
+    unsigned char delta_bytes[rewind_keyframe_interval * rewind_max_delta_bytes];
 };
 struct Button
 {
     Sprite sprite;
-    Texture texture;
     bool isVisible = true;
 };
 GameState game_state = INTRO;
 Difficulty difficulty_level = EASY;
 int selected_menu = -1;
-float bird_vel = 0.f;
-int score = 0;
+SimParams params;
+SimWorld world;
+bool flap_queued = false;
 int leaderboard[3] = { 0, 0, 0 };
 bool game_started = false;
 bool sound_on = true;
 bool music_on = true;
-bool next_gap_high = true;
-Texture bg_tex, bird_up_tex, bird_down_tex, pipe_down_tex, pipe_up_tex, intro_tex[19];
+Texture bg_tex, pipe_down_tex, pipe_up_tex, bird_sheet_tex, intro_sheet_tex, ui_sheet_tex;
+Image bird_up_img, bird_down_img;
+SpriteSheet bird_sheet, intro_sheet, ui_sheet;
 Font game_font;
 SoundBuffer flap_buf, score_buf, dead_buf;
 Sound flap_sound, score_sound, dead_sound;
 Music bg_music, intro_music;
-Sprite background, bird;
-PipePair pipes[max_pipes];
-int pipe_count = 0;
-Sprite intro_sprite;
-int intro_frame = 0;
+Sprite background;
+EcsWorld scene;
+Entity scene_bird = no_entity;
+Entity scene_pipes[max_pipes][2];
+vector<RenderItem> scene_items;
+Sprite scene_sprite;
+Sprite intro_sprite, menu_bird;
+int intro_frame = -1;
 float intro_time = 0.f;
 const int intro_frame_count = 19;
 const float intro_frame_duration = 0.40f;
+const float menu_flap_duration = 0.12f;
+AnimClip intro_clip, bird_rise_clip, bird_fall_clip, menu_flap_clip;
+AnimPlayer bird_anim;
+float menu_time = 0.f;
 Button btn_new_game, btn_settings, btn_leaderboard, btn_exit;
 Button btn_difficulty, btn_sound, btn_music, btn_back_settings;
 Button btn_easy, btn_hard, btn_back_difficulty;
@@ -74,22 +173,94 @@ Button btn_resume, btn_restart, btn_main_menu, btn_exit_pause;
 Button btn_play_again, btn_main_over, btn_exit_over;
 Button btn_back_leaderboard;
 Button btn_easy_indicator, btn_hard_indicator;
-Text score_text, leaderboard_text, title_text;
-float min_f(float a, float b);
-int get_max_gap_y();
+Text score_digits[10], title_text;
+float score_digit_advance[10];
+const int score_max_digits = 10;
+Text score_slots[score_max_digits];
+int score_slot_digit[score_max_digits];
+Text leaderboard_title, leaderboard_rows[3];
+Text game_over_title, final_score_text, start_text, demo_text, spectate_text;
+RectangleShape pause_overlay;
+RewindGroup rewind_groups[rewind_group_count];
+int rewind_newest = 0;
+int rewind_groups_used = 0;
+int rewind_tick = 0;
+bool run_unranked = false;
+bool run_end_pending = false;
+SimHit run_end_hit = HIT_NONE;
+bool autopilot_on = false;
+bool attract_mode = false;
+float menu_idle_time = 0.f;
+const float attract_idle_seconds = 20.f;
+const double autopilot_budget_us = 300.0;
+Replay current_replay;
+ReplayDb replay_db;
+CollisionMasks collision_masks;
+ReachTable reach_table;
+FixedParams fixed_physics;
+bool fixed_point_on = false;
+ObstacleProgram obstacle_pattern;
+unsigned int telemetry_run = 0;
+const int capture_ring_size = 3;
+RenderTexture capture_targets[capture_ring_size];
+bool capture_targets_ready = false;
+int capture_frame = 0;
+Sprite capture_present;
+ParticlePool particles;
+FramePacer pacer;
+int frame_rate = 60;
+double hitch_budget_ms = 0.0;
+bool use_asset_cache = true;
+const double asset_cache_wait_seconds = 10.0;
+float asset_read_seconds = 0.f;
+float asset_decode_seconds = 0.f;
+float asset_cache_seconds = 0.f;
+vector<char> font_file_bytes;
+int tick_credit = 0;
+double tick_time = 0.0;
+const double max_tick_catchup = 0.25;
+const char* state_names[GAME_OVER + 1] = { "INTRO", "MAIN_MENU", "SETTINGS_MENU", "DIFFICULTY_MENU", "LEADERBOARD_MENU", "PLAYING", "PAUSED", "GAME_OVER" };
+AllocStats alloc_by_state[GAME_OVER + 1];
+AllocStats alloc_transitions;
+RenderQueue render_queue;
+const Texture* material_textures[MATERIAL_TEXTURE_COUNT];
+vector<Vertex> frame_vertices;
+vector<const Drawable*> frame_drawables;
+vector<Vertex> batch_vertices;
+RenderQueueStats render_by_state[GAME_OVER + 1];
 void int_to_string(int num, char buffer[]);
-void apply_difficulty();
 void update_music_for_difficulty();
 void load_leaderboard();
 void save_leaderboard();
 void update_leaderboard(int new_score);
-bool load_button(Button& btn, const char filename[]);
+void setup_label(Text& text, const char* str, unsigned int size, Color fill, float outline);
+void center_text(Text& text, float y);
+void refresh_leaderboard_text();
+void refresh_final_score_text();
+void set_button_image(Button& btn, int image);
+bool read_asset_file(const string& path, vector<char>& bytes);
+bool decode_image(Image& image, const string& path);
+bool decode_sound(SoundBuffer& buf, const string& path);
+bool build_sheet(Texture& tex, SpriteSheet& sheet, const Image images[], int count, const char* cache_name);
+bool load_cached_sheet(Texture& tex, SpriteSheet& sheet, const char* cache_name);
+bool load_texture_asset(Texture& tex, const char* cache_name, const char* path);
+bool load_image_asset(Image& image, const char* cache_name, const char* path);
+bool load_sound_asset(SoundBuffer& buf, const char* cache_name, const char* path);
+bool load_font_asset(Font& font, const char* cache_name, const char* path);
+void set_sprite_frame(Sprite& sprite, const SpriteSheet& sheet, int frame);
+void show_intro_frame(int frame);
 bool load_all_assets();
 void setup_background();
 void setup_bird();
 void setup_text();
 void setup_button_positions();
+void setup_particles();
+Visual scene_visual(int texture, int layer, int left, int top, int w, int h, float origin_x, float origin_y);
+void setup_scene();
+void setup_render_queue();
 void setup_all();
+void apply_game_difficulty();
+SimStepResult step_world(bool flap);
 void reset_game();
 bool is_button_hovered(const Button& btn, const Vector2f& mouse_pos);
 void highlight_button(Button& btn, bool is_highlighted);
@@ -101,51 +272,165 @@ void handle_pause_input(const Event& ev, RenderWindow& window);
 void handle_game_over_input(const Event& ev, RenderWindow& window);
 void handle_playing_input(const Event& ev);
 void handle_intro_input(const Event& ev);
+void record_flight_input(const Event& ev);
+unsigned int world_hash();
+int flight_flags();
 void handle_events(RenderWindow& window);
-void update_bird();
-void spawn_pipes();
-void move_pipes();
-void remove_old_pipes();
-void update_scoring();
-void update_pipes();
-FloatRect get_bird_box(float shrink_x = 10.f, float shrink_y = 10.f);
-FloatRect get_pipe_box(const Sprite& pipe, float shrink_x = 5.f);
-void check_collision();
+void flap();
+void handle_death(SimHit hit);
+void finish_run();
+void update_playing();
+void set_autopilot(bool on);
+void start_attract_mode();
+void stop_attract_mode();
+void rewind_clear();
+void rewind_record();
+int rewind_encode_delta(const SimWorld& key, const SimWorld& snap, unsigned char out[]);
+void rewind_decode_delta(const unsigned char in[], SimWorld& snap);
+bool rewind_restore(int ticks_back, SimWorld& out);
+int rewind_history_ticks();
+int rewind_memory_bytes();
+void rewind_after_crash();
 void update_game(float dt);
-void draw_background(RenderWindow& window);
-void draw_main_menu(RenderWindow& window);
-void draw_settings(RenderWindow& window);
-void draw_difficulty(RenderWindow& window);
-void draw_leaderboard(RenderWindow& window);
-void draw_pause(RenderWindow& window);
-void draw_game_over(RenderWindow& window);
-void draw_pipes(RenderWindow& window);
-void draw_score(RenderWindow& window);
-void draw_game(RenderWindow& window);
+void submit_sprite(const Sprite& sprite, int layer, int material);
+void submit_rect(const RectangleShape& rect, int layer);
+void submit_text(const Text& text, int layer);
+void submit_button(Button& btn, bool is_highlighted);
+void begin_frame_queue();
+void flush_frame_queue(RenderTarget& window);
+void print_render_stats();
+void draw_background();
+void draw_main_menu();
+void draw_settings();
+void draw_difficulty();
+void draw_leaderboard();
+void draw_pause();
+void draw_game_over();
+void sync_scene();
+void draw_scene();
+void draw_particles();
+void draw_score();
+void draw_game();
+void draw_frame(RenderTarget& window);
+bool prepare_capture_targets();
+void capture_read_back(int frame);
+void toggle_capture();
+void take_screenshot();
+void draw_captured(RenderWindow& window);
 void draw(RenderWindow& window);
 bool init_game();
 void run_game(RenderWindow& window);
+bool load_raster_texture(RasterAssets& assets, int which, const Image& image);
+bool load_collision_mask(int which, const Image& image, float screen_w);
+bool load_obstacle_pattern(const char* path);
+int run_raster_check();
+int run_replay_render(const char* replay_path, const char* out_path);
+void record_frame_allocs(GameState start_state, unsigned int start_run, const AllocCounters& start);
+void print_alloc_stats();
+int run_alloc_check();
+void draw_spectator(RenderWindow& window, const SpectateView& view);
+int run_spectator(RenderWindow& window, const char* address);
 
-int main() 
+int main(int argc, char* argv[]) 
 {
+    if (argc > 1 && strcmp(argv[1], "--raster-check") == 0)
+    {
+        return run_raster_check();
+    }
+    if (argc > 3 && strcmp(argv[1], "--render-replay") == 0)
+    {
+        return run_replay_render(argv[2], argv[3]);
+    }
+    if (argc > 1 && strcmp(argv[1], "--alloc-check") == 0)
+    {
+        return run_alloc_check();
+    }
+    bool vsync = false;
+    int broadcast_port = -1;
+    int metrics_listen_port = -1;
+    const char* spectate_address = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--pattern") == 0 && i + 1 < argc)
+        {
+            if (!load_obstacle_pattern(argv[++i]))
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+        {
+            int fps = atoi(argv[++i]);
+            frame_rate = fps < 30 ? 30 : (fps > 1000 ? 1000 : fps);
+        }
+        else if (strcmp(argv[i], "--vsync") == 0)
+        {
+            vsync = true;
+        }
+        else if (strcmp(argv[i], "--broadcast") == 0)
+        {
+            bool has_port = i + 1 < argc && argv[i + 1][0] >= '0' && argv[i + 1][0] <= '9';
+            broadcast_port = has_port ? atoi(argv[++i]) : spectate_default_port;
+        }
+        else if (strcmp(argv[i], "--spectate") == 0 && i + 1 < argc)
+        {
+            spectate_address = argv[++i];
+        }
+        else if (strcmp(argv[i], "--hitch-ms") == 0 && i + 1 < argc)
+        {
+            hitch_budget_ms = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--fixed-point") == 0)
+        {
+            fixed_point_on = true;
+        }
+        else if (strcmp(argv[i], "--no-asset-cache") == 0)
+        {
+            use_asset_cache = false;
+        }
+        else if (strcmp(argv[i], "--metrics") == 0)
+        {
+            bool has_port = i + 1 < argc && argv[i + 1][0] >= '0' && argv[i + 1][0] <= '9';
+            metrics_listen_port = has_port ? atoi(argv[++i]) : metrics_default_port;
+        }
+    }
     RenderWindow window(VideoMode(width, height), "Flappy Bird - FMT Studios");
-    window.setFramerateLimit(60);
+    window.setVerticalSyncEnabled(vsync);
     if (!init_game()) 
     {
         return 1;
     }
+    pacer_init(pacer, frame_rate, vsync ? PACER_VSYNC : PACER_SLEEP_SPIN);
+    if (spectate_address != nullptr)
+    {
+        return run_spectator(window, spectate_address);
+    }
+    if (broadcast_port >= 0)
+    {
+        if (spectate_listen(broadcast_port))
+        {
+            cout << "Broadcasting to spectators on port " << spectate_port() << endl;
+        }
+        else
+        {
+            cout << "Broadcast disabled: cannot listen on port " << broadcast_port << endl;
+        }
+    }
+    if (metrics_listen_port >= 0)
+    {
+        if (metrics_listen(metrics_listen_port))
+        {
+            cout << "Serving metrics on http://127.0.0.1:" << metrics_port() << "/metrics" << endl;
+        }
+        else
+        {
+            cout << "Metrics disabled: cannot listen on port " << metrics_listen_port << endl;
+        }
+    }
     run_game(window);
     return 0;
 }
 
-float min_f(float a, float b) 
-{
-    return (a < b) ? a : b;
-}
-int get_max_gap_y() 
-{
-    return height - ground_height - pipe_gap - 25;
-}
 void int_to_string(int num, char buffer[]) 
 {
     if (num == 0)
@@ -178,26 +463,6 @@ void int_to_string(int num, char buffer[])
         buffer[i - j - 1] = temp;
     }
 }
-void apply_difficulty() 
-{
-    switch (difficulty_level) 
-    {
-    case EASY:
-        pipe_gap = 150;
-        gravity = 0.30f;
-        flap_strength = -7.0f;
-        pipe_speed = -2.8f;
-        pipe_interval = 250;
-        break;
-    case HARD:
-        pipe_gap = 110;
-        gravity = 0.55f;
-        flap_strength = -8.5f;
-        pipe_speed = -4.8f;
-        pipe_interval = 180;
-        break;
-    }
-}
 void update_music_for_difficulty() 
 {
     if (difficulty_level == EASY) 
@@ -231,9 +496,11 @@ void load_leaderboard()
         }
         in.close();
     }
+    refresh_leaderboard_text();
 }
 void save_leaderboard() 
 {
+    Clock write_clock;
     ofstream out("leaderboard.txt");
     if (out.is_open()) 
     {
@@ -243,6 +510,7 @@ void save_leaderboard()
         }
         out.close();
     }
+    metrics_leaderboard_write(write_clock.getElapsedTime().asSeconds());
 }
 void update_leaderboard(int new_score) 
 {
@@ -268,130 +536,312 @@ void update_leaderboard(int new_score)
     {
         leaderboard[i] = temp[i];
     }
+    refresh_leaderboard_text();
     save_leaderboard();
 }
-bool load_button(Button& btn, const char filename[])
+void set_button_image(Button& btn, int image)
+{
+    btn.sprite.setTexture(ui_sheet_tex);
+    set_sprite_frame(btn.sprite, ui_sheet, image);
+}
+bool read_asset_file(const string& path, vector<char>& bytes)
+{
+    Clock clock;
+    ifstream in(path, ios::binary);
+    bytes.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    asset_read_seconds += clock.getElapsedTime().asSeconds();
+    return !bytes.empty();
+}
+bool decode_image(Image& image, const string& path)
 {
-    char path[256] = "assets/";
-    int i = 7;
-    int j = 0;
-    while (filename[j] != '\0') 
+    vector<char> bytes;
+    if (!read_asset_file(path, bytes))
     {
-        path[i++] = filename[j++];
+        return false;
     }
-    path[i] = '\0';
-    if (!btn.texture.loadFromFile(path)) 
+    Clock clock;
+    bool ok = image.loadFromMemory(bytes.data(), bytes.size());
+    asset_decode_seconds += clock.getElapsedTime().asSeconds();
+    return ok;
+}
+bool decode_sound(SoundBuffer& buf, const string& path)
+{
+    vector<char> bytes;
+    if (!read_asset_file(path, bytes))
     {
-        cout << "Failed to load " << path << endl;
         return false;
     }
-    btn.sprite.setTexture(btn.texture);
-    return true;
+    Clock clock;
+    bool ok = buf.loadFromMemory(bytes.data(), bytes.size());
+    asset_decode_seconds += clock.getElapsedTime().asSeconds();
+    return ok;
 }
-bool load_all_assets()
+bool build_sheet(Texture& tex, SpriteSheet& sheet, const Image images[], int count, const char* cache_name)
 {
-    char bg_path[] = "assets/bg.png";
-    char bird_up_path[] = "assets/birdup.png";
-    char bird_down_path[] = "assets/birddown.png";
-    char pipe_down_path[] = "assets/pipedown.png";
-    char pipe_up_path[] = "assets/pipeup.png";
-    if (!bg_tex.loadFromFile(bg_path) ||
-        !bird_up_tex.loadFromFile(bird_up_path) ||
-        !bird_down_tex.loadFromFile(bird_down_path) ||
-        !pipe_down_tex.loadFromFile(pipe_down_path) ||
-        !pipe_up_tex.loadFromFile(pipe_up_path)) 
+    int w[anim_max_frames];
+    int h[anim_max_frames];
+    for (int i = 0; i < count; ++i)
     {
-        return false;
+        w[i] = (int)images[i].getSize().x;
+        h[i] = (int)images[i].getSize().y;
     }
-    if (!game_font.loadFromFile("assets/arial.ttf")) 
+    if (count > anim_max_frames || !anim_pack_sheet(sheet, w, h, count, (int)Texture::getMaximumSize(), 1))
     {
-        cout << "Failed to load font" << endl;
         return false;
     }
-    for (int i = 0; i < intro_frame_count; ++i) 
+    Image atlas;
+    atlas.create(sheet.width, sheet.height, Color::Transparent);
+    for (int i = 0; i < count; ++i)
     {
-        int frame_number = i + 1;
-        char num_buf[8];
-        int_to_string(frame_number, num_buf);
-        char path[64] = "assets/intro";
-        int p = 11;
-        int k = 0;
-        while (num_buf[k] != '\0') 
-        {
-            path[p++] = num_buf[k++];
-        }
-        path[p++] = '.';
-        path[p++] = 'g';
-        path[p++] = 'i';
-        path[p++] = 'f';
-        path[p] = '\0';
-        if (!intro_tex[i].loadFromFile(path)) 
+        if (w[i] > 0 && h[i] > 0)
         {
-            cout << "Failed to load " << path << endl;
+            atlas.copy(images[i], sheet.frames[i].left, sheet.frames[i].top);
         }
     }
-    if (intro_tex[0].getSize().x > 0) 
+    assetcache_add(cache_name, ASSET_PIXELS, sheet.width, sheet.height, 4, 0, atlas.getPixelsPtr(), (long long)sheet.width * sheet.height * 4, sheet.frames.data(), count);
+    return tex.loadFromImage(atlas);
+}
+bool load_cached_sheet(Texture& tex, SpriteSheet& sheet, const char* cache_name)
+{
+    const AssetEntry* e = assetcache_find(cache_name);
+    if (e == nullptr || e->kind != ASSET_PIXELS || e->rect_count <= 0 || e->bytes != (long long)e->width * e->height * 4 || !tex.create(e->width, e->height))
     {
-        intro_sprite.setTexture(intro_tex[0]);
-        intro_sprite.setPosition(0.f, 0.f);
-        float sx = (float)width / intro_tex[0].getSize().x;
-        float sy = (float)height / intro_tex[0].getSize().y;
-        intro_sprite.setScale(sx, sy);
+        return false;
     }
-    char flap_path[] = "assets/flap.wav";
-    char score_path[] = "assets/score.wav";
-    char dead_path[] = "assets/dead.wav";
-    if (!flap_buf.loadFromFile(flap_path) ||
-        !score_buf.loadFromFile(score_path) ||
-        !dead_buf.loadFromFile(dead_path)) 
+    Clock clock;
+    tex.update(assetcache_data(*e));
+    asset_cache_seconds += clock.getElapsedTime().asSeconds();
+    sheet.width = e->width;
+    sheet.height = e->height;
+    sheet.frames.assign(assetcache_rects(*e), assetcache_rects(*e) + e->rect_count);
+    return true;
+}
+bool load_texture_asset(Texture& tex, const char* cache_name, const char* path)
+{
+    const AssetEntry* e = assetcache_find(cache_name);
+    if (e != nullptr && e->kind == ASSET_PIXELS && e->bytes == (long long)e->width * e->height * 4 && tex.create(e->width, e->height))
+    {
+        Clock clock;
+        tex.update(assetcache_data(*e));
+        asset_cache_seconds += clock.getElapsedTime().asSeconds();
+        return true;
+    }
+    Image image;
+    if (!decode_image(image, path))
     {
         return false;
     }
-    flap_sound.setBuffer(flap_buf);
-    score_sound.setBuffer(score_buf);
-    dead_sound.setBuffer(dead_buf);
-    if (!load_button(btn_new_game, "mainnewgame.png") ||
-        !load_button(btn_settings, "settings.png") ||
-        !load_button(btn_leaderboard, "leaderboard.png") ||
-        !load_button(btn_exit, "mainexit.png")) 
+    Vector2u size = image.getSize();
+    assetcache_add(cache_name, ASSET_PIXELS, size.x, size.y, 4, 0, image.getPixelsPtr(), (long long)size.x * size.y * 4, nullptr, 0);
+    return tex.loadFromImage(image);
+}
+bool load_image_asset(Image& image, const char* cache_name, const char* path)
+{
+    const AssetEntry* e = assetcache_find(cache_name);
+    if (e != nullptr && e->kind == ASSET_PIXELS && e->bytes == (long long)e->width * e->height * 4)
+    {
+        Clock clock;
+        image.create(e->width, e->height, assetcache_data(*e));
+        asset_cache_seconds += clock.getElapsedTime().asSeconds();
+        return true;
+    }
+    if (!decode_image(image, path))
+    {
+        return false;
+    }
+    Vector2u size = image.getSize();
+    assetcache_add(cache_name, ASSET_PIXELS, size.x, size.y, 4, 0, image.getPixelsPtr(), (long long)size.x * size.y * 4, nullptr, 0);
+    return true;
+}
+bool load_sound_asset(SoundBuffer& buf, const char* cache_name, const char* path)
+{
+    const AssetEntry* e = assetcache_find(cache_name);
+    Clock clock;
+    if (e != nullptr && e->kind == ASSET_SAMPLES && e->channels > 0 &&
+        buf.loadFromSamples((const Int16*)assetcache_data(*e), (Uint64)(e->bytes / sizeof(Int16)), e->channels, e->rate))
+    {
+        asset_cache_seconds += clock.getElapsedTime().asSeconds();
+        return true;
+    }
+    if (!decode_sound(buf, path))
     {
         return false;
     }
-    if (!load_button(btn_difficulty, "difficulty.png") ||
-        !load_button(btn_sound, sound_on ? "soundon.png" : "soundoff.png") ||
-        !load_button(btn_music, music_on ? "musicon.png" : "musicoff.png") ||
-        !load_button(btn_back_settings, "backbutton.png")) 
+    assetcache_add(cache_name, ASSET_SAMPLES, 0, 0, buf.getChannelCount(), buf.getSampleRate(), buf.getSamples(), (long long)(buf.getSampleCount() * sizeof(Int16)), nullptr, 0);
+    return true;
+}
+bool load_font_asset(Font& font, const char* cache_name, const char* path)
+{
+    const AssetEntry* e = assetcache_find(cache_name);
+    Clock clock;
+    if (e != nullptr && e->kind == ASSET_BYTES && font.loadFromMemory(assetcache_data(*e), (size_t)e->bytes))
+    {
+        asset_cache_seconds += clock.getElapsedTime().asSeconds();
+        font_file_bytes.clear();
+        font_file_bytes.shrink_to_fit();
+        return true;
+    }
+    if (!read_asset_file(path, font_file_bytes))
     {
         return false;
     }
-    if (!load_button(btn_easy, "easy.png") ||
-        !load_button(btn_hard, "hard.png") ||
-        !load_button(btn_back_difficulty, "backbutton.png")) 
+    clock.restart();
+    if (!font.loadFromMemory(font_file_bytes.data(), font_file_bytes.size()))
     {
         return false;
     }
-    if (!load_button(btn_resume, "pauseresume.png") ||
-        !load_button(btn_restart, "pauserestart.png") ||
-        !load_button(btn_main_menu, "pausemain.png") ||
-        !load_button(btn_exit_pause, "pauseexit.png")) 
+    asset_decode_seconds += clock.getElapsedTime().asSeconds();
+    assetcache_add(cache_name, ASSET_BYTES, 0, 0, 0, 0, font_file_bytes.data(), (long long)font_file_bytes.size(), nullptr, 0);
+    return true;
+}
+void set_sprite_frame(Sprite& sprite, const SpriteSheet& sheet, int frame)
+{
+    const AnimRect& r = sheet.frames[frame];
+    sprite.setTextureRect(IntRect(r.left, r.top, r.width, r.height));
+}
+void show_intro_frame(int frame)
+{
+    if (frame == intro_frame || frame >= (int)intro_sheet.frames.size() || intro_sheet.frames[frame].width == 0)
+    {
+        return;
+    }
+    intro_frame = frame;
+    set_sprite_frame(intro_sprite, intro_sheet, frame);
+    float sx = (float)width / intro_sheet.frames[frame].width;
+    float sy = (float)height / intro_sheet.frames[frame].height;
+    intro_sprite.setScale(sx, sy);
+}
+bool load_all_assets()
+{
+    char bg_path[] = "assets/bg.png";
+    char bird_up_path[] = "assets/birdup.png";
+    char bird_down_path[] = "assets/birddown.png";
+    char pipe_down_path[] = "assets/pipedown.png";
+    char pipe_up_path[] = "assets/pipeup.png";
+    if (use_asset_cache && assetcache_attach(assetcache_default_name, assetcache_stamp("assets"), asset_cache_wait_seconds) != ASSETCACHE_LOCAL)
+    {
+        atexit(assetcache_detach);
+    }
+    if (!load_texture_asset(bg_tex, "bg", bg_path) ||
+        !load_image_asset(bird_up_img, "birdup", bird_up_path) ||
+        !load_image_asset(bird_down_img, "birddown", bird_down_path) ||
+        !load_texture_asset(pipe_down_tex, "pipedown", pipe_down_path) ||
+        !load_texture_asset(pipe_up_tex, "pipeup", pipe_up_path)) 
     {
         return false;
     }
-    if (!load_button(btn_play_again, "overagain.png") ||
-        !load_button(btn_main_over, "overmain.png") ||
-        !load_button(btn_exit_over, "overexit.png")) 
+    Image bird_frames[BIRD_FRAME_COUNT] = { bird_up_img, bird_down_img };
+    if (!load_cached_sheet(bird_sheet_tex, bird_sheet, "bird_sheet") && !build_sheet(bird_sheet_tex, bird_sheet, bird_frames, BIRD_FRAME_COUNT, "bird_sheet"))
     {
+        cout << "Failed to build bird sprite sheet" << endl;
         return false;
     }
-    if (!load_button(btn_back_leaderboard, "backbutton.png")) 
+    int rise_frames[] = { BIRD_FRAME_UP };
+    int fall_frames[] = { BIRD_FRAME_DOWN };
+    int flap_frames[] = { BIRD_FRAME_UP, BIRD_FRAME_DOWN };
+    bird_rise_clip = anim_make_clip(rise_frames, 1, 1.f, false);
+    bird_fall_clip = anim_make_clip(fall_frames, 1, 1.f, false);
+    menu_flap_clip = anim_make_clip(flap_frames, 2, menu_flap_duration, true);
+    if (!load_font_asset(game_font, "font", "assets/arial.ttf")) 
     {
+        cout << "Failed to load font" << endl;
         return false;
     }
-    if (!load_button(btn_easy_indicator, "easy.png") ||
-        !load_button(btn_hard_indicator, "hard.png"))
+    int intro_order[intro_frame_count];
+    for (int i = 0; i < intro_frame_count; ++i) 
+    {
+        intro_order[i] = i;
+    }
+    intro_clip = anim_make_clip(intro_order, intro_frame_count, intro_frame_duration, false);
+    bool intro_ready = load_cached_sheet(intro_sheet_tex, intro_sheet, "intro_sheet");
+    if (!intro_ready)
+    {
+        Image intro_images[intro_frame_count];
+        for (int i = 0; i < intro_frame_count; ++i) 
+        {
+            int frame_number = i + 1;
+            char num_buf[8];
+            int_to_string(frame_number, num_buf);
+            char path[64] = "assets/intro";
+            int p = 11;
+            int k = 0;
+            while (num_buf[k] != '\0') 
+            {
+                path[p++] = num_buf[k++];
+            }
+            path[p++] = '.';
+            path[p++] = 'g';
+            path[p++] = 'i';
+            path[p++] = 'f';
+            path[p] = '\0';
+            if (!decode_image(intro_images[i], path)) 
+            {
+                cout << "Failed to load " << path << endl;
+            }
+        }
+        intro_ready = build_sheet(intro_sheet_tex, intro_sheet, intro_images, intro_frame_count, "intro_sheet");
+    }
+    if (intro_ready)
+    {
+        intro_sprite.setTexture(intro_sheet_tex);
+        intro_sprite.setPosition(0.f, 0.f);
+        show_intro_frame(0);
+    }
+    else
+    {
+        cout << "Intro frames do not fit in one sprite sheet" << endl;
+    }
+    char flap_path[] = "assets/flap.wav";
+    char score_path[] = "assets/score.wav";
+    char dead_path[] = "assets/dead.wav";
+    if (!load_sound_asset(flap_buf, "flap", flap_path) ||
+        !load_sound_asset(score_buf, "score", score_path) ||
+        !load_sound_asset(dead_buf, "dead", dead_path)) 
     {
         return false;
     }
+    flap_sound.setBuffer(flap_buf);
+    score_sound.setBuffer(score_buf);
+    dead_sound.setBuffer(dead_buf);
+    if (!load_cached_sheet(ui_sheet_tex, ui_sheet, "ui_sheet"))
+    {
+        Image ui_images[UI_IMAGE_COUNT];
+        for (int i = 0; i < UI_IMAGE_COUNT; ++i)
+        {
+            string path = string("assets/") + ui_image_files[i];
+            if (!decode_image(ui_images[i], path))
+            {
+                cout << "Failed to load " << path << endl;
+                return false;
+            }
+        }
+        if (!build_sheet(ui_sheet_tex, ui_sheet, ui_images, UI_IMAGE_COUNT, "ui_sheet"))
+        {
+            cout << "Failed to build button sprite sheet" << endl;
+            return false;
+        }
+    }
+    set_button_image(btn_new_game, UI_NEW_GAME);
+    set_button_image(btn_settings, UI_SETTINGS);
+    set_button_image(btn_leaderboard, UI_LEADERBOARD);
+    set_button_image(btn_exit, UI_MAIN_EXIT);
+    set_button_image(btn_difficulty, UI_DIFFICULTY);
+    set_button_image(btn_sound, sound_on ? UI_SOUND_ON : UI_SOUND_OFF);
+    set_button_image(btn_music, music_on ? UI_MUSIC_ON : UI_MUSIC_OFF);
+    set_button_image(btn_back_settings, UI_BACK);
+    set_button_image(btn_easy, UI_EASY);
+    set_button_image(btn_hard, UI_HARD);
+    set_button_image(btn_back_difficulty, UI_BACK);
+    set_button_image(btn_resume, UI_RESUME);
+    set_button_image(btn_restart, UI_RESTART);
+    set_button_image(btn_main_menu, UI_PAUSE_MAIN);
+    set_button_image(btn_exit_pause, UI_PAUSE_EXIT);
+    set_button_image(btn_play_again, UI_PLAY_AGAIN);
+    set_button_image(btn_main_over, UI_OVER_MAIN);
+    set_button_image(btn_exit_over, UI_OVER_EXIT);
+    set_button_image(btn_back_leaderboard, UI_BACK);
+    set_button_image(btn_easy_indicator, UI_EASY);
+    set_button_image(btn_hard_indicator, UI_HARD);
 
     if (!intro_music.openFromFile("assets/animationsound.mp3")) 
     {
@@ -401,6 +851,11 @@ bool load_all_assets()
     {
         intro_music.setLoop(false);
     }
+    if (assetcache_publish() && !load_font_asset(game_font, "font", "assets/arial.ttf"))
+    {
+        cout << "Failed to load font" << endl;
+        return false;
+    }
     return true;
 }
 void setup_background()
@@ -413,26 +868,95 @@ void setup_background()
 }
 void setup_bird() 
 {
-    bird.setTexture(bird_up_tex);
-    bird.setOrigin(bird.getLocalBounds().width / 2.f, bird.getLocalBounds().height / 2.f);
-    bird.setPosition(120, height / 2);
+    menu_bird.setTexture(bird_sheet_tex);
+    set_sprite_frame(menu_bird, bird_sheet, BIRD_FRAME_UP);
+    params.bird_w = (float)bird_up_img.getSize().x;
+    params.bird_h = (float)bird_up_img.getSize().y;
+    params.pipe_w = 1.5f * pipe_down_tex.getSize().x;
+    if (load_collision_mask(MASK_BIRD_UP, bird_up_img, params.pipe_w) &&
+        load_collision_mask(MASK_BIRD_DOWN, bird_down_img, params.pipe_w) &&
+        load_collision_mask(MASK_PIPE_TOP, pipe_down_tex.copyToImage(), params.pipe_w) &&
+        load_collision_mask(MASK_PIPE_BOTTOM, pipe_up_tex.copyToImage(), params.pipe_w))
+    {
+        params.masks = &collision_masks;
+    }
+    else
+    {
+        cout << "Sprites too large for pixel collision masks, using hit boxes" << endl;
+        params.masks = nullptr;
+    }
+}
+void setup_label(Text& text, const char* str, unsigned int size, Color fill, float outline)
+{
+    text.setFont(game_font);
+    text.setString(str);
+    text.setCharacterSize(size);
+    text.setFillColor(fill);
+    text.setOutlineColor(Color::Black);
+    text.setOutlineThickness(outline);
+}
+void center_text(Text& text, float y)
+{
+    FloatRect bounds = text.getLocalBounds();
+    text.setPosition((width - bounds.width) / 2, y);
+}
+void refresh_leaderboard_text()
+{
+    char buffer[100];
+    for (int i = 0; i < 3; i++)
+    {
+        buffer[0] = '1' + i;
+        buffer[1] = '.';
+        buffer[2] = ' ';
+        int_to_string(leaderboard[i], buffer + 3);
+        leaderboard_rows[i].setString(buffer);
+        center_text(leaderboard_rows[i], 200 + i * 70);
+    }
+}
+void refresh_final_score_text()
+{
+    char score_buffer[50] = "Score: ";
+    int_to_string(world.score, score_buffer + 7);
+    final_score_text.setString(score_buffer);
+    center_text(final_score_text, 40 + game_over_title.getLocalBounds().height + 20);
 }
 void setup_text() 
 {
-    score_text = Text("", game_font, 64);
-    score_text.setFillColor(Color::White);
-    score_text.setOutlineColor(Color::Black);
-    score_text.setOutlineThickness(4);
-    score_text.setPosition(width / 2 - 40, 20);
-    leaderboard_text = Text("", game_font, 48);
-    leaderboard_text.setFillColor(Color::White);
-    leaderboard_text.setOutlineColor(Color::Black);
-    leaderboard_text.setOutlineThickness(3);
+    for (int d = 0; d < 10; ++d)
+    {
+        char digit[2] = { (char)('0' + d), '\0' };
+        setup_label(score_digits[d], digit, 64, Color::White, 4);
+        score_digit_advance[d] = score_digits[d].findCharacterPos(1).x;
+    }
+    for (int i = 0; i < score_max_digits; ++i)
+    {
+        setup_label(score_slots[i], "0", 64, Color::White, 4);
+        score_slot_digit[i] = 0;
+    }
+    setup_label(leaderboard_title, "LEADERBOARD", 60, Color::Yellow, 4);
+    center_text(leaderboard_title, 80);
+    for (int i = 0; i < 3; ++i)
+    {
+        setup_label(leaderboard_rows[i], "", 48, Color::White, 3);
+    }
+    setup_label(game_over_title, "GAME OVER", 72, Color::Red, 5);
+    center_text(game_over_title, 40);
+    setup_label(final_score_text, "", 40, Color::White, 3);
+    setup_label(start_text, "PRESS SPACE OR CLICK TO START", 32, Color::White, 3);
+    center_text(start_text, height / 2 - 50);
+    setup_label(demo_text, "DEMO - PRESS ANY KEY", 32, Color::Yellow, 3);
+    center_text(demo_text, height - 60);
+    setup_label(spectate_text, "WAITING FOR THE NEXT RUN", 32, Color::White, 3);
+    center_text(spectate_text, height / 2 - 50);
+    pause_overlay.setSize(Vector2f(width, height));
+    pause_overlay.setFillColor(Color(0, 0, 0, 150));
     title_text = Text("Flappy Bird by FMT Studios", game_font, 48);
     title_text.setFillColor(Color(0, 51, 102));
     title_text.setStyle(Text::Bold);
     FloatRect title_bounds = title_text.getLocalBounds();
     title_text.setPosition((width - title_bounds.width) / 2, 80);
+    FloatRect menu_bird_bounds = menu_bird.getLocalBounds();
+    menu_bird.setPosition((width - title_bounds.width) / 2 - menu_bird_bounds.width - 16, 80 + title_bounds.top + (title_bounds.height - menu_bird_bounds.height) / 2);
 }
 void setup_button_positions() 
 {
@@ -472,25 +996,90 @@ void setup_button_positions()
     btn_exit_over.sprite.setPosition(width / 2 - btn_exit_over.sprite.getGlobalBounds().width / 2, start_y + spacing * 2);
     btn_back_leaderboard.sprite.setPosition(width / 2 - btn_back_leaderboard.sprite.getGlobalBounds().width / 2, height - 100);
 }
+void setup_particles()
+{
+    particles_clear(particles);
+}
+Visual scene_visual(int texture, int layer, int left, int top, int w, int h, float origin_x, float origin_y)
+{
+    Visual v = { texture, layer, left, top, w, h, origin_x, origin_y };
+    return v;
+}
+void setup_scene()
+{
+    ecs_clear(scene);
+    ecs_reserve(scene, 1 + 2 * max_pipes);
+    const AnimRect& frame = bird_sheet.frames[BIRD_FRAME_UP];
+    scene_bird = ecs_create(scene);
+    ecs_add(scene.placements, scene_bird, Placement{ bird_x, height / 2.f, 1.f, 1.f, 0.f });
+    ecs_add(scene.visuals, scene_bird, scene_visual(SCENE_BIRD, LAYER_BIRD, frame.left, frame.top, frame.width, frame.height, frame.width / 2.f, frame.height / 2.f));
+    for (int i = 0; i < max_pipes; ++i)
+    {
+        for (int half = 0; half < 2; ++half)
+        {
+            scene_pipes[i][half] = ecs_create(scene);
+            ecs_add(scene.placements, scene_pipes[i][half], Placement{ 0.f, 0.f, 1.5f, 1.f, 0.f });
+        }
+    }
+    scene_items.reserve(1 + 2 * max_pipes);
+}
+void setup_render_queue()
+{
+    material_textures[MATERIAL_UNTEXTURED] = nullptr;
+    material_textures[MATERIAL_BACKGROUND] = &bg_tex;
+    material_textures[MATERIAL_INTRO] = &intro_sheet_tex;
+    material_textures[MATERIAL_UI] = &ui_sheet_tex;
+    material_textures[MATERIAL_BIRD] = &bird_sheet_tex;
+    material_textures[MATERIAL_PIPE_DOWN] = &pipe_down_tex;
+    material_textures[MATERIAL_PIPE_UP] = &pipe_up_tex;
+    queue_reserve(render_queue, frame_command_budget);
+    frame_vertices.reserve(4 * (particle_capacity + frame_quad_budget));
+    frame_drawables.reserve(frame_command_budget);
+    batch_vertices.reserve(4 * frame_quad_budget);
+}
 void setup_all() 
 {
     setup_background();
     setup_bird();
     setup_text();
     setup_button_positions();
+    setup_particles();
+    setup_scene();
+    setup_render_queue();
+}
+void apply_game_difficulty()
+{
+    apply_difficulty(difficulty_level, params, reach_table);
+    if (fixed_point_on)
+    {
+        fixed_params(params, fixed_physics);
+        params.fixed = &fixed_physics;
+    }
+}
+SimStepResult step_world(bool flap)
+{
+    return params.fixed != nullptr ? fixed_step_world(world, *params.fixed, flap) : sim_step(world, params, flap);
 }
 void reset_game() 
 {
+    finish_run();
     game_state = PLAYING;
     game_started = false;
-    score = 0;
-    pipe_count = 0;
-    bird.setPosition(120, height / 2);
-    bird.setRotation(0);
-    bird_vel = 0;
+    unsigned int seed = (unsigned)rand();
+    sim_reset(world, seed);
+    replay_begin(current_replay, difficulty_level, seed, params.masks != nullptr, fixed_point_on, params.pattern);
+    flap_queued = false;
     selected_menu = -1;
-    next_gap_high = true;
-    apply_difficulty();
+    run_unranked = autopilot_on || params.pattern != nullptr;
+    rewind_clear();
+    particles_clear(particles);
+    apply_game_difficulty();
+    ++telemetry_run;
+    if (!attract_mode)
+    {
+        telemetry_log(EVENT_RUN_START, (unsigned char)difficulty_level, telemetry_run, 0, (int)seed, world.bird_y);
+        metrics_run_started(difficulty_level);
+    }
     bg_music.stop();
 }
 bool is_button_hovered(const Button& btn, const Vector2f& mouse_pos) 
@@ -603,13 +1192,13 @@ void handle_settings_input(const Event& ev, RenderWindow& window)
             else if (selected_menu == 1) 
             {
                 sound_on = !sound_on;
-                load_button(btn_sound, sound_on ? "soundon.png" : "soundoff.png");
+                set_button_image(btn_sound, sound_on ? UI_SOUND_ON : UI_SOUND_OFF);
                 setup_button_positions();
             }
             else if (selected_menu == 2) 
             {
                 music_on = !music_on;
-                load_button(btn_music, music_on ? "musicon.png" : "musicoff.png");
+                set_button_image(btn_music, music_on ? UI_MUSIC_ON : UI_MUSIC_OFF);
                 setup_button_positions();
                 if (music_on) 
                 {
@@ -641,13 +1230,13 @@ void handle_settings_input(const Event& ev, RenderWindow& window)
         else if (is_button_hovered(btn_sound, mouse_pos)) 
         {
             sound_on = !sound_on;
-            load_button(btn_sound, sound_on ? "soundon.png" : "soundoff.png");
+            set_button_image(btn_sound, sound_on ? UI_SOUND_ON : UI_SOUND_OFF);
             setup_button_positions();
         }
         else if (is_button_hovered(btn_music, mouse_pos))
         {
             music_on = !music_on;
-            load_button(btn_music, music_on ? "musicon.png" : "musicoff.png");
+            set_button_image(btn_music, music_on ? UI_MUSIC_ON : UI_MUSIC_OFF);
             setup_button_positions();
             if (music_on) 
             {
@@ -693,13 +1282,13 @@ void handle_difficulty_input(const Event& ev, RenderWindow& window)
             if (selected_menu == 0) 
             {
                 difficulty_level = EASY;
-                apply_difficulty();
+                apply_game_difficulty();
                 update_music_for_difficulty();
             }
             else if (selected_menu == 1) 
             {
                 difficulty_level = HARD;
-                apply_difficulty();
+                apply_game_difficulty();
                 update_music_for_difficulty();
             }
             else if (selected_menu == 2)
@@ -715,13 +1304,13 @@ void handle_difficulty_input(const Event& ev, RenderWindow& window)
         if (is_button_hovered(btn_easy, mouse_pos)) 
         {
             difficulty_level = EASY;
-            apply_difficulty();
+            apply_game_difficulty();
             update_music_for_difficulty();
         }
         else if (is_button_hovered(btn_hard, mouse_pos)) 
         {
             difficulty_level = HARD;
-            apply_difficulty();
+            apply_game_difficulty();
             update_music_for_difficulty();
         }
         else if (is_button_hovered(btn_back_difficulty, mouse_pos)) 
@@ -852,6 +1441,10 @@ void handle_game_over_input(const Event& ev, RenderWindow& window)
                 window.close();
             }
         }
+        else if (ev.key.code == Keyboard::R)
+        {
+            rewind_after_crash();
+        }
     }
     if (ev.type == Event::MouseButtonPressed && ev.mouseButton.button == Mouse::Left) 
     {
@@ -883,32 +1476,16 @@ void handle_playing_input(const Event& ev)
         }
         if (ev.key.code == Keyboard::Space) 
         {
-            if (!game_started)
-            {
-                game_started = true;
-                update_music_for_difficulty();
-            }
-            bird_vel = flap_strength;
-            if (sound_on)
-            {
-                flap_sound.play();
-            }
-            bird.setTexture(bird_up_tex);
+            flap();
+        }
+        if (ev.key.code == Keyboard::A)
+        {
+            set_autopilot(!autopilot_on);
         }
     }
     if (ev.type == Event::MouseButtonPressed && ev.mouseButton.button == Mouse::Left) 
     {
-        if (!game_started) 
-        {
-            game_started = true;
-            update_music_for_difficulty();
-        }
-        bird_vel = flap_strength;
-        if (sound_on)
-        {
-            flap_sound.play();
-        }
-        bird.setTexture(bird_up_tex);
+        flap();
     }
 }
 void handle_intro_input(const Event& ev) 
@@ -924,15 +1501,77 @@ void handle_intro_input(const Event& ev)
         game_state = MAIN_MENU;
     }
 }
+void record_flight_input(const Event& ev)
+{
+    switch (ev.type)
+    {
+        case Event::KeyPressed:
+            flight_input(FLIGHT_KEY_DOWN, ev.key.code, 0, 0);
+            break;
+        case Event::KeyReleased:
+            flight_input(FLIGHT_KEY_UP, ev.key.code, 0, 0);
+            break;
+        case Event::MouseButtonPressed:
+            flight_input(FLIGHT_MOUSE_DOWN, ev.mouseButton.button, ev.mouseButton.x, ev.mouseButton.y);
+            break;
+        case Event::MouseButtonReleased:
+            flight_input(FLIGHT_MOUSE_UP, ev.mouseButton.button, ev.mouseButton.x, ev.mouseButton.y);
+            break;
+        case Event::LostFocus:
+            flight_input(FLIGHT_FOCUS_LOST, 0, 0, 0);
+            break;
+        case Event::GainedFocus:
+            flight_input(FLIGHT_FOCUS_GAINED, 0, 0, 0);
+            break;
+        case Event::Closed:
+            flight_input(FLIGHT_CLOSED, 0, 0, 0);
+            break;
+        case Event::Resized:
+            flight_input(FLIGHT_RESIZED, 0, ev.size.width, ev.size.height);
+            break;
+        default:
+            break;
+    }
+}
+unsigned int world_hash()
+{
+    return flight_hash(&world, (int)(offsetof(SimWorld, pipes) + world.pipe_count * sizeof(SimPipe)));
+}
+int flight_flags()
+{
+    return (autopilot_on ? FLIGHT_AUTOPILOT : 0) | (attract_mode ? FLIGHT_ATTRACT : 0) | (capture_active() ? FLIGHT_CAPTURE : 0) | (game_started ? FLIGHT_STARTED : 0);
+}
 void handle_events(RenderWindow& window) 
 {
     Event ev;
     while (window.pollEvent(ev)) 
     {
+        record_flight_input(ev);
         if (ev.type == Event::Closed) 
         {
             window.close();
         }
+        if (attract_mode && (ev.type == Event::KeyPressed || ev.type == Event::MouseButtonPressed))
+        {
+            stop_attract_mode();
+            continue;
+        }
+        if (ev.type == Event::KeyPressed || ev.type == Event::MouseButtonPressed || ev.type == Event::MouseMoved)
+        {
+            menu_idle_time = 0.f;
+        }
+        if (ev.type == Event::KeyPressed && ev.key.code == Keyboard::F9)
+        {
+            toggle_capture();
+        }
+        if (ev.type == Event::KeyPressed && ev.key.code == Keyboard::F12)
+        {
+            take_screenshot();
+        }
+        if (ev.type == Event::KeyPressed && ev.key.code == Keyboard::F8)
+        {
+            flight_request();
+        }
         switch (game_state) 
         {
             case INTRO:
@@ -962,145 +1601,289 @@ void handle_events(RenderWindow& window)
         }
     }
 }
-void update_bird() 
+void flap()
 {
-    bird_vel += gravity;
-    bird.move(0, bird_vel);
-    bird.setRotation(min_f(bird_vel * 4.f, 90.f));
-    if (bird_vel > 0)
+    if (!game_started)
     {
-        bird.setTexture(bird_down_tex);
+        game_started = true;
+        update_music_for_difficulty();
     }
-}
-void spawn_pipes() 
+    flap_queued = true;
+    if (sound_on)
+    {
+        flap_sound.play();
+    }
+}
+void handle_death(SimHit hit)
 {
-    if (pipe_count == 0 || pipes[pipe_count - 1].top.getPosition().x <= width - pipe_interval) 
+    if (attract_mode)
+    {
+        start_attract_mode();
+        return;
+    }
+    if (autopilot_on)
     {
-        if (pipe_count < max_pipes) 
+        AutopilotStats stats = autopilot_stats();
+        if (stats.plans > 0)
         {
-            int max_gap = get_max_gap_y();
-            int gap_y;
-            if (difficulty_level == HARD) 
-            {
-                if (next_gap_high) 
-                {
-                    gap_y = min_gap_y + (max_gap - min_gap_y) / 4;
-                }
-                else 
-                {
-                    gap_y = min_gap_y + (3 * (max_gap - min_gap_y)) / 4;
-                }
-                next_gap_high = !next_gap_high;
-            }
-            else 
-            {
-                gap_y = min_gap_y + rand() % (max_gap - min_gap_y + 1);
-            }
-            pipes[pipe_count].top.setTexture(pipe_down_tex);
-            pipes[pipe_count].top.setPosition(width, 0);
-            pipes[pipe_count].top.setScale(1.5f, gap_y / float(pipe_down_tex.getSize().y));
-            float bottom_y = gap_y + pipe_gap;
-            float bottom_h = height - bottom_y;
-            pipes[pipe_count].bottom.setTexture(pipe_up_tex);
-            pipes[pipe_count].bottom.setPosition(width, bottom_y);
-            pipes[pipe_count].bottom.setScale(1.5f, bottom_h / float(pipe_up_tex.getSize().y));
-            pipes[pipe_count].scored = false;
-            ++pipe_count;
+            cout << "Autopilot: score " << world.score << ", " << stats.plans << " plans, mean lookahead " << (double)stats.depth_total / stats.plans
+                 << " ticks, mean " << stats.micros_total / stats.plans << " us, max " << stats.micros_max << " us, " << stats.overruns << " over budget, " << stats.missed_ticks << " late ticks" << endl;
         }
     }
+    run_end_pending = true;
+    run_end_hit = hit;
+    particles_emit(particles, particle_feathers, bird_x, world.bird_y, 0.f, world.bird_vel * 0.5f);
+    if (sound_on)
+    {
+        dead_sound.play();
+    }
+    current_replay.score = world.score;
+    current_replay.ticks = world.tick;
+    save_replay(current_replay, "last_run.rpl");
+    if (!run_unranked)
+    {
+        replaydb_append(replay_db, current_replay, (long long)time(nullptr));
+        if (world.score > 0 && world.score > leaderboard[0])
+        {
+            save_replay(current_replay, "best_run.rpl");
+        }
+        update_leaderboard(world.score);
+    }
+    refresh_final_score_text();
+    game_state = GAME_OVER;
+    game_started = false;
+    bg_music.stop();
+    selected_menu = -1;
 }
-void move_pipes() 
+void finish_run()
 {
-    for (int i = 0; i < pipe_count; ++i) 
+    if (!run_end_pending)
     {
-        pipes[i].top.move(pipe_speed, 0);
-        pipes[i].bottom.move(pipe_speed, 0);
+        return;
     }
+    run_end_pending = false;
+    metrics_run_finished(params.difficulty);
+    telemetry_log(EVENT_DEATH, (unsigned char)params.difficulty, telemetry_run, (unsigned)world.tick, (int)run_end_hit, world.bird_y);
+    telemetry_log(EVENT_RUN_END, (unsigned char)params.difficulty, telemetry_run, (unsigned)world.tick, world.score, world.bird_y);
 }
-void remove_old_pipes() 
+void update_playing()
 {
-    if (pipe_count > 0 && pipes[0].top.getPosition().x + pipes[0].top.getGlobalBounds().width < 0) 
+    if (flap_queued)
     {
-        for (int i = 0; i < pipe_count - 1; ++i) 
+        current_replay.flap_ticks.push_back(world.tick);
+        if (!attract_mode)
         {
-            pipes[i] = pipes[i + 1];
+            telemetry_log(EVENT_FLAP, (unsigned char)params.difficulty, telemetry_run, (unsigned)world.tick, 0, world.bird_y);
         }
-        --pipe_count;
+        particles_emit(particles, particle_dust, bird_x - params.bird_w / 4, world.bird_y + params.bird_h / 3, params.pipe_speed * world.speed_scale * 0.5f, 0.f);
     }
-}
-void update_scoring() 
-{
-    for (int i = 0; i < pipe_count; ++i) 
+    SimStepResult result = step_world(flap_queued);
+    spectate_publish(world, params, flap_queued);
+    flap_queued = false;
+    if (result.scored > 0 && !attract_mode)
+    {
+        telemetry_log(EVENT_SCORE, (unsigned char)params.difficulty, telemetry_run, (unsigned)world.tick, world.score, world.bird_y);
+    }
+    if (result.scored > 0 && sound_on)
+    {
+        score_sound.play();
+    }
+    if (result.scored > 0)
     {
-        if (!pipes[i].scored && pipes[i].top.getPosition().x + pipes[i].top.getGlobalBounds().width < bird.getPosition().x) 
+        particles_emit(particles, particle_sparkles, bird_x, world.bird_y, 0.f, 0.f);
+    }
+    if (result.hit != HIT_NONE)
+    {
+        handle_death(result.hit);
+    }
+    else
+    {
+        rewind_record();
+        if (autopilot_on)
         {
-            pipes[i].scored = true;
-            ++score;
-            if (sound_on)
-            {
-                score_sound.play();
-            }
+            autopilot_post(world, params);
         }
     }
 }
-void update_pipes() 
+void set_autopilot(bool on)
+{
+    autopilot_on = on;
+    if (on)
+    {
+        run_unranked = true;
+        autopilot_start(params, autopilot_budget_us);
+        autopilot_post(world, params);
+    }
+    else
+    {
+        autopilot_stop();
+    }
+}
+void start_attract_mode()
+{
+    reset_game();
+    attract_mode = true;
+    set_autopilot(true);
+    game_started = true;
+}
+void stop_attract_mode()
+{
+    attract_mode = false;
+    set_autopilot(false);
+    game_state = MAIN_MENU;
+    game_started = false;
+    selected_menu = -1;
+    menu_idle_time = 0.f;
+}
+void rewind_clear()
 {
-    spawn_pipes();
-    move_pipes();
-    remove_old_pipes();
-    update_scoring();
+    rewind_newest = 0;
+    rewind_groups_used = 0;
+    rewind_tick = 0;
 }
-FloatRect get_bird_box(float shrink_x, float shrink_y) 
+int rewind_encode_delta(const SimWorld& key, const SimWorld& snap, unsigned char out[])
 {
-    FloatRect bounds = bird.getGlobalBounds();
-    return FloatRect
-    (
-        bounds.left + shrink_x,
-        bounds.top + shrink_y,
-        bounds.width - (shrink_x * 2),
-        bounds.height - (shrink_y * 2)
-    );
+    unsigned int key_words[snapshot_words];
+    unsigned int snap_words[snapshot_words];
+    memcpy(key_words, &key, sizeof(key_words));
+    memcpy(snap_words, &snap, sizeof(snap_words));
+    int n = 1;
+    int changed = 0;
+    for (int i = 0; i < snapshot_words; ++i)
+    {
+        if (key_words[i] != snap_words[i])
+        {
+            out[n++] = (unsigned char)i;
+            memcpy(out + n, &snap_words[i], 4);
+            n += 4;
+            ++changed;
+        }
+    }
+    out[0] = (unsigned char)changed;
+    return n;
 }
-FloatRect get_pipe_box(const Sprite& pipe, float shrink_x) 
+void rewind_decode_delta(const unsigned char in[], SimWorld& snap)
 {
-    FloatRect bounds = pipe.getGlobalBounds();
-    return FloatRect
-    (
-        bounds.left + shrink_x,
-        bounds.top,
-        bounds.width - (shrink_x * 2),
-        bounds.height
-    );
+    unsigned int words[snapshot_words];
+    memcpy(words, &snap, sizeof(words));
+    int changed = in[0];
+    int n = 1;
+    for (int i = 0; i < changed; ++i)
+    {
+        int index = in[n++];
+        memcpy(&words[index], in + n, 4);
+        n += 4;
+    }
+    memcpy(&snap, words, sizeof(words));
 }
-void check_collision() 
+void rewind_record()
 {
-    FloatRect bird_box = get_bird_box(10.f, 10.f);
-    bool died = (bird_box.top < 0) || (bird_box.top + bird_box.height > height);
-    if (!died) 
+    const SimWorld& snap = world;
+    RewindGroup* group = &rewind_groups[rewind_newest];
+    if (rewind_groups_used == 0 || group->tick_count == rewind_keyframe_interval)
     {
-        for (int i = 0; i < pipe_count; ++i)
+        if (rewind_groups_used > 0)
         {
-            FloatRect top_box = get_pipe_box(pipes[i].top, 5.f);
-            FloatRect bottom_box = get_pipe_box(pipes[i].bottom, 5.f);
-            if (bird_box.intersects(top_box) || bird_box.intersects(bottom_box)) 
-            {
-                died = true;
-                break;
-            }
+            rewind_newest = (rewind_newest + 1) % rewind_group_count;
+        }
+        if (rewind_groups_used < rewind_group_count)
+        {
+            ++rewind_groups_used;
         }
+        group = &rewind_groups[rewind_newest];
+        group->keyframe = snap;
+        group->first_tick = rewind_tick;
+        group->tick_count = 1;
+        group->bytes_used = 0;
+        group->delta_offset[0] = -1;
+    }
+    else
+    {
+        group->delta_offset[group->tick_count] = group->bytes_used;
+        group->bytes_used += rewind_encode_delta(group->keyframe, snap, group->delta_bytes + group->bytes_used);
+        ++group->tick_count;
+    }
+    ++rewind_tick;
+}
+bool rewind_restore(int ticks_back, SimWorld& out)
+{
+    if (rewind_groups_used == 0)
+    {
+        return false;
+    }
+    int oldest = (rewind_newest - rewind_groups_used + 1 + rewind_group_count) % rewind_group_count;
+    int target = rewind_tick - 1 - ticks_back;
+    if (target < rewind_groups[oldest].first_tick)
+    {
+        target = rewind_groups[oldest].first_tick;
     }
-    if (died) 
+    for (int g = 0; g < rewind_groups_used; ++g)
     {
-        if (sound_on)
+        int index = (rewind_newest - g + rewind_group_count) % rewind_group_count;
+        RewindGroup& group = rewind_groups[index];
+        if (target < group.first_tick)
         {
-            dead_sound.play();
+            continue;
         }
-        update_leaderboard(score);
-        game_state = GAME_OVER;
-        game_started = false;
-        bg_music.stop();
-        selected_menu = -1;
+        int k = target - group.first_tick;
+        out = group.keyframe;
+        if (k > 0)
+        {
+            rewind_decode_delta(group.delta_bytes + group.delta_offset[k], out);
+        }
+        group.tick_count = k + 1;
+        group.bytes_used = 0;
+        if (k > 0)
+        {
+            group.bytes_used = group.delta_offset[k] + 1 + 5 * group.delta_bytes[group.delta_offset[k]];
+        }
+        rewind_newest = index;
+        rewind_groups_used -= g;
+        rewind_tick = target + 1;
+        return true;
     }
+    return false;
+}
+int rewind_history_ticks()
+{
+    int ticks = 0;
+    for (int g = 0; g < rewind_groups_used; ++g)
+    {
+        ticks += rewind_groups[(rewind_newest - g + rewind_group_count) % rewind_group_count].tick_count;
+    }
+    return ticks;
+}
+int rewind_memory_bytes()
+{
+    int bytes = 0;
+    for (int g = 0; g < rewind_groups_used; ++g)
+    {
+        bytes += sizeof(SimWorld) + rewind_groups[(rewind_newest - g + rewind_group_count) % rewind_group_count].bytes_used;
+    }
+    return bytes;
+}
+void rewind_after_crash()
+{
+    int history_ticks = rewind_history_ticks();
+    if (history_ticks == 0)
+    {
+        return;
+    }
+    float bytes_per_second = rewind_memory_bytes() * (float)rewind_ticks_per_second / history_ticks;
+    Clock restore_clock;
+    if (!rewind_restore(rewind_step_ticks, world))
+    {
+        return;
+    }
+    replay_truncate(current_replay, world.tick);
+    run_end_pending = false;
+    Int64 restore_us = restore_clock.getElapsedTime().asMicroseconds();
+    cout << "Rewind: history " << (float)history_ticks / rewind_ticks_per_second << " s, "
+         << bytes_per_second << " bytes/s of history, restored in " << restore_us << " us" << endl;
+    run_unranked = true;
+    game_state = PLAYING;
+    game_started = false;
+    selected_menu = -1;
 }
 void update_game(float dt) 
 {
@@ -1111,246 +1894,901 @@ void update_game(float dt)
             intro_music.play();
         }
         intro_time += dt;
-        if (intro_time >= intro_frame_duration) 
+        if (anim_clip_done(intro_clip, intro_time)) 
+        {
+            intro_music.stop();
+            game_state = MAIN_MENU;
+        }
+        else 
+        {
+            show_intro_frame(anim_clip_frame(intro_clip, intro_time));
+        }
+    }
+    else if (game_state == MAIN_MENU)
+    {
+        menu_time += dt;
+        set_sprite_frame(menu_bird, bird_sheet, anim_clip_frame(menu_flap_clip, menu_time));
+        menu_idle_time += dt;
+        if (menu_idle_time >= attract_idle_seconds)
         {
-            intro_time = 0.f;
-            intro_frame++;
-            if (intro_frame >= intro_frame_count) 
+            start_attract_mode();
+        }
+    }
+    else if (game_state == PLAYING && game_started) 
+    {
+        int ticks = 0;
+        if (pacer.mode == PACER_VSYNC)
+        {
+            tick_time += dt < max_tick_catchup ? dt : max_tick_catchup;
+            ticks = (int)(tick_time * sim_ticks_per_second);
+            tick_time -= (double)ticks / sim_ticks_per_second;
+        }
+        else
+        {
+            tick_credit += sim_ticks_per_second;
+            ticks = tick_credit / frame_rate;
+            tick_credit -= ticks * frame_rate;
+        }
+        for (int t = 0; t < ticks && game_state == PLAYING; ++t)
+        {
+            bool autopilot_flap = false;
+            if (autopilot_on && autopilot_poll(world.tick, autopilot_flap) && autopilot_flap)
             {
-                intro_music.stop();
-                game_state = MAIN_MENU;
+                flap();
             }
-            else 
+            update_playing();
+        }
+        if (game_state != PLAYING)
+        {
+            tick_credit = 0;
+            tick_time = 0.0;
+        }
+    }
+    if (game_state == PLAYING || game_state == GAME_OVER)
+    {
+        particles_update(particles, dt * 60.f);
+    }
+}
+void submit_sprite(const Sprite& sprite, int layer, int material)
+{
+    IntRect r = sprite.getTextureRect();
+    float w = (float)abs(r.width);
+    float h = (float)abs(r.height);
+    float u0 = (float)r.left;
+    float v0 = (float)r.top;
+    float u1 = u0 + r.width;
+    float v1 = v0 + r.height;
+    const Transform& t = sprite.getTransform();
+    Color color = sprite.getColor();
+    int first = (int)frame_vertices.size();
+    frame_vertices.push_back(Vertex(t.transformPoint(0.f, 0.f), color, Vector2f(u0, v0)));
+    frame_vertices.push_back(Vertex(t.transformPoint(w, 0.f), color, Vector2f(u1, v0)));
+    frame_vertices.push_back(Vertex(t.transformPoint(w, h), color, Vector2f(u1, v1)));
+    frame_vertices.push_back(Vertex(t.transformPoint(0.f, h), color, Vector2f(u0, v1)));
+    queue_vertices(render_queue, layer, material, first, 4);
+}
+void submit_rect(const RectangleShape& rect, int layer)
+{
+    Vector2f size = rect.getSize();
+    const Transform& t = rect.getTransform();
+    Color color = rect.getFillColor();
+    int first = (int)frame_vertices.size();
+    frame_vertices.push_back(Vertex(t.transformPoint(0.f, 0.f), color));
+    frame_vertices.push_back(Vertex(t.transformPoint(size.x, 0.f), color));
+    frame_vertices.push_back(Vertex(t.transformPoint(size.x, size.y), color));
+    frame_vertices.push_back(Vertex(t.transformPoint(0.f, size.y), color));
+    queue_vertices(render_queue, layer, MATERIAL_UNTEXTURED, first, 4);
+}
+void submit_text(const Text& text, int layer)
+{
+    frame_drawables.push_back(&text);
+    int calls = text.getOutlineThickness() != 0.f ? 2 : 1;
+    queue_drawable(render_queue, layer, MATERIAL_FONT + (int)text.getCharacterSize(), (int)frame_drawables.size() - 1, calls);
+}
+void submit_button(Button& btn, bool is_highlighted)
+{
+    highlight_button(btn, is_highlighted);
+    submit_sprite(btn.sprite, DRAW_MENU, MATERIAL_UI);
+}
+void begin_frame_queue()
+{
+    queue_begin(render_queue);
+    frame_vertices.clear();
+    frame_drawables.clear();
+}
+void flush_frame_queue(RenderTarget& window)
+{
+    queue_finish(render_queue);
+    for (const QueueBatch& b : render_queue.batches)
+    {
+        if (b.drawable >= 0)
+        {
+            window.draw(*frame_drawables[b.drawable]);
+            continue;
+        }
+        const Vertex* vertices = &frame_vertices[render_queue.commands[b.first_command].first];
+        if (!b.contiguous)
+        {
+            batch_vertices.clear();
+            for (int i = b.first_command; i < b.first_command + b.command_count; ++i)
             {
-                if (intro_tex[intro_frame].getSize().x > 0) 
-                {
-                    intro_sprite.setTexture(intro_tex[intro_frame]);
-                    float sx = (float)width / intro_tex[intro_frame].getSize().x;
-                    float sy = (float)height / intro_tex[intro_frame].getSize().y;
-                    intro_sprite.setScale(sx, sy);
-                }
+                const QueueCommand& c = render_queue.commands[i];
+                batch_vertices.insert(batch_vertices.end(), frame_vertices.begin() + c.first, frame_vertices.begin() + c.first + c.count);
             }
+            vertices = &batch_vertices[0];
         }
+        const Texture* texture = b.material < MATERIAL_TEXTURE_COUNT ? material_textures[b.material] : nullptr;
+        window.draw(vertices, b.vertex_count, Quads, RenderStates(texture));
     }
-    else if (game_state == PLAYING && game_started) 
+}
+void print_render_stats()
+{
+    cout << "Render queue per frame (direct -> sorted and batched):" << endl;
+    for (int i = 0; i <= GAME_OVER; ++i)
     {
-        update_bird();
-        update_pipes();
-        check_collision();
+        const RenderQueueStats& s = render_by_state[i];
+        if (s.frames == 0)
+        {
+            continue;
+        }
+        double f = (double)s.frames;
+        cout << "  " << state_names[i] << ": " << s.frames << " frames, " << s.commands / f << " commands, "
+             << s.immediate_calls / f << " -> " << s.batched_calls / f << " draw calls, "
+             << s.immediate_changes / f << " -> " << s.batched_changes / f << " texture changes" << endl;
     }
 }
-void draw_background(RenderWindow& window) 
+void draw_background() 
 {
-    window.draw(background);
+    submit_sprite(background, DRAW_BACKGROUND, MATERIAL_BACKGROUND);
 }
-void draw_main_menu(RenderWindow& window) 
+void draw_main_menu() 
 {
-    window.draw(title_text);
-    highlight_button(btn_new_game, selected_menu == 0);
-    highlight_button(btn_settings, selected_menu == 1);
-    highlight_button(btn_leaderboard, selected_menu == 2);
-    highlight_button(btn_exit, selected_menu == 3);
-    window.draw(btn_new_game.sprite);
-    window.draw(btn_settings.sprite);
-    window.draw(btn_leaderboard.sprite);
-    window.draw(btn_exit.sprite);
+    submit_text(title_text, DRAW_MENU);
+    submit_sprite(menu_bird, DRAW_MENU, MATERIAL_BIRD);
+    submit_button(btn_new_game, selected_menu == 0);
+    submit_button(btn_settings, selected_menu == 1);
+    submit_button(btn_leaderboard, selected_menu == 2);
+    submit_button(btn_exit, selected_menu == 3);
 }
-void draw_settings(RenderWindow& window) 
+void draw_settings() 
 {
-    highlight_button(btn_difficulty, selected_menu == 0);
-    highlight_button(btn_sound, selected_menu == 1);
-    highlight_button(btn_music, selected_menu == 2);
-    highlight_button(btn_back_settings, selected_menu == 3);
-    window.draw(btn_difficulty.sprite);
-    window.draw(btn_sound.sprite);
-    window.draw(btn_music.sprite);
-    window.draw(btn_back_settings.sprite);
+    submit_button(btn_difficulty, selected_menu == 0);
+    submit_button(btn_sound, selected_menu == 1);
+    submit_button(btn_music, selected_menu == 2);
+    submit_button(btn_back_settings, selected_menu == 3);
     if (difficulty_level == EASY)
     {
-        window.draw(btn_easy_indicator.sprite);
+        submit_sprite(btn_easy_indicator.sprite, DRAW_MENU, MATERIAL_UI);
     }
     else 
     {
-        window.draw(btn_hard_indicator.sprite);
+        submit_sprite(btn_hard_indicator.sprite, DRAW_MENU, MATERIAL_UI);
     }
 }
-void draw_difficulty(RenderWindow& window) 
+void draw_difficulty() 
 {
-    highlight_button(btn_easy, selected_menu == 0 || (selected_menu == -1 && difficulty_level == EASY));
-    highlight_button(btn_hard, selected_menu == 1 || (selected_menu == -1 && difficulty_level == HARD));
-    highlight_button(btn_back_difficulty, selected_menu == 2);
-    window.draw(btn_easy.sprite);
-    window.draw(btn_hard.sprite);
-    window.draw(btn_back_difficulty.sprite);
+    submit_button(btn_easy, selected_menu == 0 || (selected_menu == -1 && difficulty_level == EASY));
+    submit_button(btn_hard, selected_menu == 1 || (selected_menu == -1 && difficulty_level == HARD));
+    submit_button(btn_back_difficulty, selected_menu == 2);
 }
-void draw_leaderboard(RenderWindow& window)
+void draw_leaderboard()
 {
-    Text title("LEADERBOARD", game_font, 60);
-    title.setFillColor(Color::Yellow);
-    title.setOutlineColor(Color::Black);
-    title.setOutlineThickness(4);
-    FloatRect bounds = title.getLocalBounds();
-    title.setPosition((width - bounds.width) / 2, 80);
-    window.draw(title);
-    char buffer[100];
+    submit_text(leaderboard_title, DRAW_MENU);
     for (int i = 0; i < 3; i++)
     {
-        buffer[0] = '1' + i;
-        buffer[1] = '.';
-        buffer[2] = ' ';
-        int_to_string(leaderboard[i], buffer + 3);
-        Text score_display(buffer, game_font, 48);
-        score_display.setFillColor(Color::White);
-        score_display.setOutlineColor(Color::Black);
-        score_display.setOutlineThickness(3);
-        FloatRect sb = score_display.getLocalBounds();
-        score_display.setPosition((width - sb.width) / 2, 200 + i * 70);
-        window.draw(score_display);
-    }
-    highlight_button(btn_back_leaderboard, false);
-    window.draw(btn_back_leaderboard.sprite);
-}
-void draw_pause(RenderWindow& window)
-{
-    RectangleShape overlay(Vector2f(width, height));
-    overlay.setFillColor(Color(0, 0, 0, 150));
-    window.draw(overlay);
-    highlight_button(btn_resume, selected_menu == 0);
-    highlight_button(btn_restart, selected_menu == 1);
-    highlight_button(btn_main_menu, selected_menu == 2);
-    highlight_button(btn_exit_pause, selected_menu == 3);
-    window.draw(btn_resume.sprite);
-    window.draw(btn_restart.sprite);
-    window.draw(btn_main_menu.sprite);
-    window.draw(btn_exit_pause.sprite);
-}
-void draw_game_over(RenderWindow& window) 
-{
-    Text game_over_title("GAME OVER", game_font, 72);
-    game_over_title.setFillColor(Color::Red);
-    game_over_title.setOutlineColor(Color::Black);
-    game_over_title.setOutlineThickness(5);
-    FloatRect bounds = game_over_title.getLocalBounds();
-    game_over_title.setPosition((width - bounds.width) / 2, 40);
-    window.draw(game_over_title);
-    char score_buffer[50];
-    score_buffer[0] = 'S';
-    score_buffer[1] = 'c';
-    score_buffer[2] = 'o';
-    score_buffer[3] = 'r';
-    score_buffer[4] = 'e';
-    score_buffer[5] = ':';
-    score_buffer[6] = ' ';
-    int_to_string(score, score_buffer + 7);
-    Text final_score_text(score_buffer, game_font, 40);
-    final_score_text.setFillColor(Color::White);
-    final_score_text.setOutlineColor(Color::Black);
-    final_score_text.setOutlineThickness(3);
-    FloatRect score_bounds = final_score_text.getLocalBounds();
-    final_score_text.setPosition((width - score_bounds.width) / 2, 40 + bounds.height + 20);
-    window.draw(final_score_text);
-    highlight_button(btn_play_again, selected_menu == 0);
-    highlight_button(btn_main_over, selected_menu == 1);
-    highlight_button(btn_exit_over, selected_menu == 2);
-    window.draw(btn_play_again.sprite);
-    window.draw(btn_main_over.sprite);
-    window.draw(btn_exit_over.sprite);
-}
-void draw_pipes(RenderWindow& window) 
-{
-    for (int i = 0; i < pipe_count; ++i) 
-    {
-        window.draw(pipes[i].top);
-        window.draw(pipes[i].bottom);
-    }
-}
-void draw_score(RenderWindow& window) 
+        submit_text(leaderboard_rows[i], DRAW_MENU);
+    }
+    submit_button(btn_back_leaderboard, false);
+}
+void draw_pause()
+{
+    submit_rect(pause_overlay, DRAW_OVERLAY);
+    submit_button(btn_resume, selected_menu == 0);
+    submit_button(btn_restart, selected_menu == 1);
+    submit_button(btn_main_menu, selected_menu == 2);
+    submit_button(btn_exit_pause, selected_menu == 3);
+}
+void draw_game_over() 
+{
+    submit_text(game_over_title, DRAW_MENU);
+    submit_text(final_score_text, DRAW_MENU);
+    submit_button(btn_play_again, selected_menu == 0);
+    submit_button(btn_main_over, selected_menu == 1);
+    submit_button(btn_exit_over, selected_menu == 2);
+}
+void sync_scene()
+{
+    Placement* bird_placement = ecs_get(scene.placements, scene_bird);
+    bird_placement->y = world.bird_y;
+    bird_placement->rotation = world.bird_rotation;
+    float now = (float)world.tick;
+    anim_play(bird_anim, world.bird_falling ? bird_fall_clip : bird_rise_clip, now);
+    const AnimRect& frame = bird_sheet.frames[anim_frame(bird_anim, now)];
+    Visual* bird_visual = ecs_get(scene.visuals, scene_bird);
+    bird_visual->left = frame.left;
+    bird_visual->top = frame.top;
+    Vector2u down = pipe_down_tex.getSize();
+    Vector2u up = pipe_up_tex.getSize();
+    for (int i = 0; i < max_pipes; ++i)
+    {
+        Entity top = scene_pipes[i][0];
+        Entity bottom = scene_pipes[i][1];
+        if (i >= world.pipe_count)
+        {
+            ecs_remove(scene.visuals, top);
+            ecs_remove(scene.visuals, bottom);
+            continue;
+        }
+        int gap_y = world.pipes[i].gap_y;
+        float bottom_y = gap_y + params.pipe_gap;
+        float bottom_h = height - bottom_y;
+        Placement* placement = ecs_get(scene.placements, top);
+        placement->x = world.pipes[i].x;
+        placement->scale_y = gap_y / float(down.y);
+        placement = ecs_get(scene.placements, bottom);
+        placement->x = world.pipes[i].x;
+        placement->y = bottom_y;
+        placement->scale_y = bottom_h / float(up.y);
+        ecs_add(scene.visuals, top, scene_visual(SCENE_PIPE_DOWN, LAYER_PIPES, 0, 0, (int)down.x, (int)down.y, 0.f, 0.f));
+        ecs_add(scene.visuals, bottom, scene_visual(SCENE_PIPE_UP, LAYER_PIPES, 0, 0, (int)up.x, (int)up.y, 0.f, 0.f));
+    }
+}
+void draw_scene()
+{
+    ecs_render_list(scene, scene_items);
+    for (const RenderItem& item : scene_items)
+    {
+        const Visual& v = item.visual;
+        scene_sprite.setTextureRect(IntRect(v.left, v.top, v.width, v.height));
+        scene_sprite.setOrigin(v.origin_x, v.origin_y);
+        scene_sprite.setPosition(item.placement.x, item.placement.y);
+        scene_sprite.setScale(item.placement.scale_x, item.placement.scale_y);
+        scene_sprite.setRotation(item.placement.rotation);
+        submit_sprite(scene_sprite, DRAW_PIPES + v.layer, scene_materials[v.texture]);
+    }
+}
+void draw_particles()
+{
+    int n = particles.count;
+    if (n == 0)
+    {
+        return;
+    }
+    int first = (int)frame_vertices.size();
+    frame_vertices.resize(first + 4 * n);
+    for (int i = 0; i < n; ++i)
+    {
+        Color color(particles.color[i]);
+        color.a = (Uint8)(color.a * particle_fade(particles, i));
+        float half = particles.size[i] * 0.5f;
+        float x = particles.x[i];
+        float y = particles.y[i];
+        Vertex* quad = &frame_vertices[first + 4 * i];
+        quad[0].position = Vector2f(x - half, y - half);
+        quad[1].position = Vector2f(x + half, y - half);
+        quad[2].position = Vector2f(x + half, y + half);
+        quad[3].position = Vector2f(x - half, y + half);
+        quad[0].color = color;
+        quad[1].color = color;
+        quad[2].color = color;
+        quad[3].color = color;
+    }
+    queue_vertices(render_queue, DRAW_PARTICLES, MATERIAL_UNTEXTURED, first, 4 * n);
+}
+void draw_score() 
 {
     if (game_state == PLAYING) 
     {
         char score_str[20];
-        int_to_string(score, score_str);
-        score_text.setString(score_str);
-        window.draw(score_text);
+        int_to_string(world.score, score_str);
+        float x = width / 2 - 40;
+        for (int i = 0; score_str[i] != '\0' && i < score_max_digits; ++i)
+        {
+            int d = score_str[i] - '0';
+            if (score_slot_digit[i] != d)
+            {
+                score_slots[i].setString(score_digits[d].getString());
+                score_slot_digit[i] = d;
+            }
+            score_slots[i].setPosition(x, 20);
+            submit_text(score_slots[i], DRAW_HUD);
+            x += score_digit_advance[d];
+        }
     }
 }
-void draw_game(RenderWindow& window)
+void draw_game()
 {
-    draw_pipes(window);
-    window.draw(bird);
-    draw_score(window);
+    sync_scene();
+    draw_scene();
+    draw_particles();
+    draw_score();
     if (!game_started && game_state == PLAYING) 
     {
-        Text start_text("PRESS SPACE OR CLICK TO START", game_font, 32);
-        start_text.setFillColor(Color::White);
-        start_text.setOutlineColor(Color::Black);
-        start_text.setOutlineThickness(3);
-        FloatRect bounds = start_text.getLocalBounds();
-        start_text.setPosition((width - bounds.width) / 2, height / 2 - 50);
-        window.draw(start_text);
+        submit_text(start_text, DRAW_HUD);
+    }
+    if (attract_mode)
+    {
+        submit_text(demo_text, DRAW_HUD);
     }
 }
-void draw(RenderWindow& window)
+void draw_frame(RenderTarget& window)
 {
     window.clear();
+    begin_frame_queue();
     if (game_state == INTRO) 
     {
-        window.draw(intro_sprite);
-        window.display();
-        return;
+        submit_sprite(intro_sprite, DRAW_BACKGROUND, MATERIAL_INTRO);
+    }
+    else
+    {
+        draw_background();
     }
-    draw_background(window);
     switch (game_state) 
     {
         case MAIN_MENU:
-            draw_main_menu(window);
+            draw_main_menu();
             break;
         case SETTINGS_MENU:
-            draw_settings(window);
+            draw_settings();
             break;
         case DIFFICULTY_MENU:
-            draw_difficulty(window);
+            draw_difficulty();
             break;
         case LEADERBOARD_MENU:
-            draw_leaderboard(window);
+            draw_leaderboard();
             break;
         case PLAYING:
-            draw_game(window);
+            draw_game();
             break;
         case PAUSED:
-            draw_game(window);
-            draw_pause(window);
+            draw_game();
+            draw_pause();
             break;
         case GAME_OVER:
-            draw_game(window);
-            draw_game_over(window);
+            draw_game();
+            draw_game_over();
             break;
         default:
             break;
     }
+    flush_frame_queue(window);
+    queue_add_stats(render_by_state[game_state], render_queue.frame);
+}
+bool prepare_capture_targets()
+{
+    if (!capture_targets_ready)
+    {
+        for (int i = 0; i < capture_ring_size; ++i)
+        {
+            if (!capture_targets[i].create(width, height))
+            {
+                return false;
+            }
+        }
+        capture_targets_ready = true;
+    }
+    return true;
+}
+void capture_read_back(int frame)
+{
+    Clock overhead;
+    Image image = capture_targets[frame % capture_ring_size].getTexture().copyToImage();
+    capture_submit(image.getPixelsPtr(), false);
+    capture_add_overhead((double)overhead.getElapsedTime().asMicroseconds());
+}
+void toggle_capture()
+{
+    if (capture_active())
+    {
+        int first = capture_frame - (capture_ring_size - 1);
+        for (int frame = (first < 0 ? 0 : first); frame < capture_frame; ++frame)
+        {
+            capture_read_back(frame);
+        }
+        capture_stop();
+        CaptureStats stats = capture_stats();
+        cout << "Capture stopped: " << stats.frames_written << " frames written, " << stats.frames_dropped << " dropped, "
+             << (stats.frames_submitted > 0 ? stats.submit_us_total / stats.frames_submitted : 0.0) << " us capture overhead per frame" << endl;
+        return;
+    }
+    if (!prepare_capture_targets())
+    {
+        cout << "Failed to create capture targets" << endl;
+        return;
+    }
+    char path[64] = "capture_";
+    int_to_string((int)time(NULL), path + 8);
+    strcat(path, ".y4m");
+    if (capture_start(path, CAPTURE_Y4M, width, height, frame_rate))
+    {
+        capture_frame = 0;
+        cout << "Capturing to " << path << endl;
+    }
+}
+void take_screenshot()
+{
+    if (capture_active() || !prepare_capture_targets())
+    {
+        return;
+    }
+    draw_frame(capture_targets[0]);
+    capture_targets[0].display();
+    Image image = capture_targets[0].getTexture().copyToImage();
+    char path[64] = "screenshot_";
+    int_to_string((int)time(NULL), path + 11);
+    strcat(path, ".png");
+    string file = path;
+    thread([image, file]() { image.saveToFile(file); }).detach();
+}
+void draw_captured(RenderWindow& window)
+{
+    RenderTexture& target = capture_targets[capture_frame % capture_ring_size];
+    draw_frame(target);
+    target.display();
+    capture_present.setTexture(target.getTexture(), true);
+    window.clear();
+    window.draw(capture_present);
+    if (capture_frame >= capture_ring_size - 1)
+    {
+        capture_read_back(capture_frame - (capture_ring_size - 1));
+    }
+    ++capture_frame;
+}
+void draw(RenderWindow& window)
+{
+    if (capture_active())
+    {
+        draw_captured(window);
+    }
+    else
+    {
+        draw_frame(window);
+    }
+    flight_phase(FLIGHT_DRAW);
+    pacer_wait(pacer);
+    flight_phase(FLIGHT_WAIT);
     window.display();
+    flight_phase(FLIGHT_PRESENT);
 }
 bool init_game() 
 {
     srand((unsigned)time(NULL));
+    Clock load_clock;
     if (!load_all_assets()) 
     {
         cerr << "Game initialization failed due to asset loading error." << endl;
         return false;
     }
+    float load_seconds = load_clock.getElapsedTime().asSeconds();
+    metrics_asset_load(load_seconds);
+    AssetCacheStats cache = assetcache_stats();
+    if (cache.mode == ASSETCACHE_SHARED)
+    {
+        cout << "Assets loaded in " << load_seconds * 1000.f << " ms, shared cache " << cache.bytes / 1048576.0 << " MB in " << cache.entries << " entries, "
+             << cache.users << " processes attached" << endl;
+    }
+    else
+    {
+        cout << "Assets loaded in " << load_seconds * 1000.f << " ms without the shared cache" << endl;
+    }
+    cout << "  " << asset_read_seconds * 1000.f << " ms reading files, " << asset_decode_seconds * 1000.f << " ms decoding in SFML, " << asset_cache_seconds * 1000.f
+         << " ms copying from the cache" << endl;
     setup_all();
     load_leaderboard();
-    apply_difficulty();
+    apply_game_difficulty();
     return true;
 }
 void run_game(RenderWindow& window) 
 {
     Clock clock;
+    string telemetry_path = "telemetry_" + to_string((long long)time(nullptr)) + ".fbt";
+    if (!telemetry_open(telemetry_path.c_str()))
+    {
+        cout << "Telemetry disabled: cannot write " << telemetry_path << endl;
+    }
+    if (!replaydb_open(replay_db, "replays.fdb"))
+    {
+        cout << "Replay store disabled: cannot open replays.fdb" << endl;
+    }
+    flight_open(hitch_budget_ms > 0.0 ? hitch_budget_ms : 3000.0 / frame_rate, state_names, GAME_OVER + 1);
+    pacer_reset_stats(pacer);
     while (window.isOpen()) 
     {
+        AllocCounters frame_start = alloc_counters();
+        GameState frame_state = game_state;
+        unsigned int frame_run = telemetry_run;
+        flight_begin_frame(game_state);
         float dt = clock.restart().asSeconds();
         handle_events(window);
+        flight_phase(FLIGHT_EVENTS);
         update_game(dt);
+        if (game_state != GAME_OVER)
+        {
+            finish_run();
+        }
+        spectate_poll(game_state, world, params);
+        flight_phase(FLIGHT_UPDATE);
+        double presented = pacer.last;
+        long long missed = pacer.missed;
         draw(window);
+        metrics_frame(pacer.last - presented, pacer.missed > missed);
+        flight_end_frame(world.tick, world.score, world_hash(), flight_flags());
+        record_frame_allocs(frame_state, frame_run, frame_start);
+    }
+    finish_run();
+    autopilot_stop();
+    capture_stop();
+    telemetry_close();
+    replaydb_close(replay_db);
+    flight_close();
+    pacer_close(pacer);
+    cout << "Frames: " << pacer.frames.count << " at " << frame_rate << " Hz, mean " << stats_mean(pacer.frames) * 1000.0 << " ms, p99 "
+         << stats_percentile(pacer.frames, 0.99) * 1000.0 << " ms, worst " << pacer.frames.worst * 1000.0 << " ms, " << pacer.missed << " missed deadlines" << endl;
+    print_alloc_stats();
+    print_render_stats();
+    FlightStats flight = flight_stats();
+    cout << "Flight recorder: " << flight.hitches << " frames over " << (hitch_budget_ms > 0.0 ? hitch_budget_ms : 3000.0 / frame_rate) << " ms, "
+         << flight.dumps << " dumps, worst frame " << flight.worst_ms << " ms" << endl;
+    SpectateStats broadcast = spectate_stats();
+    spectate_close();
+    if (broadcast.clients_accepted > 0)
+    {
+        cout << "Broadcast: " << broadcast.clients_accepted << " spectators, " << broadcast.bytes_published << " bytes per spectator, " << broadcast.bytes_sent
+             << " bytes sent, " << broadcast.clients_dropped << " dropped, " << broadcast.publish_seconds / (broadcast.publishes > 0 ? broadcast.publishes : 1) * 1e6
+             << " us per tick" << endl;
+    }
+    MetricsStats served = metrics_stats();
+    metrics_close();
+    if (served.scrapes > 0)
+    {
+        cout << "Metrics: " << served.scrapes << " scrapes, " << served.bytes_sent << " bytes sent, " << served.render_seconds / served.scrapes * 1e6 << " us per scrape" << endl;
+    }
+    TelemetryStats stats = telemetry_stats();
+    if (stats.events_logged > 0)
+    {
+        cout << "Telemetry: " << stats.events_written << " events, " << stats.bytes_written << " bytes, " << stats.events_dropped << " dropped" << endl;
+    }
+}
+void record_frame_allocs(GameState start_state, unsigned int start_run, const AllocCounters& start)
+{
+    if (game_state != start_state || telemetry_run != start_run)
+    {
+        alloc_record(alloc_transitions, start);
+    }
+    else
+    {
+        alloc_record(alloc_by_state[start_state], start);
+    }
+}
+void print_alloc_stats()
+{
+    if (!alloc_tracking())
+    {
+        return;
+    }
+    cout << "Heap allocations per frame on the main thread:" << endl;
+    for (int i = 0; i <= GAME_OVER + 1; ++i)
+    {
+        const AllocStats& s = i <= GAME_OVER ? alloc_by_state[i] : alloc_transitions;
+        if (s.frames == 0)
+        {
+            continue;
+        }
+        cout << "  " << (i <= GAME_OVER ? state_names[i] : "state changes") << ": " << s.frames << " frames, " << s.frames_allocating << " allocating, "
+             << (double)s.allocs / s.frames << " allocs and " << (double)s.bytes / s.frames << " bytes per frame, worst " << s.worst_allocs << endl;
+    }
+}
+int run_alloc_check()
+{
+    const int warmup_frames = 300;
+    const int checked_frames = 3600;
+    if (!alloc_tracking())
+    {
+        cerr << "Build with FLAPPY_ALLOC_TRACK defined to count allocations" << endl;
+        return 1;
+    }
+    if (!init_game())
+    {
+        return 1;
+    }
+    RenderTexture target;
+    if (!target.create(width, height))
+    {
+        cerr << "Could not create render texture" << endl;
+        return 1;
     }
-}
\ No newline at end of file
+    const float dt = 1.f / sim_ticks_per_second;
+    reset_game();
+    set_autopilot(true);
+    game_started = true;
+    for (int frame = 0; frame < warmup_frames + checked_frames; ++frame)
+    {
+        if (frame == warmup_frames)
+        {
+            for (AllocStats& s : alloc_by_state)
+            {
+                s = AllocStats();
+            }
+            alloc_transitions = AllocStats();
+        }
+        AllocCounters frame_start = alloc_counters();
+        GameState frame_state = game_state;
+        unsigned int frame_run = telemetry_run;
+        if (game_state != PLAYING)
+        {
+            reset_game();
+            game_started = true;
+        }
+        update_game(dt);
+        draw_frame(target);
+        target.display();
+        record_frame_allocs(frame_state, frame_run, frame_start);
+    }
+    autopilot_stop();
+    print_alloc_stats();
+    const AllocStats& playing = alloc_by_state[PLAYING];
+    if (playing.frames == 0 || playing.allocs > 0)
+    {
+        cout << "FAIL: " << playing.frames_allocating << " of " << playing.frames << " PLAYING frames allocated after warm-up" << endl;
+        return 1;
+    }
+    cout << "PASS: " << playing.frames << " PLAYING frames without a heap allocation" << endl;
+    return 0;
+}
+bool load_raster_texture(RasterAssets& assets, int which, const Image& image)
+{
+    return raster_set_texture(assets, which, image.getPixelsPtr(), image.getSize().x, image.getSize().y);
+}
+bool load_collision_mask(int which, const Image& image, float screen_w)
+{
+    return mask_set_texture(collision_masks, which, image.getPixelsPtr(), image.getSize().x, image.getSize().y, screen_w);
+}
+bool load_obstacle_pattern(const char* path)
+{
+    char error[160];
+    if (!pattern_load(obstacle_pattern, path, error, sizeof(error)))
+    {
+        cerr << "Pattern " << path << ": " << error << endl;
+        return false;
+    }
+    params.pattern = &obstacle_pattern;
+    cout << "Loaded obstacle pattern " << path << " (" << obstacle_pattern.length << " bytes of bytecode)" << endl;
+    return true;
+}
+int run_raster_check()
+{
+    const int out_w = 84;
+    const int out_h = 84;
+    const int frames = 8;
+    if (!init_game())
+    {
+        return 1;
+    }
+    RasterAssets assets;
+    if (!load_raster_texture(assets, RASTER_BACKGROUND, bg_tex.copyToImage()) ||
+        !load_raster_texture(assets, RASTER_BIRD_UP, bird_up_img) ||
+        !load_raster_texture(assets, RASTER_BIRD_DOWN, bird_down_img) ||
+        !load_raster_texture(assets, RASTER_PIPE_DOWN, pipe_down_tex.copyToImage()) ||
+        !load_raster_texture(assets, RASTER_PIPE_UP, pipe_up_tex.copyToImage()))
+    {
+        return 1;
+    }
+    raster_prepare(assets, out_w, out_h);
+    RenderTexture target;
+    if (!target.create(width, height))
+    {
+        cerr << "Could not create render texture" << endl;
+        return 1;
+    }
+    unsigned char expected[out_w * out_h];
+    unsigned char actual[out_w * out_h];
+    double total_error = 0.0;
+    int worst_error = 0;
+    sim_reset(world, 7);
+    for (int frame = 0; frame < frames; ++frame)
+    {
+        for (int t = 0; t < 37; ++t)
+        {
+            bool flap_now = world.pipe_count > 0 && world.bird_y > world.pipes[0].gap_y + params.pipe_gap / 2;
+            if (sim_step(world, params, flap_now).hit != HIT_NONE)
+            {
+                sim_reset(world, world.rng);
+            }
+        }
+        target.clear();
+        begin_frame_queue();
+        draw_background();
+        sync_scene();
+        draw_scene();
+        flush_frame_queue(target);
+        target.display();
+        Image image = target.getTexture().copyToImage();
+        raster_downsample_rgba(image.getPixelsPtr(), width, height, expected, out_w, out_h);
+        raster_draw_world(assets, world, params, actual);
+        for (int i = 0; i < out_w * out_h; ++i)
+        {
+            int error = abs((int)expected[i] - (int)actual[i]);
+            total_error += error;
+            if (error > worst_error)
+            {
+                worst_error = error;
+            }
+        }
+    }
+    double mean_error = total_error / ((double)frames * out_w * out_h);
+    cout << "Raster fidelity at " << out_w << "x" << out_h << ": mean abs error " << mean_error << ", max " << worst_error << endl;
+    return mean_error < 4.0 ? 0 : 1;
+}
+int run_replay_render(const char* replay_path, const char* out_path)
+{
+    Replay replay;
+    if (!load_replay(replay, replay_path))
+    {
+        cerr << "Could not read replay " << replay_path << endl;
+        return 1;
+    }
+    if (!init_game())
+    {
+        return 1;
+    }
+    RenderTexture target;
+    if (!target.create(width, height))
+    {
+        cerr << "Could not create render texture" << endl;
+        return 1;
+    }
+    size_t out_len = strlen(out_path);
+    CaptureFormat format = (out_len > 4 && strcmp(out_path + out_len - 4, ".y4m") == 0) ? CAPTURE_Y4M : CAPTURE_PNG;
+    if (!capture_start(out_path, format, width, height, 60))
+    {
+        cerr << "Could not open " << out_path << endl;
+        return 1;
+    }
+    if (replay.pixel_collision && params.masks == nullptr)
+    {
+        cerr << "Replay was recorded with pixel collision but the masks are unavailable; it may not play back exactly" << endl;
+    }
+    if (!replay.pixel_collision)
+    {
+        params.masks = nullptr;
+    }
+    fixed_point_on = replay.fixed_point != 0;
+    params.pattern = nullptr;
+    if (!replay.pattern.empty())
+    {
+        if (!pattern_set_code(obstacle_pattern, replay.pattern.data(), (int)replay.pattern.size()))
+        {
+            cerr << "Replay contains an invalid obstacle pattern" << endl;
+            return 1;
+        }
+        params.pattern = &obstacle_pattern;
+    }
+    difficulty_level = (Difficulty)replay.difficulty;
+    apply_game_difficulty();
+    sim_reset(world, replay.seed);
+    game_state = PLAYING;
+    game_started = true;
+    sound_on = false;
+    size_t next_flap = 0;
+    Clock wall;
+    while (world.tick < replay.ticks)
+    {
+        bool flap_now = next_flap < replay.flap_ticks.size() && replay.flap_ticks[next_flap] == world.tick;
+        if (flap_now)
+        {
+            ++next_flap;
+        }
+        SimStepResult result = step_world(flap_now);
+        draw_frame(target);
+        target.display();
+        Image image = target.getTexture().copyToImage();
+        capture_submit(image.getPixelsPtr(), true);
+        if (result.hit != HIT_NONE)
+        {
+            break;
+        }
+    }
+    capture_stop();
+    float seconds = wall.getElapsedTime().asSeconds();
+    float run_seconds = world.tick / 60.f;
+    cout << "Rendered " << world.tick << " ticks (score " << world.score << ", replay says " << replay.score << ") in " << seconds
+         << " s, " << (seconds > 0.f ? run_seconds / seconds : 0.f) << "x real time" << endl;
+    return 0;
+}
+void draw_spectator(RenderWindow& window, const SpectateView& view)
+{
+    window.clear();
+    begin_frame_queue();
+    draw_background();
+    if (view.synced && (view.state == PLAYING || view.state == PAUSED || view.state == GAME_OVER))
+    {
+        draw_game();
+        if (view.state == GAME_OVER)
+        {
+            submit_text(game_over_title, DRAW_MENU);
+            submit_text(final_score_text, DRAW_MENU);
+        }
+    }
+    else
+    {
+        submit_text(spectate_text, DRAW_HUD);
+    }
+    flush_frame_queue(window);
+    pacer_wait(pacer);
+    window.display();
+}
+int run_spectator(RenderWindow& window, const char* address)
+{
+    char host[256];
+    strncpy(host, address, sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+    int port = spectate_default_port;
+    char* colon = strrchr(host, ':');
+    if (colon != nullptr)
+    {
+        *colon = '\0';
+        port = atoi(colon + 1);
+    }
+    SpectateClient* client = new SpectateClient();
+    if (!spectate_connect(*client, host, port))
+    {
+        cerr << "Cannot connect to " << host << ":" << port << endl;
+        delete client;
+        return 1;
+    }
+    cout << "Watching " << host << ":" << port << endl;
+    pacer_reset_stats(pacer);
+    const SpectateView& view = client->view;
+    game_started = true;
+    int shown_state = -1;
+    int shown_flaps = 0;
+    int shown_scores = 0;
+    Clock clock;
+    while (window.isOpen())
+    {
+        Event ev;
+        while (window.pollEvent(ev))
+        {
+            if (ev.type == Event::Closed || (ev.type == Event::KeyPressed && ev.key.code == Keyboard::Escape))
+            {
+                window.close();
+            }
+        }
+        float dt = clock.restart().asSeconds();
+        if (spectate_receive(*client) < 0)
+        {
+            cout << "Broadcast ended" << endl;
+            break;
+        }
+        world = view.world;
+        params.difficulty = view.params.difficulty;
+        params.pipe_gap = view.params.pipe_gap;
+        game_state = view.state == GAME_OVER ? GAME_OVER : PLAYING;
+        if (view.flaps != shown_flaps)
+        {
+            particles_emit(particles, particle_dust, bird_x - params.bird_w / 4, world.bird_y + params.bird_h / 3, view.params.pipe_speed * world.speed_scale * 0.5f, 0.f);
+        }
+        if (view.scores != shown_scores)
+        {
+            particles_emit(particles, particle_sparkles, bird_x, world.bird_y, 0.f, 0.f);
+        }
+        if (view.state != shown_state && view.state == GAME_OVER)
+        {
+            particles_emit(particles, particle_feathers, bird_x, world.bird_y, 0.f, world.bird_vel * 0.5f);
+            refresh_final_score_text();
+        }
+        if (view.state != shown_state && view.state == PLAYING && shown_state != PAUSED)
+        {
+            particles_clear(particles);
+        }
+        shown_state = view.state;
+        shown_flaps = view.flaps;
+        shown_scores = view.scores;
+        particles_update(particles, dt * 60.f);
+        draw_spectator(window, view);
+    }
+    spectate_disconnect(*client);
+    cout << "Spectated " << view.bytes << " bytes, " << view.records << " records, " << view.keyframes << " keyframes" << endl;
+    delete client;
+    return 0;
+}
@@ -0,0 +1,331 @@
+#include "metrics.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include "net.h"
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#endif
+using namespace std;
+const double metrics_frame_bounds[metrics_frame_buckets] = { 0.004, 0.007, 0.0084, 0.0125, 0.0167, 0.02, 0.025, 0.0334, 0.05, 0.1 };
+const double metrics_write_bounds[metrics_write_buckets] = { 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.05 };
+const char* metrics_difficulty_names[metrics_difficulties] = { "easy", "hard" };
+const int metrics_request_bytes = 2048;
+const int metrics_poll_ms = 200;
+const int metrics_read_ms = 1000;
+atomic<long long> metrics_frame_counts[metrics_frame_buckets + 1];
+atomic<long long> metrics_frame_ns(0);
+atomic<long long> metrics_dropped(0);
+atomic<long long> metrics_write_counts[metrics_write_buckets + 1];
+atomic<long long> metrics_write_ns(0);
+atomic<long long> metrics_started[metrics_difficulties];
+atomic<long long> metrics_finished[metrics_difficulties];
+atomic<long long> metrics_asset_ns(-1);
+atomic<long long> metrics_scrapes(0);
+atomic<long long> metrics_rejected(0);
+atomic<long long> metrics_bytes(0);
+atomic<long long> metrics_render_ns(0);
+atomic<bool> metrics_running(false);
+long long metrics_listener = -1;
+int metrics_bound_port = 0;
+thread metrics_thread;
+int metrics_bucket(const double* bounds, int count, double seconds)
+{
+    int b = 0;
+    while (b < count && seconds > bounds[b])
+    {
+        ++b;
+    }
+    return b;
+}
+void metrics_frame(double seconds, bool dropped)
+{
+    metrics_frame_counts[metrics_bucket(metrics_frame_bounds, metrics_frame_buckets, seconds)].fetch_add(1, memory_order_relaxed);
+    metrics_frame_ns.fetch_add((long long)(seconds * 1e9), memory_order_relaxed);
+    if (dropped)
+    {
+        metrics_dropped.fetch_add(1, memory_order_relaxed);
+    }
+}
+void metrics_run_started(int difficulty)
+{
+    if (difficulty >= 0 && difficulty < metrics_difficulties)
+    {
+        metrics_started[difficulty].fetch_add(1, memory_order_relaxed);
+    }
+}
+void metrics_run_finished(int difficulty)
+{
+    if (difficulty >= 0 && difficulty < metrics_difficulties)
+    {
+        metrics_finished[difficulty].fetch_add(1, memory_order_relaxed);
+    }
+}
+void metrics_leaderboard_write(double seconds)
+{
+    metrics_write_counts[metrics_bucket(metrics_write_bounds, metrics_write_buckets, seconds)].fetch_add(1, memory_order_relaxed);
+    metrics_write_ns.fetch_add((long long)(seconds * 1e9), memory_order_relaxed);
+}
+void metrics_asset_load(double seconds)
+{
+    metrics_asset_ns.store((long long)(seconds * 1e9), memory_order_relaxed);
+}
+long long metrics_resident_bytes()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+    {
+        return (long long)pmc.WorkingSetSize;
+    }
+    return -1;
+#elif defined(__linux__)
+    ifstream statm("/proc/self/statm");
+    long long size = 0;
+    long long resident = 0;
+    if (statm >> size >> resident)
+    {
+        return resident * sysconf(_SC_PAGESIZE);
+    }
+    return -1;
+#else
+    return -1;
+#endif
+}
+void metrics_header(string& out, const char* name, const char* type, const char* help)
+{
+    char line[256];
+    snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+    out += line;
+}
+void metrics_value(string& out, const char* name, const char* labels, long long value)
+{
+    char line[256];
+    snprintf(line, sizeof(line), "%s%s %lld\n", name, labels, value);
+    out += line;
+}
+void metrics_seconds(string& out, const char* name, const char* labels, long long ns)
+{
+    char line[256];
+    snprintf(line, sizeof(line), "%s%s %.9f\n", name, labels, ns / 1e9);
+    out += line;
+}
+void metrics_histogram(string& out, const char* name, const char* help, const double* bounds, int count, atomic<long long>* buckets, const atomic<long long>& sum_ns)
+{
+    char series[128];
+    char labels[64];
+    metrics_header(out, name, "histogram", help);
+    snprintf(series, sizeof(series), "%s_bucket", name);
+    long long total = 0;
+    for (int b = 0; b <= count; ++b)
+    {
+        total += buckets[b].load(memory_order_relaxed);
+        if (b < count)
+        {
+            snprintf(labels, sizeof(labels), "{le=\"%g\"}", bounds[b]);
+        }
+        else
+        {
+            snprintf(labels, sizeof(labels), "{le=\"+Inf\"}");
+        }
+        metrics_value(out, series, labels, total);
+    }
+    snprintf(series, sizeof(series), "%s_sum", name);
+    metrics_seconds(out, series, "", sum_ns.load(memory_order_relaxed));
+    snprintf(series, sizeof(series), "%s_count", name);
+    metrics_value(out, series, "", total);
+}
+void metrics_render(string& out)
+{
+    char labels[64];
+    out.clear();
+    metrics_histogram(out, "flappy_frame_seconds", "Time between presented frames.", metrics_frame_bounds, metrics_frame_buckets, metrics_frame_counts, metrics_frame_ns);
+    metrics_header(out, "flappy_frames_dropped_total", "counter", "Frames that missed their presentation deadline.");
+    metrics_value(out, "flappy_frames_dropped_total", "", metrics_dropped.load(memory_order_relaxed));
+    metrics_header(out, "flappy_runs_started_total", "counter", "Player runs started, by difficulty.");
+    for (int d = 0; d < metrics_difficulties; ++d)
+    {
+        snprintf(labels, sizeof(labels), "{difficulty=\"%s\"}", metrics_difficulty_names[d]);
+        metrics_value(out, "flappy_runs_started_total", labels, metrics_started[d].load(memory_order_relaxed));
+    }
+    metrics_header(out, "flappy_runs_finished_total", "counter", "Player runs that ended in a crash, by difficulty.");
+    for (int d = 0; d < metrics_difficulties; ++d)
+    {
+        snprintf(labels, sizeof(labels), "{difficulty=\"%s\"}", metrics_difficulty_names[d]);
+        metrics_value(out, "flappy_runs_finished_total", labels, metrics_finished[d].load(memory_order_relaxed));
+    }
+    metrics_histogram(out, "flappy_leaderboard_write_seconds", "Time to write the leaderboard file.", metrics_write_bounds, metrics_write_buckets, metrics_write_counts, metrics_write_ns);
+    long long asset_ns = metrics_asset_ns.load(memory_order_relaxed);
+    if (asset_ns >= 0)
+    {
+        metrics_header(out, "flappy_asset_load_seconds", "gauge", "Time spent loading assets at startup.");
+        metrics_seconds(out, "flappy_asset_load_seconds", "", asset_ns);
+    }
+    long long resident = metrics_resident_bytes();
+    if (resident >= 0)
+    {
+        metrics_header(out, "process_resident_memory_bytes", "gauge", "Resident memory size in bytes.");
+        metrics_value(out, "process_resident_memory_bytes", "", resident);
+    }
+    metrics_header(out, "flappy_metrics_scrapes_total", "counter", "Metrics requests served.");
+    metrics_value(out, "flappy_metrics_scrapes_total", "", metrics_scrapes.load(memory_order_relaxed));
+}
+bool metrics_readable(long long s, int ms)
+{
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET((NetSocket)s, &set);
+    timeval timeout;
+    timeout.tv_sec = ms / 1000;
+    timeout.tv_usec = (ms % 1000) * 1000;
+    return select((int)s + 1, &set, nullptr, nullptr, &timeout) > 0;
+}
+bool metrics_send_all(long long s, const char* data, int size)
+{
+    while (size > 0)
+    {
+        int n = (int)send((NetSocket)s, data, size, net_send_flags);
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        size -= n;
+        metrics_bytes.fetch_add(n, memory_order_relaxed);
+    }
+    return true;
+}
+void metrics_serve(long long client, string& body)
+{
+    char request[metrics_request_bytes];
+    int fill = 0;
+    request[0] = '\0';
+    while (fill < metrics_request_bytes - 1 && strstr(request, "\r\n\r\n") == nullptr && metrics_readable(client, metrics_read_ms))
+    {
+        int n = (int)recv((NetSocket)client, request + fill, metrics_request_bytes - 1 - fill, 0);
+        if (n <= 0)
+        {
+            break;
+        }
+        fill += n;
+        request[fill] = '\0';
+    }
+    bool ok = strncmp(request, "GET /metrics", 12) == 0 && (request[12] == ' ' || request[12] == '?');
+    char header[256];
+    if (ok)
+    {
+        auto start = chrono::steady_clock::now();
+        metrics_render(body);
+        metrics_render_ns.fetch_add(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count(), memory_order_relaxed);
+        metrics_scrapes.fetch_add(1, memory_order_relaxed);
+        snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: %d\r\nConnection: close\r\n\r\n",
+                 (int)body.size());
+    }
+    else
+    {
+        body.clear();
+        metrics_rejected.fetch_add(1, memory_order_relaxed);
+        snprintf(header, sizeof(header), "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+    }
+    if (metrics_send_all(client, header, (int)strlen(header)))
+    {
+        metrics_send_all(client, body.data(), (int)body.size());
+    }
+    net_close_socket(client);
+}
+void metrics_loop()
+{
+    string body;
+    body.reserve(4096);
+    while (metrics_running.load(memory_order_acquire))
+    {
+        if (!metrics_readable(metrics_listener, metrics_poll_ms))
+        {
+            continue;
+        }
+        long long client = (long long)accept((NetSocket)metrics_listener, nullptr, nullptr);
+        if (client >= 0)
+        {
+            metrics_serve(client, body);
+        }
+    }
+}
+bool metrics_listen(int port)
+{
+    if (metrics_running.load())
+    {
+        return false;
+    }
+    long long s = net_listen(INADDR_LOOPBACK, port, 16, metrics_bound_port);
+    if (s < 0)
+    {
+        return false;
+    }
+    metrics_listener = s;
+    metrics_running.store(true, memory_order_release);
+    metrics_thread = thread(metrics_loop);
+    return true;
+}
+int metrics_port()
+{
+    return metrics_running.load() ? metrics_bound_port : 0;
+}
+void metrics_close()
+{
+    if (!metrics_running.load())
+    {
+        return;
+    }
+    metrics_running.store(false, memory_order_release);
+    metrics_thread.join();
+    net_close_socket(metrics_listener);
+    metrics_listener = -1;
+    metrics_bound_port = 0;
+}
+MetricsStats metrics_stats()
+{
+    MetricsStats stats;
+    stats.scrapes = metrics_scrapes.load();
+    stats.rejected = metrics_rejected.load();
+    stats.bytes_sent = metrics_bytes.load();
+    stats.render_seconds = metrics_render_ns.load() / 1e9;
+    return stats;
+}
+bool metrics_fetch(int port, const char* path, string& response)
+{
+    response.clear();
+    if (!net_init())
+    {
+        return false;
+    }
+    NetSocket s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (!net_valid(s))
+    {
+        return false;
+    }
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    char request[256];
+    snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n", path);
+    bool ok = connect(s, (sockaddr*)&addr, sizeof(addr)) == 0 && send(s, request, (int)strlen(request), net_send_flags) == (int)strlen(request);
+    char chunk[4096];
+    while (ok && metrics_readable((long long)s, metrics_read_ms))
+    {
+        int n = (int)recv(s, chunk, sizeof(chunk), 0);
+        if (n <= 0)
+        {
+            break;
+        }
+        response.append(chunk, n);
+    }
+    net_close_socket((long long)s);
+    return ok && response.compare(0, 12, "HTTP/1.1 200") == 0;
+}
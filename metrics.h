@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+const int metrics_default_port = 9464;
+const int metrics_frame_buckets = 10;
+const int metrics_write_buckets = 8;
+const int metrics_difficulties = 2;
+struct MetricsStats
+{
+    long long scrapes = 0;
+    long long rejected = 0;
+    long long bytes_sent = 0;
+    double render_seconds = 0.0;
+};
+bool metrics_listen(int port);
+int metrics_port();
+void metrics_close();
+void metrics_frame(double seconds, bool dropped);
+void metrics_run_started(int difficulty);
+void metrics_run_finished(int difficulty);
+void metrics_leaderboard_write(double seconds);
+void metrics_asset_load(double seconds);
+long long metrics_resident_bytes();
+void metrics_render(std::string& out);
+MetricsStats metrics_stats();
+bool metrics_fetch(int port, const char* path, std::string& response);
@@ -0,0 +1,70 @@
+#include "net.h"
+#include <cstring>
+#ifdef _WIN32
+#pragma comment(lib, "ws2_32.lib")
+#endif
+bool net_init()
+{
+#ifdef _WIN32
+    static bool started = false;
+    if (!started)
+    {
+        WSADATA data;
+        started = WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }
+    return started;
+#else
+    return true;
+#endif
+}
+bool net_valid(NetSocket s)
+{
+#ifdef _WIN32
+    return s != INVALID_SOCKET;
+#else
+    return s >= 0;
+#endif
+}
+void net_close_socket(long long s)
+{
+#ifdef _WIN32
+    closesocket((NetSocket)s);
+#else
+    close((NetSocket)s);
+#endif
+}
+bool net_would_block()
+{
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+long long net_listen(unsigned int address, int port, int backlog, int& bound_port)
+{
+    if (!net_init())
+    {
+        return -1;
+    }
+    NetSocket s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (!net_valid(s))
+    {
+        return -1;
+    }
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(address);
+    addr.sin_port = htons((unsigned short)port);
+    socklen_t addr_len = sizeof(addr);
+    if (bind(s, (const sockaddr*)&addr, sizeof(addr)) != 0 || listen(s, backlog) != 0 || getsockname(s, (sockaddr*)&addr, &addr_len) != 0)
+    {
+        net_close_socket((long long)s);
+        return -1;
+    }
+    bound_port = ntohs(addr.sin_port);
+    return (long long)s;
+}
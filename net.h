@@ -0,0 +1,27 @@
+#pragma once
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET NetSocket;
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int NetSocket;
+#endif
+#ifdef MSG_NOSIGNAL
+const int net_send_flags = MSG_NOSIGNAL;
+#else
+const int net_send_flags = 0;
+#endif
+bool net_init();
+bool net_valid(NetSocket s);
+void net_close_socket(long long s);
+bool net_would_block();
+long long net_listen(unsigned int address, int port, int backlog, int& bound_port);
@@ -0,0 +1,125 @@
+#include "pacer.h"
+#include <chrono>
+#include <thread>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+using namespace std;
+double pacer_now()
+{
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+void pacer_sleep(FramePacer& p, double seconds)
+{
+    if (seconds <= 0.0)
+    {
+        return;
+    }
+#ifdef _WIN32
+    if (p.timer != nullptr)
+    {
+        LARGE_INTEGER due;
+        due.QuadPart = -(LONGLONG)(seconds * 1e7);
+        if (SetWaitableTimer((HANDLE)p.timer, &due, 0, nullptr, nullptr, FALSE))
+        {
+            WaitForSingleObject((HANDLE)p.timer, INFINITE);
+            return;
+        }
+    }
+#else
+    (void)p;
+#endif
+    this_thread::sleep_for(chrono::duration<double>(seconds));
+}
+void pacer_init(FramePacer& p, double hz, PacerMode mode, double spin)
+{
+    pacer_close(p);
+    p.mode = mode;
+    p.period = 1.0 / (hz > 1.0 ? hz : 1.0);
+    p.spin = spin < 0.0 ? 0.0 : spin;
+#ifdef _WIN32
+    p.timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (p.timer == nullptr)
+    {
+        p.timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+    }
+#endif
+    pacer_reset_stats(p);
+}
+void pacer_close(FramePacer& p)
+{
+#ifdef _WIN32
+    if (p.timer != nullptr)
+    {
+        CloseHandle((HANDLE)p.timer);
+    }
+#endif
+    p.timer = nullptr;
+}
+void pacer_wait(FramePacer& p)
+{
+    double now = pacer_now();
+    if (p.mode == PACER_SLEEP_SPIN)
+    {
+        if (now > p.deadline)
+        {
+            ++p.missed;
+            p.deadline = now;
+        }
+        else
+        {
+            pacer_sleep(p, p.deadline - p.spin - now);
+            now = pacer_now();
+            while (now < p.deadline)
+            {
+                now = pacer_now();
+            }
+        }
+        stats_add(p.lateness, now - p.deadline);
+        p.deadline += p.period;
+    }
+    else if (now - p.last > p.period * 1.5)
+    {
+        ++p.missed;
+    }
+    stats_add(p.frames, now - p.last);
+    p.last = now;
+}
+void pacer_reset_stats(FramePacer& p)
+{
+    p.last = pacer_now();
+    p.deadline = p.last + p.period;
+    p.missed = 0;
+    p.frames = FrameStats();
+    p.lateness = FrameStats();
+}
+void stats_add(FrameStats& s, double seconds)
+{
+    int bin = (int)(seconds / pacer_bin_seconds);
+    ++s.histogram[bin < 0 ? 0 : (bin > pacer_bins ? pacer_bins : bin)];
+    ++s.count;
+    s.total += seconds;
+    s.worst = seconds > s.worst ? seconds : s.worst;
+}
+double stats_mean(const FrameStats& s)
+{
+    return s.count > 0 ? s.total / s.count : 0.0;
+}
+double stats_percentile(const FrameStats& s, double q)
+{
+    long long target = (long long)(q * s.count);
+    long long seen = 0;
+    for (int i = 0; i <= pacer_bins; ++i)
+    {
+        seen += s.histogram[i];
+        if (seen > target)
+        {
+            return i < pacer_bins && (i + 1) * pacer_bin_seconds < s.worst ? (i + 1) * pacer_bin_seconds : s.worst;
+        }
+    }
+    return s.worst;
+}
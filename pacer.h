@@ -0,0 +1,36 @@
+#pragma once
+const int pacer_bins = 4000;
+const double pacer_bin_seconds = 0.000025;
+enum PacerMode
+{
+    PACER_SLEEP_SPIN,
+    PACER_VSYNC
+};
+struct FrameStats
+{
+    long long count = 0;
+    double total = 0.0;
+    double worst = 0.0;
+    int histogram[pacer_bins + 1] = {};
+};
+struct FramePacer
+{
+    PacerMode mode = PACER_SLEEP_SPIN;
+    double period = 1.0 / 60.0;
+    double spin = 0.002;
+    double deadline = 0.0;
+    double last = 0.0;
+    long long missed = 0;
+    void* timer = nullptr;
+    FrameStats frames;
+    FrameStats lateness;
+};
+double pacer_now();
+void pacer_sleep(FramePacer& p, double seconds);
+void pacer_init(FramePacer& p, double hz, PacerMode mode, double spin = 0.002);
+void pacer_close(FramePacer& p);
+void pacer_wait(FramePacer& p);
+void pacer_reset_stats(FramePacer& p);
+void stats_add(FrameStats& s, double seconds);
+double stats_mean(const FrameStats& s);
+double stats_percentile(const FrameStats& s, double q);
@@ -0,0 +1,75 @@
+#include "particles.h"
+#include <cmath>
+#include "simulation.h"
+using namespace std;
+float particle_random(ParticlePool& pool, float lo, float hi)
+{
+    return lo + (hi - lo) * (float)(xorshift32(pool.rng) >> 8) * (1.f / 16777216.f);
+}
+void particles_clear(ParticlePool& pool)
+{
+    pool.count = 0;
+}
+int particles_emit(ParticlePool& pool, const ParticleEmitter& e, float x, float y, float base_vx, float base_vy)
+{
+    int n = e.count;
+    if (n > particle_capacity - pool.count)
+    {
+        n = particle_capacity - pool.count;
+    }
+    const float to_radians = 3.14159265f / 180.f;
+    for (int k = 0; k < n; ++k)
+    {
+        int i = pool.count++;
+        float angle = (e.angle + particle_random(pool, -0.5f, 0.5f) * e.spread) * to_radians;
+        float speed = particle_random(pool, e.speed_min, e.speed_max);
+        pool.x[i] = x;
+        pool.y[i] = y;
+        pool.vx[i] = base_vx + cosf(angle) * speed;
+        pool.vy[i] = base_vy + sinf(angle) * speed;
+        pool.age[i] = 0.f;
+        pool.life[i] = particle_random(pool, e.life_min, e.life_max);
+        pool.gravity[i] = e.gravity;
+        pool.size[i] = e.size;
+        pool.color[i] = e.color;
+    }
+    return n;
+}
+void particles_update(ParticlePool& pool, float dt)
+{
+    int n = pool.count;
+    int padded = (n + 7) & ~7;
+    float damping = 1.f - (1.f - pool.drag) * dt;
+    for (int i = 0; i < padded; ++i)
+    {
+        pool.vy[i] = (pool.vy[i] + pool.gravity[i] * dt) * damping;
+        pool.vx[i] = pool.vx[i] * damping;
+        pool.x[i] += pool.vx[i] * dt;
+        pool.y[i] += pool.vy[i] * dt;
+        pool.age[i] += dt;
+    }
+    int i = 0;
+    while (i < n)
+    {
+        if (pool.age[i] < pool.life[i])
+        {
+            ++i;
+            continue;
+        }
+        --n;
+        pool.x[i] = pool.x[n];
+        pool.y[i] = pool.y[n];
+        pool.vx[i] = pool.vx[n];
+        pool.vy[i] = pool.vy[n];
+        pool.age[i] = pool.age[n];
+        pool.life[i] = pool.life[n];
+        pool.gravity[i] = pool.gravity[n];
+        pool.size[i] = pool.size[n];
+        pool.color[i] = pool.color[n];
+    }
+    pool.count = n;
+}
+float particle_fade(const ParticlePool& pool, int i)
+{
+    return 1.f - pool.age[i] / pool.life[i];
+}
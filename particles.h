@@ -0,0 +1,37 @@
+#pragma once
+const int particle_capacity = 65536;
+struct ParticleEmitter
+{
+    int count;
+    float speed_min;
+    float speed_max;
+    float angle;
+    float spread;
+    float life_min;
+    float life_max;
+    float gravity;
+    float size;
+    unsigned int color;
+};
+const ParticleEmitter particle_dust = { 8, 0.3f, 1.2f, 90.f, 100.f, 12.f, 24.f, -0.01f, 3.f, 0xE0D0A8FF };
+const ParticleEmitter particle_feathers = { 48, 0.8f, 4.f, 0.f, 360.f, 40.f, 90.f, 0.05f, 4.f, 0xF8D848FF };
+const ParticleEmitter particle_sparkles = { 24, 1.f, 3.5f, -90.f, 360.f, 18.f, 36.f, 0.f, 3.f, 0xFFF8B0FF };
+struct ParticlePool
+{
+    int count = 0;
+    unsigned int rng = 0x2545F491u;
+    float drag = 0.97f;
+    alignas(32) float x[particle_capacity];
+    alignas(32) float y[particle_capacity];
+    alignas(32) float vx[particle_capacity];
+    alignas(32) float vy[particle_capacity];
+    alignas(32) float age[particle_capacity];
+    alignas(32) float life[particle_capacity];
+    alignas(32) float gravity[particle_capacity];
+    alignas(32) float size[particle_capacity];
+    alignas(32) unsigned int color[particle_capacity];
+};
+void particles_clear(ParticlePool& pool);
+int particles_emit(ParticlePool& pool, const ParticleEmitter& e, float x, float y, float base_vx, float base_vy);
+void particles_update(ParticlePool& pool, float dt);
+float particle_fade(const ParticlePool& pool, int i);
@@ -0,0 +1,461 @@
+#include "pattern.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+using namespace std;
+const int pattern_max_tokens = 16;
+const int pattern_max_line = 256;
+const int pattern_step_budget = 4 * pattern_max_code;
+struct PatternCompiler
+{
+    ObstacleProgram* prog;
+    int line;
+    char* error;
+    int error_size;
+    int depth;
+    int body_start[pattern_max_depth];
+    bool body_gap[pattern_max_depth];
+    bool any_gap;
+};
+int pattern_read_i16(const unsigned char* c)
+{
+    return (short)(c[0] | (c[1] << 8));
+}
+bool pattern_fail(PatternCompiler& pc, const char* message, const char* token)
+{
+    if (token != nullptr)
+    {
+        snprintf(pc.error, pc.error_size, "line %d: %s '%s'", pc.line, message, token);
+    }
+    else
+    {
+        snprintf(pc.error, pc.error_size, "line %d: %s", pc.line, message);
+    }
+    return false;
+}
+bool pattern_emit(PatternCompiler& pc, int byte)
+{
+    if (pc.prog->length >= pattern_max_code)
+    {
+        return pattern_fail(pc, "pattern is longer than the bytecode limit", nullptr);
+    }
+    pc.prog->code[pc.prog->length++] = (unsigned char)byte;
+    return true;
+}
+bool pattern_emit_i16(PatternCompiler& pc, int value)
+{
+    return pattern_emit(pc, value & 0xFF) && pattern_emit(pc, (value >> 8) & 0xFF);
+}
+bool pattern_parse_int(const char* token, int lo, int hi, int& out)
+{
+    char* end = nullptr;
+    long value = strtol(token, &end, 10);
+    if (end == token || *end != '\0' || value < lo || value > hi)
+    {
+        return false;
+    }
+    out = (int)value;
+    return true;
+}
+bool pattern_compile_value(PatternCompiler& pc, char* tokens[], int count, int& t, bool allow_rand, bool allow_frac)
+{
+    if (t >= count)
+    {
+        return pattern_fail(pc, "missing value", nullptr);
+    }
+    const char* token = tokens[t++];
+    static const char* names[] = { "top", "high", "mid", "low", "bottom" };
+    for (int i = 0; i < 5; ++i)
+    {
+        if (strcmp(token, names[i]) == 0)
+        {
+            if (!allow_frac)
+            {
+                return pattern_fail(pc, "position name not allowed here", token);
+            }
+            return pattern_emit(pc, PATTERN_FRAC) && pattern_emit_i16(pc, 250 * i);
+        }
+    }
+    if (strcmp(token, "same") == 0)
+    {
+        return pattern_emit(pc, PATTERN_REL) && pattern_emit_i16(pc, 0);
+    }
+    if (strcmp(token, "rand") == 0)
+    {
+        if (!allow_rand)
+        {
+            return pattern_fail(pc, "rand cannot be nested", nullptr);
+        }
+        return pattern_emit(pc, PATTERN_RAND) && pattern_compile_value(pc, tokens, count, t, false, allow_frac) &&
+               pattern_compile_value(pc, tokens, count, t, false, allow_frac);
+    }
+    size_t len = strlen(token);
+    int value = 0;
+    if (len > 1 && token[len - 1] == '%')
+    {
+        string digits(token, len - 1);
+        if (!allow_frac || !pattern_parse_int(digits.c_str(), 0, 100, value))
+        {
+            return pattern_fail(pc, "bad percentage", token);
+        }
+        return pattern_emit(pc, PATTERN_FRAC) && pattern_emit_i16(pc, value * 10);
+    }
+    if (!pattern_parse_int(token, -height, height, value))
+    {
+        return pattern_fail(pc, "bad value", token);
+    }
+    int kind = (token[0] == '+' || token[0] == '-') ? PATTERN_REL : PATTERN_ABS;
+    return pattern_emit(pc, kind) && pattern_emit_i16(pc, value);
+}
+bool pattern_compile_line(PatternCompiler& pc, char* tokens[], int count)
+{
+    const char* op = tokens[0];
+    int t = 1;
+    if (strcmp(op, "gap") == 0)
+    {
+        if (!pattern_emit(pc, PATTERN_GAP) || !pattern_compile_value(pc, tokens, count, t, true, true))
+        {
+            return false;
+        }
+        pc.any_gap = true;
+        if (pc.depth > 0)
+        {
+            pc.body_gap[pc.depth - 1] = true;
+        }
+    }
+    else if (strcmp(op, "speed") == 0)
+    {
+        if (!pattern_emit(pc, PATTERN_SPEED) || !pattern_compile_value(pc, tokens, count, t, true, false))
+        {
+            return false;
+        }
+    }
+    else if (strcmp(op, "move") == 0)
+    {
+        int amp = 0;
+        int period = 0;
+        if (count < 3 || !pattern_parse_int(tokens[1], 0, height / 2, amp) || !pattern_parse_int(tokens[2], 0, 30000, period))
+        {
+            return pattern_fail(pc, "move needs an amplitude and a period in ticks", nullptr);
+        }
+        if (amp > 0 && period < 2)
+        {
+            return pattern_fail(pc, "move period must be at least 2 ticks", tokens[2]);
+        }
+        t = 3;
+        if (!pattern_emit(pc, PATTERN_MOVE) || !pattern_emit_i16(pc, amp) || !pattern_emit_i16(pc, amp > 0 ? period : 0))
+        {
+            return false;
+        }
+    }
+    else if (strcmp(op, "repeat") == 0 || strcmp(op, "loop") == 0)
+    {
+        int times = -1;
+        if (op[0] == 'r')
+        {
+            if (count < 2 || !pattern_parse_int(tokens[1], 1, 30000, times))
+            {
+                return pattern_fail(pc, "repeat needs a count from 1 to 30000", nullptr);
+            }
+            t = 2;
+        }
+        if (pc.depth == pattern_max_depth)
+        {
+            return pattern_fail(pc, "loops nested too deeply", nullptr);
+        }
+        if (!pattern_emit(pc, PATTERN_REPEAT) || !pattern_emit_i16(pc, times))
+        {
+            return false;
+        }
+        pc.body_start[pc.depth] = pc.prog->length;
+        pc.body_gap[pc.depth] = false;
+        ++pc.depth;
+    }
+    else if (strcmp(op, "end") == 0)
+    {
+        if (pc.depth == 0)
+        {
+            return pattern_fail(pc, "end without repeat or loop", nullptr);
+        }
+        --pc.depth;
+        if (!pc.body_gap[pc.depth])
+        {
+            return pattern_fail(pc, "loop body never places a gap", nullptr);
+        }
+        if (pc.depth > 0)
+        {
+            pc.body_gap[pc.depth - 1] = true;
+        }
+        if (!pattern_emit(pc, PATTERN_END) || !pattern_emit_i16(pc, pc.body_start[pc.depth]))
+        {
+            return false;
+        }
+    }
+    else
+    {
+        return pattern_fail(pc, "unknown statement", op);
+    }
+    if (t < count)
+    {
+        return pattern_fail(pc, "unexpected", tokens[t]);
+    }
+    return true;
+}
+bool pattern_compile(ObstacleProgram& prog, const char* source, char* error, int error_size)
+{
+    PatternCompiler pc;
+    pc.prog = &prog;
+    pc.line = 0;
+    pc.error = error;
+    pc.error_size = error_size;
+    pc.depth = 0;
+    pc.any_gap = false;
+    prog.length = 0;
+    const char* cursor = source;
+    while (*cursor != '\0')
+    {
+        ++pc.line;
+        const char* eol = strchr(cursor, '\n');
+        size_t len = eol ? (size_t)(eol - cursor) : strlen(cursor);
+        if (len >= (size_t)pattern_max_line)
+        {
+            return pattern_fail(pc, "line too long", nullptr);
+        }
+        char line[pattern_max_line];
+        memcpy(line, cursor, len);
+        line[len] = '\0';
+        cursor += eol ? len + 1 : len;
+        char* comment = strchr(line, '#');
+        if (comment != nullptr)
+        {
+            *comment = '\0';
+        }
+        char* tokens[pattern_max_tokens];
+        int count = 0;
+        for (char* tok = strtok(line, " \t\r"); tok != nullptr; tok = strtok(nullptr, " \t\r"))
+        {
+            if (count == pattern_max_tokens)
+            {
+                return pattern_fail(pc, "too many words on one line", nullptr);
+            }
+            tokens[count++] = tok;
+        }
+        if (count > 0 && !pattern_compile_line(pc, tokens, count))
+        {
+            return false;
+        }
+    }
+    if (pc.depth > 0)
+    {
+        return pattern_fail(pc, "missing end", nullptr);
+    }
+    if (!pc.any_gap)
+    {
+        return pattern_fail(pc, "pattern never places a gap", nullptr);
+    }
+    return true;
+}
+bool pattern_load(ObstacleProgram& prog, const char* path, char* error, int error_size)
+{
+    ifstream in(path);
+    if (!in.is_open())
+    {
+        snprintf(error, error_size, "cannot open %s", path);
+        return false;
+    }
+    stringstream text;
+    text << in.rdbuf();
+    return pattern_compile(prog, text.str().c_str(), error, error_size);
+}
+int pattern_check_value(const unsigned char* code, int pc, int length, bool allow_rand)
+{
+    if (pc + 3 > length)
+    {
+        return -1;
+    }
+    int kind = code[pc];
+    if (kind == PATTERN_ABS || kind == PATTERN_REL || kind == PATTERN_FRAC)
+    {
+        return pc + 3;
+    }
+    if (kind != PATTERN_RAND || !allow_rand)
+    {
+        return -1;
+    }
+    pc = pattern_check_value(code, pc + 1, length, false);
+    return pc < 0 ? -1 : pattern_check_value(code, pc, length, false);
+}
+bool pattern_set_code(ObstacleProgram& prog, const unsigned char* code, int length)
+{
+    if (length <= 0 || length > pattern_max_code)
+    {
+        return false;
+    }
+    int body_start[pattern_max_depth];
+    int depth = 0;
+    bool gap_seen = false;
+    int pc = 0;
+    while (pc < length)
+    {
+        int op = code[pc];
+        if (op == PATTERN_GAP || op == PATTERN_SPEED)
+        {
+            pc = pattern_check_value(code, pc + 1, length, true);
+            gap_seen = gap_seen || op == PATTERN_GAP;
+        }
+        else if (op == PATTERN_MOVE)
+        {
+            if (pc + 5 > length || pattern_read_i16(code + pc + 1) < 0 || pattern_read_i16(code + pc + 3) < 0 ||
+                (pattern_read_i16(code + pc + 1) > 0 && pattern_read_i16(code + pc + 3) < 2))
+            {
+                return false;
+            }
+            pc += 5;
+        }
+        else if (op == PATTERN_REPEAT)
+        {
+            if (pc + 3 > length || depth == pattern_max_depth || pattern_read_i16(code + pc + 1) == 0 || pattern_read_i16(code + pc + 1) < -1)
+            {
+                return false;
+            }
+            pc += 3;
+            body_start[depth++] = pc;
+        }
+        else if (op == PATTERN_END)
+        {
+            if (pc + 3 > length || depth == 0 || pattern_read_i16(code + pc + 1) != body_start[--depth])
+            {
+                return false;
+            }
+            pc += 3;
+        }
+        else
+        {
+            return false;
+        }
+        if (pc < 0)
+        {
+            return false;
+        }
+    }
+    if (depth != 0 || !gap_seen)
+    {
+        return false;
+    }
+    memcpy(prog.code, code, length);
+    prog.length = length;
+    return true;
+}
+void pattern_reset(PatternState& s)
+{
+    s.pc = 0;
+    s.depth = 0;
+    for (int i = 0; i < pattern_max_depth; ++i)
+    {
+        s.loop_left[i] = 0;
+    }
+    s.last_gap = -1;
+    s.speed_pct = 100;
+    s.move_amp = 0;
+    s.move_period = 0;
+}
+int pattern_value(const unsigned char* c, int& size, int relative_to, int lo, int hi, unsigned int& rng)
+{
+    int value = pattern_read_i16(c + 1);
+    size = 3;
+    switch (c[0])
+    {
+    case PATTERN_REL:
+        return relative_to + value;
+    case PATTERN_FRAC:
+        return lo + (hi - lo) * value / 1000;
+    case PATTERN_RAND:
+    {
+        int a_size = 0;
+        int b_size = 0;
+        int a = pattern_value(c + 1, a_size, relative_to, lo, hi, rng);
+        int b = pattern_value(c + 1 + a_size, b_size, relative_to, lo, hi, rng);
+        size = 1 + a_size + b_size;
+        if (a > b)
+        {
+            int swap = a;
+            a = b;
+            b = swap;
+        }
+        return a + (int)(xorshift32(rng) % (unsigned int)(b - a + 1));
+    }
+    default:
+        return value;
+    }
+}
+int pattern_next_gap(const ObstacleProgram& prog, PatternState& s, unsigned int& rng, float& speed_scale, const SimParams& p)
+{
+    int lo = min_gap_y;
+    int hi = get_max_gap_y(p);
+    for (int step = 0; step < pattern_step_budget; ++step)
+    {
+        if (s.pc >= prog.length)
+        {
+            s.pc = 0;
+            s.depth = 0;
+        }
+        const unsigned char* c = prog.code + s.pc;
+        int size = 0;
+        switch (c[0])
+        {
+        case PATTERN_GAP:
+        {
+            int gap = pattern_value(c + 1, size, s.last_gap < 0 ? (lo + hi) / 2 : s.last_gap, lo, hi, rng);
+            s.pc += 1 + size;
+            if (2 * s.move_amp > hi - lo)
+            {
+                s.move_amp = (hi - lo) / 2;
+            }
+            int gap_lo = lo + s.move_amp;
+            int gap_hi = hi - s.move_amp;
+            gap = gap < gap_lo ? gap_lo : (gap > gap_hi ? gap_hi : gap);
+            s.last_gap = gap;
+            return gap;
+        }
+        case PATTERN_SPEED:
+        {
+            int pct = pattern_value(c + 1, size, s.speed_pct, pattern_min_speed, pattern_max_speed, rng);
+            s.speed_pct = pct < pattern_min_speed ? pattern_min_speed : (pct > pattern_max_speed ? pattern_max_speed : pct);
+            speed_scale = s.speed_pct / 100.f;
+            s.pc += 1 + size;
+            break;
+        }
+        case PATTERN_MOVE:
+            s.move_amp = pattern_read_i16(c + 1);
+            s.move_period = pattern_read_i16(c + 3);
+            s.pc += 5;
+            break;
+        case PATTERN_REPEAT:
+            s.loop_left[s.depth++] = pattern_read_i16(c + 1);
+            s.pc += 3;
+            break;
+        case PATTERN_END:
+        {
+            int& left = s.loop_left[s.depth - 1];
+            if (left < 0 || --left > 0)
+            {
+                s.pc = pattern_read_i16(c + 1);
+            }
+            else
+            {
+                --s.depth;
+                s.pc += 3;
+            }
+            break;
+        }
+        default:
+            s.pc = prog.length;
+            break;
+        }
+    }
+    s.last_gap = (lo + hi) / 2;
+    return s.last_gap;
+}
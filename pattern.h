@@ -0,0 +1,30 @@
+#pragma once
+#include "simulation.h"
+const int pattern_max_code = 1024;
+const int pattern_min_speed = 25;
+const int pattern_max_speed = 400;
+enum PatternOp
+{
+    PATTERN_GAP = 1,
+    PATTERN_SPEED,
+    PATTERN_MOVE,
+    PATTERN_REPEAT,
+    PATTERN_END
+};
+enum PatternValue
+{
+    PATTERN_ABS = 1,
+    PATTERN_REL,
+    PATTERN_FRAC,
+    PATTERN_RAND
+};
+struct ObstacleProgram
+{
+    unsigned char code[pattern_max_code];
+    int length = 0;
+};
+bool pattern_compile(ObstacleProgram& prog, const char* source, char* error, int error_size);
+bool pattern_load(ObstacleProgram& prog, const char* path, char* error, int error_size);
+bool pattern_set_code(ObstacleProgram& prog, const unsigned char* code, int length);
+void pattern_reset(PatternState& s);
+int pattern_next_gap(const ObstacleProgram& prog, PatternState& s, unsigned int& rng, float& speed_scale, const SimParams& p);
@@ -0,0 +1,247 @@
+#include "raster.h"
+#include <cmath>
+#include <cstring>
+using namespace std;
+const int raster_bird_samples = 4;
+unsigned char rgba_to_gray(const unsigned char* px)
+{
+    return (unsigned char)((77 * px[0] + 150 * px[1] + 29 * px[2]) >> 8);
+}
+bool raster_set_texture(RasterAssets& a, int which, const unsigned char* rgba, int w, int h)
+{
+    if (which < 0 || which >= RASTER_TEXTURE_COUNT || !rgba || w <= 0 || h <= 0)
+    {
+        return false;
+    }
+    RasterTexture& t = a.textures[which];
+    t.w = w;
+    t.h = h;
+    t.gray.resize((size_t)w * h);
+    t.alpha.resize((size_t)w * h);
+    for (int i = 0; i < w * h; ++i)
+    {
+        t.gray[i] = rgba_to_gray(rgba + 4 * i);
+        t.alpha[i] = rgba[4 * i + 3];
+    }
+    if (a.out_w > 0)
+    {
+        raster_prepare(a, a.out_w, a.out_h);
+    }
+    return true;
+}
+void raster_downsample_rgba(const unsigned char* rgba, int w, int h, unsigned char* out, int out_w, int out_h)
+{
+    for (int r = 0; r < out_h; ++r)
+    {
+        int y0 = r * h / out_h;
+        int y1 = (r + 1) * h / out_h;
+        if (y1 <= y0)
+        {
+            y1 = y0 + 1;
+        }
+        for (int c = 0; c < out_w; ++c)
+        {
+            int x0 = c * w / out_w;
+            int x1 = (c + 1) * w / out_w;
+            if (x1 <= x0)
+            {
+                x1 = x0 + 1;
+            }
+            unsigned int sum = 0;
+            for (int y = y0; y < y1; ++y)
+            {
+                for (int x = x0; x < x1; ++x)
+                {
+                    sum += rgba_to_gray(rgba + 4 * ((size_t)y * w + x));
+                }
+            }
+            out[(size_t)r * out_w + c] = (unsigned char)(sum / ((y1 - y0) * (x1 - x0)));
+        }
+    }
+}
+void raster_prepare(RasterAssets& a, int out_w, int out_h)
+{
+    a.out_w = out_w;
+    a.out_h = out_h;
+    a.background.assign((size_t)out_w * out_h, 0);
+    const RasterTexture& bg = a.textures[RASTER_BACKGROUND];
+    if (bg.w == 0)
+    {
+        return;
+    }
+    for (int r = 0; r < out_h; ++r)
+    {
+        int y0 = r * bg.h / out_h;
+        int y1 = (r + 1) * bg.h / out_h;
+        if (y1 <= y0)
+        {
+            y1 = y0 + 1;
+        }
+        for (int c = 0; c < out_w; ++c)
+        {
+            int x0 = c * bg.w / out_w;
+            int x1 = (c + 1) * bg.w / out_w;
+            if (x1 <= x0)
+            {
+                x1 = x0 + 1;
+            }
+            unsigned int sum = 0;
+            for (int y = y0; y < y1; ++y)
+            {
+                for (int x = x0; x < x1; ++x)
+                {
+                    sum += bg.gray[(size_t)y * bg.w + x];
+                }
+            }
+            a.background[(size_t)r * out_w + c] = (unsigned char)(sum / ((y1 - y0) * (x1 - x0)));
+        }
+    }
+}
+float span_coverage(float lo, float hi, float cell_lo, float cell_hi)
+{
+    float a = lo > cell_lo ? lo : cell_lo;
+    float b = hi < cell_hi ? hi : cell_hi;
+    return b > a ? (b - a) / (cell_hi - cell_lo) : 0.f;
+}
+void raster_blend_span(unsigned char* __restrict row, const unsigned short* __restrict weight, const unsigned char* __restrict color, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        int d = (int)color[i] - (int)row[i];
+        row[i] = (unsigned char)(row[i] + ((d * weight[i]) >> 8));
+    }
+}
+void raster_draw_pipe(const RasterAssets& a, const RasterTexture& t, float x0, float x1, float y0, float y1, unsigned char* out)
+{
+    if (t.w == 0 || y1 <= y0)
+    {
+        return;
+    }
+    float sx = (float)width / a.out_w;
+    float sy = (float)height / a.out_h;
+    int c0 = (int)floorf(x0 / sx);
+    int c1 = (int)ceilf(x1 / sx);
+    int r0 = (int)floorf(y0 / sy);
+    int r1 = (int)ceilf(y1 / sy);
+    if (c0 < 0)
+    {
+        c0 = 0;
+    }
+    if (c1 > a.out_w)
+    {
+        c1 = a.out_w;
+    }
+    if (r0 < 0)
+    {
+        r0 = 0;
+    }
+    if (r1 > a.out_h)
+    {
+        r1 = a.out_h;
+    }
+    int span = c1 - c0;
+    if (span <= 0 || r1 <= r0)
+    {
+        return;
+    }
+    const int max_span = 1024;
+    if (span > max_span)
+    {
+        span = max_span;
+    }
+    float cover_x[max_span];
+    int tex_u[max_span];
+    for (int i = 0; i < span; ++i)
+    {
+        int c = c0 + i;
+        cover_x[i] = span_coverage(x0, x1, c * sx, (c + 1) * sx);
+        int u = (int)(((c + 0.5f) * sx - x0) / (x1 - x0) * t.w);
+        tex_u[i] = u < 0 ? 0 : (u >= t.w ? t.w - 1 : u);
+    }
+    unsigned short weight[max_span];
+    unsigned char color[max_span];
+    for (int r = r0; r < r1; ++r)
+    {
+        float cover_y = span_coverage(y0, y1, r * sy, (r + 1) * sy);
+        int v = (int)(((r + 0.5f) * sy - y0) / (y1 - y0) * t.h);
+        v = v < 0 ? 0 : (v >= t.h ? t.h - 1 : v);
+        const unsigned char* gray_row = &t.gray[(size_t)v * t.w];
+        const unsigned char* alpha_row = &t.alpha[(size_t)v * t.w];
+        for (int i = 0; i < span; ++i)
+        {
+            weight[i] = (unsigned short)(cover_x[i] * cover_y * alpha_row[tex_u[i]] * (256.f / 255.f) + 0.5f);
+            color[i] = gray_row[tex_u[i]];
+        }
+        raster_blend_span(out + (size_t)r * a.out_w + c0, weight, color, span);
+    }
+}
+void raster_draw_bird(const RasterAssets& a, const SimWorld& w, const SimParams& p, unsigned char* out)
+{
+    const RasterTexture& t = a.textures[w.bird_falling ? RASTER_BIRD_DOWN : RASTER_BIRD_UP];
+    if (t.w == 0)
+    {
+        return;
+    }
+    float sx = (float)width / a.out_w;
+    float sy = (float)height / a.out_h;
+    float angle = w.bird_rotation * 3.141592654f / 180.f;
+    float c = cosf(angle);
+    float s = sinf(angle);
+    float radius = 0.5f * sqrtf(p.bird_w * p.bird_w + p.bird_h * p.bird_h);
+    int c0 = (int)floorf((bird_x - radius) / sx);
+    int c1 = (int)ceilf((bird_x + radius) / sx);
+    int r0 = (int)floorf((w.bird_y - radius) / sy);
+    int r1 = (int)ceilf((w.bird_y + radius) / sy);
+    c0 = c0 < 0 ? 0 : c0;
+    r0 = r0 < 0 ? 0 : r0;
+    c1 = c1 > a.out_w ? a.out_w : c1;
+    r1 = r1 > a.out_h ? a.out_h : r1;
+    float tex_sx = t.w / p.bird_w;
+    float tex_sy = t.h / p.bird_h;
+    const int n = raster_bird_samples;
+    for (int r = r0; r < r1; ++r)
+    {
+        for (int col = c0; col < c1; ++col)
+        {
+            unsigned int alpha_sum = 0;
+            unsigned int color_sum = 0;
+            for (int j = 0; j < n; ++j)
+            {
+                float dy = (r + (j + 0.5f) / n) * sy - w.bird_y;
+                for (int i = 0; i < n; ++i)
+                {
+                    float dx = (col + (i + 0.5f) / n) * sx - bird_x;
+                    float lx = c * dx + s * dy + p.bird_w / 2.f;
+                    float ly = -s * dx + c * dy + p.bird_h / 2.f;
+                    if (lx < 0.f || ly < 0.f || lx >= p.bird_w || ly >= p.bird_h)
+                    {
+                        continue;
+                    }
+                    size_t texel = (size_t)(int)(ly * tex_sy) * t.w + (int)(lx * tex_sx);
+                    alpha_sum += t.alpha[texel];
+                    color_sum += t.alpha[texel] * t.gray[texel];
+                }
+            }
+            if (alpha_sum == 0)
+            {
+                continue;
+            }
+            unsigned char& dst = out[(size_t)r * a.out_w + col];
+            unsigned int total = 255u * n * n;
+            dst = (unsigned char)((dst * (total - alpha_sum) + color_sum) / total);
+        }
+    }
+}
+void raster_draw_world(const RasterAssets& a, const SimWorld& w, const SimParams& p, unsigned char* out)
+{
+    memcpy(out, a.background.data(), a.background.size());
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        float x0 = w.pipes[i].x;
+        float x1 = x0 + p.pipe_w;
+        float bottom_y = (float)(w.pipes[i].gap_y + p.pipe_gap);
+        raster_draw_pipe(a, a.textures[RASTER_PIPE_DOWN], x0, x1, 0.f, (float)w.pipes[i].gap_y, out);
+        raster_draw_pipe(a, a.textures[RASTER_PIPE_UP], x0, x1, bottom_y, (float)height, out);
+    }
+    raster_draw_bird(a, w, p, out);
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include "simulation.h"
+struct RasterTexture
+{
+    int w = 0;
+    int h = 0;
+    std::vector<unsigned char> gray;
+    std::vector<unsigned char> alpha;
+};
+enum RasterTextureId
+{
+    RASTER_BACKGROUND,
+    RASTER_BIRD_UP,
+    RASTER_BIRD_DOWN,
+    RASTER_PIPE_DOWN,
+    RASTER_PIPE_UP,
+    RASTER_TEXTURE_COUNT
+};
+struct RasterAssets
+{
+    RasterTexture textures[RASTER_TEXTURE_COUNT];
+    int out_w = 0;
+    int out_h = 0;
+    std::vector<unsigned char> background;
+};
+bool raster_set_texture(RasterAssets& a, int which, const unsigned char* rgba, int w, int h);
+void raster_prepare(RasterAssets& a, int out_w, int out_h);
+void raster_draw_world(const RasterAssets& a, const SimWorld& w, const SimParams& p, unsigned char* out);
+void raster_downsample_rgba(const unsigned char* rgba, int w, int h, unsigned char* out, int out_w, int out_h);
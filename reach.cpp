@@ -0,0 +1,569 @@
+#include "reach.h"
+#include "bitmask.h"
+#include <cmath>
+using namespace std;
+const float reach_margin = 0.01f;
+const float reach_bins_per_px = 1.f;
+const int reach_max_ticks = 4096;
+struct ReachState
+{
+    float r;
+    float lo;
+    float hi;
+    float min_top;
+    float max_bottom;
+};
+struct ReachTimeline
+{
+    int start = 0;
+    int end = 0;
+    int spacing_ticks = 0;
+    float vel[reach_max_flap_age + 1];
+    float top_off[reach_max_flap_age + 1];
+    float box_h[reach_max_flap_age + 1];
+    vector<unsigned char> prev_overlap;
+    vector<unsigned char> next_overlap;
+};
+bool reach_horizontal_overlap(const SimBox& bird, float pipe_x, const SimParams& p)
+{
+    SimPipe pipe = { pipe_x, 0, 0, 0, 0, 0 };
+    SimBox box = get_pipe_hit_box(pipe, p, true);
+    float left = (bird.left > box.left) ? bird.left : box.left;
+    float right = min_f(bird.left + bird.width, box.left + box.width);
+    return left < right;
+}
+bool reach_make_timeline(ReachTimeline& tl, const SimParams& p)
+{
+    SimBox boxes[reach_max_flap_age + 1];
+    SimWorld probe;
+    sim_reset(probe, 0);
+    probe.bird_y = 0.f;
+    tl.vel[0] = 0.f;
+    for (int k = 1; k <= reach_max_flap_age; ++k)
+    {
+        tl.vel[k] = k == 1 ? p.flap_strength + p.gravity : tl.vel[k - 1] + p.gravity;
+        probe.bird_rotation = min_f(tl.vel[k] * 4.f, 90.f);
+        boxes[k] = get_bird_hit_box(probe, p);
+        tl.top_off[k] = boxes[k].top;
+        tl.box_h[k] = boxes[k].height;
+    }
+    float prev_x = width;
+    float next_x = 0.f;
+    bool next_spawned = false;
+    tl.prev_overlap.assign(reach_max_ticks, 0);
+    tl.next_overlap.assign(reach_max_ticks, 0);
+    int first_prev = -1;
+    int last_next = -1;
+    for (int t = 0; t < reach_max_ticks; ++t)
+    {
+        if (!next_spawned && t > 0 && prev_x <= width - p.pipe_interval)
+        {
+            next_spawned = true;
+            next_x = width;
+            tl.spacing_ticks = t;
+        }
+        prev_x += p.pipe_speed;
+        next_x += p.pipe_speed;
+        for (int k = 1; k <= reach_max_flap_age; ++k)
+        {
+            tl.prev_overlap[t] |= reach_horizontal_overlap(boxes[k], prev_x, p) ? 1 : 0;
+            tl.next_overlap[t] |= next_spawned && reach_horizontal_overlap(boxes[k], next_x, p) ? 1 : 0;
+        }
+        if (first_prev < 0 && tl.prev_overlap[t])
+        {
+            first_prev = t;
+        }
+        if (tl.next_overlap[t])
+        {
+            last_next = t;
+        }
+        else if (last_next >= 0)
+        {
+            break;
+        }
+    }
+    if (first_prev < 1 || last_next < 0)
+    {
+        return false;
+    }
+    tl.start = first_prev - 1;
+    tl.end = last_next;
+    return true;
+}
+bool reach_build(ReachTable& table, const SimParams& p)
+{
+    ReachTimeline tl;
+    if (!reach_make_timeline(tl, p))
+    {
+        return false;
+    }
+    int first_gap = min_gap_y;
+    int last_gap = get_max_gap_y(p);
+    int gap_count = last_gap - first_gap + 1;
+    if (gap_count < 1)
+    {
+        return false;
+    }
+    int span = gap_count - 1;
+    float r_lo = -(float)span - 2.f * p.bird_h;
+    float r_hi = (float)(span + p.pipe_gap) + 2.f * p.bird_h;
+    int bins = (int)((r_hi - r_lo) * reach_bins_per_px) + 1;
+    int cells = bins * (reach_max_flap_age + 1);
+    vector<ReachState> states[2] = { vector<ReachState>(cells), vector<ReachState>(cells) };
+    vector<int> stamp(cells, -1);
+    vector<int> live[2];
+    live[0].reserve(cells);
+    live[1].reserve(cells);
+    for (int r = 0; r <= p.pipe_gap; ++r)
+    {
+        for (int k = 1; k <= reach_max_flap_age; ++k)
+        {
+            int cell = k * bins + (int)((r - r_lo) * reach_bins_per_px);
+            ReachState& s = states[0][cell];
+            s.r = (float)r;
+            s.lo = -1e9f;
+            s.hi = 1e9f;
+            s.min_top = 1e9f;
+            s.max_bottom = -1e9f;
+            stamp[cell] = tl.start;
+            live[0].push_back(cell);
+        }
+    }
+    int cur = 0;
+    float gap = (float)p.pipe_gap;
+    for (int t = tl.start + 1; t <= tl.end; ++t)
+    {
+        int nxt = 1 - cur;
+        live[nxt].clear();
+        for (int cell : live[cur])
+        {
+            const ReachState s = states[cur][cell];
+            int k = cell / bins;
+            for (int flap = 0; flap < 2; ++flap)
+            {
+                int nk = flap ? 1 : k + 1;
+                if (nk > reach_max_flap_age)
+                {
+                    continue;
+                }
+                ReachState n;
+                n.r = s.r + tl.vel[nk];
+                if (n.r < r_lo || n.r >= r_hi)
+                {
+                    continue;
+                }
+                float top = n.r + tl.top_off[nk];
+                float bottom = top + tl.box_h[nk];
+                if (tl.prev_overlap[t] && (top < reach_margin || bottom > gap - reach_margin))
+                {
+                    continue;
+                }
+                n.lo = s.lo;
+                n.hi = s.hi;
+                if (tl.next_overlap[t])
+                {
+                    n.hi = min_f(n.hi, top - reach_margin);
+                    n.lo = n.lo > bottom - gap + reach_margin ? n.lo : bottom - gap + reach_margin;
+                    if (n.lo > n.hi || n.hi < -span || n.lo > span)
+                    {
+                        continue;
+                    }
+                }
+                n.min_top = min_f(s.min_top, top);
+                n.max_bottom = s.max_bottom > bottom ? s.max_bottom : bottom;
+                if (-n.min_top + reach_margin > last_gap || height - n.max_bottom - reach_margin < first_gap
+                    || -n.min_top + reach_margin > height - n.max_bottom - reach_margin)
+                {
+                    continue;
+                }
+                int ncell = nk * bins + (int)((n.r - r_lo) * reach_bins_per_px);
+                if (stamp[ncell] != t)
+                {
+                    stamp[ncell] = t;
+                    states[nxt][ncell] = n;
+                    live[nxt].push_back(ncell);
+                    continue;
+                }
+                ReachState& old = states[nxt][ncell];
+                float width_new = min_f(n.hi - n.lo, 2.f * span + 1.f);
+                float width_old = min_f(old.hi - old.lo, 2.f * span + 1.f);
+                if (width_new > width_old || (width_new == width_old && n.min_top - n.max_bottom > old.min_top - old.max_bottom))
+                {
+                    old = n;
+                }
+            }
+        }
+        cur = nxt;
+    }
+    int dy_count = 2 * span + 1;
+    vector<int> area((size_t)(gap_count + 1) * (dy_count + 1), 0);
+    for (int cell : live[cur])
+    {
+        const ReachState& s = states[cur][cell];
+        int g0 = (int)ceil(-s.min_top + reach_margin);
+        int g1 = (int)floor(height - s.max_bottom - reach_margin);
+        int d0 = (int)ceil(s.lo);
+        int d1 = (int)floor(s.hi);
+        g0 = g0 < first_gap ? 0 : g0 - first_gap;
+        g1 = g1 > last_gap ? span : g1 - first_gap;
+        d0 = d0 < -span ? 0 : d0 + span;
+        d1 = d1 > span ? dy_count - 1 : d1 + span;
+        if (g0 > g1 || d0 > d1)
+        {
+            continue;
+        }
+        ++area[(size_t)g0 * (dy_count + 1) + d0];
+        --area[(size_t)g0 * (dy_count + 1) + d1 + 1];
+        --area[(size_t)(g1 + 1) * (dy_count + 1) + d0];
+        ++area[(size_t)(g1 + 1) * (dy_count + 1) + d1 + 1];
+    }
+    for (int g = 0; g <= gap_count; ++g)
+    {
+        for (int d = 0; d <= dy_count; ++d)
+        {
+            int& a = area[(size_t)g * (dy_count + 1) + d];
+            if (g > 0)
+            {
+                a += area[(size_t)(g - 1) * (dy_count + 1) + d];
+            }
+            if (d > 0)
+            {
+                a += area[(size_t)g * (dy_count + 1) + d - 1];
+            }
+            if (g > 0 && d > 0)
+            {
+                a -= area[(size_t)(g - 1) * (dy_count + 1) + d - 1];
+            }
+        }
+    }
+    table.first_gap = first_gap;
+    table.gap_count = gap_count;
+    table.spacing_ticks = tl.spacing_ticks;
+    table.row_start.assign(gap_count + 1, 0);
+    table.next_gaps.clear();
+    for (int g = 0; g < gap_count; ++g)
+    {
+        table.row_start[g] = (int)table.next_gaps.size();
+        for (int n = 0; n < gap_count; ++n)
+        {
+            if (area[(size_t)g * (dy_count + 1) + n - g + span] > 0)
+            {
+                table.next_gaps.push_back((unsigned short)(first_gap + n));
+            }
+        }
+    }
+    table.row_start[gap_count] = (int)table.next_gaps.size();
+    table.reachable_pairs = (int)table.next_gaps.size();
+    return true;
+}
+unsigned long long reach_mix(unsigned long long h, const void* data, size_t bytes)
+{
+    const unsigned char* c = (const unsigned char*)data;
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        h = (h ^ c[i]) * 0x100000001b3ull;
+    }
+    return h;
+}
+unsigned long long reach_mix_words(unsigned long long h, const unsigned long long* words, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        h = (h ^ words[i]) * 0x100000001b3ull;
+        h ^= h >> 29;
+    }
+    return h;
+}
+unsigned long long reach_key(const SimParams& p)
+{
+    float physics[6] = { p.gravity, p.flap_strength, p.pipe_speed, p.bird_w, p.bird_h, p.pipe_w };
+    int spacing[2] = { p.pipe_gap, p.pipe_interval };
+    unsigned long long h = 0xcbf29ce484222325ull;
+    h = reach_mix(h, physics, sizeof(physics));
+    h = reach_mix(h, spacing, sizeof(spacing));
+    if (p.masks == nullptr)
+    {
+        return h;
+    }
+    for (int s = 0; s < 2; ++s)
+    {
+        for (int ph = 0; ph < mask_phases; ++ph)
+        {
+            for (int a = 0; a < mask_angle_count; ++a)
+            {
+                const BirdMask& m = p.masks->bird[s][ph][a];
+                int bounds[4] = { m.top, m.bottom, m.left, m.right };
+                h = reach_mix(h, bounds, sizeof(bounds));
+                h = reach_mix_words(h, m.rows, mask_size);
+            }
+            const PipeMask& m = p.masks->pipe[s][ph];
+            int shape[2] = { m.cols, m.tex_h };
+            h = reach_mix(h, shape, sizeof(shape));
+            h = reach_mix_words(h, m.rows.data(), m.rows.size());
+        }
+    }
+    return h;
+}
+void reach_attach(ReachTable& table, SimParams& p)
+{
+    p.reach = nullptr;
+    if (p.difficulty != EASY)
+    {
+        return;
+    }
+    unsigned long long key = reach_key(p);
+    if (!table.built || table.key != key)
+    {
+        table.key = key;
+        table.built = reach_build(table, p);
+    }
+    if (table.built)
+    {
+        p.reach = &table;
+    }
+}
+bool reach_is_reachable(const ReachTable& table, int prev_gap, int next_gap)
+{
+    int row = prev_gap - table.first_gap;
+    if (row < 0 || row >= table.gap_count)
+    {
+        return true;
+    }
+    int lo = table.row_start[row];
+    int hi = table.row_start[row + 1];
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (table.next_gaps[mid] < next_gap)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo < table.row_start[row + 1] && table.next_gaps[lo] == next_gap;
+}
+int reach_pick_gap(const ReachTable& table, int prev_gap, unsigned int r)
+{
+    int row = prev_gap - table.first_gap;
+    if (row < 0 || row >= table.gap_count)
+    {
+        return -1;
+    }
+    int count = table.row_start[row + 1] - table.row_start[row];
+    if (count == 0)
+    {
+        return -1;
+    }
+    return table.next_gaps[table.row_start[row] + r % count];
+}
+struct ReachTrace
+{
+    float y;
+    int lo;
+    int hi;
+};
+bool reach_next_window(SimWorld& w, const SimParams& p, bool next_spawned, int& lo, int& hi)
+{
+    if (!next_spawned || w.pipes[w.pipe_count - 1].x > bird_x + p.bird_w + p.bird_h)
+    {
+        return check_collision(w, p) == HIT_NONE;
+    }
+    if (w.pipe_count > 1)
+    {
+        --w.pipe_count;
+        SimHit prev = check_collision(w, p);
+        ++w.pipe_count;
+        if (prev != HIT_NONE)
+        {
+            return false;
+        }
+    }
+    int& gap_y = w.pipes[w.pipe_count - 1].gap_y;
+    gap_y = lo;
+    SimHit low = check_collision(w, p);
+    if (lo == hi)
+    {
+        return low == HIT_NONE;
+    }
+    if (low == HIT_BOTTOM_PIPE)
+    {
+        int a = lo + 1;
+        int b = hi + 1;
+        while (a < b)
+        {
+            gap_y = (a + b) / 2;
+            if (check_collision(w, p) == HIT_BOTTOM_PIPE)
+            {
+                a = gap_y + 1;
+            }
+            else
+            {
+                b = gap_y;
+            }
+        }
+        lo = a;
+        if (lo > hi)
+        {
+            return false;
+        }
+        gap_y = lo;
+        low = check_collision(w, p);
+    }
+    if (low != HIT_NONE)
+    {
+        return false;
+    }
+    gap_y = hi;
+    if (check_collision(w, p) == HIT_TOP_PIPE)
+    {
+        int a = lo;
+        int b = hi - 1;
+        while (a < b)
+        {
+            gap_y = (a + b + 1) / 2;
+            if (check_collision(w, p) == HIT_TOP_PIPE)
+            {
+                b = gap_y - 1;
+            }
+            else
+            {
+                a = gap_y;
+            }
+        }
+        hi = a;
+    }
+    return true;
+}
+bool reach_simulate_window(const SimParams& p, const ReachTimeline& tl, int prev_gap, int first_next, int last_next, float bins_per_px, vector<unsigned char>& passable)
+{
+    const float y_lo = -p.bird_h;
+    const float y_hi = height + p.bird_h;
+    int bins = (int)((y_hi - y_lo) * bins_per_px) + 1;
+    int cells = bins * (reach_max_flap_age + 1);
+    vector<ReachTrace> traces[2] = { vector<ReachTrace>(cells), vector<ReachTrace>(cells) };
+    vector<int> stamp(cells, -1);
+    vector<int> live[2];
+    SimWorld w;
+    sim_reset(w, 0);
+    w.pipes[0].x = width;
+    w.pipes[0].gap_y = prev_gap;
+    w.pipe_count = 1;
+    bool next_spawned = false;
+    int cur = 0;
+    for (int t = 0; t <= tl.end; ++t)
+    {
+        if (!next_spawned && t > 0 && w.pipes[w.pipe_count - 1].x <= width - p.pipe_interval)
+        {
+            next_spawned = true;
+            w.pipes[w.pipe_count].x = width;
+            w.pipes[w.pipe_count].gap_y = first_next;
+            w.pipes[w.pipe_count].scored = 0;
+            ++w.pipe_count;
+        }
+        move_pipes(w, p);
+        remove_old_pipes(w, p);
+        if (t == tl.start)
+        {
+            for (int r = 0; r <= p.pipe_gap; ++r)
+            {
+                for (int k = 1; k <= reach_max_flap_age; ++k)
+                {
+                    int cell = k * bins + (int)((prev_gap + r - y_lo) * bins_per_px);
+                    traces[0][cell] = { (float)(prev_gap + r), first_next, last_next };
+                    stamp[cell] = t;
+                    live[0].push_back(cell);
+                }
+            }
+        }
+        if (t <= tl.start)
+        {
+            continue;
+        }
+        int nxt = 1 - cur;
+        live[nxt].clear();
+        for (int cell : live[cur])
+        {
+            const ReachTrace s = traces[cur][cell];
+            int k = cell / bins;
+            for (int flap = 0; flap < 2; ++flap)
+            {
+                int nk = flap ? 1 : k + 1;
+                if (nk > reach_max_flap_age)
+                {
+                    continue;
+                }
+                w.bird_y = s.y;
+                w.bird_vel = tl.vel[k];
+                if (flap)
+                {
+                    flap_bird(w, p);
+                }
+                update_bird(w, p);
+                int lo = s.lo;
+                int hi = s.hi;
+                if (w.bird_y < y_lo || w.bird_y >= y_hi || !reach_next_window(w, p, next_spawned, lo, hi))
+                {
+                    continue;
+                }
+                int ncell = nk * bins + (int)((w.bird_y - y_lo) * bins_per_px);
+                if (stamp[ncell] != t)
+                {
+                    stamp[ncell] = t;
+                    traces[nxt][ncell] = { w.bird_y, lo, hi };
+                    live[nxt].push_back(ncell);
+                }
+                else if (hi - lo > traces[nxt][ncell].hi - traces[nxt][ncell].lo)
+                {
+                    traces[nxt][ncell] = { w.bird_y, lo, hi };
+                }
+            }
+        }
+        cur = nxt;
+        if (live[cur].empty())
+        {
+            return false;
+        }
+    }
+    for (int cell : live[cur])
+    {
+        for (int g = traces[cur][cell].lo; g <= traces[cur][cell].hi; ++g)
+        {
+            passable[g - min_gap_y] = 1;
+        }
+    }
+    return true;
+}
+bool reach_simulate_row(const SimParams& p, int prev_gap, vector<unsigned char>& passable)
+{
+    int last_gap = get_max_gap_y(p);
+    passable.assign(last_gap >= min_gap_y ? last_gap - min_gap_y + 1 : 0, 0);
+    ReachTimeline tl;
+    if (passable.empty() || !reach_make_timeline(tl, p))
+    {
+        return false;
+    }
+    if (p.masks == nullptr)
+    {
+        return reach_simulate_window(p, tl, prev_gap, min_gap_y, last_gap, 2.f, passable);
+    }
+    bool any = false;
+    for (int g = min_gap_y; g <= last_gap; ++g)
+    {
+        any |= reach_simulate_window(p, tl, prev_gap, g, g, 2.f, passable);
+    }
+    return any;
+}
+bool reach_simulate_pair(const SimParams& p, int prev_gap, int next_gap)
+{
+    int last_gap = get_max_gap_y(p);
+    ReachTimeline tl;
+    if (next_gap < min_gap_y || next_gap > last_gap || !reach_make_timeline(tl, p))
+    {
+        return false;
+    }
+    vector<unsigned char> passable(last_gap - min_gap_y + 1, 0);
+    return reach_simulate_window(p, tl, prev_gap, next_gap, next_gap, 8.f, passable);
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+#include "simulation.h"
+const int reach_max_flap_age = 96;
+struct ReachTable
+{
+    int first_gap = 0;
+    int gap_count = 0;
+    int spacing_ticks = 0;
+    int reachable_pairs = 0;
+    bool built = false;
+    unsigned long long key = 0;
+    std::vector<int> row_start;
+    std::vector<unsigned short> next_gaps;
+};
+bool reach_build(ReachTable& table, const SimParams& p);
+unsigned long long reach_key(const SimParams& p);
+void reach_attach(ReachTable& table, SimParams& p);
+bool reach_is_reachable(const ReachTable& table, int prev_gap, int next_gap);
+int reach_pick_gap(const ReachTable& table, int prev_gap, unsigned int r);
+bool reach_simulate_row(const SimParams& p, int prev_gap, std::vector<unsigned char>& passable);
+bool reach_simulate_pair(const SimParams& p, int prev_gap, int next_gap);
@@ -0,0 +1,91 @@
+#include "renderqueue.h"
+#include <algorithm>
+using namespace std;
+unsigned long long queue_key(RenderQueue& q, int layer, int material)
+{
+    layer = layer < 0 ? 0 : (layer >= queue_max_layers ? queue_max_layers - 1 : layer);
+    material = material < 0 ? 0 : (material > queue_max_materials ? queue_max_materials : material);
+    return ((unsigned long long)layer << 56) | ((unsigned long long)material << 40) | q.sequence++;
+}
+bool queue_key_before(const QueueCommand& a, const QueueCommand& b)
+{
+    return a.key < b.key;
+}
+void queue_count_immediate(RenderQueue& q, int material, int calls)
+{
+    q.frame.immediate_calls += calls;
+    if (material != q.last_material)
+    {
+        ++q.frame.immediate_changes;
+        q.last_material = material;
+    }
+}
+void queue_reserve(RenderQueue& q, int commands)
+{
+    q.commands.reserve(commands);
+    q.batches.reserve(commands);
+}
+void queue_begin(RenderQueue& q)
+{
+    q.commands.clear();
+    q.batches.clear();
+    q.sequence = 0;
+    q.last_material = -1;
+    q.frame = RenderQueueStats();
+    q.frame.frames = 1;
+}
+void queue_vertices(RenderQueue& q, int layer, int material, int first, int count)
+{
+    if (count <= 0)
+    {
+        return;
+    }
+    QueueCommand c = { queue_key(q, layer, material), material, first, count, -1, 1 };
+    q.commands.push_back(c);
+    queue_count_immediate(q, material, 1);
+}
+void queue_drawable(RenderQueue& q, int layer, int material, int drawable, int calls)
+{
+    QueueCommand c = { queue_key(q, layer, material), material, 0, 0, drawable, calls };
+    q.commands.push_back(c);
+    queue_count_immediate(q, material, calls);
+}
+void queue_finish(RenderQueue& q)
+{
+    sort(q.commands.begin(), q.commands.end(), queue_key_before);
+    int last_material = -1;
+    for (int i = 0; i < (int)q.commands.size(); ++i)
+    {
+        const QueueCommand& c = q.commands[i];
+        if (c.drawable < 0 && !q.batches.empty())
+        {
+            QueueBatch& b = q.batches.back();
+            if (b.drawable < 0 && b.material == c.material)
+            {
+                const QueueCommand& prev = q.commands[i - 1];
+                b.contiguous = b.contiguous && prev.first + prev.count == c.first;
+                ++b.command_count;
+                b.vertex_count += c.count;
+                continue;
+            }
+        }
+        QueueBatch b = { c.material, i, 1, c.count, c.drawable, true };
+        q.batches.push_back(b);
+        q.frame.batched_calls += c.calls;
+        if (c.material != last_material)
+        {
+            ++q.frame.batched_changes;
+            last_material = c.material;
+        }
+    }
+    q.frame.commands = (long long)q.commands.size();
+}
+void queue_add_stats(RenderQueueStats& total, const RenderQueueStats& frame)
+{
+    total.frames += frame.frames;
+    total.commands += frame.commands;
+    total.immediate_calls += frame.immediate_calls;
+    total.immediate_changes += frame.immediate_changes;
+    total.batched_calls += frame.batched_calls;
+    total.batched_changes += frame.batched_changes;
+}
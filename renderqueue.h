@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+const int queue_untextured = 0;
+const int queue_max_layers = 256;
+const int queue_max_materials = 65535;
+struct QueueCommand
+{
+    unsigned long long key;
+    int material;
+    int first;
+    int count;
+    int drawable;
+    int calls;
+};
+struct QueueBatch
+{
+    int material;
+    int first_command;
+    int command_count;
+    int vertex_count;
+    int drawable;
+    bool contiguous;
+};
+struct RenderQueueStats
+{
+    long long frames = 0;
+    long long commands = 0;
+    long long immediate_calls = 0;
+    long long immediate_changes = 0;
+    long long batched_calls = 0;
+    long long batched_changes = 0;
+};
+struct RenderQueue
+{
+    std::vector<QueueCommand> commands;
+    std::vector<QueueBatch> batches;
+    unsigned int sequence = 0;
+    int last_material = -1;
+    RenderQueueStats frame;
+};
+void queue_reserve(RenderQueue& q, int commands);
+void queue_begin(RenderQueue& q);
+void queue_vertices(RenderQueue& q, int layer, int material, int first, int count);
+void queue_drawable(RenderQueue& q, int layer, int material, int drawable, int calls);
+void queue_finish(RenderQueue& q);
+void queue_add_stats(RenderQueueStats& total, const RenderQueueStats& frame);
@@ -0,0 +1,134 @@
+#include "replay.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+using namespace std;
+const char replay_magic[4] = { 'F', 'B', 'R', 'P' };
+const int replay_version = 4;
+void replay_begin(Replay& r, Difficulty d, unsigned int seed, bool pixel_collision, bool fixed_point, const ObstacleProgram* pattern)
+{
+    r.difficulty = d;
+    r.seed = seed;
+    r.pixel_collision = pixel_collision ? 1 : 0;
+    r.fixed_point = fixed_point ? 1 : 0;
+    r.pattern.clear();
+    if (pattern != nullptr)
+    {
+        r.pattern.assign(pattern->code, pattern->code + pattern->length);
+    }
+    r.score = 0;
+    r.ticks = 0;
+    r.flap_ticks.clear();
+    r.flap_ticks.reserve(16384);
+}
+void replay_truncate(Replay& r, int tick)
+{
+    while (!r.flap_ticks.empty() && r.flap_ticks.back() >= tick)
+    {
+        r.flap_ticks.pop_back();
+    }
+}
+void replay_put(vector<unsigned char>& out, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    out.insert(out.end(), bytes, bytes + size);
+}
+void replay_encode(const Replay& r, vector<unsigned char>& out)
+{
+    int count = (int)r.flap_ticks.size();
+    int pattern_length = (int)r.pattern.size();
+    replay_put(out, replay_magic, 4);
+    replay_put(out, &replay_version, 4);
+    replay_put(out, &r.difficulty, 4);
+    replay_put(out, &r.seed, 4);
+    replay_put(out, &r.score, 4);
+    replay_put(out, &r.ticks, 4);
+    replay_put(out, &r.pixel_collision, 4);
+    replay_put(out, &r.fixed_point, 4);
+    replay_put(out, &pattern_length, 4);
+    replay_put(out, r.pattern.data(), pattern_length);
+    replay_put(out, &count, 4);
+    replay_put(out, r.flap_ticks.data(), 4 * (size_t)count);
+}
+bool replay_get(const unsigned char*& in, const unsigned char* end, void* data, size_t size)
+{
+    if ((size_t)(end - in) < size)
+    {
+        return false;
+    }
+    if (size > 0)
+    {
+        memcpy(data, in, size);
+    }
+    in += size;
+    return true;
+}
+bool replay_decode(Replay& r, const unsigned char* data, size_t size)
+{
+    const unsigned char* in = data;
+    const unsigned char* end = data + size;
+    char magic[4];
+    int version = 0;
+    int count = 0;
+    if (!replay_get(in, end, magic, 4) || !replay_get(in, end, &version, 4) || magic[0] != 'F' || magic[1] != 'B' || magic[2] != 'R' || magic[3] != 'P' ||
+        version < 1 || version > replay_version)
+    {
+        return false;
+    }
+    if (!replay_get(in, end, &r.difficulty, 4) || !replay_get(in, end, &r.seed, 4) || !replay_get(in, end, &r.score, 4) || !replay_get(in, end, &r.ticks, 4))
+    {
+        return false;
+    }
+    r.pixel_collision = 0;
+    if (version >= 2 && !replay_get(in, end, &r.pixel_collision, 4))
+    {
+        return false;
+    }
+    r.fixed_point = 0;
+    if (version >= 4 && !replay_get(in, end, &r.fixed_point, 4))
+    {
+        return false;
+    }
+    int pattern_length = 0;
+    if (version >= 3 && !replay_get(in, end, &pattern_length, 4))
+    {
+        return false;
+    }
+    if (pattern_length < 0 || pattern_length > pattern_max_code)
+    {
+        return false;
+    }
+    r.pattern.resize(pattern_length);
+    if (!replay_get(in, end, r.pattern.data(), pattern_length) || !replay_get(in, end, &count, 4))
+    {
+        return false;
+    }
+    if (count < 0 || (size_t)count > (size_t)(end - in) / 4 || r.ticks < 0 || (r.difficulty != EASY && r.difficulty != HARD))
+    {
+        return false;
+    }
+    r.flap_ticks.resize(count);
+    return replay_get(in, end, r.flap_ticks.data(), 4 * (size_t)count);
+}
+bool save_replay(const Replay& r, const char* path)
+{
+    ofstream out(path, ios::binary);
+    if (!out.is_open())
+    {
+        return false;
+    }
+    vector<unsigned char> bytes;
+    replay_encode(r, bytes);
+    out.write((const char*)bytes.data(), (streamsize)bytes.size());
+    return out.good();
+}
+bool load_replay(Replay& r, const char* path)
+{
+    ifstream in(path, ios::binary);
+    if (!in.is_open())
+    {
+        return false;
+    }
+    vector<unsigned char> bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    return replay_decode(r, bytes.data(), bytes.size());
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <vector>
+#include "simulation.h"
+#include "pattern.h"
+struct Replay
+{
+    int difficulty = EASY;
+    unsigned int seed = 0;
+    int score = 0;
+    int ticks = 0;
+    int pixel_collision = 0;
+    int fixed_point = 0;
+    std::vector<unsigned char> pattern;
+    std::vector<int> flap_ticks;
+};
+void replay_begin(Replay& r, Difficulty d, unsigned int seed, bool pixel_collision, bool fixed_point, const ObstacleProgram* pattern);
+void replay_truncate(Replay& r, int tick);
+void replay_encode(const Replay& r, std::vector<unsigned char>& out);
+bool replay_decode(Replay& r, const unsigned char* data, std::size_t size);
+bool save_replay(const Replay& r, const char* path);
+bool load_replay(Replay& r, const char* path);
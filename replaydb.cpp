@@ -0,0 +1,534 @@
+#include "replaydb.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace std;
+const char replaydb_magic[4] = { 'F', 'B', 'R', 'X' };
+const int replaydb_version = 1;
+const unsigned int replaydb_max_record = 1 << 26;
+const int replaydb_write_chunk = 4096;
+struct ReplayIndexHeader
+{
+    char magic[4];
+    int version;
+    long long count;
+    long long data_bytes;
+    long long reserved;
+};
+bool replaydb_seed_before(const ReplayKey& a, const ReplayKey& b)
+{
+    if (a.difficulty != b.difficulty)
+    {
+        return a.difficulty < b.difficulty;
+    }
+    if (a.seed != b.seed)
+    {
+        return a.seed < b.seed;
+    }
+    if (a.score != b.score)
+    {
+        return a.score > b.score;
+    }
+    if (a.timestamp != b.timestamp)
+    {
+        return a.timestamp < b.timestamp;
+    }
+    return a.offset < b.offset;
+}
+bool replaydb_score_before(const ReplayKey& a, const ReplayKey& b)
+{
+    if (a.difficulty != b.difficulty)
+    {
+        return a.difficulty < b.difficulty;
+    }
+    if (a.score != b.score)
+    {
+        return a.score > b.score;
+    }
+    if (a.timestamp != b.timestamp)
+    {
+        return a.timestamp < b.timestamp;
+    }
+    return a.offset < b.offset;
+}
+const ReplayKey* replaydb_by_seed(const ReplayDb& db)
+{
+    return (const ReplayKey*)(db.index_data + sizeof(ReplayIndexHeader));
+}
+const ReplayKey* replaydb_by_score(const ReplayDb& db)
+{
+    return replaydb_by_seed(db) + db.indexed;
+}
+void replaydb_unmap(ReplayDb& db)
+{
+#ifdef _WIN32
+    if (db.index_data != nullptr)
+    {
+        UnmapViewOfFile(db.index_data);
+    }
+    if (db.index_mapping != nullptr)
+    {
+        CloseHandle((HANDLE)db.index_mapping);
+    }
+    if (db.index_file != nullptr)
+    {
+        CloseHandle((HANDLE)db.index_file);
+    }
+#else
+    if (db.index_data != nullptr)
+    {
+        munmap((void*)db.index_data, db.index_size);
+    }
+#endif
+    db.index_data = nullptr;
+    db.index_size = 0;
+    db.index_file = nullptr;
+    db.index_mapping = nullptr;
+    db.indexed = 0;
+    db.indexed_bytes = 0;
+}
+void replaydb_adopt(ReplayDb& db, ReplayDb& from)
+{
+    db.index_data = from.index_data;
+    db.index_size = from.index_size;
+    db.index_file = from.index_file;
+    db.index_mapping = from.index_mapping;
+    db.indexed = from.indexed;
+    db.indexed_bytes = from.indexed_bytes;
+    from.index_data = nullptr;
+    from.index_size = 0;
+    from.index_file = nullptr;
+    from.index_mapping = nullptr;
+    from.indexed = 0;
+    from.indexed_bytes = 0;
+}
+bool replaydb_map(ReplayDb& db)
+{
+    replaydb_unmap(db);
+#ifdef _WIN32
+    HANDLE file = CreateFileA(db.index_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    db.index_file = file;
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    db.index_size = (size_t)size.QuadPart;
+    if (db.index_size < sizeof(ReplayIndexHeader))
+    {
+        replaydb_unmap(db);
+        return false;
+    }
+    db.index_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (db.index_mapping == nullptr)
+    {
+        replaydb_unmap(db);
+        return false;
+    }
+    db.index_data = (const unsigned char*)MapViewOfFile((HANDLE)db.index_mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    int fd = open(db.index_path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ReplayIndexHeader))
+    {
+        close(fd);
+        return false;
+    }
+    void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    madvise(data, (size_t)st.st_size, MADV_RANDOM);
+    db.index_data = (const unsigned char*)data;
+    db.index_size = (size_t)st.st_size;
+#endif
+    if (db.index_data == nullptr)
+    {
+        replaydb_unmap(db);
+        return false;
+    }
+    ReplayIndexHeader header;
+    memcpy(&header, db.index_data, sizeof(header));
+    if (memcmp(header.magic, replaydb_magic, 4) != 0 || header.version != replaydb_version || header.count < 0 ||
+        db.index_size != sizeof(header) + 2 * (size_t)header.count * sizeof(ReplayKey))
+    {
+        replaydb_unmap(db);
+        return false;
+    }
+    db.indexed = header.count;
+    db.indexed_bytes = header.data_bytes;
+    return true;
+}
+bool replaydb_parse_key(const unsigned char* record, unsigned int length, long long offset, ReplayKey& key)
+{
+    if (length < 32 || record[8] != 'F' || record[9] != 'B' || record[10] != 'R' || record[11] != 'P')
+    {
+        return false;
+    }
+    memcpy(&key.timestamp, record, 8);
+    memcpy(&key.difficulty, record + 16, 4);
+    memcpy(&key.seed, record + 20, 4);
+    memcpy(&key.score, record + 24, 4);
+    memcpy(&key.ticks, record + 28, 4);
+    key.offset = offset;
+    return true;
+}
+bool replaydb_open(ReplayDb& db, const char* path)
+{
+    replaydb_close(db);
+    db.data_path = path;
+    db.index_path = db.data_path + ".idx";
+    replaydb_map(db);
+    long long good = 0;
+    ifstream in(path, ios::binary);
+    if (in.is_open())
+    {
+        in.seekg(0, ios::end);
+        long long size = (long long)in.tellg();
+        if (size < db.indexed_bytes)
+        {
+            replaydb_unmap(db);
+        }
+        good = db.indexed_bytes;
+        in.seekg(good);
+        vector<unsigned char> bytes;
+        unsigned int length = 0;
+        while (in.read((char*)&length, 4) && length <= replaydb_max_record)
+        {
+            bytes.resize(length);
+            ReplayKey key;
+            if (!in.read((char*)bytes.data(), length) || !replaydb_parse_key(bytes.data(), length, good, key))
+            {
+                break;
+            }
+            db.pending.push_back(key);
+            good += 4 + (long long)length;
+        }
+        in.close();
+        if (good < size)
+        {
+            error_code ec;
+            filesystem::resize_file(path, (uintmax_t)good, ec);
+        }
+    }
+    else
+    {
+        replaydb_unmap(db);
+    }
+    db.data_bytes = good;
+    db.data.open(path, ios::binary | ios::app);
+    if (!db.data.is_open())
+    {
+        replaydb_close(db);
+        return false;
+    }
+    if (db.pending.size() >= (size_t)replaydb_compact_threshold)
+    {
+        replaydb_compact(db, false);
+    }
+    return true;
+}
+void replaydb_close(ReplayDb& db)
+{
+    if (db.compactor.joinable())
+    {
+        db.compactor.join();
+    }
+    lock_guard<mutex> guard(db.lock);
+    replaydb_unmap(db);
+    if (db.data.is_open())
+    {
+        db.data.close();
+    }
+    db.data_bytes = 0;
+    db.pending.clear();
+    db.compacting_keys.clear();
+}
+bool replaydb_append(ReplayDb& db, const Replay& r, long long timestamp)
+{
+    bool compact = false;
+    {
+        lock_guard<mutex> guard(db.lock);
+        if (!db.data.is_open())
+        {
+            return false;
+        }
+        db.record.assign(12, 0);
+        memcpy(&db.record[4], &timestamp, 8);
+        replay_encode(r, db.record);
+        unsigned int length = (unsigned int)(db.record.size() - 4);
+        memcpy(db.record.data(), &length, 4);
+        db.data.write((const char*)db.record.data(), (streamsize)db.record.size());
+        db.data.flush();
+        if (!db.data)
+        {
+            return false;
+        }
+        db.pending.push_back(ReplayKey{ r.difficulty, r.seed, r.score, r.ticks, timestamp, db.data_bytes });
+        db.data_bytes += (long long)db.record.size();
+        compact = db.pending.size() >= (size_t)replaydb_compact_threshold && !db.compacting;
+    }
+    if (compact)
+    {
+        replaydb_compact(db, false);
+    }
+    return true;
+}
+bool replaydb_best(ReplayDb& db, int difficulty, unsigned int seed, ReplayKey& out)
+{
+    lock_guard<mutex> guard(db.lock);
+    bool found = false;
+    const ReplayKey* first = replaydb_by_seed(db);
+    const ReplayKey* last = first + db.indexed;
+    ReplayKey probe = { difficulty, seed, INT_MAX, 0, LLONG_MIN, LLONG_MIN };
+    const ReplayKey* it = db.indexed > 0 ? lower_bound(first, last, probe, replaydb_seed_before) : last;
+    if (it != last && it->difficulty == difficulty && it->seed == seed)
+    {
+        out = *it;
+        found = true;
+    }
+    for (const vector<ReplayKey>* keys : { &db.compacting_keys, &db.pending })
+    {
+        for (const ReplayKey& key : *keys)
+        {
+            if (key.difficulty == difficulty && key.seed == seed && (!found || replaydb_seed_before(key, out)))
+            {
+                out = key;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+int replaydb_range(ReplayDb& db, int difficulty, unsigned int seed, int min_score, int max_score, long long from, long long to, vector<ReplayKey>& out)
+{
+    out.clear();
+    lock_guard<mutex> guard(db.lock);
+    const ReplayKey* first = replaydb_by_seed(db);
+    const ReplayKey* last = first + db.indexed;
+    ReplayKey probe = { difficulty, seed, max_score, 0, LLONG_MIN, LLONG_MIN };
+    const ReplayKey* it = db.indexed > 0 ? lower_bound(first, last, probe, replaydb_seed_before) : last;
+    for (; it != last && it->difficulty == difficulty && it->seed == seed && it->score >= min_score; ++it)
+    {
+        if (it->timestamp >= from && it->timestamp < to)
+        {
+            out.push_back(*it);
+        }
+    }
+    size_t indexed = out.size();
+    for (const vector<ReplayKey>* keys : { &db.compacting_keys, &db.pending })
+    {
+        for (const ReplayKey& key : *keys)
+        {
+            if (key.difficulty == difficulty && key.seed == seed && key.score >= min_score && key.score <= max_score && key.timestamp >= from && key.timestamp < to)
+            {
+                out.push_back(key);
+            }
+        }
+    }
+    if (out.size() > indexed)
+    {
+        sort(out.begin() + indexed, out.end(), replaydb_seed_before);
+        inplace_merge(out.begin(), out.begin() + indexed, out.end(), replaydb_seed_before);
+    }
+    return (int)out.size();
+}
+int replaydb_top(ReplayDb& db, int difficulty, long long from, long long to, int k, vector<ReplayKey>& out)
+{
+    out.clear();
+    if (k <= 0)
+    {
+        return 0;
+    }
+    lock_guard<mutex> guard(db.lock);
+    const ReplayKey* first = replaydb_by_score(db);
+    const ReplayKey* last = first + db.indexed;
+    ReplayKey probe = { difficulty, 0, INT_MAX, 0, LLONG_MIN, LLONG_MIN };
+    const ReplayKey* it = db.indexed > 0 ? lower_bound(first, last, probe, replaydb_score_before) : last;
+    for (; it != last && it->difficulty == difficulty && (int)out.size() < k; ++it)
+    {
+        if (it->timestamp >= from && it->timestamp < to)
+        {
+            out.push_back(*it);
+        }
+    }
+    size_t indexed = out.size();
+    for (const vector<ReplayKey>* keys : { &db.compacting_keys, &db.pending })
+    {
+        for (const ReplayKey& key : *keys)
+        {
+            if (key.difficulty == difficulty && key.timestamp >= from && key.timestamp < to)
+            {
+                out.push_back(key);
+            }
+        }
+    }
+    if (out.size() > indexed)
+    {
+        sort(out.begin() + indexed, out.end(), replaydb_score_before);
+        inplace_merge(out.begin(), out.begin() + indexed, out.end(), replaydb_score_before);
+    }
+    if ((int)out.size() > k)
+    {
+        out.resize(k);
+    }
+    return (int)out.size();
+}
+bool replaydb_load(ReplayDb& db, const ReplayKey& key, Replay& r)
+{
+    ifstream in(db.data_path, ios::binary);
+    unsigned int length = 0;
+    if (!in.is_open() || !in.seekg(key.offset) || !in.read((char*)&length, 4) || length < 8 || length > replaydb_max_record)
+    {
+        return false;
+    }
+    vector<unsigned char> bytes(length);
+    if (!in.read((char*)bytes.data(), length))
+    {
+        return false;
+    }
+    return replay_decode(r, bytes.data() + 8, length - 8);
+}
+void replaydb_merge_write(ofstream& out, const ReplayKey* a, long long na, const ReplayKey* b, long long nb, bool (*before)(const ReplayKey&, const ReplayKey&))
+{
+    vector<ReplayKey> chunk;
+    chunk.reserve(replaydb_write_chunk);
+    long long i = 0;
+    long long j = 0;
+    while (i < na || j < nb)
+    {
+        bool take_b = j < nb && (i == na || before(b[j], a[i]));
+        chunk.push_back(take_b ? b[j++] : a[i++]);
+        if ((int)chunk.size() == replaydb_write_chunk || (i == na && j == nb))
+        {
+            out.write((const char*)chunk.data(), (streamsize)(chunk.size() * sizeof(ReplayKey)));
+            chunk.clear();
+        }
+    }
+}
+void replaydb_compact_worker(ReplayDb* db)
+{
+    auto start = chrono::steady_clock::now();
+    ReplayIndexHeader header;
+    {
+        lock_guard<mutex> guard(db->lock);
+        db->compacting_keys.swap(db->pending);
+        header.data_bytes = db->data_bytes;
+    }
+    vector<ReplayKey> fresh = db->compacting_keys;
+    memcpy(header.magic, replaydb_magic, 4);
+    header.version = replaydb_version;
+    header.count = db->indexed + (long long)fresh.size();
+    header.reserved = 0;
+    string tmp_path = db->index_path + ".tmp";
+    ofstream out(tmp_path, ios::binary | ios::trunc);
+    out.write((const char*)&header, sizeof(header));
+    sort(fresh.begin(), fresh.end(), replaydb_seed_before);
+    replaydb_merge_write(out, replaydb_by_seed(*db), db->indexed, fresh.data(), (long long)fresh.size(), replaydb_seed_before);
+    sort(fresh.begin(), fresh.end(), replaydb_score_before);
+    replaydb_merge_write(out, replaydb_by_score(*db), db->indexed, fresh.data(), (long long)fresh.size(), replaydb_score_before);
+    out.close();
+    ReplayDb staged;
+    staged.index_path = tmp_path;
+    bool written = !out.fail() && replaydb_map(staged) && staged.indexed == header.count;
+    error_code ec;
+#ifndef _WIN32
+    if (written)
+    {
+        filesystem::rename(tmp_path, db->index_path, ec);
+    }
+#endif
+    ReplayDb retired;
+    vector<ReplayKey> merged;
+    {
+        lock_guard<mutex> guard(db->lock);
+#ifdef _WIN32
+        if (written)
+        {
+            replaydb_unmap(*db);
+            filesystem::rename(tmp_path, db->index_path, ec);
+        }
+#endif
+        if (written && !ec)
+        {
+            replaydb_adopt(retired, *db);
+            replaydb_adopt(*db, staged);
+            merged.swap(db->compacting_keys);
+            ++db->compactions;
+            db->compact_seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        }
+        else if (db->index_data != nullptr || !written || replaydb_map(*db))
+        {
+            db->pending.insert(db->pending.begin(), db->compacting_keys.begin(), db->compacting_keys.end());
+            db->compacting_keys.clear();
+        }
+        else
+        {
+            vector<ReplayKey> requeue(replaydb_by_seed(staged), replaydb_by_seed(staged) + staged.indexed);
+            requeue.insert(requeue.end(), db->pending.begin(), db->pending.end());
+            db->pending.swap(requeue);
+            db->compacting_keys.clear();
+        }
+        db->compacting = false;
+    }
+    replaydb_unmap(retired);
+    replaydb_unmap(staged);
+    filesystem::remove(tmp_path, ec);
+}
+void replaydb_compact(ReplayDb& db, bool wait)
+{
+    bool start = false;
+    {
+        lock_guard<mutex> guard(db.lock);
+        start = !db.compacting && !db.pending.empty() && db.data.is_open();
+        db.compacting = db.compacting || start;
+    }
+    if (start)
+    {
+        if (db.compactor.joinable())
+        {
+            db.compactor.join();
+        }
+        db.compactor = thread(replaydb_compact_worker, &db);
+    }
+    if (wait && db.compactor.joinable())
+    {
+        db.compactor.join();
+        if (!start)
+        {
+            replaydb_compact(db, true);
+        }
+    }
+}
+ReplayDbStats replaydb_stats(ReplayDb& db)
+{
+    lock_guard<mutex> guard(db.lock);
+    ReplayDbStats s;
+    s.indexed = db.indexed;
+    s.pending = (long long)(db.pending.size() + db.compacting_keys.size());
+    s.runs = s.indexed + s.pending;
+    s.data_bytes = db.data_bytes;
+    s.index_bytes = (long long)db.index_size;
+    s.compactions = db.compactions;
+    s.compact_seconds = db.compact_seconds;
+    s.compacting = db.compacting;
+    return s;
+}
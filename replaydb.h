@@ -0,0 +1,58 @@
+#pragma once
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "replay.h"
+const int replaydb_compact_threshold = 16384;
+struct ReplayKey
+{
+    int difficulty;
+    unsigned int seed;
+    int score;
+    int ticks;
+    long long timestamp;
+    long long offset;
+};
+struct ReplayDbStats
+{
+    long long runs = 0;
+    long long indexed = 0;
+    long long pending = 0;
+    long long data_bytes = 0;
+    long long index_bytes = 0;
+    int compactions = 0;
+    double compact_seconds = 0.0;
+    bool compacting = false;
+};
+struct ReplayDb
+{
+    std::string data_path;
+    std::string index_path;
+    std::ofstream data;
+    long long data_bytes = 0;
+    const unsigned char* index_data = nullptr;
+    size_t index_size = 0;
+    void* index_file = nullptr;
+    void* index_mapping = nullptr;
+    long long indexed = 0;
+    long long indexed_bytes = 0;
+    std::vector<ReplayKey> pending;
+    std::vector<ReplayKey> compacting_keys;
+    std::vector<unsigned char> record;
+    std::mutex lock;
+    std::thread compactor;
+    bool compacting = false;
+    int compactions = 0;
+    double compact_seconds = 0.0;
+};
+bool replaydb_open(ReplayDb& db, const char* path);
+void replaydb_close(ReplayDb& db);
+bool replaydb_append(ReplayDb& db, const Replay& r, long long timestamp);
+bool replaydb_best(ReplayDb& db, int difficulty, unsigned int seed, ReplayKey& out);
+int replaydb_range(ReplayDb& db, int difficulty, unsigned int seed, int min_score, int max_score, long long from, long long to, std::vector<ReplayKey>& out);
+int replaydb_top(ReplayDb& db, int difficulty, long long from, long long to, int k, std::vector<ReplayKey>& out);
+bool replaydb_load(ReplayDb& db, const ReplayKey& key, Replay& r);
+void replaydb_compact(ReplayDb& db, bool wait);
+ReplayDbStats replaydb_stats(ReplayDb& db);
@@ -0,0 +1,176 @@
+#include "simkernel.h"
+#include "reach.h"
+template <DifficultyProfile P>
+int kernel_gap_y(SimWorld& w, int prev_gap_y, const SimParams& p)
+{
+    constexpr int max_gap = height - ground_height - P.pipe_gap - 25;
+    if constexpr (P.difficulty == HARD)
+    {
+        int gap_y = w.next_gap_high ? min_gap_y + (max_gap - min_gap_y) / 4 : min_gap_y + (3 * (max_gap - min_gap_y)) / 4;
+        w.next_gap_high = !w.next_gap_high;
+        return gap_y;
+    }
+    else
+    {
+        unsigned int r = xorshift32(w.rng);
+        int gap_y = p.reach != nullptr ? reach_pick_gap(*p.reach, prev_gap_y, r) : -1;
+        return gap_y < 0 ? min_gap_y + r % (max_gap - min_gap_y + 1) : gap_y;
+    }
+}
+template <DifficultyProfile P>
+void kernel_spawn(SimWorld& w, const SimParams& p)
+{
+    if (w.pipe_count >= max_pipes || (w.pipe_count > 0 && w.pipes[w.pipe_count - 1].x > width - P.pipe_interval))
+    {
+        return;
+    }
+    int prev_gap_y = w.pipe_count > 0 ? w.pipes[w.pipe_count - 1].gap_y : -1;
+    int gap_y = kernel_gap_y<P>(w, prev_gap_y, p);
+    SimPipe& pipe = w.pipes[w.pipe_count];
+    pipe.x = width;
+    pipe.gap_y = gap_y;
+    pipe.scored = 0;
+    pipe.base_y = gap_y;
+    pipe.move_amp = 0;
+    pipe.move_period = 0;
+    ++w.pipe_count;
+}
+template <DifficultyProfile P>
+SimHit kernel_collision(const SimWorld& w, const SimParams& p)
+{
+    SimBox bird = get_bird_box(w, p, 10.f, 10.f);
+    if (bird.top < 0)
+    {
+        return HIT_CEILING;
+    }
+    float bird_right = bird.left + bird.width;
+    float bird_bottom = bird.top + bird.height;
+    if (bird_bottom > height)
+    {
+        return HIT_FLOOR;
+    }
+    float pipe_width = p.pipe_w - 10.f;
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        float left = w.pipes[i].x + 5.f;
+        float right = left + pipe_width;
+        if ((bird.left > left ? bird.left : left) >= min_f(bird_right, right))
+        {
+            continue;
+        }
+        float top_height = (float)w.pipes[i].gap_y;
+        if (bird.top < min_f(bird_bottom, top_height))
+        {
+            return HIT_TOP_PIPE;
+        }
+        float bottom_top = (float)(w.pipes[i].gap_y + P.pipe_gap);
+        if ((bird.top > bottom_top ? bird.top : bottom_top) < min_f(bird_bottom, bottom_top + (height - bottom_top)))
+        {
+            return HIT_BOTTOM_PIPE;
+        }
+    }
+    return HIT_NONE;
+}
+template <DifficultyProfile P>
+SimStepResult kernel_step(SimWorld& w, const SimParams& p, bool flap)
+{
+    SimStepResult result;
+    if (flap)
+    {
+        w.bird_vel = P.flap_strength;
+        w.bird_falling = 0;
+    }
+    w.bird_vel += P.gravity;
+    w.bird_y += w.bird_vel;
+    w.bird_rotation = min_f(w.bird_vel * 4.f, 90.f);
+    if (w.bird_vel > 0)
+    {
+        w.bird_falling = 1;
+    }
+    kernel_spawn<P>(w, p);
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        w.pipes[i].x += P.pipe_speed;
+    }
+    if (w.pipe_count > 0 && w.pipes[0].x + p.pipe_w < 0)
+    {
+        for (int i = 0; i < w.pipe_count - 1; ++i)
+        {
+            w.pipes[i] = w.pipes[i + 1];
+        }
+        --w.pipe_count;
+    }
+    result.scored = 0;
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        if (!w.pipes[i].scored && w.pipes[i].x + p.pipe_w < bird_x)
+        {
+            w.pipes[i].scored = 1;
+            ++w.score;
+            ++result.scored;
+        }
+    }
+    result.hit = kernel_collision<P>(w, p);
+    ++w.tick;
+    return result;
+}
+template <DifficultyProfile P>
+void kernel_batch(SimWorld* worlds, const unsigned char* actions, SimStepResult* results, int count, const SimParams& p)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        results[i] = kernel_step<P>(worlds[i], p, actions != nullptr && actions[i] != 0);
+    }
+}
+bool sim_profile_matches(const SimParams& p, const DifficultyProfile& profile)
+{
+    return p.difficulty == profile.difficulty && p.pipe_gap == profile.pipe_gap && p.pipe_interval == profile.pipe_interval && p.gravity == profile.gravity &&
+           p.flap_strength == profile.flap_strength && p.pipe_speed == profile.pipe_speed && p.masks == nullptr && p.pattern == nullptr;
+}
+SimKernel sim_pick_kernel(const SimParams& p)
+{
+    if (sim_profile_matches(p, easy_profile))
+    {
+        return KERNEL_EASY;
+    }
+    if (sim_profile_matches(p, hard_profile))
+    {
+        return KERNEL_HARD;
+    }
+    return KERNEL_GENERIC;
+}
+const char* sim_kernel_name(SimKernel kernel)
+{
+    static const char* names[KERNEL_COUNT] = { "generic", "easy", "hard" };
+    return kernel >= 0 && kernel < KERNEL_COUNT ? names[kernel] : "?";
+}
+SimStepResult sim_step_with(SimKernel kernel, SimWorld& w, const SimParams& p, bool flap)
+{
+    switch (kernel)
+    {
+    case KERNEL_EASY:
+        return kernel_step<easy_profile>(w, p, flap);
+    case KERNEL_HARD:
+        return kernel_step<hard_profile>(w, p, flap);
+    default:
+        return sim_step(w, p, flap);
+    }
+}
+void sim_step_batch(SimKernel kernel, SimWorld* worlds, const unsigned char* actions, SimStepResult* results, int count, const SimParams& p)
+{
+    switch (kernel)
+    {
+    case KERNEL_EASY:
+        kernel_batch<easy_profile>(worlds, actions, results, count, p);
+        break;
+    case KERNEL_HARD:
+        kernel_batch<hard_profile>(worlds, actions, results, count, p);
+        break;
+    default:
+        for (int i = 0; i < count; ++i)
+        {
+            results[i] = sim_step(worlds[i], p, actions != nullptr && actions[i] != 0);
+        }
+        break;
+    }
+}
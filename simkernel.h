@@ -0,0 +1,14 @@
+#pragma once
+#include "simulation.h"
+enum SimKernel
+{
+    KERNEL_GENERIC,
+    KERNEL_EASY,
+    KERNEL_HARD,
+    KERNEL_COUNT
+};
+bool sim_profile_matches(const SimParams& p, const DifficultyProfile& profile);
+SimKernel sim_pick_kernel(const SimParams& p);
+const char* sim_kernel_name(SimKernel kernel);
+SimStepResult sim_step_with(SimKernel kernel, SimWorld& w, const SimParams& p, bool flap);
+void sim_step_batch(SimKernel kernel, SimWorld* worlds, const unsigned char* actions, SimStepResult* results, int count, const SimParams& p);
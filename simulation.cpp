@@ -0,0 +1,292 @@
+#include "simulation.h"
+#include "reach.h"
+#include "bitmask.h"
+#include "pattern.h"
+#include <cmath>
+float min_f(float a, float b) 
+{
+    return (a < b) ? a : b;
+}
+int get_max_gap_y(const SimParams& p) 
+{
+    return height - ground_height - p.pipe_gap - 25;
+}
+const DifficultyProfile& difficulty_profile(Difficulty d)
+{
+    return d == HARD ? hard_profile : easy_profile;
+}
+void apply_difficulty(Difficulty d, SimParams& p) 
+{
+    const DifficultyProfile& profile = difficulty_profile(d);
+    p.difficulty = d;
+    p.pipe_gap = profile.pipe_gap;
+    p.gravity = profile.gravity;
+    p.flap_strength = profile.flap_strength;
+    p.pipe_speed = profile.pipe_speed;
+    p.pipe_interval = profile.pipe_interval;
+    p.reach = nullptr;
+    p.fixed = nullptr;
+}
+void apply_difficulty(Difficulty d, SimParams& p, ReachTable& reach)
+{
+    apply_difficulty(d, p);
+    reach_attach(reach, p);
+}
+unsigned int xorshift32(unsigned int& state)
+{
+    unsigned int x = state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state = x;
+    return x;
+}
+unsigned int sim_rand(SimWorld& w)
+{
+    return xorshift32(w.rng);
+}
+int next_gap_y(unsigned int& rng, int& next_gap_high, int prev_gap_y, const SimParams& p)
+{
+    int max_gap = get_max_gap_y(p);
+    int gap_y;
+    if (p.difficulty == HARD) 
+    {
+        if (next_gap_high) 
+        {
+            gap_y = min_gap_y + (max_gap - min_gap_y) / 4;
+        }
+        else 
+        {
+            gap_y = min_gap_y + (3 * (max_gap - min_gap_y)) / 4;
+        }
+        next_gap_high = !next_gap_high;
+    }
+    else 
+    {
+        unsigned int r = xorshift32(rng);
+        gap_y = p.reach != nullptr ? reach_pick_gap(*p.reach, prev_gap_y, r) : -1;
+        if (gap_y < 0)
+        {
+            gap_y = min_gap_y + r % (max_gap - min_gap_y + 1);
+        }
+    }
+    return gap_y;
+}
+int spawn_gap_y(unsigned int& rng, int& next_gap_high, PatternState& pattern, float& speed_scale, int prev_gap_y, const SimParams& p)
+{
+    if (p.pattern != nullptr)
+    {
+        return pattern_next_gap(*p.pattern, pattern, rng, speed_scale, p);
+    }
+    return next_gap_y(rng, next_gap_high, prev_gap_y, p);
+}
+int gap_wave(int tick, int amp, int period)
+{
+    int half = period / 2;
+    int phase = tick % period;
+    int rise = phase < half ? phase : period - phase;
+    return -amp + 2 * amp * rise / half;
+}
+unsigned int sim_seed(unsigned int seed)
+{
+    unsigned int x = seed * 0x9E3779B9u + 0x7F4A7C15u;
+    x = (x ^ (x >> 16)) * 0x85EBCA6Bu;
+    x = (x ^ (x >> 13)) * 0xC2B2AE35u;
+    x ^= x >> 16;
+    return x ? x : 1u;
+}
+void sim_reset(SimWorld& w, unsigned int seed)
+{
+    w.bird_y = height / 2;
+    w.bird_vel = 0.f;
+    w.bird_rotation = 0.f;
+    w.bird_falling = 0;
+    w.score = 0;
+    w.pipe_count = 0;
+    w.next_gap_high = 1;
+    w.tick = 0;
+    w.speed_scale = 1.f;
+    pattern_reset(w.pattern);
+    w.rng = sim_seed(seed);
+    for (int i = 0; i < max_pipes; ++i)
+    {
+        w.pipes[i].x = 0.f;
+        w.pipes[i].gap_y = 0;
+        w.pipes[i].scored = 0;
+        w.pipes[i].base_y = 0;
+        w.pipes[i].move_amp = 0;
+        w.pipes[i].move_period = 0;
+    }
+}
+void flap_bird(SimWorld& w, const SimParams& p)
+{
+    w.bird_vel = p.flap_strength;
+    w.bird_falling = 0;
+}
+void update_bird(SimWorld& w, const SimParams& p) 
+{
+    w.bird_vel += p.gravity;
+    w.bird_y += w.bird_vel;
+    w.bird_rotation = min_f(w.bird_vel * 4.f, 90.f);
+    if (w.bird_vel > 0)
+    {
+        w.bird_falling = 1;
+    }
+}
+void spawn_pipes(SimWorld& w, const SimParams& p) 
+{
+    if (w.pipe_count == 0 || w.pipes[w.pipe_count - 1].x <= width - p.pipe_interval) 
+    {
+        if (w.pipe_count < max_pipes) 
+        {
+            int prev_gap_y = w.pipe_count > 0 ? w.pipes[w.pipe_count - 1].gap_y : -1;
+            int gap_y = spawn_gap_y(w.rng, w.next_gap_high, w.pattern, w.speed_scale, prev_gap_y, p);
+            w.pipes[w.pipe_count].x = width;
+            w.pipes[w.pipe_count].gap_y = gap_y;
+            w.pipes[w.pipe_count].scored = 0;
+            w.pipes[w.pipe_count].base_y = gap_y;
+            w.pipes[w.pipe_count].move_amp = (short)w.pattern.move_amp;
+            w.pipes[w.pipe_count].move_period = (short)w.pattern.move_period;
+            ++w.pipe_count;
+        }
+    }
+}
+void move_pipes(SimWorld& w, const SimParams& p) 
+{
+    for (int i = 0; i < w.pipe_count; ++i) 
+    {
+        w.pipes[i].x += p.pipe_speed * w.speed_scale;
+        if (w.pipes[i].move_amp != 0)
+        {
+            w.pipes[i].gap_y = w.pipes[i].base_y + gap_wave(w.tick, w.pipes[i].move_amp, w.pipes[i].move_period);
+        }
+    }
+}
+void remove_old_pipes(SimWorld& w, const SimParams& p) 
+{
+    if (w.pipe_count > 0 && w.pipes[0].x + p.pipe_w < 0) 
+    {
+        for (int i = 0; i < w.pipe_count - 1; ++i) 
+        {
+            w.pipes[i] = w.pipes[i + 1];
+        }
+        --w.pipe_count;
+    }
+}
+int update_scoring(SimWorld& w, const SimParams& p) 
+{
+    int scored = 0;
+    for (int i = 0; i < w.pipe_count; ++i) 
+    {
+        if (!w.pipes[i].scored && w.pipes[i].x + p.pipe_w < bird_x) 
+        {
+            w.pipes[i].scored = 1;
+            ++w.score;
+            ++scored;
+        }
+    }
+    return scored;
+}
+int update_pipes(SimWorld& w, const SimParams& p) 
+{
+    spawn_pipes(w, p);
+    move_pipes(w, p);
+    remove_old_pipes(w, p);
+    return update_scoring(w, p);
+}
+SimBox get_bird_box(const SimWorld& w, const SimParams& p, float shrink_x, float shrink_y) 
+{
+    float angle = w.bird_rotation * 3.141592654f / 180.f;
+    float c = std::fabs(std::cos(angle));
+    float s = std::fabs(std::sin(angle));
+    float bounds_w = p.bird_w * c + p.bird_h * s;
+    float bounds_h = p.bird_w * s + p.bird_h * c;
+    SimBox box;
+    box.left = bird_x - bounds_w / 2.f + shrink_x;
+    box.top = w.bird_y - bounds_h / 2.f + shrink_y;
+    box.width = bounds_w - (shrink_x * 2);
+    box.height = bounds_h - (shrink_y * 2);
+    return box;
+}
+SimBox get_pipe_box(const SimPipe& pipe, const SimParams& p, bool top, float shrink_x) 
+{
+    SimBox box;
+    box.left = pipe.x + shrink_x;
+    box.width = p.pipe_w - (shrink_x * 2);
+    if (top)
+    {
+        box.top = 0.f;
+        box.height = (float)pipe.gap_y;
+    }
+    else
+    {
+        box.top = (float)(pipe.gap_y + p.pipe_gap);
+        box.height = height - box.top;
+    }
+    return box;
+}
+SimBox get_bird_hit_box(const SimWorld& w, const SimParams& p)
+{
+    if (p.masks != nullptr)
+    {
+        return mask_bird_bounds(*p.masks, w.bird_y, w.bird_rotation);
+    }
+    return get_bird_box(w, p, 10.f, 10.f);
+}
+SimBox get_pipe_hit_box(const SimPipe& pipe, const SimParams& p, bool top)
+{
+    if (p.masks != nullptr)
+    {
+        return mask_pipe_bounds(*p.masks, pipe, p, top);
+    }
+    return get_pipe_box(pipe, p, top, 5.f);
+}
+bool boxes_intersect(const SimBox& a, const SimBox& b)
+{
+    float left = (a.left > b.left) ? a.left : b.left;
+    float top = (a.top > b.top) ? a.top : b.top;
+    float right = min_f(a.left + a.width, b.left + b.width);
+    float bottom = min_f(a.top + a.height, b.top + b.height);
+    return left < right && top < bottom;
+}
+SimHit check_collision(const SimWorld& w, const SimParams& p) 
+{
+    if (p.masks != nullptr)
+    {
+        return mask_check_collision(w, p, *p.masks);
+    }
+    SimBox bird_box = get_bird_box(w, p, 10.f, 10.f);
+    if (bird_box.top < 0)
+    {
+        return HIT_CEILING;
+    }
+    if (bird_box.top + bird_box.height > height)
+    {
+        return HIT_FLOOR;
+    }
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        if (boxes_intersect(bird_box, get_pipe_box(w.pipes[i], p, true, 5.f))) 
+        {
+            return HIT_TOP_PIPE;
+        }
+        if (boxes_intersect(bird_box, get_pipe_box(w.pipes[i], p, false, 5.f))) 
+        {
+            return HIT_BOTTOM_PIPE;
+        }
+    }
+    return HIT_NONE;
+}
+SimStepResult sim_step(SimWorld& w, const SimParams& p, bool flap)
+{
+    SimStepResult result;
+    if (flap)
+    {
+        flap_bird(w, p);
+    }
+    update_bird(w, p);
+    result.scored = update_pipes(w, p);
+    result.hit = check_collision(w, p);
+    ++w.tick;
+    return result;
+}
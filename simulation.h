@@ -0,0 +1,124 @@
+#pragma once
+const int width = 864;
+const int height = 512;
+const int ground_height = 112;
+const int min_gap_y = 50;
+const int max_pipes = 20;
+const float bird_x = 120.f;
+const int pattern_max_depth = 4;
+enum Difficulty 
+{
+    EASY,
+    HARD
+};
+enum SimHit
+{
+    HIT_NONE,
+    HIT_CEILING,
+    HIT_FLOOR,
+    HIT_TOP_PIPE,
+    HIT_BOTTOM_PIPE
+};
+struct DifficultyProfile
+{
+    Difficulty difficulty;
+    int pipe_gap;
+    int pipe_interval;
+    float gravity;
+    float flap_strength;
+    float pipe_speed;
+};
+constexpr DifficultyProfile easy_profile = { EASY, 150, 250, 0.30f, -7.0f, -2.8f };
+constexpr DifficultyProfile hard_profile = { HARD, 110, 180, 0.55f, -8.5f, -4.8f };
+struct ReachTable;
+struct CollisionMasks;
+struct ObstacleProgram;
+struct FixedParams;
+struct SimParams
+{
+    Difficulty difficulty = EASY;
+    int pipe_gap = 150;
+    int pipe_interval = 250;
+    float gravity = 0.30f;
+    float flap_strength = -5.0f;
+    float pipe_speed = -2.8f;
+    float bird_w = 35.f;
+    float bird_h = 35.f;
+    float pipe_w = 37.5f;
+    const ReachTable* reach = nullptr;
+    const CollisionMasks* masks = nullptr;
+    const ObstacleProgram* pattern = nullptr;
+    const FixedParams* fixed = nullptr;
+};
+struct SimPipe
+{
+    float x;
+    int gap_y;
+    int scored;
+    int base_y;
+    short move_amp;
+    short move_period;
+};
+struct PatternState
+{
+    int pc;
+    int depth;
+    int loop_left[pattern_max_depth];
+    int last_gap;
+    int speed_pct;
+    int move_amp;
+    int move_period;
+};
+struct SimWorld
+{
+    float bird_y;
+    float bird_vel;
+    float bird_rotation;
+    int bird_falling;
+    int score;
+    int pipe_count;
+    int next_gap_high;
+    unsigned int rng;
+    int tick;
+    float speed_scale;
+    PatternState pattern;
+    SimPipe pipes[max_pipes];
+};
+struct SimBox
+{
+    float left;
+    float top;
+    float width;
+    float height;
+};
+struct SimStepResult
+{
+    int scored;
+    SimHit hit;
+};
+float min_f(float a, float b);
+int get_max_gap_y(const SimParams& p);
+const DifficultyProfile& difficulty_profile(Difficulty d);
+void apply_difficulty(Difficulty d, SimParams& p);
+void apply_difficulty(Difficulty d, SimParams& p, ReachTable& reach);
+unsigned int xorshift32(unsigned int& state);
+unsigned int sim_rand(SimWorld& w);
+int next_gap_y(unsigned int& rng, int& next_gap_high, int prev_gap_y, const SimParams& p);
+int spawn_gap_y(unsigned int& rng, int& next_gap_high, PatternState& pattern, float& speed_scale, int prev_gap_y, const SimParams& p);
+int gap_wave(int tick, int amp, int period);
+unsigned int sim_seed(unsigned int seed);
+void sim_reset(SimWorld& w, unsigned int seed);
+void flap_bird(SimWorld& w, const SimParams& p);
+void update_bird(SimWorld& w, const SimParams& p);
+void spawn_pipes(SimWorld& w, const SimParams& p);
+void move_pipes(SimWorld& w, const SimParams& p);
+void remove_old_pipes(SimWorld& w, const SimParams& p);
+int update_scoring(SimWorld& w, const SimParams& p);
+int update_pipes(SimWorld& w, const SimParams& p);
+SimBox get_bird_box(const SimWorld& w, const SimParams& p, float shrink_x = 10.f, float shrink_y = 10.f);
+SimBox get_pipe_box(const SimPipe& pipe, const SimParams& p, bool top, float shrink_x = 5.f);
+SimBox get_bird_hit_box(const SimWorld& w, const SimParams& p);
+SimBox get_pipe_hit_box(const SimPipe& pipe, const SimParams& p, bool top);
+bool boxes_intersect(const SimBox& a, const SimBox& b);
+SimHit check_collision(const SimWorld& w, const SimParams& p);
+SimStepResult sim_step(SimWorld& w, const SimParams& p, bool flap);
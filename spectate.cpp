@@ -0,0 +1,700 @@
+#include "spectate.h"
+#include "fixed.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include "net.h"
+using namespace std;
+const int spectate_keyframe_header = 35;
+const int spectate_pipe_bytes = 13;
+const int spectate_frame_bytes = 1024;
+const int spectate_ring_frames = 256;
+const int spectate_wait_ms = 5;
+struct SpectateSlot
+{
+    long long socket = -1;
+    int start = 0;
+    int end = 0;
+    bool joined = false;
+    unsigned char out[spectate_buffer_bytes];
+};
+struct SpectateFrame
+{
+    int size = 0;
+    int keyframe_size = 0;
+    unsigned char bytes[spectate_frame_bytes * 2];
+};
+long long spectate_listener = -1;
+int spectate_bound_port = 0;
+SpectateSlot spectate_slots[spectate_max_clients];
+int spectate_slot_count = 0;
+SpectateStats spectate_totals;
+SpectateFrame spectate_ring[spectate_ring_frames];
+atomic<unsigned int> spectate_head(0);
+atomic<unsigned int> spectate_tail(0);
+atomic<bool> spectate_running(false);
+atomic<bool> spectate_join_wanted(false);
+atomic<int> spectate_active(0);
+atomic<long long> spectate_accepted(0);
+atomic<long long> spectate_dropped(0);
+atomic<long long> spectate_bytes_sent(0);
+atomic<long long> spectate_sends(0);
+mutex spectate_wake_lock;
+condition_variable spectate_wake;
+thread spectate_thread;
+SimWorld spectate_last;
+SimParams spectate_last_params;
+bool spectate_started = false;
+int spectate_game_state = 0;
+float spectate_sent_y = 0.f;
+int spectate_keyframe_tick = 0;
+unsigned char spectate_frame[spectate_frame_bytes];
+template <class T>
+unsigned char* spectate_put(unsigned char* out, T v)
+{
+    memcpy(out, &v, sizeof(T));
+    return out + sizeof(T);
+}
+template <class T>
+const unsigned char* spectate_get(const unsigned char* in, T& v)
+{
+    memcpy(&v, in, sizeof(T));
+    return in + sizeof(T);
+}
+double spectate_now()
+{
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+void spectate_configure(long long s)
+{
+#ifdef _WIN32
+    u_long on = 1;
+    ioctlsocket((NetSocket)s, FIONBIO, &on);
+#else
+    fcntl((NetSocket)s, F_SETFL, fcntl((NetSocket)s, F_GETFL, 0) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+    int no_sigpipe = 1;
+    setsockopt((NetSocket)s, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+#endif
+#endif
+    int nodelay = 1;
+    setsockopt((NetSocket)s, IPPROTO_TCP, TCP_NODELAY, (const char*)&nodelay, sizeof(nodelay));
+}
+int spectate_record_bytes(const unsigned char* in, int avail)
+{
+    switch (in[0])
+    {
+        case SPECTATE_KEYFRAME:
+            return avail < spectate_keyframe_header ? 0 : spectate_keyframe_header + in[spectate_keyframe_header - 1] * spectate_pipe_bytes;
+        case SPECTATE_TICK:
+            return 8;
+        case SPECTATE_SPEED:
+        case SPECTATE_SCORE:
+            return 5;
+        case SPECTATE_PIPE:
+            return 13;
+        case SPECTATE_STATE:
+            return 2;
+        default:
+            return -1;
+    }
+}
+int spectate_encode_keyframe(unsigned char* out)
+{
+    const SimWorld& w = spectate_last;
+    const SimParams& p = spectate_last_params;
+    unsigned char* o = out;
+    o = spectate_put<unsigned char>(o, SPECTATE_KEYFRAME);
+    o = spectate_put<int>(o, w.tick);
+    o = spectate_put<unsigned char>(o, (unsigned char)spectate_game_state);
+    o = spectate_put<unsigned char>(o, (unsigned char)p.difficulty);
+    o = spectate_put<short>(o, (short)p.pipe_gap);
+    o = spectate_put<float>(o, p.pipe_speed);
+    o = spectate_put<float>(o, p.pipe_w);
+    o = spectate_put<float>(o, w.speed_scale);
+    o = spectate_put<float>(o, spectate_sent_y);
+    o = spectate_put<float>(o, w.bird_vel);
+    o = spectate_put<unsigned char>(o, (unsigned char)((w.bird_falling ? SPECTATE_FALLING : 0) | (p.fixed != nullptr ? SPECTATE_FIXED : 0)));
+    o = spectate_put<int>(o, w.score);
+    o = spectate_put<unsigned char>(o, (unsigned char)w.pipe_count);
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        const SimPipe& pipe = w.pipes[i];
+        o = spectate_put<float>(o, pipe.x);
+        o = spectate_put<short>(o, (short)pipe.gap_y);
+        o = spectate_put<short>(o, (short)pipe.base_y);
+        o = spectate_put<short>(o, pipe.move_amp);
+        o = spectate_put<short>(o, pipe.move_period);
+        o = spectate_put<unsigned char>(o, (unsigned char)pipe.scored);
+    }
+    return (int)(o - out);
+}
+int spectate_adopt(const SimWorld& w, const SimParams& p, unsigned char* out)
+{
+    spectate_last = w;
+    spectate_last_params = p;
+    spectate_sent_y = w.bird_y;
+    spectate_keyframe_tick = w.tick;
+    spectate_started = true;
+    ++spectate_totals.keyframes;
+    return spectate_encode_keyframe(out);
+}
+int spectate_write(long long socket, const unsigned char* data, int size)
+{
+    int n = (int)send((NetSocket)socket, (const char*)data, size, net_send_flags);
+    spectate_sends.fetch_add(1, memory_order_relaxed);
+    if (n < 0)
+    {
+        return net_would_block() ? 0 : -1;
+    }
+    spectate_bytes_sent.fetch_add(n, memory_order_relaxed);
+    return n;
+}
+bool spectate_flush(SpectateSlot& slot)
+{
+    if (slot.start < slot.end)
+    {
+        int n = spectate_write(slot.socket, slot.out + slot.start, slot.end - slot.start);
+        if (n < 0)
+        {
+            return false;
+        }
+        slot.start += n;
+    }
+    if (slot.start == slot.end)
+    {
+        slot.start = 0;
+        slot.end = 0;
+    }
+    return true;
+}
+bool spectate_queue(SpectateSlot& slot, const unsigned char* data, int size)
+{
+    if (!spectate_flush(slot))
+    {
+        return false;
+    }
+    if (slot.start == slot.end)
+    {
+        int n = spectate_write(slot.socket, data, size);
+        if (n < 0)
+        {
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    if (size == 0)
+    {
+        return true;
+    }
+    if (slot.end + size > spectate_buffer_bytes)
+    {
+        memmove(slot.out, slot.out + slot.start, slot.end - slot.start);
+        slot.end -= slot.start;
+        slot.start = 0;
+    }
+    if (slot.end + size > spectate_buffer_bytes)
+    {
+        return false;
+    }
+    memcpy(slot.out + slot.end, data, size);
+    slot.end += size;
+    return true;
+}
+void spectate_drop(int i)
+{
+    net_close_socket(spectate_slots[i].socket);
+    spectate_dropped.fetch_add(1, memory_order_relaxed);
+    if (spectate_slots[i].joined)
+    {
+        spectate_active.fetch_sub(1, memory_order_relaxed);
+    }
+    --spectate_slot_count;
+    SpectateSlot& last = spectate_slots[spectate_slot_count];
+    if (i != spectate_slot_count)
+    {
+        spectate_slots[i].socket = last.socket;
+        spectate_slots[i].joined = last.joined;
+        spectate_slots[i].start = 0;
+        spectate_slots[i].end = last.end - last.start;
+        memcpy(spectate_slots[i].out, last.out + last.start, last.end - last.start);
+    }
+    last.socket = -1;
+    last.joined = false;
+    last.start = 0;
+    last.end = 0;
+}
+void spectate_fan_out(const SpectateFrame& f)
+{
+    for (int i = spectate_slot_count - 1; i >= 0; --i)
+    {
+        SpectateSlot& slot = spectate_slots[i];
+        bool ok = true;
+        if (slot.joined)
+        {
+            ok = f.size > 0 ? spectate_queue(slot, f.bytes, f.size) : spectate_flush(slot);
+        }
+        else if (f.keyframe_size > 0)
+        {
+            ok = spectate_queue(slot, f.bytes + f.size, f.keyframe_size);
+            slot.joined = true;
+            spectate_active.fetch_add(1, memory_order_relaxed);
+        }
+        if (!ok)
+        {
+            spectate_drop(i);
+        }
+    }
+}
+void spectate_flush_all()
+{
+    for (int i = spectate_slot_count - 1; i >= 0; --i)
+    {
+        if (!spectate_flush(spectate_slots[i]))
+        {
+            spectate_drop(i);
+        }
+    }
+}
+void spectate_accept()
+{
+    while (true)
+    {
+        NetSocket s = accept((NetSocket)spectate_listener, nullptr, nullptr);
+        if (!net_valid(s))
+        {
+            return;
+        }
+        if (spectate_slot_count == spectate_max_clients)
+        {
+            net_close_socket((long long)s);
+            spectate_dropped.fetch_add(1, memory_order_relaxed);
+            continue;
+        }
+        spectate_configure((long long)s);
+        SpectateSlot& slot = spectate_slots[spectate_slot_count++];
+        slot.socket = (long long)s;
+        slot.joined = false;
+        slot.start = 0;
+        slot.end = 0;
+        spectate_accepted.fetch_add(1, memory_order_relaxed);
+        spectate_join_wanted.store(true, memory_order_release);
+    }
+}
+bool spectate_drain()
+{
+    unsigned int tail = spectate_tail.load(memory_order_relaxed);
+    unsigned int head = spectate_head.load(memory_order_acquire);
+    if (head == tail)
+    {
+        return false;
+    }
+    for (; tail != head; ++tail)
+    {
+        spectate_fan_out(spectate_ring[tail % spectate_ring_frames]);
+        spectate_tail.store(tail + 1, memory_order_release);
+    }
+    return true;
+}
+void spectate_sender()
+{
+    while (spectate_running.load(memory_order_acquire))
+    {
+        if (!spectate_drain())
+        {
+            spectate_flush_all();
+        }
+        spectate_accept();
+        unique_lock<mutex> lock(spectate_wake_lock);
+        spectate_wake.wait_for(lock, chrono::milliseconds(spectate_wait_ms), [] {
+            return !spectate_running.load(memory_order_acquire) || spectate_head.load(memory_order_acquire) != spectate_tail.load(memory_order_relaxed);
+        });
+    }
+    spectate_drain();
+}
+void spectate_notify()
+{
+    {
+        lock_guard<mutex> lock(spectate_wake_lock);
+    }
+    spectate_wake.notify_one();
+}
+bool spectate_send(int size)
+{
+    unsigned int head = spectate_head.load(memory_order_relaxed);
+    if (head - spectate_tail.load(memory_order_acquire) >= (unsigned int)spectate_ring_frames)
+    {
+        ++spectate_totals.frames_dropped;
+        spectate_started = false;
+        return false;
+    }
+    bool join = spectate_join_wanted.exchange(false, memory_order_acq_rel);
+    if (size == 0 && !join)
+    {
+        return false;
+    }
+    SpectateFrame& f = spectate_ring[head % spectate_ring_frames];
+    memcpy(f.bytes, spectate_frame, size);
+    f.size = size;
+    f.keyframe_size = join ? spectate_encode_keyframe(f.bytes + size) : 0;
+    spectate_head.store(head + 1, memory_order_release);
+    spectate_totals.bytes_published += size;
+    return true;
+}
+bool spectate_listen(int port)
+{
+    spectate_close();
+    long long s = net_listen(INADDR_ANY, port, spectate_max_clients, spectate_bound_port);
+    if (s < 0)
+    {
+        return false;
+    }
+    spectate_configure(s);
+    spectate_listener = s;
+    spectate_totals = SpectateStats();
+    spectate_accepted.store(0);
+    spectate_dropped.store(0);
+    spectate_bytes_sent.store(0);
+    spectate_sends.store(0);
+    spectate_active.store(0);
+    spectate_head.store(0);
+    spectate_tail.store(0);
+    spectate_join_wanted.store(false);
+    spectate_started = false;
+    spectate_game_state = 0;
+    spectate_running.store(true, memory_order_release);
+    spectate_thread = thread(spectate_sender);
+    return true;
+}
+int spectate_port()
+{
+    return spectate_listener >= 0 ? spectate_bound_port : 0;
+}
+int spectate_clients()
+{
+    return spectate_active.load(memory_order_relaxed);
+}
+void spectate_poll(int state, const SimWorld& w, const SimParams& p)
+{
+    if (spectate_listener < 0)
+    {
+        return;
+    }
+    double start = spectate_now();
+    unsigned char* o = spectate_frame;
+    if (state != spectate_game_state)
+    {
+        spectate_game_state = state;
+        o = spectate_put<unsigned char>(o, SPECTATE_STATE);
+        o = spectate_put<unsigned char>(o, (unsigned char)state);
+    }
+    if (!spectate_started || w.tick != spectate_last.tick || p.difficulty != spectate_last_params.difficulty)
+    {
+        o += spectate_adopt(w, p, o);
+    }
+    bool queued = spectate_send((int)(o - spectate_frame));
+    spectate_totals.publish_seconds += spectate_now() - start;
+    if (queued)
+    {
+        spectate_notify();
+    }
+}
+void spectate_publish(const SimWorld& w, const SimParams& p, bool flapped)
+{
+    if (spectate_listener < 0)
+    {
+        return;
+    }
+    double start = spectate_now();
+    unsigned char* o = spectate_frame;
+    if (!spectate_started || w.tick != spectate_last.tick + 1 || w.tick - spectate_keyframe_tick >= spectate_keyframe_ticks ||
+        p.pipe_gap != spectate_last_params.pipe_gap || p.pipe_speed != spectate_last_params.pipe_speed ||
+        (p.fixed != nullptr) != (spectate_last_params.fixed != nullptr))
+    {
+        o += spectate_adopt(w, p, o);
+    }
+    else
+    {
+        if (w.speed_scale != spectate_last.speed_scale)
+        {
+            o = spectate_put<unsigned char>(o, SPECTATE_SPEED);
+            o = spectate_put<float>(o, w.speed_scale);
+        }
+        long dy = lround((w.bird_y - spectate_sent_y) * spectate_y_steps);
+        dy = dy < -32768 ? -32768 : (dy > 32767 ? 32767 : dy);
+        spectate_sent_y += (float)dy / spectate_y_steps;
+        long vel = lround(w.bird_vel * spectate_y_steps);
+        vel = vel < -32768 ? -32768 : (vel > 32767 ? 32767 : vel);
+        unsigned char flags = (unsigned char)((w.bird_falling ? SPECTATE_FALLING : 0) | (flapped ? SPECTATE_FLAPPED : 0));
+        o = spectate_put<unsigned char>(o, SPECTATE_TICK);
+        o = spectate_put<unsigned char>(o, flags);
+        o = spectate_put<unsigned short>(o, (unsigned short)w.tick);
+        o = spectate_put<short>(o, (short)dy);
+        o = spectate_put<short>(o, (short)vel);
+        float newest = spectate_last.pipe_count > 0 ? spectate_last.pipes[spectate_last.pipe_count - 1].x : -1e9f;
+        for (int i = 0; i < w.pipe_count; ++i)
+        {
+            const SimPipe& pipe = w.pipes[i];
+            if (pipe.x > newest)
+            {
+                o = spectate_put<unsigned char>(o, SPECTATE_PIPE);
+                o = spectate_put<float>(o, pipe.x);
+                o = spectate_put<short>(o, (short)pipe.gap_y);
+                o = spectate_put<short>(o, (short)pipe.base_y);
+                o = spectate_put<short>(o, pipe.move_amp);
+                o = spectate_put<short>(o, pipe.move_period);
+            }
+        }
+        if (w.score != spectate_last.score)
+        {
+            o = spectate_put<unsigned char>(o, SPECTATE_SCORE);
+            o = spectate_put<int>(o, w.score);
+        }
+        spectate_last = w;
+    }
+    bool queued = spectate_send((int)(o - spectate_frame));
+    ++spectate_totals.publishes;
+    spectate_totals.publish_seconds += spectate_now() - start;
+    if (queued)
+    {
+        spectate_notify();
+    }
+}
+void spectate_close()
+{
+    if (spectate_running.load())
+    {
+        spectate_running.store(false, memory_order_release);
+        spectate_notify();
+        spectate_thread.join();
+    }
+    for (int i = 0; i < spectate_slot_count; ++i)
+    {
+        net_close_socket(spectate_slots[i].socket);
+        spectate_slots[i].socket = -1;
+        spectate_slots[i].joined = false;
+    }
+    spectate_slot_count = 0;
+    spectate_active.store(0);
+    if (spectate_listener >= 0)
+    {
+        net_close_socket(spectate_listener);
+        spectate_listener = -1;
+    }
+}
+SpectateStats spectate_stats()
+{
+    SpectateStats stats = spectate_totals;
+    stats.clients_accepted = spectate_accepted.load();
+    stats.clients_dropped = spectate_dropped.load();
+    stats.bytes_sent = spectate_bytes_sent.load();
+    stats.sends = spectate_sends.load();
+    return stats;
+}
+void spectate_apply(SpectateView& v, const unsigned char* in)
+{
+    unsigned char type = in[0];
+    ++in;
+    ++v.records;
+    if (type == SPECTATE_KEYFRAME)
+    {
+        unsigned char state, difficulty, flags, count;
+        short pipe_gap;
+        in = spectate_get(in, v.world.tick);
+        in = spectate_get(in, state);
+        in = spectate_get(in, difficulty);
+        in = spectate_get(in, pipe_gap);
+        in = spectate_get(in, v.params.pipe_speed);
+        in = spectate_get(in, v.params.pipe_w);
+        in = spectate_get(in, v.world.speed_scale);
+        in = spectate_get(in, v.world.bird_y);
+        in = spectate_get(in, v.world.bird_vel);
+        in = spectate_get(in, flags);
+        in = spectate_get(in, v.world.score);
+        in = spectate_get(in, count);
+        v.state = state;
+        v.params.difficulty = (Difficulty)difficulty;
+        v.params.pipe_gap = pipe_gap;
+        v.world.bird_falling = (flags & SPECTATE_FALLING) != 0;
+        v.fixed_point = (flags & SPECTATE_FIXED) != 0;
+        v.world.bird_rotation = min_f(v.world.bird_vel * 4.f, 90.f);
+        v.world.pipe_count = count < max_pipes ? count : max_pipes;
+        for (int i = 0; i < v.world.pipe_count; ++i)
+        {
+            SimPipe& pipe = v.world.pipes[i];
+            short gap_y, base_y;
+            unsigned char scored;
+            in = spectate_get(in, pipe.x);
+            in = spectate_get(in, gap_y);
+            in = spectate_get(in, base_y);
+            in = spectate_get(in, pipe.move_amp);
+            in = spectate_get(in, pipe.move_period);
+            in = spectate_get(in, scored);
+            pipe.gap_y = gap_y;
+            pipe.base_y = base_y;
+            pipe.scored = scored;
+        }
+        v.synced = true;
+        ++v.keyframes;
+        return;
+    }
+    if (type == SPECTATE_STATE)
+    {
+        v.state = in[0];
+        return;
+    }
+    if (!v.synced)
+    {
+        return;
+    }
+    if (type == SPECTATE_TICK)
+    {
+        unsigned char flags;
+        unsigned short tick;
+        short dy, vel;
+        in = spectate_get(in, flags);
+        in = spectate_get(in, tick);
+        in = spectate_get(in, dy);
+        in = spectate_get(in, vel);
+        int target = v.world.tick + (unsigned short)(tick - (unsigned short)v.world.tick);
+        while (v.world.tick < target)
+        {
+            if (v.fixed_point)
+            {
+                fixed_move_pipes(v.world, v.params);
+            }
+            else
+            {
+                move_pipes(v.world, v.params);
+            }
+            remove_old_pipes(v.world, v.params);
+            ++v.world.tick;
+        }
+        v.world.bird_y += (float)dy / spectate_y_steps;
+        v.world.bird_vel = (float)vel / spectate_y_steps;
+        v.world.bird_rotation = min_f(v.world.bird_vel * 4.f, 90.f);
+        v.world.bird_falling = (flags & SPECTATE_FALLING) != 0;
+        v.flaps += (flags & SPECTATE_FLAPPED) != 0;
+    }
+    else if (type == SPECTATE_SPEED)
+    {
+        spectate_get(in, v.world.speed_scale);
+    }
+    else if (type == SPECTATE_PIPE && v.world.pipe_count < max_pipes)
+    {
+        SimPipe& pipe = v.world.pipes[v.world.pipe_count++];
+        short gap_y, base_y;
+        in = spectate_get(in, pipe.x);
+        in = spectate_get(in, gap_y);
+        in = spectate_get(in, base_y);
+        in = spectate_get(in, pipe.move_amp);
+        in = spectate_get(in, pipe.move_period);
+        pipe.gap_y = gap_y;
+        pipe.base_y = base_y;
+        pipe.scored = 0;
+    }
+    else if (type == SPECTATE_SCORE)
+    {
+        spectate_get(in, v.world.score);
+        ++v.scores;
+    }
+}
+bool spectate_connect(SpectateClient& c, const char* host, int port)
+{
+    spectate_disconnect(c);
+    c.fill = 0;
+    c.view = SpectateView();
+    if (!net_init())
+    {
+        return false;
+    }
+    char service[16];
+    snprintf(service, sizeof(service), "%d", port);
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    addrinfo* list = nullptr;
+    if (getaddrinfo(host, service, &hints, &list) != 0)
+    {
+        return false;
+    }
+    for (addrinfo* a = list; a != nullptr && c.socket < 0; a = a->ai_next)
+    {
+        NetSocket s = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (!net_valid(s))
+        {
+            continue;
+        }
+        if (connect(s, a->ai_addr, (int)a->ai_addrlen) != 0)
+        {
+            net_close_socket((long long)s);
+            continue;
+        }
+        spectate_configure((long long)s);
+        c.socket = (long long)s;
+    }
+    freeaddrinfo(list);
+    return c.socket >= 0;
+}
+int spectate_receive(SpectateClient& c)
+{
+    if (c.socket < 0)
+    {
+        return -1;
+    }
+    bool open = true;
+    while (c.fill < spectate_buffer_bytes)
+    {
+        int n = (int)recv((NetSocket)c.socket, (char*)c.buffer + c.fill, spectate_buffer_bytes - c.fill, 0);
+        if (n > 0)
+        {
+            c.fill += n;
+            c.view.bytes += n;
+            continue;
+        }
+        open = n < 0 && net_would_block();
+        break;
+    }
+    int applied = 0;
+    int used = 0;
+    while (used < c.fill)
+    {
+        int size = spectate_record_bytes(c.buffer + used, c.fill - used);
+        if (size < 0)
+        {
+            open = false;
+            break;
+        }
+        if (size == 0 || used + size > c.fill)
+        {
+            break;
+        }
+        spectate_apply(c.view, c.buffer + used);
+        used += size;
+        ++applied;
+    }
+    memmove(c.buffer, c.buffer + used, c.fill - used);
+    c.fill -= used;
+    if (!open)
+    {
+        spectate_disconnect(c);
+        return -1;
+    }
+    return applied;
+}
+void spectate_disconnect(SpectateClient& c)
+{
+    if (c.socket >= 0)
+    {
+        net_close_socket(c.socket);
+        c.socket = -1;
+    }
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "simulation.h"
+const int spectate_default_port = 47800;
+const int spectate_max_clients = 64;
+const int spectate_buffer_bytes = 1 << 15;
+const int spectate_keyframe_ticks = 120;
+const int spectate_y_steps = 64;
+enum SpectateRecord
+{
+    SPECTATE_KEYFRAME = 1,
+    SPECTATE_TICK,
+    SPECTATE_SPEED,
+    SPECTATE_PIPE,
+    SPECTATE_SCORE,
+    SPECTATE_STATE
+};
+enum SpectateFlag
+{
+    SPECTATE_FALLING = 1,
+    SPECTATE_FLAPPED = 2,
+    SPECTATE_FIXED = 4
+};
+struct SpectateStats
+{
+    long long clients_accepted = 0;
+    long long clients_dropped = 0;
+    long long publishes = 0;
+    long long keyframes = 0;
+    long long bytes_published = 0;
+    long long bytes_sent = 0;
+    long long sends = 0;
+    long long frames_dropped = 0;
+    double publish_seconds = 0.0;
+};
+struct SpectateView
+{
+    SimParams params;
+    SimWorld world;
+    int state = -1;
+    bool synced = false;
+    bool fixed_point = false;
+    int flaps = 0;
+    int scores = 0;
+    long long keyframes = 0;
+    long long records = 0;
+    long long bytes = 0;
+};
+struct SpectateClient
+{
+    long long socket = -1;
+    int fill = 0;
+    unsigned char buffer[spectate_buffer_bytes];
+    SpectateView view;
+};
+bool spectate_listen(int port);
+int spectate_port();
+int spectate_clients();
+void spectate_poll(int state, const SimWorld& w, const SimParams& p);
+void spectate_publish(const SimWorld& w, const SimParams& p, bool flapped);
+void spectate_close();
+SpectateStats spectate_stats();
+bool spectate_connect(SpectateClient& c, const char* host, int port);
+int spectate_receive(SpectateClient& c);
+void spectate_disconnect(SpectateClient& c);
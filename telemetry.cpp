@@ -0,0 +1,152 @@
+#include "telemetry.h"
+#include <atomic>
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <vector>
+using namespace std;
+const unsigned int telemetry_capacity = 1 << 16;
+const unsigned int telemetry_block_events = 8192;
+const char telemetry_magic[4] = { 'F', 'B', 'T', 'L' };
+const int telemetry_version = 1;
+TelemetryEvent telemetry_ring[telemetry_capacity];
+atomic<unsigned int> telemetry_head(0);
+atomic<unsigned int> telemetry_tail(0);
+atomic<bool> telemetry_running(false);
+atomic<long long> telemetry_dropped(0);
+atomic<long long> telemetry_logged(0);
+atomic<long long> telemetry_written(0);
+atomic<long long> telemetry_bytes(0);
+atomic<long long> telemetry_write_ns(0);
+ofstream telemetry_file;
+thread telemetry_thread;
+vector<unsigned char> telemetry_block;
+bool telemetry_log(unsigned char type, unsigned char difficulty, unsigned int run, unsigned int tick, int value, float y)
+{
+    if (!telemetry_running.load(memory_order_relaxed))
+    {
+        return false;
+    }
+    unsigned int head = telemetry_head.load(memory_order_relaxed);
+    if (head - telemetry_tail.load(memory_order_acquire) >= telemetry_capacity)
+    {
+        telemetry_dropped.fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+    TelemetryEvent& e = telemetry_ring[head & (telemetry_capacity - 1)];
+    e.type = type;
+    e.difficulty = difficulty;
+    e.run = run;
+    e.tick = tick;
+    e.value = value;
+    e.y = y;
+    telemetry_head.store(head + 1, memory_order_release);
+    telemetry_logged.fetch_add(1, memory_order_relaxed);
+    return true;
+}
+template <class T>
+unsigned char* put_column(unsigned char* out, unsigned int tail, unsigned int count, T TelemetryEvent::* field)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        T v = telemetry_ring[(tail + i) & (telemetry_capacity - 1)].*field;
+        memcpy(out, &v, sizeof(T));
+        out += sizeof(T);
+    }
+    return out;
+}
+void telemetry_write_block(unsigned int tail, unsigned int count)
+{
+    auto start = chrono::steady_clock::now();
+    unsigned char* out = telemetry_block.data();
+    memcpy(out, &count, 4);
+    out += 4;
+    out = put_column(out, tail, count, &TelemetryEvent::type);
+    out = put_column(out, tail, count, &TelemetryEvent::difficulty);
+    out = put_column(out, tail, count, &TelemetryEvent::run);
+    out = put_column(out, tail, count, &TelemetryEvent::tick);
+    out = put_column(out, tail, count, &TelemetryEvent::value);
+    out = put_column(out, tail, count, &TelemetryEvent::y);
+    size_t size = out - telemetry_block.data();
+    telemetry_file.write((const char*)telemetry_block.data(), (streamsize)size);
+    telemetry_file.flush();
+    telemetry_bytes.fetch_add((long long)size, memory_order_relaxed);
+    telemetry_written.fetch_add(count, memory_order_relaxed);
+    telemetry_write_ns.fetch_add(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count(), memory_order_relaxed);
+}
+bool telemetry_drain()
+{
+    unsigned int tail = telemetry_tail.load(memory_order_relaxed);
+    unsigned int head = telemetry_head.load(memory_order_acquire);
+    if (head == tail)
+    {
+        return false;
+    }
+    unsigned int count = head - tail;
+    if (count > telemetry_block_events)
+    {
+        count = telemetry_block_events;
+    }
+    telemetry_write_block(tail, count);
+    telemetry_tail.store(tail + count, memory_order_release);
+    return true;
+}
+void telemetry_flusher()
+{
+    while (telemetry_running.load(memory_order_acquire))
+    {
+        if (!telemetry_drain())
+        {
+            this_thread::sleep_for(chrono::milliseconds(50));
+        }
+    }
+    while (telemetry_drain())
+    {
+    }
+}
+bool telemetry_open(const char* path)
+{
+    if (telemetry_running.load())
+    {
+        return false;
+    }
+    telemetry_file.open(path, ios::binary);
+    if (!telemetry_file.is_open())
+    {
+        return false;
+    }
+    telemetry_file.write(telemetry_magic, 4);
+    telemetry_file.write((const char*)&telemetry_version, 4);
+    telemetry_block.resize(4 + (size_t)telemetry_block_events * telemetry_event_bytes);
+    telemetry_head.store(0);
+    telemetry_tail.store(0);
+    telemetry_logged.store(0);
+    telemetry_dropped.store(0);
+    telemetry_written.store(0);
+    telemetry_bytes.store(0);
+    telemetry_write_ns.store(0);
+    telemetry_running.store(true, memory_order_release);
+    telemetry_thread = thread(telemetry_flusher);
+    return true;
+}
+void telemetry_close()
+{
+    if (!telemetry_running.load())
+    {
+        return;
+    }
+    telemetry_running.store(false, memory_order_release);
+    telemetry_thread.join();
+    telemetry_file.close();
+}
+TelemetryStats telemetry_stats()
+{
+    TelemetryStats stats;
+    stats.events_logged = telemetry_logged.load();
+    stats.events_dropped = telemetry_dropped.load();
+    stats.events_written = telemetry_written.load();
+    stats.bytes_written = telemetry_bytes.load();
+    stats.write_seconds = telemetry_write_ns.load() / 1e9;
+    return stats;
+}
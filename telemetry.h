@@ -0,0 +1,31 @@
+#pragma once
+enum TelemetryEventType
+{
+    EVENT_RUN_START,
+    EVENT_FLAP,
+    EVENT_SCORE,
+    EVENT_DEATH,
+    EVENT_RUN_END
+};
+struct TelemetryEvent
+{
+    unsigned char type;
+    unsigned char difficulty;
+    unsigned int run;
+    unsigned int tick;
+    int value;
+    float y;
+};
+struct TelemetryStats
+{
+    long long events_logged = 0;
+    long long events_dropped = 0;
+    long long events_written = 0;
+    long long bytes_written = 0;
+    double write_seconds = 0.0;
+};
+const int telemetry_event_bytes = 18;
+bool telemetry_open(const char* path);
+void telemetry_close();
+bool telemetry_log(unsigned char type, unsigned char difficulty, unsigned int run, unsigned int tick, int value, float y);
+TelemetryStats telemetry_stats();
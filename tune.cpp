@@ -0,0 +1,507 @@
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include "simulation.h"
+#include "reach.h"
+#include "pattern.h"
+#include "replay.h"
+#include "fixed.h"
+using namespace std;
+const int tune_max_score = 100;
+const int tune_max_profiles = 3;
+const int tune_search_population = 32;
+const int tune_search_elite = 6;
+const int tune_search_rounds = 6;
+struct TuneProfile
+{
+    const char* name;
+    int delay;
+    float mean;
+    float spread;
+};
+struct TuneSetting
+{
+    int pipe_gap;
+    float gravity;
+    float flap_strength;
+    float pipe_speed;
+    int pipe_interval;
+};
+struct TuneOutcome
+{
+    long long runs = 0;
+    long long deaths = 0;
+    long long pipes = 0;
+    long long reached[tune_max_score + 1] = {};
+};
+struct TuneResult
+{
+    TuneSetting setting;
+    bool stock_hard = false;
+    TuneOutcome outcomes[tune_max_profiles];
+};
+struct TuneJob
+{
+    vector<TuneResult>* results;
+    const TuneProfile* profiles;
+    int profile_count;
+    int runs;
+    atomic<int> next;
+};
+float tune_gaussian(unsigned int& rng);
+int tune_next_pipe(const SimWorld& w, const SimParams& p);
+float tune_rise(const SimParams& p);
+void tune_run(const SimParams& p, const TuneProfile& bot, unsigned int seed, TuneOutcome& out);
+void tune_evaluate(TuneResult& result, const TuneProfile* profiles, int profile_count, int runs);
+void tune_worker(TuneJob* job);
+void tune_run_all(vector<TuneResult>& results, const TuneProfile* profiles, int profile_count, int runs, int num_threads);
+double tune_hazard(const TuneOutcome& o);
+int tune_median(const TuneOutcome& o);
+bool tune_calibrate(int count, char* paths[], TuneProfile& human);
+void tune_grid(vector<TuneResult>& results);
+void tune_search(double target, const TuneProfile* profiles, int profile_count, int runs, int num_threads, int judge);
+void print_result_header(const TuneProfile* profiles, int profile_count);
+void print_result(const TuneResult& r, int profile_count);
+void print_survival(const TuneResult& r, const TuneProfile* profiles, int profile_count);
+int main(int argc, char* argv[])
+{
+    int num_threads = (int)thread::hardware_concurrency();
+    int runs = 1000;
+    double target = -1.0;
+    int first_path = argc;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            num_threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-runs") == 0 && i + 1 < argc)
+        {
+            runs = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "-target") == 0 && i + 1 < argc)
+        {
+            target = atof(argv[++i]);
+        }
+        else if (argv[i][0] == '-')
+        {
+            cout << "usage: Flappy-Tune [-j threads] [-runs N] [-target hazard%] [replays *.rpl]" << endl;
+            return 1;
+        }
+        else
+        {
+            first_path = i;
+            break;
+        }
+    }
+    num_threads = num_threads < 1 ? 1 : num_threads;
+    runs = runs < 10 ? 10 : runs;
+    TuneProfile profiles[tune_max_profiles] = {
+        { "expert", 0, 0.f, 4.f },
+        { "casual", 6, 0.f, 12.f },
+        { "human", 4, 0.f, 10.f }
+    };
+    int profile_count = 2;
+    if (first_path < argc)
+    {
+        if (!tune_calibrate(argc - first_path, argv + first_path, profiles[2]))
+        {
+            cout << "no usable replays, sweeping with the built-in bots only" << endl;
+        }
+        else
+        {
+            profile_count = 3;
+        }
+    }
+    auto start = chrono::steady_clock::now();
+    if (target > 0.0)
+    {
+        tune_search(target, profiles, profile_count, runs, num_threads, profile_count - 1);
+    }
+    else
+    {
+        vector<TuneResult> results;
+        tune_grid(results);
+        tune_run_all(results, profiles, profile_count, runs, num_threads);
+        int judge = profile_count - 1;
+        cout << endl << "stock tiers:" << endl;
+        print_result_header(profiles, profile_count);
+        print_result(results[0], profile_count);
+        print_result(results[1], profile_count);
+        double easy = tune_hazard(results[0].outcomes[judge]);
+        double hard = tune_hazard(results[1].outcomes[judge]);
+        double medium = sqrt(easy * hard);
+        sort(results.begin() + 2, results.end(), [judge](const TuneResult& a, const TuneResult& b) {
+            return tune_hazard(a.outcomes[judge]) < tune_hazard(b.outcomes[judge]);
+        });
+        cout << endl << "sweep, easiest to hardest for " << profiles[judge].name << ":" << endl;
+        print_result_header(profiles, profile_count);
+        int best = 2;
+        for (size_t i = 2; i < results.size(); ++i)
+        {
+            print_result(results[i], profile_count);
+            if (fabs(tune_hazard(results[i].outcomes[judge]) - medium) < fabs(tune_hazard(results[best].outcomes[judge]) - medium))
+            {
+                best = (int)i;
+            }
+        }
+        cout << endl << "MEDIUM candidate (" << profiles[judge].name << " hazard closest to " << medium * 100.0 << "%, between EASY and HARD):" << endl;
+        print_result_header(profiles, profile_count);
+        print_result(results[best], profile_count);
+        print_survival(results[0], profiles, profile_count);
+        print_survival(results[best], profiles, profile_count);
+        print_survival(results[1], profiles, profile_count);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << endl << "finished in " << seconds << " s on " << num_threads << " threads" << endl;
+    return 0;
+}
+float tune_gaussian(unsigned int& rng)
+{
+    float u1 = ((xorshift32(rng) >> 8) + 1) / 16777217.f;
+    float u2 = (xorshift32(rng) >> 8) / 16777216.f;
+    return sqrtf(-2.f * logf(u1)) * cosf(6.2831853f * u2);
+}
+int tune_next_pipe(const SimWorld& w, const SimParams& p)
+{
+    for (int i = 0; i < w.pipe_count; ++i)
+    {
+        if (w.pipes[i].x + p.pipe_w - 5.f >= bird_x - p.bird_w / 2.f + 10.f)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+float tune_rise(const SimParams& p)
+{
+    float vel = p.flap_strength;
+    float y = 0.f;
+    float top = 0.f;
+    while (vel < 0.f)
+    {
+        vel += p.gravity;
+        y += vel;
+        top = y < top ? y : top;
+    }
+    return -top;
+}
+void tune_run(const SimParams& p, const TuneProfile& bot, unsigned int seed, TuneOutcome& out)
+{
+    SimWorld w;
+    sim_reset(w, seed);
+    unsigned int rng = seed * 2654435761u + 1u;
+    float threshold = bot.mean + bot.spread * tune_gaussian(rng);
+    int flap_at = -1;
+    float aim = tune_rise(p) / 2.f;
+    long long tick_limit = (long long)(tune_max_score + 2) * p.pipe_interval / (-p.pipe_speed) * 2;
+    bool dead = false;
+    while (w.score < tune_max_score && w.tick < tick_limit)
+    {
+        int next = tune_next_pipe(w, p);
+        float center = next >= 0 ? w.pipes[next].gap_y + p.pipe_gap / 2.f : (height - ground_height) / 2.f;
+        float ahead = w.bird_y + w.bird_vel * bot.delay + p.gravity * bot.delay * (bot.delay + 1) / 2.f;
+        if (flap_at < 0 && w.bird_vel > 0 && ahead - center > aim + threshold)
+        {
+            flap_at = w.tick + bot.delay;
+        }
+        bool flap = flap_at >= 0 && w.tick >= flap_at;
+        if (flap)
+        {
+            flap_at = -1;
+            threshold = bot.mean + bot.spread * tune_gaussian(rng);
+        }
+        if (sim_step(w, p, flap).hit != HIT_NONE)
+        {
+            dead = true;
+            break;
+        }
+    }
+    ++out.runs;
+    out.deaths += dead;
+    out.pipes += w.score;
+    for (int k = 0; k <= w.score && k <= tune_max_score; ++k)
+    {
+        ++out.reached[k];
+    }
+}
+void tune_evaluate(TuneResult& result, const TuneProfile* profiles, int profile_count, int runs)
+{
+    SimParams p;
+    ReachTable table;
+    apply_difficulty(result.stock_hard ? HARD : EASY, p);
+    p.reach = nullptr;
+    p.pipe_gap = result.setting.pipe_gap;
+    p.gravity = result.setting.gravity;
+    p.flap_strength = result.setting.flap_strength;
+    p.pipe_speed = result.setting.pipe_speed;
+    p.pipe_interval = result.setting.pipe_interval;
+    if (!result.stock_hard && reach_build(table, p))
+    {
+        p.reach = &table;
+    }
+    for (int b = 0; b < profile_count; ++b)
+    {
+        result.outcomes[b] = TuneOutcome();
+        for (int r = 0; r < runs; ++r)
+        {
+            tune_run(p, profiles[b], 1000u + (unsigned int)r, result.outcomes[b]);
+        }
+    }
+}
+void tune_worker(TuneJob* job)
+{
+    int count = (int)job->results->size();
+    for (int i = job->next++; i < count; i = job->next++)
+    {
+        tune_evaluate((*job->results)[i], job->profiles, job->profile_count, job->runs);
+    }
+}
+void tune_run_all(vector<TuneResult>& results, const TuneProfile* profiles, int profile_count, int runs, int num_threads)
+{
+    TuneJob job;
+    job.results = &results;
+    job.profiles = profiles;
+    job.profile_count = profile_count;
+    job.runs = runs;
+    job.next = 0;
+    vector<thread> workers;
+    for (int t = 1; t < num_threads; ++t)
+    {
+        workers.emplace_back(tune_worker, &job);
+    }
+    tune_worker(&job);
+    for (thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+double tune_hazard(const TuneOutcome& o)
+{
+    return o.deaths > 0 ? (double)o.deaths / (o.pipes + o.deaths) : 0.0;
+}
+int tune_median(const TuneOutcome& o)
+{
+    int k = 0;
+    while (k < tune_max_score && o.reached[k + 1] * 2 >= o.runs)
+    {
+        ++k;
+    }
+    return k;
+}
+bool tune_calibrate(int count, char* paths[], TuneProfile& human)
+{
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    long long flaps = 0;
+    int used = 0;
+    ObstacleProgram* prog = new ObstacleProgram();
+    ReachTable reach;
+    for (int i = 0; i < count; ++i)
+    {
+        Replay r;
+        if (!load_replay(r, paths[i]))
+        {
+            cout << "skipping " << paths[i] << ": not a replay" << endl;
+            continue;
+        }
+        if (r.pixel_collision)
+        {
+            cout << "skipping " << paths[i] << ": recorded with pixel collision, which needs the game's sprites" << endl;
+            continue;
+        }
+        SimParams p;
+        apply_difficulty((Difficulty)r.difficulty, p, reach);
+        FixedParams fixed;
+        if (r.fixed_point)
+        {
+            fixed_params(p, fixed);
+            p.fixed = &fixed;
+        }
+        if (!r.pattern.empty())
+        {
+            if (!pattern_set_code(*prog, r.pattern.data(), (int)r.pattern.size()))
+            {
+                continue;
+            }
+            p.pattern = prog;
+        }
+        SimWorld w;
+        sim_reset(w, r.seed);
+        size_t f = 0;
+        for (int t = 0; t < r.ticks; ++t)
+        {
+            bool flap = f < r.flap_ticks.size() && r.flap_ticks[f] == t;
+            if (flap)
+            {
+                ++f;
+                int next = tune_next_pipe(w, p);
+                if (next >= 0)
+                {
+                    double offset = w.bird_y - (w.pipes[next].gap_y + p.pipe_gap / 2.0) - tune_rise(p) / 2.0;
+                    sum += offset;
+                    sum_sq += offset * offset;
+                    ++flaps;
+                }
+            }
+            SimStepResult result = p.fixed != nullptr ? fixed_step_world(w, *p.fixed, flap) : sim_step(w, p, flap);
+            if (result.hit != HIT_NONE)
+            {
+                break;
+            }
+        }
+        ++used;
+    }
+    delete prog;
+    if (flaps < 2)
+    {
+        return false;
+    }
+    double mean = sum / flaps;
+    double spread = sqrt(max(0.0, sum_sq / flaps - mean * mean));
+    human.mean = (float)mean;
+    human.spread = (float)spread;
+    cout << "human bot calibrated from " << used << " replays, " << flaps << " flaps: flaps " << mean << " px off the ideal flap height, spread " << spread << " px" << endl;
+    return true;
+}
+void tune_grid(vector<TuneResult>& results)
+{
+    TuneResult stock;
+    SimParams p;
+    for (int d = EASY; d <= HARD; ++d)
+    {
+        apply_difficulty((Difficulty)d, p);
+        stock.setting = { p.pipe_gap, p.gravity, p.flap_strength, p.pipe_speed, p.pipe_interval };
+        stock.stock_hard = d == HARD;
+        results.push_back(stock);
+    }
+    const int gaps[3] = { 110, 130, 150 };
+    const float gravities[3] = { 0.30f, 0.425f, 0.55f };
+    const float flaps[3] = { -7.f, -7.75f, -8.5f };
+    const float speeds[3] = { -2.8f, -3.8f, -4.8f };
+    const int intervals[3] = { 180, 215, 250 };
+    for (int g : gaps)
+    {
+        for (float gravity : gravities)
+        {
+            for (float flap : flaps)
+            {
+                for (float speed : speeds)
+                {
+                    for (int interval : intervals)
+                    {
+                        TuneResult r;
+                        r.setting = { g, gravity, flap, speed, interval };
+                        results.push_back(r);
+                    }
+                }
+            }
+        }
+    }
+}
+void tune_search(double target, const TuneProfile* profiles, int profile_count, int runs, int num_threads, int judge)
+{
+    const double lo[5] = { 100.0, 0.25, -9.5, -5.5, 160.0 };
+    const double hi[5] = { 170.0, 0.60, -5.0, -2.5, 280.0 };
+    double mean[5];
+    double spread[5];
+    for (int k = 0; k < 5; ++k)
+    {
+        mean[k] = (lo[k] + hi[k]) / 2.0;
+        spread[k] = (hi[k] - lo[k]) / 4.0;
+    }
+    unsigned int rng = 12345u;
+    TuneResult best;
+    double best_error = 1e9;
+    cout << "searching for a setting with " << profiles[judge].name << " hazard " << target << "% per pipe" << endl;
+    print_result_header(profiles, profile_count);
+    for (int round = 0; round < tune_search_rounds; ++round)
+    {
+        vector<TuneResult> population(tune_search_population);
+        for (TuneResult& r : population)
+        {
+            double v[5];
+            for (int k = 0; k < 5; ++k)
+            {
+                v[k] = min(hi[k], max(lo[k], mean[k] + spread[k] * tune_gaussian(rng)));
+            }
+            r.setting = { (int)lround(v[0]), (float)v[1], (float)v[2], (float)v[3], (int)lround(v[4]) };
+        }
+        tune_run_all(population, profiles, profile_count, runs, num_threads);
+        sort(population.begin(), population.end(), [target, judge](const TuneResult& a, const TuneResult& b) {
+            return fabs(tune_hazard(a.outcomes[judge]) * 100.0 - target) < fabs(tune_hazard(b.outcomes[judge]) * 100.0 - target);
+        });
+        double error = fabs(tune_hazard(population[0].outcomes[judge]) * 100.0 - target);
+        if (error < best_error)
+        {
+            best_error = error;
+            best = population[0];
+        }
+        for (int k = 0; k < 5; ++k)
+        {
+            double sum = 0.0;
+            double sum_sq = 0.0;
+            for (int e = 0; e < tune_search_elite; ++e)
+            {
+                const TuneSetting& s = population[e].setting;
+                double v = k == 0 ? s.pipe_gap : (k == 1 ? s.gravity : (k == 2 ? s.flap_strength : (k == 3 ? s.pipe_speed : s.pipe_interval)));
+                sum += v;
+                sum_sq += v * v;
+            }
+            mean[k] = sum / tune_search_elite;
+            spread[k] = max(sqrt(max(0.0, sum_sq / tune_search_elite - mean[k] * mean[k])), (hi[k] - lo[k]) / 100.0);
+        }
+        print_result(population[0], profile_count);
+    }
+    cout << endl << "best match:" << endl;
+    print_result_header(profiles, profile_count);
+    print_result(best, profile_count);
+    print_survival(best, profiles, profile_count);
+}
+void print_result_header(const TuneProfile* profiles, int profile_count)
+{
+    cout << "  gap  gravity   flap  speed interval";
+    for (int b = 0; b < profile_count; ++b)
+    {
+        cout << " | " << setw(7) << profiles[b].name << " hazard median";
+    }
+    cout << endl;
+}
+void print_result(const TuneResult& r, int profile_count)
+{
+    cout << fixed << setprecision(3) << setw(5) << r.setting.pipe_gap << setw(9) << r.setting.gravity << setw(7) << r.setting.flap_strength << setw(7)
+         << r.setting.pipe_speed << setw(9) << r.setting.pipe_interval;
+    for (int b = 0; b < profile_count; ++b)
+    {
+        cout << " | " << setw(13) << setprecision(2) << tune_hazard(r.outcomes[b]) * 100.0 << "% " << setw(6) << tune_median(r.outcomes[b]);
+    }
+    cout << defaultfloat << setprecision(6) << (r.stock_hard ? "  (HARD)" : "") << endl;
+}
+void print_survival(const TuneResult& r, const TuneProfile* profiles, int profile_count)
+{
+    const int marks[8] = { 1, 2, 5, 10, 20, 30, 50, 100 };
+    cout << endl << "survival, gap " << r.setting.pipe_gap << " gravity " << r.setting.gravity << " flap " << r.setting.flap_strength << " speed "
+         << r.setting.pipe_speed << " interval " << r.setting.pipe_interval << (r.stock_hard ? " (HARD)" : "") << ":" << endl;
+    cout << "  pipes  ";
+    for (int m : marks)
+    {
+        cout << setw(6) << m;
+    }
+    cout << endl;
+    for (int b = 0; b < profile_count; ++b)
+    {
+        cout << "  " << setw(7) << profiles[b].name;
+        for (int m : marks)
+        {
+            cout << setw(5) << (int)lround(100.0 * r.outcomes[b].reached[m] / r.outcomes[b].runs) << "%";
+        }
+        cout << endl;
+    }
+}